@@ -2,14 +2,21 @@
 
 #include AUDIO_IMPL_HEADER
 
+#include "AudioFileSource.h"
+#include "ProjectMSDLApplication.h"
 #include "ProjectMWrapper.h"
 
 #include "notifications/DisplayToastNotification.h"
 
+#include <Poco/Delegate.h>
 #include <Poco/NotificationCenter.h>
+#include <Poco/NumberParser.h>
+#include <Poco/StringTokenizer.h>
 
 #include <Poco/Util/Application.h>
 
+#include <algorithm>
+
 const char* AudioCapture::name() const
 {
     return "Audio Capturing";
@@ -20,22 +27,82 @@ void AudioCapture::initialize(Poco::Util::Application& app)
     _config = app.config().createView("audio");
 
     auto& projectMWrapper = app.getSubsystem<ProjectMWrapper>();
+    _projectMHandle = projectMWrapper.ProjectM();
 
-    if (!_impl)
+    UpdateGainControl();
+    _mixer.GainControl(&_gainControl);
+
+    auto audioFile = _config->getString("file", "");
+    if (!audioFile.empty())
     {
-        _impl = new AudioCaptureImpl;
+        if (!_fileSource)
+        {
+            _fileSource = new AudioFileSource;
+        }
+
+        _fileSource->GainControl(&_gainControl);
+
+        if (!_fileSource->Open(projectMWrapper.ProjectM(), audioFile))
+        {
+            poco_warning(_logger, "Could not open the configured audio file, capturing from an audio device instead.");
+            delete _fileSource;
+            _fileSource = nullptr;
+        }
     }
 
-    auto deviceList = _impl->AudioDeviceList();
-    int audioDeviceIndex = GetInitialAudioDeviceIndex(deviceList);
+    if (!_fileSource)
+    {
+        if (!_impl)
+        {
+            _impl = new AudioCaptureImpl;
+        }
+
+        _impl->GainControl(&_gainControl);
+
+        auto deviceList = _impl->AudioDeviceList();
+        int audioDeviceIndex = GetInitialAudioDeviceIndex(deviceList);
+
+        PrintDeviceList(deviceList);
+        PublishAudioDeviceList(std::move(deviceList));
+        _deviceListVersion = _impl->AudioDeviceListVersion();
+
+        _stopDeviceThread = false;
+        _deviceThreadResult = _deviceThread();
+        _deviceThreadRunning = true;
+
+        _impl->LatencyOffset(_config->getInt("latencyOffset", 0));
+        _impl->StartRecording(projectMWrapper.ProjectM(), audioDeviceIndex);
 
-    PrintDeviceList(deviceList);
+        UpdateMixDevices();
+    }
 
-    _impl->StartRecording(projectMWrapper.ProjectM(), audioDeviceIndex);
+    _userConfig = dynamic_cast<ProjectMSDLApplication&>(app).UserConfiguration();
+    _userConfig->propertyChanged += Poco::delegate(this, &AudioCapture::OnConfigurationPropertyChanged);
+    _userConfig->propertyRemoved += Poco::delegate(this, &AudioCapture::OnConfigurationPropertyRemoved);
 }
 
 void AudioCapture::uninitialize()
 {
+    _userConfig->propertyRemoved -= Poco::delegate(this, &AudioCapture::OnConfigurationPropertyRemoved);
+    _userConfig->propertyChanged -= Poco::delegate(this, &AudioCapture::OnConfigurationPropertyChanged);
+
+    if (_fileSource)
+    {
+        _fileSource->Close();
+        delete _fileSource;
+        _fileSource = nullptr;
+    }
+
+    if (_deviceThreadRunning)
+    {
+        _stopDeviceThread = true;
+        _deviceEvent.set();
+        _deviceThreadResult.wait();
+        _deviceThreadRunning = false;
+    }
+
+    StopMixDevices();
+
     if (_impl)
     {
         _impl->StopRecording();
@@ -49,6 +116,7 @@ void AudioCapture::NextAudioDevice()
     if (_impl)
     {
         _impl->NextAudioDevice();
+        UpdateMixDevices();
         Poco::NotificationCenter::defaultCenter().postNotification(new DisplayToastNotification(_impl->AudioDeviceName()));
     }
 }
@@ -58,6 +126,7 @@ void AudioCapture::AudioDeviceIndex(int index)
     if (_impl)
     {
         _impl->AudioDeviceIndex(index);
+        UpdateMixDevices();
         Poco::NotificationCenter::defaultCenter().postNotification(new DisplayToastNotification(_impl->AudioDeviceName()));
     }
 }
@@ -74,6 +143,11 @@ int AudioCapture::AudioDeviceIndex() const
 
 std::string AudioCapture::AudioDeviceName() const
 {
+    if (_fileSource)
+    {
+        return _fileSource->Name();
+    }
+
     if (!_impl)
     {
         return {};
@@ -82,24 +156,467 @@ std::string AudioCapture::AudioDeviceName() const
     return _impl->AudioDeviceName();
 }
 
-AudioCapture::AudioDeviceMap AudioCapture::AudioDeviceList()
+std::shared_ptr<const AudioCapture::AudioDeviceMap> AudioCapture::AudioDeviceList() const
 {
-    if (!_impl)
+    auto deviceList = std::atomic_load(&_deviceList);
+    if (!deviceList)
     {
-        return {{-1, "(No audio devices available)"}};
+        static const auto noDevices = std::make_shared<const AudioDeviceMap>(AudioDeviceMap{{-1, "(No audio devices available)"}});
+        return noDevices;
     }
 
-    return _impl->AudioDeviceList();
+    return deviceList;
+}
+
+void AudioCapture::RefreshAudioDeviceList()
+{
+    _deviceListRefreshRequested = true;
+    _deviceEvent.set();
 }
 
 void AudioCapture::FillBuffer()
 {
+    if (_fileSource)
+    {
+        _fileSource->FillBuffer();
+        return;
+    }
+
     if (!_impl)
     {
         return;
     }
 
     _impl->FillBuffer();
+
+    if (!_mixImpls.empty())
+    {
+        if (std::find(_mixImpls.begin(), _mixImpls.end(), nullptr) != _mixImpls.end())
+        {
+            PickUpOpenedMixDevices();
+        }
+
+        for (auto* mixImpl : _mixImpls)
+        {
+            if (mixImpl)
+            {
+                mixImpl->FillBuffer();
+            }
+        }
+
+        _mixer.Mix(_projectMHandle);
+    }
+
+    // Cheap atomic read, the actual enumeration runs in the background.
+    auto deviceListVersion = _impl->AudioDeviceListVersion();
+    if (deviceListVersion != _deviceListVersion)
+    {
+        _deviceListVersion = deviceListVersion;
+        RefreshAudioDeviceList();
+    }
+}
+
+uint64_t AudioCapture::BufferOverruns() const
+{
+    if (!_impl)
+    {
+        return 0;
+    }
+
+    uint64_t overruns = _impl->BufferOverruns();
+    for (const auto* mixImpl : _mixImpls)
+    {
+        if (mixImpl)
+        {
+            overruns += mixImpl->BufferOverruns();
+        }
+    }
+
+    return overruns;
+}
+
+uint64_t AudioCapture::BufferUnderruns() const
+{
+    if (!_impl)
+    {
+        return 0;
+    }
+
+    uint64_t underruns = _impl->BufferUnderruns();
+    for (const auto* mixImpl : _mixImpls)
+    {
+        if (mixImpl)
+        {
+            underruns += mixImpl->BufferUnderruns();
+        }
+    }
+
+    return underruns;
+}
+
+uint32_t AudioCapture::CaptureBufferFrames() const
+{
+    if (!_impl)
+    {
+        return 0;
+    }
+
+    return _impl->CaptureBufferFrames();
+}
+
+double AudioCapture::CallbackRate() const
+{
+    if (!_impl)
+    {
+        return 0.0;
+    }
+
+    return _impl->CallbackRate();
+}
+
+void AudioCapture::Idle(bool idle)
+{
+    if (!_impl)
+    {
+        return;
+    }
+
+    _impl->Idle(idle);
+    for (auto* mixImpl : _mixImpls)
+    {
+        if (mixImpl)
+        {
+            mixImpl->Idle(idle);
+        }
+    }
+}
+
+void AudioCapture::Calibration(bool enabled)
+{
+    if (_impl)
+    {
+        _impl->Calibration(enabled);
+    }
+}
+
+bool AudioCapture::CalibrationClick()
+{
+    if (!_impl)
+    {
+        return false;
+    }
+
+    return _impl->CalibrationClick();
+}
+
+const AudioGainControl& AudioCapture::GainControl() const
+{
+    return _gainControl;
+}
+
+std::vector<std::string> AudioCapture::ParseDeviceSet(const std::string& deviceSet)
+{
+    Poco::StringTokenizer tokenizer(deviceSet, ";", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+    return {tokenizer.begin(), tokenizer.end()};
+}
+
+std::string AudioCapture::FormatDeviceSet(const std::vector<std::string>& devices)
+{
+    std::string deviceSet;
+    for (const auto& device : devices)
+    {
+        if (!deviceSet.empty())
+        {
+            deviceSet += ";";
+        }
+        deviceSet += device;
+    }
+
+    return deviceSet;
+}
+
+void AudioCapture::OnConfigurationPropertyChanged(const Poco::Util::AbstractConfiguration::KeyValue& property)
+{
+    OnConfigurationPropertyRemoved(property.key());
+}
+
+void AudioCapture::OnConfigurationPropertyRemoved(const std::string& key)
+{
+    if (_impl && key == "audio.latencyOffset")
+    {
+        _impl->LatencyOffset(_config->getInt("latencyOffset", 0));
+        for (auto* mixImpl : _mixImpls)
+        {
+            if (mixImpl)
+            {
+                mixImpl->LatencyOffset(_config->getInt("latencyOffset", 0));
+            }
+        }
+    }
+
+    if (_impl && key == "audio.mix.devices")
+    {
+        UpdateMixDevices();
+    }
+
+    if (key == "audio.mix.gains")
+    {
+        UpdateMixGains();
+    }
+
+    if (key.find("audio.agc.") == 0)
+    {
+        UpdateGainControl();
+    }
+}
+
+void AudioCapture::DeviceThread()
+{
+    while (true)
+    {
+        _deviceEvent.wait();
+
+        if (_stopDeviceThread)
+        {
+            break;
+        }
+
+        ProcessMixDeviceRequests();
+
+        if (_deviceListRefreshRequested.exchange(false))
+        {
+            auto deviceList = _impl->AudioDeviceList();
+            poco_debug_f1(_logger, "Audio device list refreshed, %?d devices available.", deviceList.size() - 1);
+            PublishAudioDeviceList(std::move(deviceList));
+        }
+    }
+}
+
+void AudioCapture::PublishAudioDeviceList(AudioDeviceMap deviceList)
+{
+    std::atomic_store(&_deviceList, std::shared_ptr<const AudioDeviceMap>(std::make_shared<AudioDeviceMap>(std::move(deviceList))));
+}
+
+void AudioCapture::UpdateGainControl()
+{
+    _gainControl.Configure(_config->getBool("agc.enabled", false),
+                           _config->getDouble("agc.targetLevel", -18.0),
+                           _config->getInt("agc.attack", 10),
+                           _config->getInt("agc.release", 2000),
+                           _config->getDouble("agc.ceiling", 24.0));
+}
+
+void AudioCapture::UpdateMixDevices()
+{
+    auto deviceList = AudioDeviceList();
+    auto primaryDeviceName = _impl->AudioDeviceName();
+
+    std::vector<AudioCaptureImpl*> mixImpls;
+    std::vector<std::string> mixDevices;
+    std::vector<std::pair<std::string, int>> devicesToOpen;
+
+    for (const auto& device : ParseDeviceSet(_config->getString("mix.devices", "")))
+    {
+        // Entries can be device names or indices, like audio.device.
+        auto deviceEntry = deviceList->end();
+        int deviceIndex;
+        if (Poco::NumberParser::tryParse(device, deviceIndex))
+        {
+            deviceEntry = deviceList->find(deviceIndex);
+        }
+        else
+        {
+            deviceEntry = std::find_if(deviceList->begin(), deviceList->end(), [&device](const AudioDeviceMap::value_type& entry) {
+                return entry.second == device;
+            });
+        }
+
+        if (deviceEntry == deviceList->end() || deviceEntry->first < 0)
+        {
+            poco_warning_f1(_logger, R"(Audio device "%s" in audio.mix.devices is not available, skipping it.)", device);
+            continue;
+        }
+
+        // Also re-checked after each primary device switch, so no device is captured twice.
+        const auto& deviceName = deviceEntry->second;
+        if (deviceName == primaryDeviceName
+            || std::find(mixDevices.begin(), mixDevices.end(), deviceName) != mixDevices.end())
+        {
+            continue;
+        }
+
+        // Keep streams which are already running or being opened, so they don't restart on unrelated changes.
+        AudioCaptureImpl* mixImpl{nullptr};
+        auto existingDevice = std::find(_mixDevices.begin(), _mixDevices.end(), deviceName);
+        if (existingDevice != _mixDevices.end())
+        {
+            auto existingIndex = existingDevice - _mixDevices.begin();
+            mixImpl = _mixImpls[existingIndex];
+            _mixImpls.erase(_mixImpls.begin() + existingIndex);
+            _mixDevices.erase(existingDevice);
+        }
+        else
+        {
+            poco_information_f2(_logger, R"(Mixing in audio from device "%s" (ID %?d).)", deviceName, deviceEntry->first);
+            devicesToOpen.emplace_back(deviceName, deviceEntry->first);
+        }
+
+        mixImpls.push_back(mixImpl);
+        mixDevices.push_back(deviceName);
+    }
+
+    {
+        // Streams still being opened are closed when picked up, as they aren't listed anymore.
+        Poco::FastMutex::ScopedLock lock(_mixDeviceMutex);
+        for (auto* mixImpl : _mixImpls)
+        {
+            if (mixImpl)
+            {
+                _mixImplsToClose.push_back(mixImpl);
+            }
+        }
+        _mixDevicesToOpen.insert(_mixDevicesToOpen.end(), devicesToOpen.begin(), devicesToOpen.end());
+    }
+    _deviceEvent.set();
+
+    _mixImpls = std::move(mixImpls);
+    _mixDevices = std::move(mixDevices);
+
+    ConnectMixer();
+}
+
+void AudioCapture::PickUpOpenedMixDevices()
+{
+    std::vector<std::pair<std::string, AudioCaptureImpl*>> openedMixImpls;
+    {
+        Poco::FastMutex::ScopedLock lock(_mixDeviceMutex);
+        std::swap(openedMixImpls, _openedMixImpls);
+    }
+
+    if (openedMixImpls.empty())
+    {
+        return;
+    }
+
+    std::vector<AudioCaptureImpl*> unusedMixImpls;
+    for (const auto& opened : openedMixImpls)
+    {
+        size_t slot{0};
+        while (slot < _mixDevices.size() && (_mixDevices[slot] != opened.first || _mixImpls[slot] != nullptr))
+        {
+            slot++;
+        }
+
+        if (slot == _mixDevices.size())
+        {
+            unusedMixImpls.push_back(opened.second);
+            continue;
+        }
+
+        _mixImpls[slot] = opened.second;
+        _mixImpls[slot]->Mixer(&_mixer, slot + 1);
+    }
+
+    if (!unusedMixImpls.empty())
+    {
+        Poco::FastMutex::ScopedLock lock(_mixDeviceMutex);
+        _mixImplsToClose.insert(_mixImplsToClose.end(), unusedMixImpls.begin(), unusedMixImpls.end());
+        _deviceEvent.set();
+    }
+}
+
+void AudioCapture::ProcessMixDeviceRequests()
+{
+    std::vector<AudioCaptureImpl*> mixImplsToClose;
+    std::vector<std::pair<std::string, int>> devicesToOpen;
+    {
+        Poco::FastMutex::ScopedLock lock(_mixDeviceMutex);
+        std::swap(mixImplsToClose, _mixImplsToClose);
+        std::swap(devicesToOpen, _mixDevicesToOpen);
+    }
+
+    for (auto* mixImpl : mixImplsToClose)
+    {
+        mixImpl->StopRecording();
+        delete mixImpl;
+    }
+
+    for (const auto& device : devicesToOpen)
+    {
+        auto* mixImpl = new AudioCaptureImpl;
+        mixImpl->LatencyOffset(_config->getInt("latencyOffset", 0));
+        mixImpl->StartRecording(_projectMHandle, device.second);
+
+        Poco::FastMutex::ScopedLock lock(_mixDeviceMutex);
+        _openedMixImpls.emplace_back(device.first, mixImpl);
+    }
+}
+
+void AudioCapture::ConnectMixer()
+{
+    if (_mixImpls.empty())
+    {
+        _impl->Mixer(nullptr, 0);
+        _mixer.Inputs(0);
+        return;
+    }
+
+    // Inputs of streams which are still being opened stay silent until they're picked up.
+    _mixer.Inputs(_mixImpls.size() + 1);
+    _impl->Mixer(&_mixer, 0);
+    for (size_t index = 0; index < _mixImpls.size(); index++)
+    {
+        if (_mixImpls[index])
+        {
+            _mixImpls[index]->Mixer(&_mixer, index + 1);
+        }
+    }
+
+    UpdateMixGains();
+}
+
+void AudioCapture::UpdateMixGains()
+{
+    // Same separator as the device set, the first gain applies to audio.device.
+    auto gains = ParseDeviceSet(_config->getString("mix.gains", ""));
+    for (size_t input = 0; input < _mixer.Inputs(); input++)
+    {
+        double gain{0.0};
+        if (input < gains.size() && !Poco::NumberParser::tryParseFloat(gains[input], gain))
+        {
+            poco_warning_f1(_logger, R"(Invalid gain "%s" in audio.mix.gains, using 0 dB.)", gains[input]);
+            gain = 0.0;
+        }
+
+        _mixer.InputGain(input, gain);
+    }
+}
+
+void AudioCapture::StopMixDevices()
+{
+    for (const auto& opened : _openedMixImpls)
+    {
+        _mixImplsToClose.push_back(opened.second);
+    }
+    for (auto* mixImpl : _mixImpls)
+    {
+        if (mixImpl)
+        {
+            _mixImplsToClose.push_back(mixImpl);
+        }
+    }
+
+    for (auto* mixImpl : _mixImplsToClose)
+    {
+        mixImpl->StopRecording();
+        delete mixImpl;
+    }
+
+    _mixImplsToClose.clear();
+    _openedMixImpls.clear();
+    _mixDevicesToOpen.clear();
+    _mixImpls.clear();
+    _mixDevices.clear();
 }
 
 void AudioCapture::PrintDeviceList(const AudioDeviceMap& deviceList) const
@@ -1,18 +1,43 @@
 #pragma once
 
+#include "AudioGainControl.h"
+#include "AudioMixer.h"
+
+#include <Poco/ActiveMethod.h>
+#include <Poco/Event.h>
 #include <Poco/Logger.h>
+#include <Poco/Mutex.h>
 
 #include <Poco/Util/Subsystem.h>
 #include <Poco/Util/AbstractConfiguration.h>
 
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 class AudioCaptureImpl;
+class AudioFileSource;
+class projectm;
 
 /**
  * @brief Audio capturing proxy class/subsystem.
  *
- * Creates the OS-specific audio recording class and forwards the necessary calls to it.
+ * Creates the OS-specific audio recording class and forwards the necessary calls to it. If an audio file
+ * or pipe is configured, it is read instead of capturing audio from a device.
+ *
+ * Additional devices listed in "audio.mix.devices" are captured at the same time, each by its own capture
+ * implementation instance with a separate ring buffer. Their samples are summed by an AudioMixer on the
+ * render thread before being passed to projectM. Creating and destroying a capture implementation can block
+ * for a long time, so the additional streams are opened and closed on the background thread, and picked up
+ * by the render thread once they're ready.
+ *
+ * The list of audio devices is enumerated once on startup and kept as an immutable snapshot. Enumerating
+ * may require IPC round-trips to the sound server, so the list is only refreshed on a background thread
+ * if the capture implementation reports added or removed devices, or if a refresh is requested.
  */
 class AudioCapture : public Poco::Util::Subsystem
 {
@@ -49,17 +74,158 @@ public:
     std::string AudioDeviceName() const;
 
     /**
-     * @brief Returns a list of currently available audio devices.
+     * @brief Returns the latest snapshot of available audio devices. Never blocks on device enumeration.
      * @return A map with device index/name pairs.
      */
-    AudioDeviceMap AudioDeviceList();
+    std::shared_ptr<const AudioDeviceMap> AudioDeviceList() const;
+
+    /**
+     * @brief Enumerates the audio devices again in the background.
+     */
+    void RefreshAudioDeviceList();
 
     /**
      * @brief Asks the capture client to fill projectM's audio buffer for the next frame.
      */
     void FillBuffer();
 
+    /**
+     * @brief Returns the number of times captured audio data had to be dropped because projectM didn't consume it fast enough.
+     * @return The overrun count for the current device.
+     */
+    uint64_t BufferOverruns() const;
+
+    /**
+     * @brief Returns the number of frames for which less audio data was available than required.
+     * @return The underrun count for the current device.
+     */
+    uint64_t BufferUnderruns() const;
+
+    /**
+     * @brief Returns the buffer size of the main capture device.
+     * @return The number of sample frames delivered per callback, 0 if not available.
+     */
+    uint32_t CaptureBufferFrames() const;
+
+    /**
+     * @brief Returns the measured rate at which the main capture device delivers samples.
+     * @return The number of callbacks per second, 0 if not available.
+     */
+    double CallbackRate() const;
+
+    /**
+     * @brief Tells the capture implementations whether the render loop is idle.
+     *
+     * While idle, frames are rendered at a much lower rate or not at all, so the measured render rate
+     * must not be used to adapt the capture buffer size.
+     *
+     * @param idle True if the render loop is throttled or paused.
+     */
+    void Idle(bool idle);
+
+    /**
+     * @brief Enables or disables the latency calibration mode.
+     *
+     * In calibration mode, clicks in the audio data are detected when passed to projectM, so the GUI
+     * can flash the screen in sync with them and the user can adjust the latency offset until the
+     * flashes match the clicks heard.
+     *
+     * @param enabled True to enable calibration mode.
+     */
+    void Calibration(bool enabled);
+
+    /**
+     * @brief Returns whether a calibration click was passed to projectM since the last call.
+     * @return True if a click was detected.
+     */
+    bool CalibrationClick();
+
+    /**
+     * @brief Returns the automatic gain control applied to all audio sources.
+     * @return The gain control, e.g. to display the current gain and input level.
+     */
+    const AudioGainControl& GainControl() const;
+
+    /**
+     * @brief Splits a semicolon-separated device set, as used in "audio.mix.devices".
+     * @param deviceSet The configuration value.
+     * @return The device names or indices, trimmed and without empty entries.
+     */
+    static std::vector<std::string> ParseDeviceSet(const std::string& deviceSet);
+
+    /**
+     * @brief Joins device names into a semicolon-separated device set.
+     * @param devices The device names.
+     * @return The configuration value.
+     */
+    static std::string FormatDeviceSet(const std::vector<std::string>& devices);
+
 protected:
+    /**
+     * @brief Event callback if a configuration value has changed.
+     * @param property The key and value that has been changed.
+     */
+    void OnConfigurationPropertyChanged(const Poco::Util::AbstractConfiguration::KeyValue& property);
+
+    /**
+     * @brief Event callback if a configuration value has been removed.
+     * @param key The key of the removed property.
+     */
+    void OnConfigurationPropertyRemoved(const std::string& key);
+
+    /**
+     * @brief Worker thread enumerating the audio devices whenever a refresh is requested, and opening
+     *        and closing the additional capture streams.
+     */
+    void DeviceThread();
+
+    /**
+     * @brief Publishes a new device list snapshot.
+     * @param deviceList The new device list.
+     */
+    void PublishAudioDeviceList(AudioDeviceMap deviceList);
+
+    /**
+     * @brief Passes the "audio.agc.*" settings to the gain control.
+     */
+    void UpdateGainControl();
+
+    /**
+     * @brief Requests additional capture streams to be started or stopped to match "audio.mix.devices".
+     *
+     * The primary device is left out, so this must also be called after switching it. Streams for devices
+     * which are still listed keep recording. New streams are added to the mix once the
+     * worker thread has opened them. Render thread only.
+     */
+    void UpdateMixDevices();
+
+    /**
+     * @brief Adds streams opened by the worker thread to the mix, or closes them if no longer needed. Render thread only.
+     */
+    void PickUpOpenedMixDevices();
+
+    /**
+     * @brief Opens the requested additional capture streams and closes the queued ones. Called on the worker thread.
+     */
+    void ProcessMixDeviceRequests();
+
+    /**
+     * @brief Connects the primary and all opened additional streams to the mixer inputs. Render thread only.
+     */
+    void ConnectMixer();
+
+    /**
+     * @brief Passes the "audio.mix.gains" settings to the mixer inputs.
+     */
+    void UpdateMixGains();
+
+    /**
+     * @brief Stops and deletes all additional capture streams, including pending requests.
+     *
+     * Only called after the worker thread has exited.
+     */
+    void StopMixDevices();
+
     /**
      * @brief Prints a list of available audio devices on standard output if requested by the user.
      * @param deviceList The list of available audio devices.
@@ -81,8 +247,30 @@ protected:
     int GetInitialAudioDeviceIndex(const AudioDeviceMap& deviceList);
 
     Poco::AutoPtr<Poco::Util::AbstractConfiguration> _config; //!< View of the "audio" configuration subkey.
+    Poco::AutoPtr<Poco::Util::AbstractConfiguration> _userConfig; //!< The user configuration, used to listen for changes.
 
     AudioCaptureImpl* _impl{}; //!< The OS-specific capture implementation.
+    AudioFileSource* _fileSource{}; //!< File or pipe source, used instead of _impl if audio.file is set.
+    AudioGainControl _gainControl; //!< Automatic gain control, applied by all sources.
+    projectm* _projectMHandle{nullptr}; //!< projectM instance receiving the audio data.
+
+    std::vector<AudioCaptureImpl*> _mixImpls; //!< Additional capture streams mixed with _impl, nullptr while still opening. Render thread only.
+    std::vector<std::string> _mixDevices; //!< Device names captured by _mixImpls, in the same order. Render thread only.
+    AudioMixer _mixer; //!< Sums the streams if capturing from more than one device. Render thread only.
+
+    Poco::FastMutex _mixDeviceMutex; //!< Protects the worker thread requests and results below.
+    std::vector<std::pair<std::string, int>> _mixDevicesToOpen; //!< Name and index of the devices to be opened by the worker thread.
+    std::vector<std::pair<std::string, AudioCaptureImpl*>> _openedMixImpls; //!< Streams opened by the worker thread, not yet picked up.
+    std::vector<AudioCaptureImpl*> _mixImplsToClose; //!< Streams to be stopped and deleted by the worker thread.
+
+    std::shared_ptr<const AudioDeviceMap> _deviceList; //!< Latest device list snapshot, only accessed via std::atomic_load/store.
+    uint64_t _deviceListVersion{0}; //!< Last device list version reported by the capture implementation.
+    std::atomic_bool _deviceListRefreshRequested{false}; //!< Makes the worker thread enumerate the devices.
+    Poco::ActiveMethod<void, void, AudioCapture> _deviceThread{this, &AudioCapture::DeviceThread}; //!< The device worker thread.
+    Poco::ActiveResult<void> _deviceThreadResult{new Poco::ActiveResultHolder<void>()}; //!< Result of the device worker thread.
+    Poco::Event _deviceEvent; //!< Wakes up the device worker thread.
+    std::atomic_bool _stopDeviceThread{false}; //!< Makes the device worker thread exit.
+    bool _deviceThreadRunning{false}; //!< True if the device worker thread was started.
 
     Poco::Logger& _logger{ Poco::Logger::get("AudioCapture") }; //!< The class logger.
 };
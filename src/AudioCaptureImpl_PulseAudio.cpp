@@ -0,0 +1,605 @@
+#include "AudioCaptureImpl_PulseAudio.h"
+
+#include "AudioGainControl.h"
+#include "AudioMixer.h"
+#include "Tracer.h"
+
+#include <Poco/Util/Application.h>
+
+#include <projectM-4/projectM.h>
+
+#include <algorithm>
+
+PulseAudioCapture::PulseAudioCapture()
+    : _maximumFeedFrames(projectm_pcm_get_max_samples())
+{
+    auto fragmentMilliseconds = Poco::Util::Application::instance().config().getInt("audio.pulseaudio.fragmentMilliseconds", 10);
+    _fragmentMilliseconds = static_cast<uint32_t>(std::max(1, std::min(fragmentMilliseconds, 100)));
+
+    // FillBuffer() empties the buffer every frame, except for the samples held back for the latency offset.
+    _ringBuffer.Reset(_sampleFrequency * (RingBufferMilliseconds + MaximumLatencyOffsetMilliseconds) / 1000 * _channels);
+    _fillBuffer.resize(static_cast<size_t>(_maximumFeedFrames) * _channels);
+
+    _mainLoop = pa_threaded_mainloop_new();
+    if (_mainLoop == nullptr)
+    {
+        poco_error(_logger, "Could not create the PulseAudio main loop.");
+        return;
+    }
+
+    if (!CreateContext())
+    {
+        return;
+    }
+
+    if (pa_threaded_mainloop_start(_mainLoop) < 0)
+    {
+        poco_error(_logger, "Could not start the PulseAudio main loop.");
+        return;
+    }
+
+    pa_threaded_mainloop_lock(_mainLoop);
+
+    pa_context_state_t state;
+    while ((state = pa_context_get_state(_context)) != PA_CONTEXT_READY && PA_CONTEXT_IS_GOOD(state))
+    {
+        pa_threaded_mainloop_wait(_mainLoop);
+    }
+
+    if (state == PA_CONTEXT_READY)
+    {
+        _contextReady = true;
+
+        pa_operation_unref(pa_context_subscribe(_context,
+                                                static_cast<pa_subscription_mask_t>(PA_SUBSCRIPTION_MASK_SERVER | PA_SUBSCRIPTION_MASK_SOURCE),
+                                                nullptr, nullptr));
+        WaitForOperation(pa_context_get_server_info(_context, &PulseAudioCapture::ServerInfoCallback, this));
+        WaitForOperation(pa_context_get_source_info_list(_context, &PulseAudioCapture::SourceInfoCallback, this));
+
+        poco_debug_f1(_logger, "Connected to PulseAudio server, fragment size is %?d ms.", _fragmentMilliseconds);
+    }
+    else
+    {
+        poco_error_f1(_logger, "Could not connect to the PulseAudio server: %s", std::string(pa_strerror(pa_context_errno(_context))));
+    }
+
+    pa_threaded_mainloop_unlock(_mainLoop);
+}
+
+PulseAudioCapture::~PulseAudioCapture()
+{
+    if (_mainLoop == nullptr)
+    {
+        return;
+    }
+
+    pa_threaded_mainloop_lock(_mainLoop);
+    DisconnectStream();
+    ReleaseContext();
+    pa_threaded_mainloop_unlock(_mainLoop);
+
+    pa_threaded_mainloop_stop(_mainLoop);
+    pa_threaded_mainloop_free(_mainLoop);
+}
+
+std::map<int, std::string> PulseAudioCapture::AudioDeviceList()
+{
+    std::map<int, std::string> deviceList{
+        {-1, "Default output device (loopback)"}};
+
+    Poco::FastMutex::ScopedLock lock(_sourcesMutex);
+    for (size_t index = 0; index < _sources.size(); index++)
+    {
+        deviceList.insert(std::make_pair(static_cast<int>(index), _sources.at(index).second));
+    }
+
+    return deviceList;
+}
+
+void PulseAudioCapture::StartRecording(projectm* projectMHandle, int audioDeviceIndex)
+{
+    _projectMHandle = projectMHandle;
+    _currentAudioDeviceIndex = audioDeviceIndex;
+
+    if (_mainLoop == nullptr)
+    {
+        return;
+    }
+
+    _overruns = 0;
+    _underruns = 0;
+    _callbackRate = 0.0;
+    _lastCallbackRateUpdate = {};
+
+    // While reconnecting, the stream is connected once the server is back.
+    pa_threaded_mainloop_lock(_mainLoop);
+    _recording = true;
+    if (_contextReady)
+    {
+        ConnectStream();
+    }
+    pa_threaded_mainloop_unlock(_mainLoop);
+
+    poco_debug(_logger, "Started audio recording.");
+}
+
+void PulseAudioCapture::StopRecording()
+{
+    if (_mainLoop == nullptr)
+    {
+        return;
+    }
+
+    pa_threaded_mainloop_lock(_mainLoop);
+    _recording = false;
+    DisconnectStream();
+    pa_threaded_mainloop_unlock(_mainLoop);
+
+    poco_debug(_logger, "Stopped audio recording.");
+}
+
+void PulseAudioCapture::NextAudioDevice()
+{
+    size_t sourceCount;
+    {
+        Poco::FastMutex::ScopedLock lock(_sourcesMutex);
+        sourceCount = _sources.size();
+    }
+
+    // Will wrap around to the default output monitor (-1).
+    int nextAudioDeviceIndex = ((_currentAudioDeviceIndex + 2) % static_cast<int>(sourceCount + 1)) - 1;
+
+    StartRecording(_projectMHandle, nextAudioDeviceIndex);
+}
+
+void PulseAudioCapture::AudioDeviceIndex(int index)
+{
+    {
+        Poco::FastMutex::ScopedLock lock(_sourcesMutex);
+        if (index < -1 || index >= static_cast<int>(_sources.size()))
+        {
+            return;
+        }
+    }
+
+    StartRecording(_projectMHandle, index);
+}
+
+int PulseAudioCapture::AudioDeviceIndex() const
+{
+    return _currentAudioDeviceIndex;
+}
+
+std::string PulseAudioCapture::AudioDeviceName() const
+{
+    int index = _currentAudioDeviceIndex;
+
+    Poco::FastMutex::ScopedLock lock(_sourcesMutex);
+    if (index >= 0 && index < static_cast<int>(_sources.size()))
+    {
+        return _sources.at(index).second;
+    }
+
+    return "Default output device (loopback)";
+}
+
+void PulseAudioCapture::FillBuffer()
+{
+    if (!_recording)
+    {
+        return;
+    }
+
+    Tracer::Scope trace("audio", "FillBuffer");
+
+    if (_contextFailed)
+    {
+        ReconnectIfDue();
+    }
+
+    UpdateCallbackRate();
+
+    size_t framesAvailable = _ringBuffer.Available() / _channels;
+    if (framesAvailable == 0)
+    {
+        _underruns++;
+        return;
+    }
+
+    // The newest samples are held back until the latency offset has passed.
+    if (framesAvailable <= _latencyOffsetFrames)
+    {
+        return;
+    }
+    size_t framesDue = framesAvailable - _latencyOffsetFrames;
+
+    // projectM only keeps its most recent samples anyway, so skip anything older.
+    if (framesDue > _maximumFeedFrames)
+    {
+        _ringBuffer.Skip((framesDue - _maximumFeedFrames) * _channels);
+        framesDue = _maximumFeedFrames;
+    }
+
+    size_t samplesDue = framesDue * _channels;
+    size_t samplesRead;
+    while (samplesDue > 0 && (samplesRead = _ringBuffer.Read(_fillBuffer.data(), std::min(samplesDue, _fillBuffer.size()))) > 0)
+    {
+        samplesDue -= samplesRead;
+
+        if (_mixer)
+        {
+            _mixer->AddSamples(_mixerInput, _fillBuffer.data(), samplesRead / _channels, _channels, _sampleFrequency);
+            continue;
+        }
+
+        if (_gainControl)
+        {
+            _gainControl->Process(_fillBuffer.data(), samplesRead / _channels, _channels, _sampleFrequency);
+        }
+
+        projectm_pcm_add_float(_projectMHandle, _fillBuffer.data(), static_cast<unsigned int>(samplesRead / _channels), PROJECTM_STEREO);
+    }
+}
+
+uint64_t PulseAudioCapture::BufferOverruns() const
+{
+    return _overruns;
+}
+
+uint64_t PulseAudioCapture::BufferUnderruns() const
+{
+    return _underruns;
+}
+
+uint32_t PulseAudioCapture::CaptureBufferFrames() const
+{
+    if (!_recording)
+    {
+        return 0;
+    }
+
+    return _fragmentMilliseconds * _sampleFrequency / 1000;
+}
+
+double PulseAudioCapture::CallbackRate() const
+{
+    return _callbackRate;
+}
+
+void PulseAudioCapture::LatencyOffset(int milliseconds)
+{
+    int offset = std::max(0, std::min(milliseconds, MaximumLatencyOffsetMilliseconds));
+    _latencyOffsetFrames = static_cast<uint32_t>(offset) * _sampleFrequency / 1000;
+}
+
+bool PulseAudioCapture::CreateContext()
+{
+    _context = pa_context_new(pa_threaded_mainloop_get_api(_mainLoop), "projectM");
+    if (_context == nullptr)
+    {
+        poco_error(_logger, "Could not create the PulseAudio context.");
+        return false;
+    }
+
+    pa_context_set_state_callback(_context, &PulseAudioCapture::ContextStateCallback, this);
+    pa_context_set_subscribe_callback(_context, &PulseAudioCapture::SubscribeCallback, this);
+
+    if (pa_context_connect(_context, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0)
+    {
+        poco_error_f1(_logger, "Could not connect to the PulseAudio server: %s", std::string(pa_strerror(pa_context_errno(_context))));
+        return false;
+    }
+
+    return true;
+}
+
+void PulseAudioCapture::ReleaseContext()
+{
+    if (_context == nullptr)
+    {
+        return;
+    }
+
+    pa_context_set_state_callback(_context, nullptr, nullptr);
+    pa_context_set_subscribe_callback(_context, nullptr, nullptr);
+    pa_context_disconnect(_context);
+    pa_context_unref(_context);
+    _context = nullptr;
+}
+
+void PulseAudioCapture::ReconnectIfDue()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now < _nextReconnectTime)
+    {
+        return;
+    }
+
+    _contextFailed = false;
+    _nextReconnectTime = now + std::chrono::milliseconds(_reconnectBackoff.NextDelay());
+
+    // Only starts connecting, the state callback finishes the job on the mainloop thread.
+    pa_threaded_mainloop_lock(_mainLoop);
+    DisconnectStream();
+    ReleaseContext();
+    _reconnecting = true;
+    if (!CreateContext())
+    {
+        _reconnecting = false;
+        _contextFailed = true;
+    }
+    pa_threaded_mainloop_unlock(_mainLoop);
+}
+
+void PulseAudioCapture::ContextReconnected()
+{
+    _contextReady = true;
+    _reconnectBackoff.Reset();
+
+    pa_operation_unref(pa_context_subscribe(_context,
+                                            static_cast<pa_subscription_mask_t>(PA_SUBSCRIPTION_MASK_SERVER | PA_SUBSCRIPTION_MASK_SOURCE),
+                                            nullptr, nullptr));
+    pa_operation_unref(pa_context_get_server_info(_context, &PulseAudioCapture::ServerInfoCallback, this));
+    pa_operation_unref(pa_context_get_source_info_list(_context, &PulseAudioCapture::SourceInfoCallback, this));
+
+    // Uses the previous default sink and source list until the updated ones arrive, which reconnect the stream if required.
+    if (_recording)
+    {
+        ConnectStream();
+    }
+
+    poco_information(_logger, "Reconnected to the PulseAudio server.");
+}
+
+void PulseAudioCapture::UpdateCallbackRate()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (_lastCallbackRateUpdate == std::chrono::steady_clock::time_point())
+    {
+        _lastCallbackRateUpdate = now;
+        _lastCallbacks = _callbacks;
+        return;
+    }
+
+    double elapsedSeconds = std::chrono::duration<double>(now - _lastCallbackRateUpdate).count();
+    if (elapsedSeconds < 1.0)
+    {
+        return;
+    }
+
+    uint64_t callbacks = _callbacks;
+    _callbackRate = static_cast<double>(callbacks - _lastCallbacks) / elapsedSeconds;
+    _lastCallbacks = callbacks;
+    _lastCallbackRateUpdate = now;
+}
+
+void PulseAudioCapture::ConnectStream()
+{
+    DisconnectStream();
+
+    int index = _currentAudioDeviceIndex;
+    {
+        Poco::FastMutex::ScopedLock lock(_sourcesMutex);
+        if (index >= 0 && index < static_cast<int>(_sources.size()))
+        {
+            _streamSource = _sources.at(index).first;
+        }
+        else if (!_defaultSinkName.empty())
+        {
+            _streamSource = _defaultSinkName + ".monitor";
+        }
+        else
+        {
+            // No default sink, let the server pick the default source.
+            _streamSource.clear();
+        }
+    }
+
+    pa_sample_spec sampleSpec{};
+    sampleSpec.format = PA_SAMPLE_FLOAT32NE;
+    sampleSpec.rate = _sampleFrequency;
+    sampleSpec.channels = _channels;
+
+    _stream = pa_stream_new(_context, "projectM visualizer input", &sampleSpec, nullptr);
+    if (_stream == nullptr)
+    {
+        poco_error_f1(_logger, "Could not create the PulseAudio record stream: %s", std::string(pa_strerror(pa_context_errno(_context))));
+        return;
+    }
+
+    pa_stream_set_read_callback(_stream, &PulseAudioCapture::StreamReadCallback, this);
+
+    // Only the fragment size matters for record streams. Small fragments deliver the data in small chunks right away.
+    pa_buffer_attr bufferAttributes{};
+    bufferAttributes.maxlength = static_cast<uint32_t>(-1);
+    bufferAttributes.tlength = static_cast<uint32_t>(-1);
+    bufferAttributes.prebuf = static_cast<uint32_t>(-1);
+    bufferAttributes.minreq = static_cast<uint32_t>(-1);
+    bufferAttributes.fragsize = static_cast<uint32_t>(pa_usec_to_bytes(_fragmentMilliseconds * PA_USEC_PER_MSEC, &sampleSpec));
+
+    if (pa_stream_connect_record(_stream, _streamSource.empty() ? nullptr : _streamSource.c_str(), &bufferAttributes, PA_STREAM_ADJUST_LATENCY) < 0)
+    {
+        poco_error_f2(_logger, R"(Could not record from PulseAudio source "%s": %s)", _streamSource, std::string(pa_strerror(pa_context_errno(_context))));
+        DisconnectStream();
+        return;
+    }
+
+    poco_information_f1(_logger, R"(Recording audio from PulseAudio source "%s".)", _streamSource.empty() ? std::string("default") : _streamSource);
+}
+
+void PulseAudioCapture::DisconnectStream()
+{
+    if (_stream == nullptr)
+    {
+        return;
+    }
+
+    pa_stream_set_read_callback(_stream, nullptr, nullptr);
+    pa_stream_disconnect(_stream);
+    pa_stream_unref(_stream);
+    _stream = nullptr;
+}
+
+void PulseAudioCapture::WaitForOperation(pa_operation* operation)
+{
+    if (operation == nullptr)
+    {
+        return;
+    }
+
+    while (pa_operation_get_state(operation) == PA_OPERATION_RUNNING)
+    {
+        pa_threaded_mainloop_wait(_mainLoop);
+    }
+
+    pa_operation_unref(operation);
+}
+
+void PulseAudioCapture::ContextStateCallback(pa_context* context, void* userData)
+{
+    auto instance = reinterpret_cast<PulseAudioCapture*>(userData);
+
+    auto state = pa_context_get_state(context);
+    if (state == PA_CONTEXT_READY && instance->_reconnecting)
+    {
+        instance->_reconnecting = false;
+        instance->ContextReconnected();
+    }
+    else if (!PA_CONTEXT_IS_GOOD(state) && (instance->_contextReady || instance->_reconnecting))
+    {
+        if (instance->_contextReady)
+        {
+            poco_error_f1(instance->_logger, "Lost connection to the PulseAudio server, reconnecting: %s", std::string(pa_strerror(pa_context_errno(context))));
+        }
+        else
+        {
+            poco_debug_f1(instance->_logger, "Could not reconnect to the PulseAudio server: %s", std::string(pa_strerror(pa_context_errno(context))));
+        }
+
+        // The render thread replaces the context, as it can't be released from within its own callback.
+        instance->_contextReady = false;
+        instance->_reconnecting = false;
+        instance->_contextFailed = true;
+    }
+
+    pa_threaded_mainloop_signal(instance->_mainLoop, 0);
+}
+
+void PulseAudioCapture::SubscribeCallback(pa_context* context, pa_subscription_event_type_t eventType, uint32_t, void* userData)
+{
+    auto instance = reinterpret_cast<PulseAudioCapture*>(userData);
+
+    auto facility = eventType & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+    auto type = eventType & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+
+    if (facility == PA_SUBSCRIPTION_EVENT_SERVER)
+    {
+        // Sent when the default sink or source changes.
+        pa_operation_unref(pa_context_get_server_info(context, &PulseAudioCapture::ServerInfoCallback, instance));
+    }
+    else if (facility == PA_SUBSCRIPTION_EVENT_SOURCE && type != PA_SUBSCRIPTION_EVENT_CHANGE)
+    {
+        pa_operation_unref(pa_context_get_source_info_list(context, &PulseAudioCapture::SourceInfoCallback, instance));
+    }
+}
+
+void PulseAudioCapture::ServerInfoCallback(pa_context*, const pa_server_info* info, void* userData)
+{
+    auto instance = reinterpret_cast<PulseAudioCapture*>(userData);
+
+    bool defaultSinkChanged{false};
+    if (info != nullptr && info->default_sink_name != nullptr)
+    {
+        Poco::FastMutex::ScopedLock lock(instance->_sourcesMutex);
+        defaultSinkChanged = instance->_defaultSinkName != info->default_sink_name;
+        instance->_defaultSinkName = info->default_sink_name;
+    }
+
+    if (defaultSinkChanged && instance->_recording && instance->_currentAudioDeviceIndex == -1)
+    {
+        poco_debug(instance->_logger, "Default output device changed, following it.");
+        instance->ConnectStream();
+    }
+
+    pa_threaded_mainloop_signal(instance->_mainLoop, 0);
+}
+
+void PulseAudioCapture::SourceInfoCallback(pa_context*, const pa_source_info* info, int eol, void* userData)
+{
+    auto instance = reinterpret_cast<PulseAudioCapture*>(userData);
+
+    if (eol == 0 && info != nullptr)
+    {
+        instance->_pendingSources.emplace_back(info->name, info->description != nullptr ? info->description : info->name);
+        return;
+    }
+
+    bool sourceLost{false};
+    {
+        Poco::FastMutex::ScopedLock lock(instance->_sourcesMutex);
+        if (eol > 0)
+        {
+            std::swap(instance->_sources, instance->_pendingSources);
+            instance->_deviceListVersion++;
+        }
+        instance->_pendingSources.clear();
+
+        // Indices may have shifted, keep pointing to the same source if it still exists.
+        if (instance->_currentAudioDeviceIndex >= 0)
+        {
+            auto source = std::find_if(instance->_sources.begin(), instance->_sources.end(),
+                                       [instance](const std::pair<std::string, std::string>& entry) {
+                                           return entry.first == instance->_streamSource;
+                                       });
+            if (source != instance->_sources.end())
+            {
+                instance->_currentAudioDeviceIndex = static_cast<int>(source - instance->_sources.begin());
+            }
+            else
+            {
+                instance->_currentAudioDeviceIndex = -1;
+                sourceLost = true;
+            }
+        }
+    }
+
+    if (sourceLost && instance->_recording)
+    {
+        poco_information(instance->_logger, "Audio source was removed, falling back to the default output device.");
+        instance->ConnectStream();
+    }
+
+    pa_threaded_mainloop_signal(instance->_mainLoop, 0);
+}
+
+void PulseAudioCapture::StreamReadCallback(pa_stream* stream, size_t, void* userData)
+{
+    auto instance = reinterpret_cast<PulseAudioCapture*>(userData);
+    instance->_callbacks++;
+
+    Tracer::RegisterThread("PulseAudio");
+    Tracer::Scope trace("audio", "AudioInputCallback");
+
+    const void* data;
+    size_t bytes;
+    while (pa_stream_readable_size(stream) > 0)
+    {
+        if (pa_stream_peek(stream, &data, &bytes) < 0 || bytes == 0)
+        {
+            break;
+        }
+
+        // data is NULL for holes in the stream, which are skipped.
+        if (data != nullptr)
+        {
+            size_t sampleCount = bytes / sizeof(float);
+            sampleCount -= sampleCount % _channels;
+            if (instance->_ringBuffer.Write(static_cast<const float*>(data), sampleCount) < sampleCount)
+            {
+                instance->_overruns++;
+            }
+        }
+
+        pa_stream_drop(stream);
+    }
+}
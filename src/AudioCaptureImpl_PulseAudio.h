@@ -0,0 +1,300 @@
+#pragma once
+
+#include "AudioRingBuffer.h"
+#include "ReconnectBackoff.h"
+
+#include <pulse/pulseaudio.h>
+
+#include <Poco/Logger.h>
+#include <Poco/Mutex.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AudioGainControl;
+class AudioMixer;
+class projectm;
+
+/**
+ * @brief PulseAudio-based audio capturing thread.
+ *
+ * Uses the PulseAudio asynchronous API to capture from the monitor source of the default output device
+ * (loopback), or from any other source. Also works with PipeWire's PulseAudio server.
+ *
+ * The "default" device follows the server's default sink, so switching the output device in the desktop
+ * mixer automatically switches capturing to the new device's monitor. Sources which are added or removed
+ * are picked up immediately. If the selected source disappears, capturing falls back to the default monitor.
+ *
+ * Compared to SDL, the fragment size can be configured and the data doesn't pass through another buffer,
+ * which considerably lowers the capture latency.
+ *
+ * Used by the SDL capture implementation if built with PulseAudio support and the server is reachable on
+ * startup. If the connection is lost later on, it is reestablished in the background.
+ */
+class PulseAudioCapture
+{
+public:
+    PulseAudioCapture();
+
+    ~PulseAudioCapture();
+
+    /**
+     * @brief Returns whether the server connection is currently established.
+     * @return True if connected to the PulseAudio server.
+     */
+    bool Connected() const
+    {
+        return _contextReady;
+    }
+
+    /**
+     * @brief Returns a map of available recording devices.
+     * @return A vector of available audio device IDs and names.
+     */
+    std::map<int, std::string> AudioDeviceList();
+
+    /**
+     * @brief Starts audio capturing with the first available device.
+     * @param projectMHandle projectM instance handle that will receive the captured data.
+     * @param audioDeviceIndex The initial audio device ID to capture from. Use -1 to select the monitor of the
+     *                         default output device.
+     */
+    void StartRecording(projectm* projectMHandle, int audioDeviceIndex);
+
+    /**
+     * @brief Stops audio recording.
+     */
+    void StopRecording();
+
+    /**
+     * @brief Switches to the next available audio recording device.
+     */
+    void NextAudioDevice();
+
+    /**
+     * @brief Activates the audio device with the given idnex for recording.
+     * @param index The index, as listed by @a AudioDeviceList()
+     */
+    void AudioDeviceIndex(int index);
+
+    /**
+     * @brief Returns the currently used Audio device index.
+     * @return The index of the current audio device, as listed by @a AudioDeviceList()
+     */
+    int AudioDeviceIndex() const;
+
+    /**
+     * @brief Retrieves the current audio device name.
+     * @return The name of the currently selected audio recording device.
+     */
+    std::string AudioDeviceName() const;
+
+    /**
+     * @brief Returns a counter which is incremented whenever devices are added or removed.
+     * @return The device list version.
+     */
+    uint64_t AudioDeviceListVersion() const
+    {
+        return _deviceListVersion;
+    }
+
+    /**
+     * @brief Passes the samples captured since the last call to projectM. Must be called on the render thread.
+     *
+     * If the latency offset is set, the most recent samples are kept in the buffer until they are due.
+     * Also reconnects to the server if the connection was lost.
+     */
+    void FillBuffer();
+
+    /**
+     * @brief Sets the gain control applied to the samples before passing them to projectM.
+     * @param gainControl The gain control instance, or nullptr to pass the samples unchanged.
+     */
+    void GainControl(AudioGainControl* gainControl)
+    {
+        _gainControl = gainControl;
+    }
+
+    /**
+     * @brief Passes the samples to a mixer input instead of projectM, if capturing from several devices.
+     * @param mixer The mixer, or nullptr to pass the samples to projectM directly.
+     * @param input The mixer input index.
+     */
+    void Mixer(AudioMixer* mixer, size_t input)
+    {
+        _mixer = mixer;
+        _mixerInput = input;
+    }
+
+    /**
+     * @brief Returns the number of times captured samples were dropped because the ring buffer was full.
+     * @return The overrun count since the recording was started.
+     */
+    uint64_t BufferOverruns() const;
+
+    /**
+     * @brief Returns the number of frames for which no new audio data was available.
+     * @return The underrun count since the recording was started.
+     */
+    uint64_t BufferUnderruns() const;
+
+    /**
+     * @brief Returns the requested fragment size, which determines how often new samples arrive.
+     * @return The fragment size in sample frames, 0 if not recording.
+     */
+    uint32_t CaptureBufferFrames() const;
+
+    /**
+     * @brief Returns the measured rate at which the server delivers samples.
+     * @return The number of read callbacks per second, averaged over the last second.
+     */
+    double CallbackRate() const;
+
+    /**
+     * @brief Sets the audio/visual latency offset.
+     *
+     * The samples are delayed by keeping the offset's worth of data in the ring buffer. As the server
+     * delivers the data in fragments, the delay is only accurate to about one fragment.
+     *
+     * @param milliseconds The offset in milliseconds, clamped to 0 to MaximumLatencyOffsetMilliseconds.
+     */
+    void LatencyOffset(int milliseconds);
+
+    /**
+     * @brief Calibration mode is not supported with PulseAudio, click detection is only implemented for SDL.
+     */
+    void Calibration(bool)
+    {
+    }
+
+    /**
+     * @brief Calibration mode is not supported with PulseAudio.
+     * @return Always false.
+     */
+    bool CalibrationClick()
+    {
+        return false;
+    }
+
+    static constexpr int MaximumLatencyOffsetMilliseconds{1000}; //!< Largest supported latency offset.
+
+protected:
+    /**
+     * @brief Creates a new context and starts connecting it to the server.
+     * @return True if connecting was started, false if it failed right away.
+     * @note The mainloop lock must be held, or the mainloop must not be running yet.
+     */
+    bool CreateContext();
+
+    /**
+     * @brief Disconnects and releases the context without invoking its callbacks anymore.
+     * @note The mainloop lock must be held, or the mainloop must not be running.
+     */
+    void ReleaseContext();
+
+    /**
+     * @brief Replaces a failed context with a new one, at most once per backoff delay. Render thread only.
+     */
+    void ReconnectIfDue();
+
+    /**
+     * @brief Subscribes to server changes and requests the device state after reconnecting.
+     * @note Must be called on the mainloop thread.
+     */
+    void ContextReconnected();
+
+    /**
+     * @brief Creates and connects the record stream for the current device index.
+     * @note The mainloop lock must be held, or the method must be called on the mainloop thread.
+     */
+    void ConnectStream();
+
+    /**
+     * @brief Disconnects and releases the record stream.
+     * @note The mainloop lock must be held, or the method must be called on the mainloop thread.
+     */
+    void DisconnectStream();
+
+    /**
+     * @brief Waits for an asynchronous operation to complete and releases it.
+     * @param operation The operation to wait for. Its callback must signal the mainloop.
+     * @note The mainloop lock must be held.
+     */
+    void WaitForOperation(pa_operation* operation);
+
+    /**
+     * @brief Updates the measured callback rate about once per second. Render thread only.
+     */
+    void UpdateCallbackRate();
+
+    /**
+     * @brief Wakes up threads waiting for the context to connect, and tracks connection loss and reconnection.
+     */
+    static void ContextStateCallback(pa_context* context, void* userData);
+
+    /**
+     * @brief Requests updated server info or source lists after the server sent a change event.
+     */
+    static void SubscribeCallback(pa_context* context, pa_subscription_event_type_t eventType, uint32_t index, void* userData);
+
+    /**
+     * @brief Stores the default sink name and follows it if recording from the default output device.
+     */
+    static void ServerInfoCallback(pa_context* context, const pa_server_info* info, void* userData);
+
+    /**
+     * @brief Collects the source list and replaces the current list once complete.
+     */
+    static void SourceInfoCallback(pa_context* context, const pa_source_info* info, int eol, void* userData);
+
+    /**
+     * @brief Copies the received samples into the ring buffer.
+     */
+    static void StreamReadCallback(pa_stream* stream, size_t bytes, void* userData);
+
+    projectm* _projectMHandle{nullptr}; //!< Handle if the projectM instance that will receive the audio data.
+    AudioGainControl* _gainControl{nullptr}; //!< Gain control applied before passing samples to projectM.
+    AudioMixer* _mixer{nullptr}; //!< Mixer receiving the samples instead of projectM, if set.
+    size_t _mixerInput{0}; //!< Mixer input index of this stream.
+    std::atomic_int _currentAudioDeviceIndex{-1}; //!< Currently selected audio device index.
+    std::atomic_bool _recording{false}; //!< True between StartRecording() and StopRecording().
+
+    pa_threaded_mainloop* _mainLoop{nullptr}; //!< PulseAudio event loop thread.
+    pa_context* _context{nullptr}; //!< Server connection.
+    pa_stream* _stream{nullptr}; //!< The record stream, or nullptr if not recording.
+    std::string _streamSource; //!< Name of the source the stream is connected to.
+    std::atomic_bool _contextReady{false}; //!< True while the context is connected.
+    std::atomic_bool _contextFailed{false}; //!< Set by the mainloop thread if the connection was lost or reconnecting failed.
+    bool _reconnecting{false}; //!< True while a replacement context is connecting. Mainloop lock only.
+    ReconnectBackoff _reconnectBackoff; //!< Delay between reconnection attempts. Reset by the mainloop thread once connected.
+    std::chrono::steady_clock::time_point _nextReconnectTime; //!< Earliest time for the next reconnection attempt. Render thread only.
+
+    mutable Poco::FastMutex _sourcesMutex; //!< Protects _defaultSinkName, _sources and _pendingSources.
+    std::string _defaultSinkName; //!< Name of the server's default sink.
+    std::vector<std::pair<std::string, std::string>> _sources; //!< Available sources, name and description.
+    std::vector<std::pair<std::string, std::string>> _pendingSources; //!< Source list being received. Mainloop thread only.
+    std::atomic<uint64_t> _deviceListVersion{0}; //!< Incremented whenever a new source list was received.
+
+    AudioRingBuffer _ringBuffer; //!< Interleaved stereo samples written by the mainloop thread and read by FillBuffer().
+    std::vector<float> _fillBuffer; //!< Scratch buffer used to pass samples from the ring buffer to projectM.
+    uint32_t _maximumFeedFrames{0}; //!< projectM's PCM buffer size. Older samples are skipped.
+    uint32_t _latencyOffsetFrames{0}; //!< Number of most recent sample frames held back to apply the latency offset.
+    std::atomic<uint64_t> _overruns{0}; //!< Number of read callbacks which couldn't store all samples.
+    std::atomic<uint64_t> _underruns{0}; //!< Number of FillBuffer() calls without new samples.
+    std::atomic<uint64_t> _callbacks{0}; //!< Number of read callbacks.
+    uint64_t _lastCallbacks{0}; //!< Callback count at the last rate update.
+    std::chrono::steady_clock::time_point _lastCallbackRateUpdate; //!< Time of the last rate update.
+    double _callbackRate{0.0}; //!< Measured callbacks per second.
+
+    constexpr static uint32_t _sampleFrequency{44100}; //!< Sample frequency. PulseAudio resamples the source if required.
+    constexpr static uint32_t _channels{2}; //!< Channel count. PulseAudio remaps the source if required.
+    constexpr static int RingBufferMilliseconds{500}; //!< Ring buffer headroom in addition to the maximum latency offset.
+    uint32_t _fragmentMilliseconds{10}; //!< Requested fragment size, determines how often new data arrives.
+
+    Poco::Logger& _logger{Poco::Logger::get("AudioCapture.PulseAudio")}; //!< The class logger.
+};
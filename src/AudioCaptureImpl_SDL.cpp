@@ -1,34 +1,87 @@
 #include "AudioCaptureImpl_SDL.h"
 
+#ifdef USE_PULSEAUDIO
+#include "AudioCaptureImpl_PulseAudio.h"
+#endif
+
+#include "AudioGainControl.h"
+#include "AudioMixer.h"
+#include "Tracer.h"
+
 #include <Poco/Util/Application.h>
 
 #include <projectM-4/projectM.h>
 
+#include <algorithm>
+#include <cmath>
+
 AudioCaptureImpl::AudioCaptureImpl()
-    : _requestedSampleCount(projectm_pcm_get_max_samples())
+    : _deviceThread(this, &AudioCaptureImpl::DeviceThread)
+    , _maximumFeedFrames(projectm_pcm_get_max_samples())
 {
-    auto targetFps = Poco::Util::Application::instance().config().getUInt("projectM.fps", 60);
-    if (targetFps > 0)
+#ifdef USE_PULSEAUDIO
+    _pulseAudio.reset(new PulseAudioCapture);
+    if (_pulseAudio->Connected())
     {
-        _requestedSampleCount = std::min(_requestedSampleFrequency / targetFps, _requestedSampleCount);
-        // Don't let the buffer get too small to prevent excessive updates calls.
-        // 300 samples is enough for 144 FPS.
-        _requestedSampleCount = std::max(_requestedSampleCount, 300U);
+        return;
     }
 
+    poco_information(_logger, "PulseAudio server is not available, capturing audio via SDL instead.");
+    _pulseAudio.reset();
+#endif
+
+    auto& config = Poco::Util::Application::instance().config();
+
+    // With an unlimited frame rate, start with 60 FPS until the actual rate has been measured.
+    auto targetFps = config.getDouble("projectM.fps", 60.0);
+    _requestedSampleCount = BufferSizeForFrameRate(targetFps > 0.0 ? targetFps : 60.0);
+    _adaptiveBufferSize = config.getBool("audio.sdl.adaptiveBufferSize", true);
+
+    // The buffer is never reset while recording, as devices are switched without stopping. Besides some
+    // headroom for scheduling jitter, it must be able to hold the maximum latency offset.
+    size_t ringBufferFrames = _requestedSampleFrequency * (RingBufferMilliseconds + MaximumLatencyOffsetMilliseconds) / 1000;
+    _ringBuffer.Reset(ringBufferFrames * _channels);
+    _fillBuffer.resize(FillBufferFrames * _channels);
+
 #ifdef SDL_HINT_AUDIO_INCLUDE_MONITORS
     SDL_SetHint(SDL_HINT_AUDIO_INCLUDE_MONITORS, "1");
 #endif
     SDL_InitSubSystem(SDL_INIT_AUDIO);
+    SDL_AddEventWatch(&AudioCaptureImpl::AudioDeviceEventWatch, this);
+
+    _deviceThreadResult = _deviceThread();
 }
 
 AudioCaptureImpl::~AudioCaptureImpl()
 {
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        // SDL was never initialized.
+        return;
+    }
+#endif
+
+    SDL_DelEventWatch(&AudioCaptureImpl::AudioDeviceEventWatch, this);
+
+    StopRecording();
+
+    _stopDeviceThread = true;
+    _deviceThreadEvent.set();
+    _deviceThreadResult.wait();
+
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
 }
 
 std::map<int, std::string> AudioCaptureImpl::AudioDeviceList()
 {
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->AudioDeviceList();
+    }
+#endif
+
     std::map<int, std::string> deviceList{
         {-1, "Default capturing device"}};
 
@@ -52,67 +105,454 @@ std::map<int, std::string> AudioCaptureImpl::AudioDeviceList()
 
 void AudioCaptureImpl::StartRecording(projectm* projectMHandle, int audioDeviceIndex)
 {
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->StartRecording(projectMHandle, audioDeviceIndex);
+        return;
+    }
+#endif
+
     _projectMHandle = projectMHandle;
-    _currentAudioDeviceIndex = audioDeviceIndex;
+    _recording = true;
+    _filling = false;
+    _overruns = 0;
+    _underruns = 0;
+    _callbackRate = 0.0;
+    _lastCallbackRateUpdate = {};
+    _bufferSizeMismatchSince = {};
 
-    if (OpenAudioDevice())
-    {
-        SDL_PauseAudioDevice(_currentAudioDeviceID, false);
+    RequestAudioDevice(audioDeviceIndex);
 
-        poco_debug(_logger, "Started audio recording.");
-    }
+    poco_debug(_logger, "Started audio recording.");
 }
 
 void AudioCaptureImpl::StopRecording()
 {
-    if (_currentAudioDeviceID)
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->StopRecording();
+        return;
+    }
+#endif
+
+    if (!_recording)
     {
-        SDL_PauseAudioDevice(_currentAudioDeviceID, true);
-        SDL_CloseAudioDevice(_currentAudioDeviceID);
-        _currentAudioDeviceID = 0;
+        return;
+    }
+
+    _recording = false;
 
-        poco_debug(_logger, "Stopped audio recording and closed device.");
+    if (_currentDevice)
+    {
+        // Waits for a running callback to finish, so the device won't touch the ring buffer anymore.
+        SDL_LockAudioDevice(_currentDevice->id);
+        _currentDevice->active = false;
+        SDL_UnlockAudioDevice(_currentDevice->id);
     }
+
+    {
+        Poco::FastMutex::ScopedLock lock(_deviceMutex);
+        _openRequested = false;
+        if (_openedDevice)
+        {
+            _devicesToClose.push_back(std::move(_openedDevice));
+        }
+    }
+
+    CloseAudioDeviceAsync(std::move(_currentDevice));
+    CloseAudioDeviceAsync(std::move(_pendingDevice));
+    _bufferFrames = 0;
+
+    poco_debug(_logger, "Stopped audio recording.");
 }
 
 void AudioCaptureImpl::NextAudioDevice()
 {
-    StopRecording();
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->NextAudioDevice();
+        return;
+    }
+#endif
 
     // Will wrap around to default capture device (-1).
     int nextAudioDeviceId = ((_currentAudioDeviceIndex + 2) % (SDL_GetNumAudioDevices(true) + 1)) - 1;
 
-    StartRecording(_projectMHandle, nextAudioDeviceId);
+    AudioDeviceIndex(nextAudioDeviceId);
 }
 
 void AudioCaptureImpl::AudioDeviceIndex(int index)
 {
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->AudioDeviceIndex(index);
+        return;
+    }
+#endif
+
     if (index >= -1 && index < SDL_GetNumAudioDevices(true))
     {
-        _currentAudioDeviceIndex = index;
-        StartRecording(_projectMHandle, index);
+        RequestAudioDevice(index);
     }
 }
 
 int AudioCaptureImpl::AudioDeviceIndex() const
 {
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->AudioDeviceIndex();
+    }
+#endif
+
     return _currentAudioDeviceIndex;
 }
 
 std::string AudioCaptureImpl::AudioDeviceName() const
 {
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->AudioDeviceName();
+    }
+#endif
+
     if (_currentAudioDeviceIndex >= 0)
     {
-        return SDL_GetAudioDeviceName(_currentAudioDeviceIndex, true);
+        auto deviceName = SDL_GetAudioDeviceName(_currentAudioDeviceIndex, true);
+        if (deviceName != nullptr)
+        {
+            return deviceName;
+        }
     }
-    else
+
+    return "Default capturing device";
+}
+
+uint64_t AudioCaptureImpl::AudioDeviceListVersion() const
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->AudioDeviceListVersion();
+    }
+#endif
+
+    return _deviceListVersion;
+}
+
+void AudioCaptureImpl::GainControl(AudioGainControl* gainControl)
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->GainControl(gainControl);
+        return;
+    }
+#endif
+
+    _gainControl = gainControl;
+}
+
+void AudioCaptureImpl::Mixer(AudioMixer* mixer, size_t input)
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->Mixer(mixer, input);
+        return;
+    }
+#endif
+
+    _mixer = mixer;
+    _mixerInput = input;
+}
+
+void AudioCaptureImpl::RequestAudioDevice(int index)
+{
+    _currentAudioDeviceIndex = index;
+
+    {
+        Poco::FastMutex::ScopedLock lock(_deviceMutex);
+        _requestedIndex = index;
+        _openRequested = true;
+    }
+
+    _deviceThreadEvent.set();
+}
+
+void AudioCaptureImpl::CloseAudioDeviceAsync(std::unique_ptr<CaptureDevice> device)
+{
+    if (!device)
+    {
+        return;
+    }
+
+    {
+        Poco::FastMutex::ScopedLock lock(_deviceMutex);
+        _devicesToClose.push_back(std::move(device));
+    }
+
+    _deviceThreadEvent.set();
+}
+
+void AudioCaptureImpl::UpdateAudioDevice()
+{
+    HandleDeviceListChange();
+
+    {
+        Poco::FastMutex::ScopedLock lock(_deviceMutex);
+        if (_openedDevice)
+        {
+            // A newer device replaces one which is still waiting for data.
+            if (_pendingDevice)
+            {
+                _devicesToClose.push_back(std::move(_pendingDevice));
+                _deviceThreadEvent.set();
+            }
+            _pendingDevice = std::move(_openedDevice);
+        }
+
+        if (_openFailed)
+        {
+            // Keep recording from the previous device.
+            _openFailed = false;
+            _currentAudioDeviceIndex = _currentDevice ? _currentDevice->index : -1;
+        }
+    }
+
+    if (_pendingDevice &&
+        (_pendingDevice->delivering || !_currentDevice ||
+         std::chrono::steady_clock::now() - _pendingDevice->openedTime > SwitchTimeout))
+    {
+        ActivatePendingDevice();
+    }
+}
+
+void AudioCaptureImpl::ActivatePendingDevice()
+{
+    if (_currentDevice)
+    {
+        // Waits for a running callback to finish, so only one device writes into the ring buffer at any time.
+        SDL_LockAudioDevice(_currentDevice->id);
+        _currentDevice->active = false;
+        SDL_UnlockAudioDevice(_currentDevice->id);
+
+        CloseAudioDeviceAsync(std::move(_currentDevice));
+    }
+
+    _currentDevice = std::move(_pendingDevice);
+    _callbackSampleCount = _currentDevice->callbackSampleCount;
+    _bufferFrames = _currentDevice->bufferFrames;
+    _currentDevice->active = true;
+
+    poco_debug_f1(_logger, R"(Now recording from audio device "%s".)",
+                  _currentDevice->name.empty() ? std::string("System default capturing device") : _currentDevice->name);
+}
+
+void AudioCaptureImpl::HandleDeviceListChange()
+{
+    if (!_deviceListChanged.exchange(false) || !_recording)
+    {
+        return;
+    }
+
+    // Indices shift when devices come and go, so look up the recording device by name.
+    if (_currentDevice && _currentDevice->index >= 0)
+    {
+        int deviceCount = SDL_GetNumAudioDevices(true);
+        for (int index = 0; index < deviceCount; index++)
+        {
+            auto deviceName = SDL_GetAudioDeviceName(index, true);
+            if (deviceName != nullptr && _currentDevice->name == deviceName)
+            {
+                _currentDevice->index = index;
+                break;
+            }
+        }
+
+        if (!_pendingDevice)
+        {
+            _currentAudioDeviceIndex = _currentDevice->index;
+        }
+    }
+
+    if (_currentDevice && SDL_GetAudioDeviceStatus(_currentDevice->id) == SDL_AUDIO_STOPPED)
+    {
+        poco_warning_f1(_logger, R"(Audio device "%s" was removed, falling back to the default capturing device.)",
+                        _currentDevice->name.empty() ? std::string("System default capturing device") : _currentDevice->name);
+
+        _currentDevice->active = false;
+        CloseAudioDeviceAsync(std::move(_currentDevice));
+        RequestAudioDevice(-1);
+        return;
+    }
+
+    if (!_currentDevice && !_pendingDevice)
+    {
+        bool opening;
+        {
+            Poco::FastMutex::ScopedLock lock(_deviceMutex);
+            opening = _openRequested || _opening || _openedDevice;
+        }
+
+        // Nothing is recording, e.g. because no device was available before. Try again.
+        if (!opening)
+        {
+            RequestAudioDevice(_currentAudioDeviceIndex);
+        }
+    }
+}
+
+void AudioCaptureImpl::AdaptBufferSize(std::chrono::steady_clock::time_point now)
+{
+    if (!_adaptiveBufferSize || _idle || !_currentDevice || _pendingDevice || _framePeriod <= 0.0)
+    {
+        _bufferSizeMismatchSince = {};
+        return;
+    }
+
+    auto idealSampleCount = BufferSizeForFrameRate(1.0 / _framePeriod);
+    double ratio = static_cast<double>(idealSampleCount) / _requestedSampleCount;
+    if (ratio < BufferSizeHysteresis && ratio > 1.0 / BufferSizeHysteresis)
+    {
+        _bufferSizeMismatchSince = {};
+        return;
+    }
+
+    // Short frame rate changes, e.g. while loading a preset, shouldn't reopen the device.
+    if (_bufferSizeMismatchSince == std::chrono::steady_clock::time_point())
+    {
+        _bufferSizeMismatchSince = now;
+        return;
+    }
+
+    if (now - _bufferSizeMismatchSince < BufferSizeSettleTime)
+    {
+        return;
+    }
+
+    {
+        Poco::FastMutex::ScopedLock lock(_deviceMutex);
+        if (_openRequested || _opening || _openedDevice)
+        {
+            // Don't replace a device switch requested by the user.
+            return;
+        }
+    }
+
+    poco_debug_f3(_logger, "Render rate changed to %.1f FPS, reopening audio device with a buffer size of %?d instead of %?d sample frames.",
+                  1.0 / _framePeriod, idealSampleCount, _requestedSampleCount.load());
+
+    _requestedSampleCount = idealSampleCount;
+    _bufferSizeMismatchSince = {};
+
+    // The current device keeps recording until the reopened one delivers data.
+    RequestAudioDevice(_currentDevice->index);
+}
+
+void AudioCaptureImpl::UpdateCallbackRate(std::chrono::steady_clock::time_point now)
+{
+    if (_lastCallbackRateUpdate == std::chrono::steady_clock::time_point())
+    {
+        _lastCallbackRateUpdate = now;
+        _lastCallbacks = _callbacks;
+        return;
+    }
+
+    double elapsedSeconds = std::chrono::duration<double>(now - _lastCallbackRateUpdate).count();
+    if (elapsedSeconds < 1.0)
+    {
+        return;
+    }
+
+    uint64_t callbacks = _callbacks;
+    _callbackRate = static_cast<double>(callbacks - _lastCallbacks) / elapsedSeconds;
+    _lastCallbacks = callbacks;
+    _lastCallbackRateUpdate = now;
+}
+
+uint32_t AudioCaptureImpl::BufferSizeForFrameRate(double framesPerSecond) const
+{
+    auto sampleCount = static_cast<uint32_t>(_requestedSampleFrequency / framesPerSecond);
+
+    // Larger blocks than projectM keeps are useless, and too small ones cause excessive callbacks.
+    return std::max(std::min(sampleCount, _maximumFeedFrames), MinimumBufferFrames);
+}
+
+void AudioCaptureImpl::DeviceThread()
+{
+    Tracer::RegisterThread("SDL audio devices");
+
+    while (true)
     {
-        return "Default capturing device";
+        _deviceThreadEvent.wait();
+
+        CloseQueuedDevices();
+
+        if (_stopDeviceThread)
+        {
+            break;
+        }
+
+        int index;
+        {
+            Poco::FastMutex::ScopedLock lock(_deviceMutex);
+            if (!_openRequested)
+            {
+                continue;
+            }
+            index = _requestedIndex;
+            _openRequested = false;
+            _opening = true;
+        }
+
+        auto device = OpenAudioDevice(index);
+
+        {
+            Poco::FastMutex::ScopedLock lock(_deviceMutex);
+            _opening = false;
+
+            if (_openRequested || !_recording)
+            {
+                // Superseded by a newer request or recording was stopped in the meantime.
+                if (device)
+                {
+                    _devicesToClose.push_back(std::move(device));
+                }
+                _deviceThreadEvent.set();
+            }
+            else if (device)
+            {
+                if (_openedDevice)
+                {
+                    _devicesToClose.push_back(std::move(_openedDevice));
+                    _deviceThreadEvent.set();
+                }
+                _openedDevice = std::move(device);
+            }
+            else
+            {
+                _openFailed = true;
+            }
+        }
     }
+
+    CloseQueuedDevices();
 }
 
-bool AudioCaptureImpl::OpenAudioDevice()
+std::unique_ptr<AudioCaptureImpl::CaptureDevice> AudioCaptureImpl::OpenAudioDevice(int index)
 {
+    Tracer::Scope trace("audio", "OpenAudioDevice");
+
+    std::unique_ptr<CaptureDevice> device(new CaptureDevice);
+    device->owner = this;
+    device->index = index;
+
     SDL_AudioSpec requestedSpecs{};
     SDL_AudioSpec actualSpecs{};
 
@@ -121,39 +561,413 @@ bool AudioCaptureImpl::OpenAudioDevice()
     requestedSpecs.channels = 2;
     requestedSpecs.samples = _requestedSampleCount;
     requestedSpecs.callback = AudioCaptureImpl::AudioInputCallback;
-    requestedSpecs.userdata = this;
+    requestedSpecs.userdata = device.get();
 
     // Will be NULL on error, which happens if the requested index is -1. This automatically selects the default device.
-    auto deviceName = SDL_GetAudioDeviceName(_currentAudioDeviceIndex, true);
-    _currentAudioDeviceID = SDL_OpenAudioDevice(deviceName, true, &requestedSpecs, &actualSpecs, 0);
+    auto deviceName = SDL_GetAudioDeviceName(index, true);
+    if (deviceName != nullptr)
+    {
+        device->name = deviceName;
+    }
 
-    if (_currentAudioDeviceID == 0)
+    // Take whatever rate, format and channel count the device delivers natively and convert it ourselves.
+    device->id = SDL_OpenAudioDevice(deviceName, true, &requestedSpecs, &actualSpecs,
+                                     SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+
+    PCMConverter::SampleFormat sampleFormat{PCMConverter::SampleFormat::F32};
+    if (device->id != 0 && !ConverterSampleFormat(actualSpecs.format, sampleFormat))
+    {
+        // Format not supported by the converter, let SDL convert it to float.
+        SDL_CloseAudioDevice(device->id);
+        device->id = SDL_OpenAudioDevice(deviceName, true, &requestedSpecs, &actualSpecs,
+                                         SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+        sampleFormat = PCMConverter::SampleFormat::F32;
+    }
+
+    if (device->id == 0)
     {
         poco_error_f3(_logger, R"(Failed to open audio device "%s" (ID %?d): %s)",
                       std::string(deviceName != nullptr ? deviceName : "System default capturing device"),
-                      _currentAudioDeviceIndex,
+                      index,
                       std::string(SDL_GetError()));
-        return false;
+        return {};
     }
 
-    _channels = actualSpecs.channels;
+    device->frameSize = SDL_AUDIO_BITSIZE(actualSpecs.format) / 8 * actualSpecs.channels;
+    device->bufferFrames = actualSpecs.samples;
+    device->converter.Configure(sampleFormat, actualSpecs.channels, actualSpecs.freq, _requestedSampleFrequency, actualSpecs.samples);
+    device->convertedBuffer.resize(device->converter.MaximumOutputFrames() * PCMConverter::OutputChannels);
+    device->callbackSampleCount = static_cast<uint32_t>(device->converter.MaximumOutputFrames());
+    device->openedTime = std::chrono::steady_clock::now();
 
     poco_information_f4(_logger, R"(Opened audio recording device "%s" (ID %?d) with %?d channels at %?d Hz.)",
                         std::string(deviceName != nullptr ? deviceName : "System default capturing device"),
-                        _currentAudioDeviceIndex,
+                        index,
                         actualSpecs.channels,
                         actualSpecs.freq);
+    poco_debug_f1(_logger, "Audio device buffer size is %?d sample frames.", actualSpecs.samples);
+    if (device->converter.Resampling())
+    {
+        poco_debug_f2(_logger, "Resampling audio from %?d Hz to %?d Hz.", actualSpecs.freq, _requestedSampleFrequency);
+    }
+
+    // Start right away. The callback discards the data until the render thread activates the device.
+    SDL_PauseAudioDevice(device->id, false);
+
+    return device;
+}
+
+void AudioCaptureImpl::CloseQueuedDevices()
+{
+    std::vector<std::unique_ptr<CaptureDevice>> devices;
+    {
+        Poco::FastMutex::ScopedLock lock(_deviceMutex);
+        std::swap(devices, _devicesToClose);
+    }
+
+    for (const auto& device : devices)
+    {
+        // Blocks until the device's audio thread has finished.
+        SDL_CloseAudioDevice(device->id);
 
-    return true;
+        poco_debug_f1(_logger, R"(Closed audio device "%s".)",
+                      device->name.empty() ? std::string("System default capturing device") : device->name);
+    }
 }
 
 void AudioCaptureImpl::AudioInputCallback(void* userData, unsigned char* stream, int len)
 {
     poco_assert_dbg(userData);
+    auto device = reinterpret_cast<CaptureDevice*>(userData);
+
+    device->delivering = true;
+    if (!device->active)
+    {
+        return;
+    }
+
+    auto instance = device->owner;
+    instance->_callbacks++;
+
+    // SDL calls back as soon as a block is complete, so this is close to the capture time of its last sample.
+    auto captureTime = std::chrono::steady_clock::now();
+
+    Tracer::RegisterThread("SDL audio");
+    Tracer::Scope trace("audio", "AudioInputCallback");
+
+    size_t inputFrames = static_cast<size_t>(len) / device->frameSize;
+    size_t maximumInputFrames = device->converter.MaximumInputFrames();
+    bool overrun{false};
+
+    while (inputFrames > 0)
+    {
+        size_t blockFrames = std::min(inputFrames, maximumInputFrames);
+        size_t sampleCount = device->converter.Process(stream, blockFrames, device->convertedBuffer.data()) * instance->_channels;
+        stream += blockFrames * device->frameSize;
+        inputFrames -= blockFrames;
+
+        // Only store whole sample frames, dropping the newest data if the render thread falls behind.
+        size_t freeSpace = instance->_ringBuffer.FreeSpace();
+        if (freeSpace < sampleCount)
+        {
+            sampleCount = freeSpace - freeSpace % instance->_channels;
+            overrun = true;
+        }
+
+        instance->_ringBuffer.Write(device->convertedBuffer.data(), sampleCount);
+        instance->_writtenFrames += sampleCount / instance->_channels;
+    }
+
+    if (overrun)
+    {
+        instance->_overruns++;
+    }
+
+    instance->PublishCaptureTimestamp(instance->_writtenFrames, captureTime);
+}
+
+int AudioCaptureImpl::AudioDeviceEventWatch(void* userData, SDL_Event* event)
+{
     auto instance = reinterpret_cast<AudioCaptureImpl*>(userData);
 
-    unsigned int samples = len / sizeof(float) / instance->_channels;
+    if ((event->type == SDL_AUDIODEVICEADDED || event->type == SDL_AUDIODEVICEREMOVED) && event->adevice.iscapture)
+    {
+        instance->_deviceListChanged = true;
+        instance->_deviceListVersion++;
+    }
+
+    return 0;
+}
+
+bool AudioCaptureImpl::ConverterSampleFormat(SDL_AudioFormat format, PCMConverter::SampleFormat& sampleFormat)
+{
+    switch (format)
+    {
+        case AUDIO_S16SYS:
+            sampleFormat = PCMConverter::SampleFormat::S16;
+            return true;
+
+        case AUDIO_S32SYS:
+            sampleFormat = PCMConverter::SampleFormat::S32;
+            return true;
+
+        case AUDIO_F32SYS:
+            sampleFormat = PCMConverter::SampleFormat::F32;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void AudioCaptureImpl::FillBuffer()
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->FillBuffer();
+        return;
+    }
+#endif
+
+    Tracer::Scope trace("audio", "FillBuffer");
+
+    UpdateAudioDevice();
+    if (!_currentDevice)
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (_filling)
+    {
+        _framePeriod = 0.9 * _framePeriod + 0.1 * std::chrono::duration<double>(now - _lastFillTime).count();
+    }
+    else
+    {
+        _framePeriod = static_cast<double>(_callbackSampleCount) / _requestedSampleFrequency;
+        _filling = true;
+    }
+    _lastFillTime = now;
+
+    UpdateCallbackRate(now);
+    AdaptBufferSize(now);
+
+    CaptureTimestamp timestamp;
+    if (!LatestCaptureTimestamp(timestamp))
+    {
+        return;
+    }
+
+    // The frame rendered now is displayed about one frame period later. Find the sample captured at
+    // that time minus the latency offset, extrapolating from the newest block's timestamp.
+    auto targetTime = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(_framePeriod)) - _latencyOffset;
+    int64_t targetFrame = static_cast<int64_t>(timestamp.endFrame) +
+                          std::llround(std::chrono::duration<double>(targetTime - timestamp.time).count() * _requestedSampleFrequency);
+
+    // Without offset, the target is always a bit ahead of the captured data. Only count it as an underrun
+    // if it's further ahead than the callback interval and frame time can explain.
+    int64_t availableEndFrame = static_cast<int64_t>(_consumedFrames + _ringBuffer.Available() / _channels);
+    int64_t allowedGap = static_cast<int64_t>(2 * _callbackSampleCount + _framePeriod * _requestedSampleFrequency);
+    if (targetFrame > availableEndFrame + allowedGap)
+    {
+        _underruns++;
+    }
+
+    targetFrame = std::min(targetFrame, availableEndFrame);
+    if (targetFrame <= static_cast<int64_t>(_consumedFrames))
+    {
+        // Offset was increased, wait until the data is due.
+        return;
+    }
+
+    // projectM only keeps its most recent samples anyway, so skip anything older.
+    auto framesDue = static_cast<size_t>(targetFrame - static_cast<int64_t>(_consumedFrames));
+    if (framesDue > _maximumFeedFrames)
+    {
+        auto framesSkipped = _ringBuffer.Skip((framesDue - _maximumFeedFrames) * _channels) / _channels;
+        _consumedFrames += framesSkipped;
+        framesDue -= framesSkipped;
+    }
+
+    size_t samplesDue = framesDue * _channels;
+    while (samplesDue > 0)
+    {
+        size_t samplesRead = _ringBuffer.Read(_fillBuffer.data(), std::min(samplesDue, _fillBuffer.size()));
+        if (samplesRead == 0)
+        {
+            break;
+        }
+
+        if (_calibrating)
+        {
+            DetectCalibrationClick(_fillBuffer.data(), samplesRead);
+        }
+
+        if (_mixer)
+        {
+            _mixer->AddSamples(_mixerInput, _fillBuffer.data(), samplesRead / _channels, _channels, _requestedSampleFrequency);
+        }
+        else
+        {
+            if (_gainControl)
+            {
+                _gainControl->Process(_fillBuffer.data(), samplesRead / _channels, _channels, _requestedSampleFrequency);
+            }
+
+            projectm_pcm_add_float(_projectMHandle, _fillBuffer.data(), static_cast<unsigned int>(samplesRead / _channels),
+                                   static_cast<projectm_channels>(_channels));
+        }
+        _consumedFrames += samplesRead / _channels;
+        samplesDue -= samplesRead;
+    }
+}
+
+uint64_t AudioCaptureImpl::BufferOverruns() const
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->BufferOverruns();
+    }
+#endif
+
+    return _overruns;
+}
+
+uint64_t AudioCaptureImpl::BufferUnderruns() const
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->BufferUnderruns();
+    }
+#endif
+
+    return _underruns;
+}
+
+uint32_t AudioCaptureImpl::CaptureBufferFrames() const
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->CaptureBufferFrames();
+    }
+#endif
+
+    return _bufferFrames;
+}
+
+double AudioCaptureImpl::CallbackRate() const
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->CallbackRate();
+    }
+#endif
+
+    return _callbackRate;
+}
+
+void AudioCaptureImpl::Idle(bool idle)
+{
+    if (idle == _idle)
+    {
+        return;
+    }
+
+    // Restarts the frame period measurement with the next FillBuffer() call.
+    _idle = idle;
+    _filling = false;
+    _bufferSizeMismatchSince = {};
+}
+
+void AudioCaptureImpl::LatencyOffset(int milliseconds)
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->LatencyOffset(milliseconds);
+        return;
+    }
+#endif
+
+    _latencyOffset = std::chrono::milliseconds(std::max(0, std::min(milliseconds, MaximumLatencyOffsetMilliseconds)));
+}
+
+void AudioCaptureImpl::Calibration(bool enabled)
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        _pulseAudio->Calibration(enabled);
+        return;
+    }
+#endif
+
+    _calibrating = enabled;
+    _calibrationClick = false;
+    _calibrationLevel = 0.0f;
+}
+
+bool AudioCaptureImpl::CalibrationClick()
+{
+#ifdef USE_PULSEAUDIO
+    if (_pulseAudio)
+    {
+        return _pulseAudio->CalibrationClick();
+    }
+#endif
+
+    bool click = _calibrationClick;
+    _calibrationClick = false;
+    return click;
+}
+
+void AudioCaptureImpl::PublishCaptureTimestamp(uint64_t endFrame, std::chrono::steady_clock::time_point time)
+{
+    // Seqlock: readers retry if the sequence number is odd or has changed while reading.
+    auto sequence = _timestampSequence.load(std::memory_order_relaxed);
+    _timestampSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _timestampEndFrame.store(endFrame, std::memory_order_relaxed);
+    _timestampTime.store(time.time_since_epoch().count(), std::memory_order_relaxed);
+
+    _timestampSequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool AudioCaptureImpl::LatestCaptureTimestamp(CaptureTimestamp& timestamp) const
+{
+    uint32_t sequenceBefore;
+    uint32_t sequenceAfter;
+    do
+    {
+        sequenceBefore = _timestampSequence.load(std::memory_order_acquire);
+        timestamp.endFrame = _timestampEndFrame.load(std::memory_order_relaxed);
+        timestamp.time = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(_timestampTime.load(std::memory_order_relaxed)));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        sequenceAfter = _timestampSequence.load(std::memory_order_relaxed);
+    } while ((sequenceBefore & 1) != 0 || sequenceBefore != sequenceAfter);
+
+    return timestamp.endFrame > 0;
+}
+
+void AudioCaptureImpl::DetectCalibrationClick(const float* samples, size_t count)
+{
+    float peak{0.0f};
+    for (size_t sample = 0; sample < count; sample++)
+    {
+        peak = std::max(peak, std::abs(samples[sample]));
+    }
+
+    // A click is a loud peak well above the slowly decaying level of the previous ones.
+    if (peak > CalibrationClickThreshold && peak > _calibrationLevel * 4.0f)
+    {
+        _calibrationClick = true;
+    }
 
-    projectm_pcm_add_float(instance->_projectMHandle, reinterpret_cast<float*>(stream), samples,
-                           static_cast<projectm_channels>(instance->_channels));
+    _calibrationLevel = std::max(peak, _calibrationLevel * 0.95f);
 }
@@ -1,18 +1,48 @@
 #pragma once
 
+#include "AudioRingBuffer.h"
+#include "PCMConverter.h"
+
 #include <SDL2/SDL.h>
 
+#include <Poco/ActiveMethod.h>
+#include <Poco/Event.h>
 #include <Poco/Logger.h>
+#include <Poco/Mutex.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+class AudioGainControl;
+class AudioMixer;
 class projectm;
 
+#ifdef USE_PULSEAUDIO
+class PulseAudioCapture;
+#endif
+
 /**
  * @brief SDL-based audio capturing thread.
  *
  * Uses SDL's audio API to capture PCM data from any supported drivers.
+ *
+ * Opening an audio device can take hundreds of milliseconds with some drivers, so devices are opened
+ * and closed on a separate worker thread. When switching devices, the previous device keeps recording
+ * until the new one delivers its first samples, so the audio passed to projectM never stops. Devices
+ * which are added or removed are picked up via SDL's hot-plug events. If the recording device is
+ * removed, capturing falls back to the default device.
+ *
+ * The device buffer size determines how often SDL delivers new samples. Ideally, one block arrives per
+ * rendered frame. The initial size is derived from the configured frame rate, and then follows the measured
+ * render rate. As reopening a device takes time, the buffer size is only changed if it is off by a large
+ * factor for several seconds. The device is then reopened like when switching devices, so there's no gap.
+ *
+ * If built with PulseAudio support, capturing is passed on to PulseAudioCapture if the PulseAudio server
+ * is reachable on startup. SDL is only used if it isn't, e.g. on ALSA-only systems.
  */
 class AudioCaptureImpl
 {
@@ -28,7 +58,10 @@ public:
     std::map<int, std::string> AudioDeviceList();
 
     /**
-     * @brief Starts audio capturing with the first available device.
+     * @brief Starts audio capturing with the given device.
+     *
+     * The device is opened asynchronously, capturing starts once it's ready.
+     *
      * @param projectMHandle projectM instance handle that will receive the captured data.
      * @param audioDeviceIndex The initial audio device ID to capture from. Use -1 to select the implementation's
      *                      default device.
@@ -36,7 +69,7 @@ public:
     void StartRecording(projectm* projectMHandle, int audioDeviceIndex);
 
     /**
-     * @brief Stops audio recording.
+     * @brief Stops audio recording. The devices are closed asynchronously.
      */
     void StopRecording();
 
@@ -47,6 +80,9 @@ public:
 
     /**
      * @brief Activates the audio device with the given idnex for recording.
+     *
+     * The current device keeps recording until the new one is open and delivers data.
+     *
      * @param index The index, as listed by @a AudioDeviceList()
      */
     void AudioDeviceIndex(int index);
@@ -63,40 +99,308 @@ public:
      */
     std::string AudioDeviceName() const;
 
+    /**
+     * @brief Returns a counter which is incremented whenever devices are added or removed.
+     * @return The device list version.
+     */
+    uint64_t AudioDeviceListVersion() const;
+
     /**
      * @brief Asks the capture client to fill projectM's audio buffer for the next frame.
      *
-     * As of now, SDL uses async callbacks to directly fill projectM's audio buffer.
+     * SDL delivers the samples asynchronously into a ring buffer. This method passes the samples
+     * which are due for this frame, based on the time since the last call, to projectM. Must be
+     * called on the render thread.
+     */
+    void FillBuffer();
+
+    /**
+     * @brief Sets the gain control applied to the samples before passing them to projectM.
+     * @param gainControl The gain control instance, or nullptr to pass the samples unchanged.
+     */
+    void GainControl(AudioGainControl* gainControl);
+
+    /**
+     * @brief Passes the samples to a mixer input instead of projectM, if capturing from several devices.
+     * @param mixer The mixer, or nullptr to pass the samples to projectM directly.
+     * @param input The mixer input index.
+     */
+    void Mixer(AudioMixer* mixer, size_t input);
+
+    /**
+     * @brief Returns the number of callbacks which had to drop samples because the ring buffer was full.
+     * @return The overrun count since the device was opened.
+     */
+    uint64_t BufferOverruns() const;
+
+    /**
+     * @brief Returns the number of frames which got less audio data than was due.
+     * @return The underrun count since the device was opened.
+     */
+    uint64_t BufferUnderruns() const;
+
+    /**
+     * @brief Returns the buffer size of the recording device.
+     * @return The number of sample frames per callback at the device's sample rate, 0 if not recording.
+     */
+    uint32_t CaptureBufferFrames() const;
+
+    /**
+     * @brief Returns the measured rate at which the recording device delivers samples.
+     * @return The number of callbacks per second, averaged over the last second.
+     */
+    double CallbackRate() const;
+
+    /**
+     * @brief Suspends buffer size adaptation while the render loop is idle.
+     *
+     * The frame period measured while idle says nothing about the render rate once rendering resumes,
+     * so it is measured anew after each transition.
+     *
+     * @param idle True if the render loop is throttled or paused.
+     */
+    void Idle(bool idle);
+
+    /**
+     * @brief Sets the audio/visual latency offset.
+     *
+     * Delays the audio passed to projectM, so the visuals match the sound if it reaches the listeners
+     * later than the capture device, e.g. through a separate PA system.
      *
-     * @todo Store audio samples internally and push them to projectM when requested.
+     * @param milliseconds The offset in milliseconds, clamped to 0 to MaximumLatencyOffsetMilliseconds.
+     */
+    void LatencyOffset(int milliseconds);
+
+    /**
+     * @brief Enables or disables click detection used to calibrate the latency offset.
+     * @param enabled True to detect clicks in the audio passed to projectM.
      */
-    void FillBuffer(){};
+    void Calibration(bool enabled);
+
+    /**
+     * @brief Returns whether a click was passed to projectM since the last call, if calibrating.
+     * @return True if a click was detected.
+     */
+    bool CalibrationClick();
+
+    static constexpr int MaximumLatencyOffsetMilliseconds{1000}; //!< Largest supported latency offset.
 
 protected:
     /**
-     * @brief Opens the SDL audio device with the currently selected index.
-     * @return
+     * @brief An opened SDL audio device and its conversion state.
+     *
+     * Only the active device writes into the ring buffer. Inactive devices just flag that they
+     * deliver data and discard it.
+     */
+    struct CaptureDevice {
+        AudioCaptureImpl* owner{nullptr}; //!< The capture implementation receiving the data.
+        SDL_AudioDeviceID id{0}; //!< SDL device ID, 0 if not opened.
+        int index{-1}; //!< Device index the device was opened with, -1 for the default device.
+        std::string name; //!< Device name, empty for the default device.
+        size_t frameSize{0}; //!< Size of one sample frame as delivered by the device, in bytes.
+        uint32_t bufferFrames{0}; //!< Device buffer size in sample frames, as returned by SDL.
+        uint32_t callbackSampleCount{0}; //!< Maximum sample frames stored per callback, after resampling.
+        PCMConverter converter; //!< Converts the device's native format to 44.1 kHz float stereo.
+        std::vector<float> convertedBuffer; //!< Output buffer of the converter.
+        std::atomic_bool active{false}; //!< True if the callback writes into the ring buffer.
+        std::atomic_bool delivering{false}; //!< True after the first callback.
+        std::chrono::steady_clock::time_point openedTime; //!< Time the device was opened.
+    };
+
+    /**
+     * @brief Asks the worker thread to open the device with the given index.
+     *
+     * Requests made while another device is still being opened replace the earlier request.
+     *
+     * @param index The device index, -1 for the default device.
+     */
+    void RequestAudioDevice(int index);
+
+    /**
+     * @brief Passes a device to the worker thread for closing.
+     * @param device The device to close. Must be inactive.
      */
-    bool OpenAudioDevice();
+    void CloseAudioDeviceAsync(std::unique_ptr<CaptureDevice> device);
+
+    /**
+     * @brief Picks up newly opened devices and activates them once they deliver data. Render thread only.
+     */
+    void UpdateAudioDevice();
+
+    /**
+     * @brief Makes the pending device write into the ring buffer and closes the previous device.
+     */
+    void ActivatePendingDevice();
+
+    /**
+     * @brief Reacts to added or removed devices. Render thread only.
+     */
+    void HandleDeviceListChange();
+
+    /**
+     * @brief Reopens the device with a new buffer size if the render rate has changed considerably. Render thread only.
+     * @param now The current time.
+     */
+    void AdaptBufferSize(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Updates the measured callback rate about once per second. Render thread only.
+     * @param now The current time.
+     */
+    void UpdateCallbackRate(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Calculates the device buffer size delivering one block per rendered frame.
+     * @param framesPerSecond The render rate.
+     * @return The buffer size in sample frames.
+     */
+    uint32_t BufferSizeForFrameRate(double framesPerSecond) const;
+
+    /**
+     * @brief Worker thread opening and closing audio devices.
+     */
+    void DeviceThread();
+
+    /**
+     * @brief Opens the SDL audio device with the given index and starts it. Called on the worker thread.
+     * @param index The device index, -1 for the default device.
+     * @return The opened device, or nullptr if the device could not be opened.
+     */
+    std::unique_ptr<CaptureDevice> OpenAudioDevice(int index);
+
+    /**
+     * @brief Closes all devices queued for closing. Called on the worker thread.
+     */
+    void CloseQueuedDevices();
 
     /**
      * @brief SDL audio capture callback.
      *
-     * Called everytime if there is new data available in the audio recording buffer.
+     * Called everytime if there is new data available in the audio recording buffer. Only copies
+     * the data into the ring buffer, as projectM must not be accessed outside the render thread.
      *
-     * @param userData
-     * @param stream
-     * @param len
+     * @param userData The CaptureDevice the data was recorded from.
+     * @param stream The recorded samples in the device format.
+     * @param len The length of the data in bytes.
      */
     static void AudioInputCallback(void* userData, unsigned char* stream, int len);
 
+    /**
+     * @brief SDL event watch flagging audio device hot-plug events. May be called on any thread.
+     * @param userData The AudioCaptureImpl instance.
+     * @param event The SDL event.
+     * @return Always 0, the return value is ignored for event watches.
+     */
+    static int AudioDeviceEventWatch(void* userData, SDL_Event* event);
+
+    /**
+     * @brief Maps an SDL audio format to the converter's sample format.
+     * @param format The SDL audio format.
+     * @param sampleFormat Receives the converter sample format.
+     * @return True if the converter supports the format.
+     */
+    static bool ConverterSampleFormat(SDL_AudioFormat format, PCMConverter::SampleFormat& sampleFormat);
+
+    /**
+     * @brief Capture timestamp of the most recent block.
+     */
+    struct CaptureTimestamp {
+        uint64_t endFrame{0}; //!< Total number of sample frames written to the ring buffer, including this block.
+        std::chrono::steady_clock::time_point time; //!< Capture time of the block's last sample frame.
+    };
+
+    /**
+     * @brief Publishes the timestamp of a newly captured block. Called on the audio thread.
+     * @param endFrame Total number of sample frames written, including the block.
+     * @param time Capture time of the block's last sample frame.
+     */
+    void PublishCaptureTimestamp(uint64_t endFrame, std::chrono::steady_clock::time_point time);
+
+    /**
+     * @brief Reads the latest capture timestamp. Never waits for the audio thread.
+     * @param timestamp Receives the timestamp.
+     * @return True if any audio was captured yet.
+     */
+    bool LatestCaptureTimestamp(CaptureTimestamp& timestamp) const;
+
+    /**
+     * @brief Checks the samples passed to projectM for a calibration click.
+     * @param samples Interleaved samples.
+     * @param count Number of samples.
+     */
+    void DetectCalibrationClick(const float* samples, size_t count);
+
     projectm* _projectMHandle{nullptr}; //!< Handle if the projectM instance that will receive the audio data.
-    int32_t _currentAudioDeviceIndex{-1}; //!< Currently selected audio device index.
-    SDL_AudioDeviceID _currentAudioDeviceID{0}; //!< Device ID of the currently opened audio device.
-    uint32_t _channels{2};
+    AudioGainControl* _gainControl{nullptr}; //!< Gain control applied before passing samples to projectM.
+    AudioMixer* _mixer{nullptr}; //!< Mixer receiving the samples instead of projectM, if set.
+    size_t _mixerInput{0}; //!< Mixer input index of this stream.
+    int32_t _currentAudioDeviceIndex{-1}; //!< Currently selected audio device index, updated right away when switching.
+    uint32_t _channels{PCMConverter::OutputChannels}; //!< Channels stored in the ring buffer, always the converter's output channel count.
+    std::atomic_bool _recording{false}; //!< True between StartRecording() and StopRecording().
+
+    std::unique_ptr<CaptureDevice> _currentDevice; //!< The device writing into the ring buffer. Render thread only.
+    std::unique_ptr<CaptureDevice> _pendingDevice; //!< Opened device waiting for its first data. Render thread only.
+    std::atomic_bool _deviceListChanged{false}; //!< Set by the event watch if a capture device was added or removed.
+    std::atomic<uint64_t> _deviceListVersion{0}; //!< Incremented by the event watch if a capture device was added or removed.
+
+    Poco::FastMutex _deviceMutex; //!< Protects the worker thread requests and results below.
+    bool _openRequested{false}; //!< True if the worker thread should open _requestedIndex.
+    bool _opening{false}; //!< True while a request is being processed.
+    int _requestedIndex{-1}; //!< Index of the device to open.
+    std::unique_ptr<CaptureDevice> _openedDevice; //!< Device opened by the worker thread, not yet picked up.
+    bool _openFailed{false}; //!< True if the last requested device could not be opened.
+    std::vector<std::unique_ptr<CaptureDevice>> _devicesToClose; //!< Inactive devices to be closed by the worker thread.
+
+    Poco::ActiveMethod<void, void, AudioCaptureImpl> _deviceThread; //!< Active method running the device worker thread.
+    Poco::ActiveResult<void> _deviceThreadResult{new Poco::ActiveResultHolder<void>()}; //!< Result of the worker thread.
+    Poco::Event _deviceThreadEvent; //!< Wakes up the worker thread.
+    std::atomic_bool _stopDeviceThread{false}; //!< Makes the worker thread exit.
+
+    AudioRingBuffer _ringBuffer; //!< Interleaved samples written by AudioInputCallback() and read by FillBuffer().
+    std::vector<float> _fillBuffer; //!< Scratch buffer used to pass samples from the ring buffer to projectM.
+    std::chrono::steady_clock::time_point _lastFillTime; //!< Time of the last FillBuffer() call.
+    double _framePeriod{0.0}; //!< Smoothed time between FillBuffer() calls in seconds.
+    bool _filling{false}; //!< True after the first FillBuffer() call since starting the recording.
+    uint64_t _writtenFrames{0}; //!< Total sample frames written to the ring buffer. Active device's audio thread only.
+    uint64_t _consumedFrames{0}; //!< Total sample frames read or skipped from the ring buffer. Render thread only.
+    uint32_t _maximumFeedFrames{0}; //!< projectM's PCM buffer size. Older samples are skipped instead of passed on.
+    std::chrono::milliseconds _latencyOffset{0}; //!< Delay applied to the audio passed to projectM.
 
+    std::atomic<uint32_t> _timestampSequence{0}; //!< Seqlock sequence number for the capture timestamp, odd while writing.
+    std::atomic<uint64_t> _timestampEndFrame{0}; //!< End frame of the latest captured block.
+    std::atomic<int64_t> _timestampTime{0}; //!< Capture time of the latest block in steady clock ticks.
+
+    bool _calibrating{false}; //!< True if calibration click detection is enabled.
+    bool _calibrationClick{false}; //!< True if a click was detected since the last CalibrationClick() call.
+    float _calibrationLevel{0.0f}; //!< Slowly decaying peak level used to detect the click onsets.
+
+    std::atomic<uint64_t> _overruns{0}; //!< Number of callbacks which couldn't store all samples.
+    std::atomic<uint64_t> _underruns{0}; //!< Number of FillBuffer() calls which got less samples than due.
+
+    std::atomic<uint64_t> _callbacks{0}; //!< Number of callbacks of the active device.
+    uint64_t _lastCallbacks{0}; //!< Callback count at the last rate update.
+    std::chrono::steady_clock::time_point _lastCallbackRateUpdate; //!< Time of the last rate update.
+    double _callbackRate{0.0}; //!< Measured callbacks per second.
+
+    bool _adaptiveBufferSize{true}; //!< If true, the buffer size follows the measured render rate.
+    bool _idle{false}; //!< True while the render loop is idle, suspends buffer size adaptation.
+    std::chrono::steady_clock::time_point _bufferSizeMismatchSince; //!< Time since which the buffer size is off, or epoch if it fits.
+
+    constexpr static float CalibrationClickThreshold{0.25f}; //!< Minimum peak amplitude of a calibration click.
+    constexpr static int RingBufferMilliseconds{500}; //!< Ring buffer headroom for scheduling jitter, in addition to the maximum latency offset.
+    constexpr static size_t FillBufferFrames{4096}; //!< Maximum sample frames passed to projectM at once.
+    constexpr static std::chrono::milliseconds SwitchTimeout{2000}; //!< Time after which a new device is used even if it didn't deliver data yet.
+    constexpr static double BufferSizeHysteresis{1.5}; //!< Factor by which the ideal buffer size must differ before the device is reopened.
+    constexpr static std::chrono::milliseconds BufferSizeSettleTime{3000}; //!< Time the ideal buffer size must stay off before the device is reopened.
+    constexpr static uint32_t MinimumBufferFrames{300}; //!< Smallest buffer size, prevents excessive callbacks. Enough for 144 FPS.
     constexpr static uint32_t _requestedSampleFrequency{44100}; //!< Requested sample frequency. Currently hardcoded as 44100 Hz, as this is what the spectrum analyzer expects.
-    uint32_t _requestedSampleCount{44100U / 60U}; //!< Requested audio buffer size. Determines how often SDL will call AudioInputCallback() with new data, and how much data is delivered on each call.
+    uint32_t _callbackSampleCount{0}; //!< Maximum sample frames stored per callback of the active device, after resampling.
+    uint32_t _bufferFrames{0}; //!< Buffer size of the active device in sample frames.
+    std::atomic<uint32_t> _requestedSampleCount{44100U / 60U}; //!< Requested audio buffer size. Determines how often SDL will call AudioInputCallback() with new data, and how much data is delivered on each call.
+
+#ifdef USE_PULSEAUDIO
+    std::unique_ptr<PulseAudioCapture> _pulseAudio; //!< Native PulseAudio capture, used instead of SDL if set.
+#endif
 
     Poco::Logger& _logger{Poco::Logger::get("AudioCapture.SDL")}; //!< The class logger.
 };
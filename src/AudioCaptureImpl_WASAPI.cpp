@@ -1,5 +1,9 @@
 #include "AudioCaptureImpl_WASAPI.h"
 
+#include "AudioGainControl.h"
+#include "AudioMixer.h"
+#include "Tracer.h"
+
 #include <projectM-4/projectM.h>
 
 #include <Poco/UnicodeConverter.h>
@@ -8,10 +12,16 @@
 #include <mmdeviceapi.h>
 #include <objbase.h>
 
+#include <algorithm>
+
 AudioCaptureImpl::AudioCaptureImpl()
     : _captureThread(this, &AudioCaptureImpl::CaptureThread)
 {
     CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    // Never reset while capturing, as the render thread may read it at any time.
+    _ringBuffer.Reset(OutputSampleRate * RingBufferMilliseconds / 1000 * PCMConverter::OutputChannels);
+    _fillBuffer.resize(FillBufferFrames * PCMConverter::OutputChannels);
 }
 
 AudioCaptureImpl::~AudioCaptureImpl()
@@ -130,6 +140,27 @@ void AudioCaptureImpl::FillBuffer()
             poco_debug(_logger, "Timeout waiting for audio buffer fill");
         }
     }
+
+    // Whatever the capture thread has stored so far, also after a timeout.
+    size_t samplesRead;
+    while ((samplesRead = _ringBuffer.Read(_fillBuffer.data(), _fillBuffer.size())) > 0)
+    {
+        size_t frames = samplesRead / PCMConverter::OutputChannels;
+
+        if (_mixer)
+        {
+            _mixer->AddSamples(_mixerInput, _fillBuffer.data(), frames, PCMConverter::OutputChannels, OutputSampleRate);
+        }
+        else
+        {
+            if (_gainControl)
+            {
+                _gainControl->Process(_fillBuffer.data(), frames, PCMConverter::OutputChannels, OutputSampleRate);
+            }
+
+            projectm_pcm_add_float(_projectMHandle, _fillBuffer.data(), static_cast<unsigned int>(frames), PROJECTM_STEREO);
+        }
+    }
 }
 
 HRESULT AudioCaptureImpl::QueryInterface(const IID& riid, void** ppvObject)
@@ -261,6 +292,10 @@ bool AudioCaptureImpl::OpenAudioDevice(IMMDevice* device, bool useLoopback)
     }
 
     _channels = pwfx->nChannels;
+    _sampleFrequency = pwfx->nSamplesPerSec;
+
+    _converter.Configure(PCMConverter::SampleFormat::F32, _channels, static_cast<int>(_sampleFrequency), OutputSampleRate, ConverterBlockFrames);
+    _convertedBuffer.resize(_converter.MaximumOutputFrames() * PCMConverter::OutputChannels);
 
     // Can't use event-driven processing in loopback mode, but as we
     // get a "fill buffer" request before rendering each frame, this isn't
@@ -332,6 +367,8 @@ void AudioCaptureImpl::CaptureThread()
 {
     poco_debug(_logger, "Audio capture thread starting.");
 
+    Tracer::RegisterThread("WASAPI capture");
+
     HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
 
     if (FAILED(result))
@@ -447,7 +484,8 @@ void AudioCaptureImpl::CaptureThread()
 
                 if (framesAvailable > 0 && data != nullptr)
                 {
-                    projectm_pcm_add_float(_projectMHandle, reinterpret_cast<float*>(data), framesAvailable, static_cast<projectm_channels>(_channels));
+                    Tracer::Scope trace("audio", "AudioInputCallback");
+                    StoreSamples(data, framesAvailable);
                 }
 
                 _audioCaptureClient->ReleaseBuffer(framesAvailable);
@@ -474,6 +512,35 @@ void AudioCaptureImpl::CaptureThread()
     poco_debug(_logger, "Audio capture thread exiting.");
 }
 
+void AudioCaptureImpl::StoreSamples(const BYTE* data, size_t frames)
+{
+    const size_t inputFrameSize = _channels * sizeof(float);
+    bool overrun{false};
+
+    while (frames > 0)
+    {
+        size_t blockFrames = std::min(frames, ConverterBlockFrames);
+        size_t sampleCount = _converter.Process(data, blockFrames, _convertedBuffer.data()) * PCMConverter::OutputChannels;
+        data += blockFrames * inputFrameSize;
+        frames -= blockFrames;
+
+        // Only store whole sample frames, dropping the newest data if the render thread falls behind.
+        size_t freeSpace = _ringBuffer.FreeSpace();
+        if (freeSpace < sampleCount)
+        {
+            sampleCount = freeSpace - freeSpace % PCMConverter::OutputChannels;
+            overrun = true;
+        }
+
+        _ringBuffer.Write(_convertedBuffer.data(), sampleCount);
+    }
+
+    if (overrun)
+    {
+        _overruns++;
+    }
+}
+
 IMMDeviceEnumerator* AudioCaptureImpl::GetDeviceEnumerator() const
 {
     IMMDeviceEnumerator* enumerator{nullptr};
@@ -499,6 +566,8 @@ HRESULT AudioCaptureImpl::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNe
 
     poco_trace_f2(_logger, "Audio device state changed for device ID %s: %lu", deviceId, dwNewState);
 
+    _deviceListVersion++;
+
     // Recalculate current device index and restart only if not default.
     if (_currentAudioDeviceIndex >= 0)
     {
@@ -546,6 +615,8 @@ HRESULT AudioCaptureImpl::OnDeviceAdded(LPCWSTR pwstrDeviceId)
 {
     poco_trace_f1(_logger, "Audio device added: %s", UnicodeToString(pwstrDeviceId));
 
+    _deviceListVersion++;
+
     return S_OK;
 }
 
@@ -553,6 +624,8 @@ HRESULT AudioCaptureImpl::OnDeviceRemoved(LPCWSTR pwstrDeviceId)
 {
     poco_trace_f1(_logger, "Audio device removed: %s", UnicodeToString(pwstrDeviceId));
 
+    _deviceListVersion++;
+
     return S_OK;
 }
 
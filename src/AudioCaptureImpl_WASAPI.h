@@ -1,5 +1,8 @@
 #pragma once
 
+#include "AudioRingBuffer.h"
+#include "PCMConverter.h"
+
 #include <Poco/Logger.h>
 
 #include <Audioclient.h>
@@ -8,8 +11,13 @@
 #include <Poco/Event.h>
 
 #include <mmdeviceapi.h>
+
+#include <atomic>
 #include <string>
+#include <vector>
 
+class AudioGainControl;
+class AudioMixer;
 struct projectm;
 
 /**
@@ -23,6 +31,10 @@ struct projectm;
  * sources come after that, with playback devices before recording devices.
  *
  * It supports hot-plug device changes with fallback to other devices.
+ *
+ * The capture thread converts the data to 44.1 kHz stereo float and stores it in a ring buffer, which is
+ * drained by FillBuffer() on the render thread. projectM and the mixer are thus only ever accessed on the
+ * render thread, even if either side runs into its wait timeout.
  */
 class AudioCaptureImpl : public IMMNotificationClient
 {
@@ -79,11 +91,106 @@ public:
      */
     std::string AudioDeviceName() const;
 
+    /**
+     * @brief Returns a counter which is incremented whenever devices are added or removed.
+     * @return The device list version.
+     */
+    uint64_t AudioDeviceListVersion() const
+    {
+        return _deviceListVersion;
+    }
+
     /**
      * @brief Asks the capture client to fill projectM's audio buffer for the next frame.
      */
     void FillBuffer();
 
+    /**
+     * @brief Sets the gain control applied to the samples before passing them to projectM.
+     * @param gainControl The gain control instance, or nullptr to pass the samples unchanged.
+     */
+    void GainControl(AudioGainControl* gainControl)
+    {
+        _gainControl = gainControl;
+    }
+
+    /**
+     * @brief Passes the samples to a mixer input instead of projectM, if capturing from several devices.
+     * @param mixer The mixer, or nullptr to pass the samples to projectM directly.
+     * @param input The mixer input index.
+     */
+    void Mixer(AudioMixer* mixer, size_t input)
+    {
+        _mixer = mixer;
+        _mixerInput = input;
+    }
+
+    /**
+     * @brief Returns the number of buffer overruns.
+     * @return The number of captured packets which couldn't be stored completely in the ring buffer.
+     */
+    uint64_t BufferOverruns() const
+    {
+        return _overruns;
+    }
+
+    /**
+     * @brief Returns the number of buffer underruns.
+     * @return Always 0.
+     */
+    uint64_t BufferUnderruns() const
+    {
+        return 0;
+    }
+
+    /**
+     * @brief Buffer statistics are not reported for WASAPI, as the render thread polls the capture client.
+     * @return Always 0.
+     */
+    uint32_t CaptureBufferFrames() const
+    {
+        return 0;
+    }
+
+    /**
+     * @brief Buffer statistics are not reported for WASAPI, as the render thread polls the capture client.
+     * @return Always 0.
+     */
+    double CallbackRate() const
+    {
+        return 0.0;
+    }
+
+    /**
+     * @brief Latency compensation requires capture timestamps, which are only implemented for SDL.
+     */
+    void LatencyOffset(int)
+    {
+    }
+
+    /**
+     * @brief The buffer size doesn't depend on the render rate with WASAPI, so the idle state is ignored.
+     */
+    void Idle(bool)
+    {
+    }
+
+    /**
+     * @brief Calibration mode is not supported with WASAPI.
+     */
+    void Calibration(bool)
+    {
+    }
+
+    /**
+     * @brief Calibration mode is not supported with WASAPI.
+     * @return Always false.
+     */
+    bool CalibrationClick()
+    {
+        return false;
+    }
+
     /**
      * @brief Converts a widechar/unicode string to a UTF-8-encoded string
      * @param unicodeString A pointer to a widechar string
@@ -201,7 +308,7 @@ protected:
      * @brief Main audio capture thread.
      *
      * This method is the workhorse of the audio capture implementation. Inside the thread, the selected capture device
-     * is opened and then the thread will wait for the FillBuffer event to read audio data and push it into projectM.
+     * is opened and then the thread will wait for the FillBuffer event to read audio data and store it in the ring buffer.
      *
      * The capture thread also registers the MM notification callbacks, which enable us to react to hot-plug events.
      * The callback will trigger a loop restart inside the thread to reinitialize the current audio device if it has
@@ -209,6 +316,13 @@ protected:
      */
     void CaptureThread();
 
+    /**
+     * @brief Converts a captured packet and writes it to the ring buffer. Capture thread only.
+     * @param data Interleaved float samples in the device's mix format.
+     * @param frames The number of frames in the packet.
+     */
+    void StoreSamples(const BYTE* data, size_t frames);
+
     /**
      * @brief Creates a new MMDeviceEnumerator interface.
      * @return A pointer to the created MMDeviceEnumerator or nullptr if the creation failed.
@@ -281,6 +395,9 @@ protected:
     Poco::Logger& _logger{Poco::Logger::get("AudioCapture.WASAPI")}; //!< The class logger.
 
     projectm* _projectMHandle{nullptr}; //!< Handle if the projectM instance that will receive the audio data.
+    AudioGainControl* _gainControl{nullptr}; //!< Gain control applied before passing samples to projectM.
+    AudioMixer* _mixer{nullptr}; //!< Mixer receiving the samples instead of projectM, if set.
+    size_t _mixerInput{0}; //!< Mixer input index of this stream.
     int _currentAudioDeviceIndex{-1}; //!< Currently selected audio device index.
     IAudioClient* _audioClient{nullptr}; //!< Currently used audio client.
     IAudioCaptureClient* _audioCaptureClient{nullptr}; //!< Currently used capture client.
@@ -291,6 +408,15 @@ protected:
     Poco::ActiveResult<void> _captureThreadResult{new Poco::ActiveResultHolder<void>()};
     std::string _currentCaptureDeviceId; //!< Current capture device ID. USed for checking if capturing needs restarting.
     WORD _channels{0}; //!< Number of channels on the current capture device.
+    DWORD _sampleFrequency{0}; //!< Sample frequency of the current capture device.
+
+    PCMConverter _converter; //!< Converts the device's mix format to 44.1 kHz stereo. Capture thread only.
+    std::vector<float> _convertedBuffer; //!< Output buffer of the converter. Capture thread only.
+    AudioRingBuffer _ringBuffer; //!< Converted samples written by the capture thread and read by FillBuffer().
+    std::vector<float> _fillBuffer; //!< Samples read from the ring buffer for projectM or the mixer. Render thread only.
+    std::atomic<uint64_t> _overruns{0}; //!< Number of packets which couldn't be stored completely.
+
+    std::atomic<uint64_t> _deviceListVersion{0}; //!< Incremented whenever a device is added, removed or changes its state.
 
     std::atomic_bool _isCapturing{false}; //!< If true, capturing is running. Capture thread will exit if set to false.
     std::atomic_bool _restartCapturing{false}; //!< If true, the capture thread will stop and restart capturing without exiting.
@@ -298,4 +424,9 @@ protected:
     Poco::Event _bufferFilledEvent; //!< Event which gets set if the buffer has been filled.
 
     static constexpr char _defaultDeviceName[] = "System Default Playback Device"; //!< Display name for the default device (index -1).
+
+    static constexpr int OutputSampleRate{44100}; //!< Sample rate stored in the ring buffer.
+    static constexpr int RingBufferMilliseconds{500}; //!< Ring buffer size, as headroom for render thread stalls.
+    static constexpr size_t ConverterBlockFrames{4096}; //!< Maximum frames passed to the converter at once.
+    static constexpr size_t FillBufferFrames{4096}; //!< Maximum sample frames passed to projectM at once.
 };
@@ -0,0 +1,361 @@
+#include "AudioFileSource.h"
+
+#include "AudioGainControl.h"
+#include "Tracer.h"
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Path.h>
+
+#include <Poco/Util/Application.h>
+
+#include <projectM-4/projectM.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+uint16_t ReadUInt16(const char* data)
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t ReadUInt32(const char* data)
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+} // namespace
+
+AudioFileSource::~AudioFileSource()
+{
+    Close();
+}
+
+bool AudioFileSource::Open(projectm* projectMHandle, const std::string& path)
+{
+    Close();
+
+    _projectMHandle = projectMHandle;
+    _path = path;
+
+    auto& config = Poco::Util::Application::instance().config();
+    _loop = config.getBool("audio.file.loop", true);
+    _pacing = config.getString("audio.file.pacing", "realtime") == "frame" ? Pacing::Frame : Pacing::RealTime;
+
+    bool isPipe{false};
+#ifndef _WIN32
+    struct stat fileStatus {};
+    isPipe = stat(path.c_str(), &fileStatus) == 0 && S_ISFIFO(fileStatus.st_mode);
+#endif
+
+    if (isPipe)
+    {
+#ifndef _WIN32
+        // Non-blocking, so opening doesn't wait for a writer and reading never stalls the render loop.
+        _pipe = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+        if (_pipe < 0)
+        {
+            poco_error_f2(_logger, R"(Could not open audio pipe "%s": %s)", path, std::string(strerror(errno)));
+            return false;
+        }
+#endif
+        ReadRawFormat();
+        _pipeBuffer.resize(static_cast<size_t>(_sampleRate) * _frameSize);
+        _pipeBufferBytes = 0;
+    }
+    else
+    {
+        try
+        {
+            _mapping = Poco::SharedMemory(Poco::File(path), Poco::SharedMemory::AM_READ);
+        }
+        catch (Poco::Exception& ex)
+        {
+            poco_error_f2(_logger, R"(Could not open audio file "%s": %s)", path, ex.displayText());
+            return false;
+        }
+
+        size_t mappingSize = static_cast<size_t>(_mapping.end() - _mapping.begin());
+        switch (ParseWaveHeader(_mapping.begin(), mappingSize))
+        {
+            case WaveHeader::None:
+                ReadRawFormat();
+                _data = _mapping.begin();
+                _dataSize = mappingSize;
+                break;
+
+            case WaveHeader::Supported:
+                break;
+
+            case WaveHeader::Unsupported:
+                // Playing the header and samples as raw data would only produce noise.
+                poco_error_f1(_logger, R"(Audio file "%s" is a WAV file in an unsupported format.)", path);
+                Close();
+                return false;
+        }
+
+        _dataSize -= _dataSize % _frameSize;
+        _readOffset = 0;
+
+        if (_dataSize == 0)
+        {
+            poco_error_f1(_logger, R"(Audio file "%s" contains no samples.)", path);
+            Close();
+            return false;
+        }
+    }
+
+    _converter.Configure(_format, _channels, _sampleRate, OutputSampleRate, ConversionBlockFrames);
+    _convertedBuffer.resize(_converter.MaximumOutputFrames() * PCMConverter::OutputChannels);
+
+    auto targetFps = config.getDouble("projectM.fps", 60.0);
+    _framesPerVideoFrame = _sampleRate / (targetFps > 0.0 ? targetFps : 60.0);
+    _pendingFrames = 0.0;
+    _started = false;
+
+    poco_information_f4(_logger, R"(Playing audio from %s "%s" with %?d channels at %?d Hz.)",
+                        std::string(isPipe ? "pipe" : "file"), path, _channels, _sampleRate);
+
+    return true;
+}
+
+void AudioFileSource::Close()
+{
+#ifndef _WIN32
+    if (_pipe >= 0)
+    {
+        close(_pipe);
+    }
+#endif
+    _pipe = -1;
+
+    _mapping = Poco::SharedMemory();
+    _data = nullptr;
+    _dataSize = 0;
+}
+
+std::string AudioFileSource::Name() const
+{
+    return Poco::Path(_path).getFileName();
+}
+
+void AudioFileSource::FillBuffer()
+{
+    if (_data == nullptr && _pipe < 0)
+    {
+        return;
+    }
+
+    Tracer::Scope trace("audio", "FillBuffer");
+
+    if (_pacing == Pacing::Frame)
+    {
+        _pendingFrames += _framesPerVideoFrame;
+    }
+    else
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (_started)
+        {
+            _pendingFrames += std::chrono::duration<double>(now - _lastFillTime).count() * _sampleRate;
+        }
+        else
+        {
+            _pendingFrames += _framesPerVideoFrame;
+        }
+        _lastFillTime = now;
+
+        // Don't try to catch up after a long stall, e.g. while the window was being dragged.
+        _pendingFrames = std::min(_pendingFrames, MaximumCatchUpSeconds * _sampleRate);
+    }
+    _started = true;
+
+    auto framesDue = static_cast<size_t>(_pendingFrames);
+    _pendingFrames -= static_cast<double>(framesDue);
+
+    if (_pipe >= 0)
+    {
+        FillFromPipe(framesDue);
+    }
+    else
+    {
+        FillFromFile(framesDue);
+    }
+}
+
+AudioFileSource::WaveHeader AudioFileSource::ParseWaveHeader(const char* data, size_t size)
+{
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+    {
+        return WaveHeader::None;
+    }
+
+    bool formatFound{false};
+    size_t offset{12};
+    while (offset + 8 <= size)
+    {
+        const char* chunk = data + offset;
+        size_t chunkSize = ReadUInt32(chunk + 4);
+        const char* chunkData = chunk + 8;
+        size_t available = std::min(chunkSize, size - offset - 8);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && available >= 16)
+        {
+            auto formatTag = ReadUInt16(chunkData);
+            _channels = ReadUInt16(chunkData + 2);
+            _sampleRate = static_cast<int>(ReadUInt32(chunkData + 4));
+            auto bitsPerSample = ReadUInt16(chunkData + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE stores the actual format tag in the first two bytes of the sub format GUID.
+            if (formatTag == 0xFFFE && available >= 26)
+            {
+                formatTag = ReadUInt16(chunkData + 24);
+            }
+
+            if (formatTag == 1 && bitsPerSample == 16)
+            {
+                _format = PCMConverter::SampleFormat::S16;
+            }
+            else if (formatTag == 1 && bitsPerSample == 32)
+            {
+                _format = PCMConverter::SampleFormat::S32;
+            }
+            else if (formatTag == 3 && bitsPerSample == 32)
+            {
+                _format = PCMConverter::SampleFormat::F32;
+            }
+            else
+            {
+                poco_error_f2(_logger, "Unsupported WAV sample format %?d with %?d bits per sample.",
+                              formatTag, bitsPerSample);
+                return WaveHeader::Unsupported;
+            }
+
+            if (_channels == 0 || _sampleRate <= 0)
+            {
+                return WaveHeader::Unsupported;
+            }
+
+            _frameSize = static_cast<size_t>(bitsPerSample / 8) * _channels;
+            formatFound = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0 && formatFound)
+        {
+            _data = chunkData;
+            _dataSize = available;
+            return WaveHeader::Supported;
+        }
+
+        // Chunks are padded to an even size.
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    // No format or data chunk.
+    return WaveHeader::Unsupported;
+}
+
+void AudioFileSource::ReadRawFormat()
+{
+    auto& config = Poco::Util::Application::instance().config();
+
+    auto format = config.getString("audio.file.format", "f32");
+    size_t sampleSize{4};
+    if (format == "s16")
+    {
+        _format = PCMConverter::SampleFormat::S16;
+        sampleSize = 2;
+    }
+    else if (format == "s32")
+    {
+        _format = PCMConverter::SampleFormat::S32;
+    }
+    else
+    {
+        _format = PCMConverter::SampleFormat::F32;
+    }
+
+    _channels = std::max(config.getInt("audio.file.channels", 2), 1);
+    _sampleRate = std::max(config.getInt("audio.file.sampleRate", 44100), 1);
+    _frameSize = sampleSize * _channels;
+}
+
+void AudioFileSource::FillFromFile(size_t frames)
+{
+    while (frames > 0)
+    {
+        if (_readOffset >= _dataSize)
+        {
+            if (!_loop)
+            {
+                return;
+            }
+            _readOffset = 0;
+        }
+
+        size_t blockFrames = std::min(frames, (_dataSize - _readOffset) / _frameSize);
+        AddFrames(_data + _readOffset, blockFrames);
+        _readOffset += blockFrames * _frameSize;
+        frames -= blockFrames;
+    }
+}
+
+void AudioFileSource::FillFromPipe(size_t frames)
+{
+#ifndef _WIN32
+    size_t bytesWanted = std::min(frames * _frameSize, _pipeBuffer.size());
+    while (_pipeBufferBytes < bytesWanted)
+    {
+        auto bytesRead = read(_pipe, _pipeBuffer.data() + _pipeBufferBytes, bytesWanted - _pipeBufferBytes);
+        if (bytesRead <= 0)
+        {
+            // No more data right now (EAGAIN), or no writer connected (0).
+            break;
+        }
+        _pipeBufferBytes += static_cast<size_t>(bytesRead);
+    }
+
+    size_t framesAvailable = _pipeBufferBytes / _frameSize;
+    AddFrames(_pipeBuffer.data(), framesAvailable);
+
+    // Keep a partial frame for the next call.
+    size_t bytesUsed = framesAvailable * _frameSize;
+    memmove(_pipeBuffer.data(), _pipeBuffer.data() + bytesUsed, _pipeBufferBytes - bytesUsed);
+    _pipeBufferBytes -= bytesUsed;
+#endif
+}
+
+void AudioFileSource::AddFrames(const char* data, size_t frames)
+{
+    while (frames > 0)
+    {
+        size_t blockFrames = std::min(frames, ConversionBlockFrames);
+        auto outputFrames = _converter.Process(data, blockFrames, _convertedBuffer.data());
+
+        if (_gainControl)
+        {
+            _gainControl->Process(_convertedBuffer.data(), outputFrames, PCMConverter::OutputChannels, OutputSampleRate);
+        }
+
+        AddToProjectM(_convertedBuffer.data(), outputFrames);
+
+        data += blockFrames * _frameSize;
+        frames -= blockFrames;
+    }
+}
+
+void AudioFileSource::AddToProjectM(const float* samples, size_t frames)
+{
+    projectm_pcm_add_float(_projectMHandle, samples, static_cast<unsigned int>(frames), PROJECTM_STEREO);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "PCMConverter.h"
+
+#include <Poco/Logger.h>
+#include <Poco/SharedMemory.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class AudioGainControl;
+class projectm;
+
+/**
+ * @brief Audio source reading PCM data from a file or named pipe instead of a capture device.
+ *
+ * WAV files with 16 or 32 bit integer or 32 bit float samples are recognized by their header, WAV
+ * files in any other format are rejected. Files without a RIFF/WAVE header, and named pipes like MPD's
+ * "fifo" output, are read as raw PCM using the format given in the "audio.file.*" configuration keys.
+ * Files are memory-mapped and can be looped, pipes are read without blocking.
+ *
+ * Two pacing modes are supported:
+ * - Real time: each FillBuffer() call passes the samples for the wall-clock time elapsed since the
+ *   previous call, so playback runs at normal speed.
+ * - Frame: each FillBuffer() call passes exactly one frame's worth of samples, based on the target
+ *   FPS. Rendering as fast as possible then produces the same output for each run, which is useful
+ *   for benchmarks and headless tests.
+ */
+class AudioFileSource
+{
+public:
+    /**
+     * @brief How samples are paced.
+     */
+    enum class Pacing
+    {
+        RealTime, //!< Samples are passed according to the elapsed time.
+        Frame //!< Each frame receives exactly 1/fps seconds of samples.
+    };
+
+    virtual ~AudioFileSource();
+
+    /**
+     * @brief Opens the given file or named pipe and prepares the conversion.
+     * @param projectMHandle projectM instance handle that will receive the audio data.
+     * @param path Path of the WAV file, raw PCM file or named pipe.
+     * @return True if the source was opened successfully.
+     */
+    bool Open(projectm* projectMHandle, const std::string& path);
+
+    /**
+     * @brief Closes the file or pipe.
+     */
+    void Close();
+
+    /**
+     * @brief Returns a display name for the source.
+     * @return The file name.
+     */
+    std::string Name() const;
+
+    /**
+     * @brief Passes the samples due for the next frame to projectM.
+     */
+    void FillBuffer();
+
+    /**
+     * @brief Sets the gain control applied to the samples before passing them to projectM.
+     * @param gainControl The gain control instance, or nullptr to pass the samples unchanged.
+     */
+    void GainControl(AudioGainControl* gainControl)
+    {
+        _gainControl = gainControl;
+    }
+
+protected:
+    static constexpr size_t ConversionBlockFrames{4096}; //!< Maximum input frames converted at once.
+    static constexpr int OutputSampleRate{44100}; //!< Sample rate of the data passed to projectM.
+    static constexpr double MaximumCatchUpSeconds{0.5}; //!< Upper limit of samples passed after a long frame.
+
+    /**
+     * @brief Result of parsing a file's WAV header.
+     */
+    enum class WaveHeader
+    {
+        None, //!< Not a RIFF/WAVE file, read as raw PCM.
+        Supported, //!< A WAV file in a supported format.
+        Unsupported //!< A WAV file with an unsupported sample format or invalid header.
+    };
+
+    /**
+     * @brief Reads the format from the WAV header and locates the sample data.
+     * @param data Start of the mapped file.
+     * @param size Size of the mapped file.
+     * @return Whether the file is a WAV file and can be played.
+     */
+    WaveHeader ParseWaveHeader(const char* data, size_t size);
+
+    /**
+     * @brief Reads the raw PCM format from the configuration.
+     */
+    void ReadRawFormat();
+
+    /**
+     * @brief Passes frames from the mapped file to projectM, looping if enabled.
+     * @param frames Number of input frames to pass.
+     */
+    void FillFromFile(size_t frames);
+
+    /**
+     * @brief Passes available frames from the pipe to projectM, but no more than requested.
+     * @param frames Maximum number of input frames to pass.
+     */
+    void FillFromPipe(size_t frames);
+
+    /**
+     * @brief Converts input frames and adds them to projectM's audio buffer.
+     * @param data Input samples.
+     * @param frames Number of input frames.
+     */
+    void AddFrames(const char* data, size_t frames);
+
+    /**
+     * @brief Passes converted samples to projectM.
+     * @param samples Interleaved 44.1 kHz stereo float samples.
+     * @param frames Number of stereo frames.
+     */
+    virtual void AddToProjectM(const float* samples, size_t frames);
+
+    projectm* _projectMHandle{nullptr}; //!< Handle if the projectM instance that will receive the audio data.
+    AudioGainControl* _gainControl{nullptr}; //!< Gain control applied before passing samples to projectM.
+    std::string _path; //!< The file or pipe path.
+
+    PCMConverter::SampleFormat _format{PCMConverter::SampleFormat::F32}; //!< Input sample format.
+    int _channels{2}; //!< Number of input channels.
+    int _sampleRate{44100}; //!< Input sample rate.
+    size_t _frameSize{0}; //!< Size of one input frame in bytes.
+
+    Poco::SharedMemory _mapping; //!< Memory mapping of the file. Unused for pipes.
+    const char* _data{nullptr}; //!< Start of the sample data in the mapped file.
+    size_t _dataSize{0}; //!< Size of the sample data in bytes, a multiple of the frame size.
+    size_t _readOffset{0}; //!< Current read position in the sample data.
+    bool _loop{true}; //!< If true, file playback restarts at the beginning when reaching the end.
+
+    int _pipe{-1}; //!< File descriptor of the named pipe, or -1 if reading a file.
+    std::vector<char> _pipeBuffer; //!< Receives pipe data, may hold a partial frame between calls.
+    size_t _pipeBufferBytes{0}; //!< Number of valid bytes in _pipeBuffer.
+
+    PCMConverter _converter; //!< Converts the input to 44.1 kHz float stereo.
+    std::vector<float> _convertedBuffer; //!< Output buffer of the converter.
+
+    Pacing _pacing{Pacing::RealTime}; //!< Sample pacing mode.
+    double _framesPerVideoFrame{0.0}; //!< Input frames passed per FillBuffer() call in frame pacing mode.
+    double _pendingFrames{0.0}; //!< Input frames due, including the fractional part carried over.
+    std::chrono::steady_clock::time_point _lastFillTime; //!< Time of the last FillBuffer() call.
+    bool _started{false}; //!< True after the first FillBuffer() call.
+
+    Poco::Logger& _logger{Poco::Logger::get("AudioCapture.File")}; //!< The class logger.
+};
@@ -0,0 +1,190 @@
+#include "AudioGainControl.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIOGAINCONTROL_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIOGAINCONTROL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+float DecibelsToLinear(double decibels)
+{
+    return static_cast<float>(std::pow(10.0, decibels / 20.0));
+}
+
+float LinearToDecibels(float value)
+{
+    return 20.0f * std::log10(std::max(value, 1e-6f));
+}
+
+} // namespace
+
+void AudioGainControl::Configure(bool enabled, double targetLevel, int attackMilliseconds, int releaseMilliseconds, double ceiling)
+{
+    _targetLevel = DecibelsToLinear(std::min(targetLevel, 0.0));
+    _attackSeconds = static_cast<float>(std::max(attackMilliseconds, 1)) / 1000.0f;
+    _releaseSeconds = static_cast<float>(std::max(releaseMilliseconds, 1)) / 1000.0f;
+    _maximumGain = DecibelsToLinear(std::max(ceiling, 0.0));
+    _enabled = enabled;
+}
+
+void AudioGainControl::Process(float* samples, size_t frames, int channels, int sampleRate)
+{
+    if (samples == nullptr || frames == 0 || channels <= 0 || sampleRate <= 0)
+    {
+        return;
+    }
+
+    size_t count = frames * static_cast<size_t>(channels);
+
+    float blockPeak;
+    double sumOfSquares;
+    Measure(samples, count, blockPeak, sumOfSquares);
+
+    float blockMeanSquare = static_cast<float>(sumOfSquares / static_cast<double>(count));
+    float blockSeconds = static_cast<float>(frames) / static_cast<float>(sampleRate);
+    float windowCoefficient = std::exp(-blockSeconds / WindowSeconds);
+    _meanSquare = windowCoefficient * _meanSquare + (1.0f - windowCoefficient) * blockMeanSquare;
+    _peakLevel = std::max(blockPeak, _peakLevel * windowCoefficient);
+
+    float rms = std::sqrt(_meanSquare);
+    _level = rms;
+    _peak = _peakLevel;
+
+    if (!_enabled)
+    {
+        _currentGain = 1.0f;
+        _gain = 1.0f;
+        return;
+    }
+
+    // The block level is checked as well, as the windowed level takes seconds to decay once the input stops.
+    float targetGain = _currentGain;
+    if (rms > GateLevel && blockMeanSquare > GateLevel * GateLevel)
+    {
+        targetGain = _targetLevel / rms;
+        if (_peakLevel > 0.0f)
+        {
+            targetGain = std::min(targetGain, 1.0f / _peakLevel);
+        }
+        targetGain = std::max(MinimumGain, std::min(targetGain, _maximumGain.load()));
+    }
+
+    float timeConstant = targetGain < _currentGain ? _attackSeconds : _releaseSeconds;
+    float newGain = targetGain + (_currentGain - targetGain) * std::exp(-blockSeconds / timeConstant);
+
+    ApplyGain(samples, count, _currentGain, newGain);
+
+    _currentGain = newGain;
+    _gain = newGain;
+}
+
+bool AudioGainControl::Enabled() const
+{
+    return _enabled;
+}
+
+float AudioGainControl::Gain() const
+{
+    return LinearToDecibels(_gain);
+}
+
+float AudioGainControl::Level() const
+{
+    return LinearToDecibels(_level);
+}
+
+float AudioGainControl::Peak() const
+{
+    return LinearToDecibels(_peak);
+}
+
+void AudioGainControl::Measure(const float* samples, size_t count, float& peak, double& sumOfSquares)
+{
+    size_t index{0};
+    peak = 0.0f;
+    sumOfSquares = 0.0;
+
+#ifdef AUDIOGAINCONTROL_SSE2
+    const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    auto peaks = _mm_setzero_ps();
+    auto sums = _mm_setzero_ps();
+    for (; index + 4 <= count; index += 4)
+    {
+        auto values = _mm_loadu_ps(&samples[index]);
+        peaks = _mm_max_ps(peaks, _mm_and_ps(values, absMask));
+        sums = _mm_add_ps(sums, _mm_mul_ps(values, values));
+    }
+
+    float peakLanes[4];
+    float sumLanes[4];
+    _mm_storeu_ps(peakLanes, peaks);
+    _mm_storeu_ps(sumLanes, sums);
+    for (int lane = 0; lane < 4; lane++)
+    {
+        peak = std::max(peak, peakLanes[lane]);
+        sumOfSquares += sumLanes[lane];
+    }
+#elif defined(AUDIOGAINCONTROL_NEON)
+    auto peaks = vdupq_n_f32(0.0f);
+    auto sums = vdupq_n_f32(0.0f);
+    for (; index + 4 <= count; index += 4)
+    {
+        auto values = vld1q_f32(&samples[index]);
+        peaks = vmaxq_f32(peaks, vabsq_f32(values));
+        sums = vmlaq_f32(sums, values, values);
+    }
+
+    float peakLanes[4];
+    float sumLanes[4];
+    vst1q_f32(peakLanes, peaks);
+    vst1q_f32(sumLanes, sums);
+    for (int lane = 0; lane < 4; lane++)
+    {
+        peak = std::max(peak, peakLanes[lane]);
+        sumOfSquares += sumLanes[lane];
+    }
+#endif
+
+    for (; index < count; index++)
+    {
+        peak = std::max(peak, std::abs(samples[index]));
+        sumOfSquares += samples[index] * samples[index];
+    }
+}
+
+void AudioGainControl::ApplyGain(float* samples, size_t count, float startGain, float endGain)
+{
+    size_t index{0};
+    float step = (endGain - startGain) / static_cast<float>(count);
+
+#ifdef AUDIOGAINCONTROL_SSE2
+    auto gains = _mm_set_ps(startGain + 3.0f * step, startGain + 2.0f * step, startGain + step, startGain);
+    const auto increment = _mm_set1_ps(4.0f * step);
+    for (; index + 4 <= count; index += 4)
+    {
+        _mm_storeu_ps(&samples[index], _mm_mul_ps(_mm_loadu_ps(&samples[index]), gains));
+        gains = _mm_add_ps(gains, increment);
+    }
+#elif defined(AUDIOGAINCONTROL_NEON)
+    const float initialGains[4] = {startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step};
+    auto gains = vld1q_f32(initialGains);
+    const auto increment = vdupq_n_f32(4.0f * step);
+    for (; index + 4 <= count; index += 4)
+    {
+        vst1q_f32(&samples[index], vmulq_f32(vld1q_f32(&samples[index]), gains));
+        gains = vaddq_f32(gains, increment);
+    }
+#endif
+
+    for (; index < count; index++)
+    {
+        samples[index] *= startGain + static_cast<float>(index) * step;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Automatic gain control applied to captured audio before it is passed to projectM.
+ *
+ * Keeps the input at a constant loudness, so beat detection works without adjusting the beat sensitivity
+ * whenever the input level changes. The level is measured as the RMS and decaying peak over a short window.
+ * The gain follows the ratio of target and measured level, smoothed with separate attack (gain decreasing)
+ * and release (gain increasing) times. It is limited by the configured ceiling and never pushes the peak
+ * level above full scale. Input below the noise gate keeps the current gain, so silence isn't amplified.
+ * The gate closes as soon as a single block is below it, not only once the windowed level has decayed.
+ *
+ * The level is also measured if the gain control is disabled, so the GUI can always display it.
+ *
+ * Process() must always be called from the same thread. Configure() and the getters are thread-safe.
+ */
+class AudioGainControl
+{
+public:
+    /**
+     * @brief Updates the gain control parameters.
+     * @param enabled If false, samples are only measured, but not changed.
+     * @param targetLevel The target RMS level in dBFS.
+     * @param attackMilliseconds Time constant for decreasing the gain.
+     * @param releaseMilliseconds Time constant for increasing the gain.
+     * @param ceiling The maximum gain in dB.
+     */
+    void Configure(bool enabled, double targetLevel, int attackMilliseconds, int releaseMilliseconds, double ceiling);
+
+    /**
+     * @brief Measures the level of the given samples and applies the gain in place.
+     * @param samples Interleaved float samples.
+     * @param frames The number of frames in the buffer.
+     * @param channels The number of channels per frame.
+     * @param sampleRate The sample rate, used to convert time constants.
+     */
+    void Process(float* samples, size_t frames, int channels, int sampleRate);
+
+    /**
+     * @brief Returns whether the gain is applied.
+     * @return True if the gain control is enabled.
+     */
+    bool Enabled() const;
+
+    /**
+     * @brief Returns the current gain.
+     * @return The gain in dB, 0.0 if disabled.
+     */
+    float Gain() const;
+
+    /**
+     * @brief Returns the windowed RMS level of the input.
+     * @return The RMS level in dBFS, before applying the gain.
+     */
+    float Level() const;
+
+    /**
+     * @brief Returns the windowed peak level of the input.
+     * @return The peak level in dBFS, before applying the gain.
+     */
+    float Peak() const;
+
+protected:
+    static constexpr float WindowSeconds{0.4f}; //!< Time constant of the level measurement.
+    static constexpr float GateLevel{0.001f}; //!< RMS level below which the gain is held (-60 dBFS).
+    static constexpr float MinimumGain{0.1f}; //!< Lowest gain applied to loud input (-20 dB).
+
+    /**
+     * @brief Computes the absolute peak and the sum of squares of the samples.
+     * @param samples The samples to measure.
+     * @param count The number of samples.
+     * @param peak Receives the absolute peak value.
+     * @param sumOfSquares Receives the sum of all squared samples.
+     */
+    static void Measure(const float* samples, size_t count, float& peak, double& sumOfSquares);
+
+    /**
+     * @brief Multiplies the samples with a gain ramping linearly from start to end, avoiding zipper noise.
+     * @param samples The samples to change.
+     * @param count The number of samples.
+     * @param startGain The gain applied to the first sample.
+     * @param endGain The gain reached after the last sample.
+     */
+    static void ApplyGain(float* samples, size_t count, float startGain, float endGain);
+
+    std::atomic_bool _enabled{false}; //!< If true, the gain is applied.
+    std::atomic<float> _targetLevel{0.125f}; //!< Linear target RMS level.
+    std::atomic<float> _attackSeconds{0.01f}; //!< Time constant for decreasing the gain.
+    std::atomic<float> _releaseSeconds{2.0f}; //!< Time constant for increasing the gain.
+    std::atomic<float> _maximumGain{15.85f}; //!< Linear gain ceiling.
+
+    float _meanSquare{0.0f}; //!< Windowed mean square of the input. Processing thread only.
+    float _peakLevel{0.0f}; //!< Decaying peak level of the input. Processing thread only.
+    float _currentGain{1.0f}; //!< Linear gain applied at the end of the last block. Processing thread only.
+
+    std::atomic<float> _gain{1.0f}; //!< Published linear gain.
+    std::atomic<float> _level{0.0f}; //!< Published linear RMS level.
+    std::atomic<float> _peak{0.0f}; //!< Published linear peak level.
+};
@@ -0,0 +1,143 @@
+#include "AudioMixer.h"
+
+#include "AudioGainControl.h"
+
+#include <projectM-4/projectM.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void AudioMixer::Inputs(size_t count)
+{
+    _inputs = std::vector<Input>(count);
+    for (auto& input : _inputs)
+    {
+        input.samples.reserve(MaximumPendingFrames * PCMConverter::OutputChannels);
+    }
+}
+
+size_t AudioMixer::Inputs() const
+{
+    return _inputs.size();
+}
+
+void AudioMixer::InputGain(size_t input, double decibels)
+{
+    if (input >= _inputs.size())
+    {
+        return;
+    }
+
+    _inputs[input].gain = static_cast<float>(std::pow(10.0, decibels / 20.0));
+}
+
+void AudioMixer::GainControl(AudioGainControl* gainControl)
+{
+    _gainControl = gainControl;
+}
+
+void AudioMixer::AddSamples(size_t input, const float* samples, size_t frames, int channels, int sampleRate)
+{
+    if (input >= _inputs.size() || samples == nullptr || frames == 0 || channels <= 0 || sampleRate <= 0)
+    {
+        return;
+    }
+
+    auto& mixerInput = _inputs[input];
+    mixerInput.lastSamplesTime = std::chrono::steady_clock::now();
+
+    if (channels == PCMConverter::OutputChannels && sampleRate == OutputSampleRate)
+    {
+        mixerInput.samples.insert(mixerInput.samples.end(), samples, samples + frames * PCMConverter::OutputChannels);
+    }
+    else
+    {
+        if (mixerInput.converterChannels != channels || mixerInput.converterSampleRate != sampleRate)
+        {
+            mixerInput.converter.Configure(PCMConverter::SampleFormat::F32, channels, sampleRate, OutputSampleRate, ConverterBlockFrames);
+            mixerInput.convertedBuffer.resize(mixerInput.converter.MaximumOutputFrames() * PCMConverter::OutputChannels);
+            mixerInput.converterChannels = channels;
+            mixerInput.converterSampleRate = sampleRate;
+        }
+
+        while (frames > 0)
+        {
+            size_t blockFrames = std::min(frames, ConverterBlockFrames);
+            size_t outputFrames = mixerInput.converter.Process(samples, blockFrames, mixerInput.convertedBuffer.data());
+            mixerInput.samples.insert(mixerInput.samples.end(), mixerInput.convertedBuffer.data(),
+                                      mixerInput.convertedBuffer.data() + outputFrames * PCMConverter::OutputChannels);
+
+            samples += blockFrames * static_cast<size_t>(channels);
+            frames -= blockFrames;
+        }
+    }
+
+    // projectM only keeps its most recent samples anyway, so drop the oldest ones.
+    size_t maximumSamples = MaximumPendingFrames * PCMConverter::OutputChannels;
+    if (mixerInput.samples.size() > maximumSamples)
+    {
+        mixerInput.samples.erase(mixerInput.samples.begin(), mixerInput.samples.end() - maximumSamples);
+    }
+}
+
+void AudioMixer::Mix(projectm* projectMHandle)
+{
+    size_t frames = MixInputs(std::chrono::steady_clock::now());
+    if (frames == 0)
+    {
+        return;
+    }
+
+    projectm_pcm_add_float(projectMHandle, _mixBuffer.data(), static_cast<unsigned int>(frames), PROJECTM_STEREO);
+}
+
+size_t AudioMixer::MixInputs(std::chrono::steady_clock::time_point now)
+{
+    // Only mix what all active inputs have received, the remainder is mixed with the next frame.
+    size_t minimumCount = std::numeric_limits<size_t>::max();
+    size_t maximumCount{0};
+    for (const auto& input : _inputs)
+    {
+        maximumCount = std::max(maximumCount, input.samples.size());
+        if (now - input.lastSamplesTime <= StallTimeout)
+        {
+            minimumCount = std::min(minimumCount, input.samples.size());
+        }
+    }
+
+    if (minimumCount == std::numeric_limits<size_t>::max())
+    {
+        // All inputs stalled, pass on whatever is left.
+        minimumCount = maximumCount;
+    }
+
+    // Don't let a slower input hold back the others indefinitely.
+    size_t maximumBacklog = MaximumBacklogFrames * PCMConverter::OutputChannels;
+    size_t sampleCount = std::max(minimumCount, maximumCount > maximumBacklog ? maximumCount - maximumBacklog : 0);
+
+    if (sampleCount == 0)
+    {
+        return 0;
+    }
+
+    _mixBuffer.assign(sampleCount, 0.0f);
+    for (auto& input : _inputs)
+    {
+        size_t inputCount = std::min(sampleCount, input.samples.size());
+        for (size_t index = 0; index < inputCount; index++)
+        {
+            _mixBuffer[index] += input.samples[index] * input.gain;
+        }
+        input.samples.erase(input.samples.begin(), input.samples.begin() + static_cast<std::ptrdiff_t>(inputCount));
+    }
+
+    size_t frames = sampleCount / PCMConverter::OutputChannels;
+
+    if (_gainControl)
+    {
+        _gainControl->Process(_mixBuffer.data(), frames, PCMConverter::OutputChannels, OutputSampleRate);
+    }
+
+    return frames;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "PCMConverter.h"
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+class AudioGainControl;
+class projectm;
+
+/**
+ * @brief Sums the audio of several capture streams before passing it to projectM.
+ *
+ * Each capture implementation stores its samples in its own ring buffer on the audio thread. When the
+ * render thread fills projectM's buffer, every stream passes the samples due for this frame to its mixer
+ * input, and Mix() then adds up all inputs, applies the gain control and passes the result to projectM.
+ * As the mixer is only accessed on the render thread, no locking is required, and the audio threads never
+ * wait for each other.
+ *
+ * Inputs are converted to 44.1 kHz stereo if required. As the devices deliver their samples in blocks of
+ * different sizes and at different times, only as many samples as all inputs have received are mixed, and
+ * the rest is kept for the next frame. Inputs which didn't deliver anything for StallTimeout are left out
+ * and padded with silence, so a stalled device can't hold back the remaining ones. If an input is running
+ * slightly slower than the others, the others' backlog is limited to MaximumBacklogFrames, padding the
+ * slower input with a few samples of silence when required.
+ */
+class AudioMixer
+{
+public:
+    static constexpr int OutputSampleRate{44100}; //!< Sample rate of the mixed audio.
+
+    /**
+     * @brief Sets the number of mixer inputs. Discards all pending samples.
+     * @param count The number of inputs.
+     */
+    void Inputs(size_t count);
+
+    /**
+     * @brief Returns the number of mixer inputs.
+     * @return The input count.
+     */
+    size_t Inputs() const;
+
+    /**
+     * @brief Sets the gain of a single input.
+     * @param input The input index.
+     * @param decibels The gain in dB.
+     */
+    void InputGain(size_t input, double decibels);
+
+    /**
+     * @brief Sets the gain control applied to the mixed samples.
+     * @param gainControl The gain control instance, or nullptr to pass the mix unchanged.
+     */
+    void GainControl(AudioGainControl* gainControl);
+
+    /**
+     * @brief Adds samples to an input. Render thread only.
+     * @param input The input index.
+     * @param samples Interleaved float samples.
+     * @param frames The number of frames in the buffer.
+     * @param channels The number of channels per frame.
+     * @param sampleRate The sample rate of the data.
+     */
+    void AddSamples(size_t input, const float* samples, size_t frames, int channels, int sampleRate);
+
+    /**
+     * @brief Sums the samples received by all inputs and passes the result to projectM. Render thread only.
+     * @param projectMHandle projectM instance handle that will receive the mixed data.
+     */
+    void Mix(projectm* projectMHandle);
+
+protected:
+    /**
+     * @brief Sums the samples due for this frame into the mix buffer and applies the gain control.
+     * @param now The current time, used to detect stalled inputs.
+     * @return The number of stereo frames in the mix buffer.
+     */
+    size_t MixInputs(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief A single mixer input.
+     */
+    struct Input {
+        std::vector<float> samples; //!< Interleaved stereo samples not mixed yet.
+        std::chrono::steady_clock::time_point lastSamplesTime; //!< Time samples were last added, epoch if never.
+        float gain{1.0f}; //!< Linear input gain.
+        PCMConverter converter; //!< Converts data which isn't 44.1 kHz stereo.
+        std::vector<float> convertedBuffer; //!< Output buffer of the converter.
+        int converterChannels{0}; //!< Channel count the converter was configured for, 0 if not configured.
+        int converterSampleRate{0}; //!< Sample rate the converter was configured for.
+    };
+
+    std::vector<Input> _inputs; //!< The mixer inputs.
+    std::vector<float> _mixBuffer; //!< Interleaved stereo mix passed to projectM.
+    AudioGainControl* _gainControl{nullptr}; //!< Gain control applied to the mix.
+
+    static constexpr size_t MaximumPendingFrames{OutputSampleRate}; //!< Samples kept per input between two Mix() calls.
+    static constexpr size_t ConverterBlockFrames{4096}; //!< Maximum frames passed to the converter at once.
+    static constexpr size_t MaximumBacklogFrames{OutputSampleRate / 10}; //!< Samples an input may run ahead of the slowest one.
+    static constexpr std::chrono::milliseconds StallTimeout{100}; //!< Time without samples after which an input is padded with silence.
+};
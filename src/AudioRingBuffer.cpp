@@ -0,0 +1,94 @@
+#include "AudioRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void AudioRingBuffer::Reset(size_t capacity)
+{
+    size_t roundedCapacity{1};
+    while (roundedCapacity < capacity)
+    {
+        roundedCapacity <<= 1;
+    }
+
+    _buffer.assign(roundedCapacity, 0.0f);
+    _mask = roundedCapacity - 1;
+    _writePosition.store(0, std::memory_order_relaxed);
+    _readPosition.store(0, std::memory_order_relaxed);
+}
+
+size_t AudioRingBuffer::Capacity() const
+{
+    return _buffer.size();
+}
+
+size_t AudioRingBuffer::FreeSpace() const
+{
+    auto writePosition = _writePosition.load(std::memory_order_relaxed);
+    auto readPosition = _readPosition.load(std::memory_order_acquire);
+
+    return _buffer.size() - (writePosition - readPosition);
+}
+
+size_t AudioRingBuffer::Write(const float* samples, size_t count)
+{
+    auto writePosition = _writePosition.load(std::memory_order_relaxed);
+    auto readPosition = _readPosition.load(std::memory_order_acquire);
+
+    count = std::min(count, _buffer.size() - (writePosition - readPosition));
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // Copy in up to two parts if the write wraps around the end of the buffer.
+    auto offset = writePosition & _mask;
+    auto firstPart = std::min(count, _buffer.size() - offset);
+    memcpy(&_buffer[offset], samples, firstPart * sizeof(float));
+    memcpy(&_buffer[0], samples + firstPart, (count - firstPart) * sizeof(float));
+
+    _writePosition.store(writePosition + count, std::memory_order_release);
+
+    return count;
+}
+
+size_t AudioRingBuffer::Available() const
+{
+    auto readPosition = _readPosition.load(std::memory_order_relaxed);
+    auto writePosition = _writePosition.load(std::memory_order_acquire);
+
+    return writePosition - readPosition;
+}
+
+size_t AudioRingBuffer::Read(float* samples, size_t count)
+{
+    auto readPosition = _readPosition.load(std::memory_order_relaxed);
+    auto writePosition = _writePosition.load(std::memory_order_acquire);
+
+    count = std::min(count, writePosition - readPosition);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    auto offset = readPosition & _mask;
+    auto firstPart = std::min(count, _buffer.size() - offset);
+    memcpy(samples, &_buffer[offset], firstPart * sizeof(float));
+    memcpy(samples + firstPart, &_buffer[0], (count - firstPart) * sizeof(float));
+
+    _readPosition.store(readPosition + count, std::memory_order_release);
+
+    return count;
+}
+
+size_t AudioRingBuffer::Skip(size_t count)
+{
+    auto readPosition = _readPosition.load(std::memory_order_relaxed);
+    auto writePosition = _writePosition.load(std::memory_order_acquire);
+
+    count = std::min(count, writePosition - readPosition);
+
+    _readPosition.store(readPosition + count, std::memory_order_release);
+
+    return count;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Wait-free single-producer/single-consumer ring buffer for interleaved float samples.
+ *
+ * One thread (the audio callback) writes, one other thread (the render thread) reads. Neither side
+ * ever blocks or allocates: the read and write positions are free-running counters, published with
+ * release/acquire ordering, and the capacity is a power of two so wrapping is a simple mask.
+ *
+ * @note Reset() must only be called while no producer is active, e.g. with the audio device closed.
+ */
+class AudioRingBuffer
+{
+public:
+    /**
+     * @brief (Re)allocates the buffer and discards all samples.
+     * @param capacity The minimum number of samples the buffer can hold. Rounded up to a power of two.
+     */
+    void Reset(size_t capacity);
+
+    /**
+     * @brief Returns the number of samples the buffer can hold.
+     * @return The buffer capacity in samples.
+     */
+    size_t Capacity() const;
+
+    /**
+     * @brief Returns the number of samples that can currently be written. Producer side.
+     * @return The free space in samples.
+     */
+    size_t FreeSpace() const;
+
+    /**
+     * @brief Appends samples to the buffer. Producer side.
+     * @param samples The samples to write.
+     * @param count The number of samples to write.
+     * @return The number of samples actually written, less than @a count if the buffer is full.
+     */
+    size_t Write(const float* samples, size_t count);
+
+    /**
+     * @brief Returns the number of samples that can currently be read. Consumer side.
+     * @return The number of buffered samples.
+     */
+    size_t Available() const;
+
+    /**
+     * @brief Removes samples from the buffer. Consumer side.
+     * @param samples Receives the samples.
+     * @param count The maximum number of samples to read.
+     * @return The number of samples actually read.
+     */
+    size_t Read(float* samples, size_t count);
+
+    /**
+     * @brief Discards the oldest samples without copying them. Consumer side.
+     * @param count The maximum number of samples to discard.
+     * @return The number of samples actually discarded.
+     */
+    size_t Skip(size_t count);
+
+protected:
+    std::vector<float> _buffer; //!< Sample storage, size is a power of two.
+    size_t _mask{0}; //!< Capacity minus one, used to wrap positions.
+
+    alignas(64) std::atomic<size_t> _writePosition{0}; //!< Total samples written. Only modified by the producer.
+    alignas(64) std::atomic<size_t> _readPosition{0}; //!< Total samples read. Only modified by the consumer.
+};
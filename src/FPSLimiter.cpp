@@ -2,21 +2,37 @@
 
 #include <SDL2/SDL.h>
 
-void FPSLimiter::TargetFPS(int fps)
+FPSLimiter::FPSLimiter()
+    : _counterFrequency(SDL_GetPerformanceFrequency())
+    , _spinMarginTicks(static_cast<uint64_t>(SpinMarginSeconds * static_cast<double>(_counterFrequency)))
 {
-    if (fps)
+}
+
+void FPSLimiter::TargetFPS(double fps)
+{
+    if (fps == _targetFps)
     {
-        _targetFrameTime = 1000 / fps;
+        return;
+    }
+
+    _targetFps = fps > 0.0 ? fps : 0.0;
+
+    if (_targetFps > 0.0)
+    {
+        _targetFrameTicks = static_cast<double>(_counterFrequency) / _targetFps;
     }
     else
     {
-        _targetFrameTime = 0;
+        _targetFrameTicks = 0.0;
     }
+
+    // Restart scheduling with the next frame.
+    _epochTicks = 0;
 }
 
 float FPSLimiter::FPS() const
 {
-    uint32_t frameTimeSum{ 0 };
+    uint64_t frameTimeSum{ 0 };
     uint32_t frameTimeCount{ 0 };
 
     for (auto _lastFrameTime : _lastFrameTimes)
@@ -33,24 +49,85 @@ float FPSLimiter::FPS() const
         return 0.0f;
     }
 
-   return 1000.0f / (static_cast<float>(frameTimeSum) / static_cast<float>(frameTimeCount));
+    return static_cast<float>(static_cast<double>(_counterFrequency) /
+                              (static_cast<double>(frameTimeSum) / static_cast<double>(frameTimeCount)));
+}
+
+uint64_t FPSLimiter::LastFrameMicroseconds() const
+{
+    int lastOffset = (_nextFrameTimesOffset + 9) % 10;
+    return _lastFrameTimes[lastOffset] * 1000000 / _counterFrequency;
+}
+
+bool FPSLimiter::LastFrameMissedDeadline() const
+{
+    return _lastFrameMissedDeadline;
 }
 
 void FPSLimiter::StartFrame()
 {
-    _lastTickCount = SDL_GetTicks();
+    _frameStartTicks = SDL_GetPerformanceCounter();
+
+    if (_epochTicks == 0)
+    {
+        ResetSchedule(_frameStartTicks);
+    }
 }
 
 void FPSLimiter::EndFrame()
 {
-    uint32_t frameTime = SDL_GetTicks() - _lastTickCount;
+    _lastFrameMissedDeadline = false;
 
-    if (_targetFrameTime && frameTime < _targetFrameTime)
+    if (_targetFrameTicks > 0.0)
     {
-        SDL_Delay(_targetFrameTime - frameTime);
-        frameTime = SDL_GetTicks() - _lastTickCount;
+        _framesSinceEpoch++;
+        uint64_t deadline = _epochTicks + static_cast<uint64_t>(static_cast<double>(_framesSinceEpoch) * _targetFrameTicks);
+
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (now < deadline)
+        {
+            WaitUntil(deadline);
+        }
+        else
+        {
+            _lastFrameMissedDeadline = now > deadline;
+
+            if (static_cast<double>(now - deadline) > _targetFrameTicks)
+            {
+                // More than a whole frame late. Don't try to catch up by rushing the next frames,
+                // just continue the cadence from here.
+                ResetSchedule(now);
+            }
+        }
     }
 
-    _lastFrameTimes[_nextFrameTimesOffset] = frameTime;
+    _lastFrameTimes[_nextFrameTimesOffset] = SDL_GetPerformanceCounter() - _frameStartTicks;
     _nextFrameTimesOffset = (_nextFrameTimesOffset + 1) % 10;
 }
+
+void FPSLimiter::WaitUntil(uint64_t deadline) const
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+
+    while (now < deadline)
+    {
+        uint64_t remaining = deadline - now;
+        if (remaining > _spinMarginTicks)
+        {
+            // SDL_Delay() may oversleep by a scheduler tick, so only sleep until the spin margin.
+            auto sleepTime = static_cast<uint32_t>((remaining - _spinMarginTicks) * 1000 / _counterFrequency);
+            if (sleepTime > 0)
+            {
+                SDL_Delay(sleepTime);
+            }
+        }
+
+        now = SDL_GetPerformanceCounter();
+    }
+}
+
+void FPSLimiter::ResetSchedule(uint64_t now)
+{
+    _epochTicks = now;
+    _framesSinceEpoch = 0;
+}
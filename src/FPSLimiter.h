@@ -3,16 +3,23 @@
 #include <cstdint>
 
 /**
- * @brief Limits FPS by adding a delay if necessary. Also keeps track of actual FPS.
+ * @brief Limits FPS by waiting for the next frame deadline if necessary. Also keeps track of actual FPS.
+ *
+ * Uses SDL's high-resolution performance counter instead of millisecond ticks. Frame deadlines are
+ * scheduled as absolute points in time relative to a fixed epoch, so rounding errors don't accumulate
+ * and fractional target rates like 59.94 FPS are met exactly on average. Waiting is done by a coarse
+ * sleep first, then spinning on the counter for the last stretch before the deadline.
  */
 class FPSLimiter
 {
 public:
+    FPSLimiter();
+
     /**
      * @brief Sets the target frames per second value.
-     * @param fps The targeted frames per second. Set to 0 for unlimited FPS.
+     * @param fps The targeted frames per second, may be fractional. Set to 0 for unlimited FPS.
      */
-    void TargetFPS(int fps);
+    void TargetFPS(double fps);
 
     /**
      * @brief Calculates the current real FPS.
@@ -23,6 +30,21 @@ public:
      */
     float FPS() const;
 
+    /**
+     * @brief Returns the duration of the last completed frame.
+     * @return The last frame time in microseconds, including limiting delay.
+     */
+    uint64_t LastFrameMicroseconds() const;
+
+    /**
+     * @brief Returns whether the last completed frame finished after its scheduled deadline.
+     *
+     * Always false if FPS are unlimited.
+     *
+     * @return True if the frame deadline was missed, false if not.
+     */
+    bool LastFrameMissedDeadline() const;
+
     /**
      * @brief Marks the start of a new frame.
      *
@@ -33,17 +55,41 @@ public:
     /**
      * @brief Marks the end of a frame.
      *
-     * Will pause if required to lower FPS to target value. Also records the last frame time for FPS calculation.
+     * Will pause until the next frame deadline if required to lower FPS to target value. Also records the
+     * last frame time for FPS calculation.
      */
     void EndFrame();
 
 protected:
+    /**
+     * @brief Waits until the performance counter reaches the given value.
+     *
+     * Sleeps in whole milliseconds while the deadline is further away than the spin margin, then busy-waits
+     * for the remaining time.
+     *
+     * @param deadline The performance counter value to wait for.
+     */
+    void WaitUntil(uint64_t deadline) const;
 
-    uint32_t _lastTickCount{ 0 }; //!< Last SDL tick count, when a new frame was started.
-    uint32_t _targetFrameTime{ 0 }; //!< Targeted time per frame in milliseconds.
-    uint32_t _lastFrameTimes[10]{}; //!< Actual tick time of the last ten frames, including limiting delay.
-    int _nextFrameTimesOffset{ 0 }; //!< Next offset to overwrite the _lastFrameTimes ring buffer.
+    /**
+     * @brief Restarts deadline scheduling at the given counter value.
+     * @param now The performance counter value to use as the new epoch.
+     */
+    void ResetSchedule(uint64_t now);
 
-};
+    static constexpr double SpinMarginSeconds{0.002}; //!< Time before a deadline which is spent spinning instead of sleeping.
+
+    uint64_t _counterFrequency{1}; //!< Performance counter ticks per second.
+    uint64_t _spinMarginTicks{0}; //!< SpinMarginSeconds in performance counter ticks.
 
+    double _targetFps{0.0}; //!< Currently targeted frames per second, 0 if unlimited.
+    double _targetFrameTicks{0.0}; //!< Targeted time per frame in (fractional) performance counter ticks.
 
+    uint64_t _frameStartTicks{0}; //!< Performance counter value when the current frame was started.
+    uint64_t _epochTicks{0}; //!< Performance counter value all frame deadlines are scheduled relative to.
+    uint64_t _framesSinceEpoch{0}; //!< Number of frames completed since _epochTicks.
+
+    uint64_t _lastFrameTimes[10]{}; //!< Actual counter time of the last ten frames, including limiting delay.
+    int _nextFrameTimesOffset{0}; //!< Next offset to overwrite the _lastFrameTimes ring buffer.
+    bool _lastFrameMissedDeadline{false}; //!< True if the last frame finished after its deadline.
+};
@@ -0,0 +1,368 @@
+#include "FrameProfiler.h"
+
+#include <SDL2/SDL.h>
+
+#ifdef USE_GLEW
+#include <GL/glew.h>
+#endif
+
+#include <SDL2/SDL_opengl.h>
+
+#include <Poco/Logger.h>
+
+#include <cstring>
+#include <string>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+#ifndef GL_MAJOR_VERSION
+#define GL_MAJOR_VERSION 0x821B
+#endif
+
+#ifndef GL_MINOR_VERSION
+#define GL_MINOR_VERSION 0x821C
+#endif
+
+struct FrameProfiler::QueryFunctions {
+    void(APIENTRY* genQueries)(GLsizei, GLuint*){nullptr};
+    void(APIENTRY* deleteQueries)(GLsizei, const GLuint*){nullptr};
+    void(APIENTRY* beginQuery)(GLenum, GLuint){nullptr};
+    void(APIENTRY* endQuery)(GLenum){nullptr};
+    void(APIENTRY* getQueryObjectuiv)(GLuint, GLenum, GLuint*){nullptr};
+    void(APIENTRY* getQueryObjectui64v)(GLuint, GLenum, GLuint64*){nullptr};
+};
+
+FrameProfiler::ScopedStage::ScopedStage(FrameProfiler& profiler, Stage stage)
+    : _profiler(profiler)
+    , _stage(stage)
+    , _traceScope("render", StageName(stage))
+{
+    _profiler.BeginStage(_stage);
+}
+
+FrameProfiler::ScopedStage::~ScopedStage()
+{
+    _profiler.EndStage(_stage);
+}
+
+FrameProfiler::FrameProfiler()
+    : _gl(new QueryFunctions)
+    , _counterFrequency(SDL_GetPerformanceFrequency())
+{
+}
+
+FrameProfiler::~FrameProfiler() = default;
+
+void FrameProfiler::Initialize()
+{
+    auto& logger = Poco::Logger::get("FrameProfiler");
+
+    if (!LoadQueryFunctions())
+    {
+        poco_information(logger, "GL timer queries are not supported by the driver, only recording CPU stage times.");
+        return;
+    }
+
+    for (auto& slotQueries : _queries)
+    {
+        _gl->genQueries(StageCount, slotQueries);
+    }
+
+    _gpuTimingAvailable = true;
+
+    poco_debug(logger, "GL timer queries available, recording CPU and GPU stage times.");
+}
+
+void FrameProfiler::Shutdown()
+{
+    if (!_gpuTimingAvailable)
+    {
+        return;
+    }
+
+    for (auto& slotQueries : _queries)
+    {
+        _gl->deleteQueries(StageCount, slotQueries);
+    }
+
+    std::memset(_queries, 0, sizeof(_queries));
+    std::memset(_queryIssued, 0, sizeof(_queryIssued));
+    std::memset(_queryFrameNumber, 0, sizeof(_queryFrameNumber));
+
+    _gpuTimingAvailable = false;
+}
+
+void FrameProfiler::BeginFrame()
+{
+    _frameNumber++;
+
+    auto& sample = _samples[_frameNumber % SampleCount];
+    sample = FrameSample();
+    sample.frameNumber = _frameNumber;
+
+    if (_gpuTimingAvailable)
+    {
+        int slot = static_cast<int>(_frameNumber % GpuQueryLatency);
+        CollectGpuResults(slot);
+        _queryFrameNumber[slot] = _frameNumber;
+    }
+}
+
+void FrameProfiler::EndFrame()
+{
+    _lastCompletedFrameNumber = _frameNumber;
+}
+
+void FrameProfiler::BeginStage(Stage stage)
+{
+    if (_gpuTimingAvailable)
+    {
+        int slot = static_cast<int>(_frameNumber % GpuQueryLatency);
+        _gl->beginQuery(GL_TIME_ELAPSED, _queries[slot][static_cast<int>(stage)]);
+    }
+
+    _stageStartTicks = SDL_GetPerformanceCounter();
+}
+
+void FrameProfiler::EndStage(Stage stage)
+{
+    auto stageTicks = SDL_GetPerformanceCounter() - _stageStartTicks;
+
+    auto& sample = _samples[_frameNumber % SampleCount];
+    sample.cpuMilliseconds[static_cast<int>(stage)] += static_cast<double>(stageTicks) * 1000.0 / static_cast<double>(_counterFrequency);
+
+    if (_gpuTimingAvailable)
+    {
+        int slot = static_cast<int>(_frameNumber % GpuQueryLatency);
+        _gl->endQuery(GL_TIME_ELAPSED);
+        _queryIssued[slot][static_cast<int>(stage)] = true;
+    }
+}
+
+bool FrameProfiler::GpuTimingAvailable() const
+{
+    return _gpuTimingAvailable;
+}
+
+const FrameProfiler::FrameSample& FrameProfiler::LastSample() const
+{
+    return _samples[_lastCompletedFrameNumber % SampleCount];
+}
+
+std::vector<FrameProfiler::FrameSample> FrameProfiler::Samples() const
+{
+    std::vector<FrameSample> samples;
+
+    if (_lastCompletedFrameNumber == 0)
+    {
+        return samples;
+    }
+
+    uint64_t firstFrame = _lastCompletedFrameNumber >= SampleCount ? _lastCompletedFrameNumber - SampleCount + 1 : 1;
+    samples.reserve(_lastCompletedFrameNumber - firstFrame + 1);
+
+    for (uint64_t frame = firstFrame; frame <= _lastCompletedFrameNumber; frame++)
+    {
+        const auto& sample = _samples[frame % SampleCount];
+        if (sample.frameNumber == frame)
+        {
+            samples.push_back(sample);
+        }
+    }
+
+    return samples;
+}
+
+FrameProfiler::FrameSample FrameProfiler::AverageSample() const
+{
+    FrameSample average;
+
+    uint64_t cpuFrames{0};
+    uint64_t gpuFrames{0};
+
+    for (const auto& sample : Samples())
+    {
+        cpuFrames++;
+        for (int stage = 0; stage < StageCount; stage++)
+        {
+            average.cpuMilliseconds[stage] += sample.cpuMilliseconds[stage];
+        }
+
+        if (sample.gpuValid)
+        {
+            gpuFrames++;
+            for (int stage = 0; stage < StageCount; stage++)
+            {
+                average.gpuMilliseconds[stage] += sample.gpuMilliseconds[stage];
+            }
+        }
+    }
+
+    for (int stage = 0; stage < StageCount; stage++)
+    {
+        if (cpuFrames > 0)
+        {
+            average.cpuMilliseconds[stage] /= static_cast<double>(cpuFrames);
+        }
+        if (gpuFrames > 0)
+        {
+            average.gpuMilliseconds[stage] /= static_cast<double>(gpuFrames);
+        }
+    }
+
+    average.frameNumber = cpuFrames;
+    average.gpuValid = gpuFrames > 0;
+
+    return average;
+}
+
+void FrameProfiler::WriteCSV(std::ostream& stream) const
+{
+    stream << "frame";
+    for (int stage = 0; stage < StageCount; stage++)
+    {
+        stream << ",cpu_" << StageName(static_cast<Stage>(stage));
+    }
+    for (int stage = 0; stage < StageCount; stage++)
+    {
+        stream << ",gpu_" << StageName(static_cast<Stage>(stage));
+    }
+    stream << "\n";
+
+    for (const auto& sample : Samples())
+    {
+        stream << sample.frameNumber;
+        for (double cpuTime : sample.cpuMilliseconds)
+        {
+            stream << "," << cpuTime;
+        }
+        for (double gpuTime : sample.gpuMilliseconds)
+        {
+            stream << ",";
+            if (sample.gpuValid)
+            {
+                stream << gpuTime;
+            }
+        }
+        stream << "\n";
+    }
+}
+
+const char* FrameProfiler::StageName(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::PollEvents:
+            return "PollEvents";
+        case Stage::CheckViewportSize:
+            return "CheckViewportSize";
+        case Stage::FillBuffer:
+            return "FillBuffer";
+        case Stage::RenderFrame:
+            return "RenderFrame";
+        case Stage::DrawGUI:
+            return "DrawGUI";
+        case Stage::Swap:
+            return "Swap";
+        default:
+            return "Unknown";
+    }
+}
+
+void FrameProfiler::CollectGpuResults(int slot)
+{
+    uint64_t frameNumber = _queryFrameNumber[slot];
+    if (frameNumber == 0)
+    {
+        return;
+    }
+
+    // Results for a frame arrive in submission order, so the last issued query is checked first.
+    int lastIssuedStage{-1};
+    for (int stage = 0; stage < StageCount; stage++)
+    {
+        if (_queryIssued[slot][stage])
+        {
+            lastIssuedStage = stage;
+        }
+    }
+
+    bool resultsAvailable{lastIssuedStage >= 0};
+    if (resultsAvailable)
+    {
+        GLuint available{GL_FALSE};
+        _gl->getQueryObjectuiv(_queries[slot][lastIssuedStage], GL_QUERY_RESULT_AVAILABLE, &available);
+        resultsAvailable = available != GL_FALSE;
+    }
+
+    // Only store results if the frame is still in the ring buffer. If the GPU lags behind more
+    // than the query latency, the results are dropped instead of waiting for them.
+    auto& sample = _samples[frameNumber % SampleCount];
+    if (resultsAvailable && sample.frameNumber == frameNumber)
+    {
+        for (int stage = 0; stage < StageCount; stage++)
+        {
+            if (!_queryIssued[slot][stage])
+            {
+                continue;
+            }
+
+            GLuint64 elapsedNanoseconds{0};
+            _gl->getQueryObjectui64v(_queries[slot][stage], GL_QUERY_RESULT, &elapsedNanoseconds);
+            sample.gpuMilliseconds[stage] = static_cast<double>(elapsedNanoseconds) / 1000000.0;
+        }
+
+        sample.gpuValid = true;
+    }
+
+    std::memset(_queryIssued[slot], 0, sizeof(_queryIssued[slot]));
+    _queryFrameNumber[slot] = 0;
+}
+
+bool FrameProfiler::LoadQueryFunctions()
+{
+#if USE_GLES
+    if (!SDL_GL_ExtensionSupported("GL_EXT_disjoint_timer_query"))
+    {
+        return false;
+    }
+
+    const char* suffix = "EXT";
+#else
+    GLint majorVersion{0};
+    GLint minorVersion{0};
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+    if (majorVersion * 10 + minorVersion < 33 && !SDL_GL_ExtensionSupported("GL_ARB_timer_query"))
+    {
+        return false;
+    }
+
+    const char* suffix = "";
+#endif
+
+    auto load = [suffix](const char* name) {
+        return SDL_GL_GetProcAddress((std::string(name) + suffix).c_str());
+    };
+
+    _gl->genQueries = reinterpret_cast<decltype(_gl->genQueries)>(load("glGenQueries"));
+    _gl->deleteQueries = reinterpret_cast<decltype(_gl->deleteQueries)>(load("glDeleteQueries"));
+    _gl->beginQuery = reinterpret_cast<decltype(_gl->beginQuery)>(load("glBeginQuery"));
+    _gl->endQuery = reinterpret_cast<decltype(_gl->endQuery)>(load("glEndQuery"));
+    _gl->getQueryObjectuiv = reinterpret_cast<decltype(_gl->getQueryObjectuiv)>(load("glGetQueryObjectuiv"));
+    _gl->getQueryObjectui64v = reinterpret_cast<decltype(_gl->getQueryObjectui64v)>(load("glGetQueryObjectui64v"));
+
+    return _gl->genQueries && _gl->deleteQueries && _gl->beginQuery && _gl->endQuery &&
+           _gl->getQueryObjectuiv && _gl->getQueryObjectui64v;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Tracer.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Measures the CPU and GPU time spent in each stage of the render loop.
+ *
+ * CPU times are taken from SDL's performance counter. If the OpenGL driver supports timer queries
+ * (GL 3.3 core, ARB_timer_query or EXT_disjoint_timer_query on GLES), each stage is also wrapped in a
+ * GL_TIME_ELAPSED query. Query results are only read back once the query slot is reused a few frames
+ * later, and only if the driver already reports them as available, so profiling never stalls the
+ * pipeline.
+ *
+ * Completed frames are stored in a fixed-size ring buffer which can be read by the GUI overlay or
+ * exported to a file.
+ */
+class FrameProfiler
+{
+public:
+    /**
+     * @brief The instrumented stages of a single render loop iteration, in execution order.
+     */
+    enum class Stage
+    {
+        PollEvents,
+        CheckViewportSize,
+        FillBuffer,
+        RenderFrame,
+        DrawGUI,
+        Swap,
+        Count //!< Number of stages, not a real stage.
+    };
+
+    static constexpr int StageCount{static_cast<int>(Stage::Count)}; //!< Number of instrumented stages.
+    static constexpr int SampleCount{256}; //!< Number of frames kept in the ring buffer.
+
+    /**
+     * @brief Timings of a single frame.
+     */
+    struct FrameSample {
+        uint64_t frameNumber{0}; //!< Running frame number, starting at 1. 0 if the sample is unused.
+        double cpuMilliseconds[StageCount]{}; //!< CPU time per stage in milliseconds.
+        double gpuMilliseconds[StageCount]{}; //!< GPU time per stage in milliseconds, only valid if gpuValid is true.
+        bool gpuValid{false}; //!< True if the GPU timer query results for this frame have been retrieved.
+    };
+
+    /**
+     * @brief Measures the CPU (and GPU) time of a stage for as long as the object lives.
+     *
+     * Also records the stage as a trace event if tracing is enabled.
+     */
+    class ScopedStage
+    {
+    public:
+        ScopedStage(FrameProfiler& profiler, Stage stage);
+
+        ~ScopedStage();
+
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+    private:
+        FrameProfiler& _profiler; //!< The profiler receiving the measurement.
+        Stage _stage; //!< The measured stage.
+        Tracer::Scope _traceScope; //!< Trace event for the stage.
+    };
+
+    FrameProfiler();
+
+    ~FrameProfiler();
+
+    /**
+     * @brief Checks for timer query support and creates the GL query objects.
+     *
+     * Must be called with the rendering GL context being current.
+     */
+    void Initialize();
+
+    /**
+     * @brief Deletes all GL query objects.
+     *
+     * Must be called with the rendering GL context being current.
+     */
+    void Shutdown();
+
+    /**
+     * @brief Starts a new frame.
+     *
+     * Also collects the GPU timings of the frame which previously used the same query slot, if the
+     * results are available without waiting.
+     */
+    void BeginFrame();
+
+    /**
+     * @brief Finishes the current frame and makes its CPU timings available to readers.
+     */
+    void EndFrame();
+
+    /**
+     * @brief Starts measuring a stage. Prefer using ScopedStage.
+     * @param stage The stage to measure.
+     */
+    void BeginStage(Stage stage);
+
+    /**
+     * @brief Stops measuring the given stage.
+     * @param stage The stage to stop measuring. Must be the stage most recently started.
+     */
+    void EndStage(Stage stage);
+
+    /**
+     * @brief Returns whether GPU timings are recorded.
+     * @return True if the driver supports timer queries, false if only CPU times are recorded.
+     */
+    bool GpuTimingAvailable() const;
+
+    /**
+     * @brief Returns the most recently completed frame.
+     * @return The last frame sample. GPU timings are not yet available for this frame.
+     */
+    const FrameSample& LastSample() const;
+
+    /**
+     * @brief Returns the completed frames currently stored in the ring buffer.
+     * @return The frame samples, oldest first.
+     */
+    std::vector<FrameSample> Samples() const;
+
+    /**
+     * @brief Averages the timings of all completed frames in the ring buffer.
+     *
+     * GPU timings are only averaged over the frames with valid GPU results. The frame number of the
+     * returned sample is set to the number of averaged frames.
+     *
+     * @return The averaged frame sample.
+     */
+    FrameSample AverageSample() const;
+
+    /**
+     * @brief Writes all stored frame samples as CSV, one line per frame.
+     * @param stream The stream to write to.
+     */
+    void WriteCSV(std::ostream& stream) const;
+
+    /**
+     * @brief Returns a human-readable name for the given stage.
+     * @param stage The stage.
+     * @return The stage name.
+     */
+    static const char* StageName(Stage stage);
+
+protected:
+    static constexpr int GpuQueryLatency{4}; //!< Number of frames GPU query results are read back after being issued.
+
+    /**
+     * @brief Reads the results of the given query slot if they are available and stores them in the frame sample.
+     * @param slot The query slot to read.
+     */
+    void CollectGpuResults(int slot);
+
+    /**
+     * @brief Resolves the timer query functions from the GL driver.
+     * @return True if all required functions are available, false if not.
+     */
+    bool LoadQueryFunctions();
+
+    struct QueryFunctions;
+
+    std::unique_ptr<QueryFunctions> _gl; //!< Timer query functions resolved from the GL driver.
+
+    bool _gpuTimingAvailable{false}; //!< True if timer queries are supported and query objects were created.
+
+    unsigned int _queries[GpuQueryLatency][StageCount]{}; //!< GL query object names per slot and stage.
+    bool _queryIssued[GpuQueryLatency][StageCount]{}; //!< True if the query was issued for the frame in the slot.
+    uint64_t _queryFrameNumber[GpuQueryLatency]{}; //!< Frame number the query slot was last used for, 0 if unused.
+
+    uint64_t _counterFrequency{1}; //!< Performance counter ticks per second.
+    uint64_t _stageStartTicks{0}; //!< Performance counter value when the current stage was started.
+
+    uint64_t _frameNumber{0}; //!< Number of the current frame.
+    uint64_t _lastCompletedFrameNumber{0}; //!< Number of the last frame passed to EndFrame().
+
+    FrameSample _samples[SampleCount]; //!< Ring buffer of frame samples, indexed by frame number.
+};
@@ -0,0 +1,119 @@
+#include "FrameTimeHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+void FrameTimeHistogram::Record(uint64_t frameTimeMicroseconds, bool missedDeadline)
+{
+    auto value = static_cast<uint32_t>(std::min<uint64_t>(frameTimeMicroseconds, UINT32_MAX));
+
+    _counts[BucketIndex(value)]++;
+    _frameCount++;
+
+    if (missedDeadline)
+    {
+        _missedDeadlines++;
+    }
+
+    _minimum = std::min(_minimum, value);
+    _maximum = std::max(_maximum, value);
+}
+
+double FrameTimeHistogram::Percentile(double percentile) const
+{
+    if (_frameCount == 0)
+    {
+        return 0.0;
+    }
+
+    percentile = std::max(0.0, std::min(100.0, percentile));
+    auto rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(_frameCount)));
+    rank = std::max<uint64_t>(rank, 1);
+
+    // The lowest and highest ranks are known exactly, the buckets only approximate them.
+    if (rank == 1)
+    {
+        return static_cast<double>(_minimum) / 1000.0;
+    }
+    if (rank >= _frameCount)
+    {
+        return static_cast<double>(_maximum) / 1000.0;
+    }
+
+    uint64_t cumulativeCount{0};
+    for (uint32_t index = 0; index < BucketCount; index++)
+    {
+        cumulativeCount += _counts[index];
+        if (cumulativeCount >= rank)
+        {
+            auto value = std::max(static_cast<double>(_minimum), std::min(static_cast<double>(_maximum), BucketValue(index)));
+            return value / 1000.0;
+        }
+    }
+
+    return static_cast<double>(_maximum) / 1000.0;
+}
+
+FrameTimeHistogram::Summary FrameTimeHistogram::GetSummary() const
+{
+    Summary summary;
+
+    summary.frameCount = _frameCount;
+    summary.missedDeadlines = _missedDeadlines;
+
+    if (_frameCount > 0)
+    {
+        summary.minimum = static_cast<double>(_minimum) / 1000.0;
+        summary.p50 = Percentile(50.0);
+        summary.p95 = Percentile(95.0);
+        summary.p99 = Percentile(99.0);
+        summary.maximum = static_cast<double>(_maximum) / 1000.0;
+    }
+
+    return summary;
+}
+
+void FrameTimeHistogram::Reset()
+{
+    std::fill(std::begin(_counts), std::end(_counts), 0);
+    _frameCount = 0;
+    _missedDeadlines = 0;
+    _minimum = UINT32_MAX;
+    _maximum = 0;
+}
+
+uint32_t FrameTimeHistogram::BucketIndex(uint32_t value)
+{
+    if (value < 2 * SubBucketCount)
+    {
+        return value;
+    }
+
+    uint32_t highestBit{SubBucketBits + 1};
+    while (highestBit < 31 && (value >> (highestBit + 1)) != 0)
+    {
+        highestBit++;
+    }
+
+    // Top (SubBucketBits + 1) bits of the value, including the leading one.
+    uint32_t shift = highestBit - SubBucketBits;
+    uint32_t subBucket = (value >> shift) - SubBucketCount;
+
+    return 2 * SubBucketCount + (shift - 1) * SubBucketCount + subBucket;
+}
+
+double FrameTimeHistogram::BucketValue(uint32_t index)
+{
+    if (index < 2 * SubBucketCount)
+    {
+        return static_cast<double>(index);
+    }
+
+    uint32_t offset = index - 2 * SubBucketCount;
+    uint32_t shift = offset / SubBucketCount + 1;
+    uint64_t lowerBound = static_cast<uint64_t>(offset % SubBucketCount + SubBucketCount) << shift;
+    uint64_t bucketWidth = uint64_t{1} << shift;
+
+    return static_cast<double>(lowerBound) + static_cast<double>(bucketWidth - 1) / 2.0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Fixed-memory, log-bucketed frame time histogram.
+ *
+ * Works similar to an HDR histogram: frame times are recorded in microseconds, values below 64 µs
+ * are stored exactly, and every power-of-two range above is split into 32 linear sub-buckets. This
+ * gives a relative error of at most ~3% over the whole range up to 2^32 µs while using a constant
+ * amount of memory and O(1) recording cost.
+ */
+class FrameTimeHistogram
+{
+public:
+    /**
+     * @brief Frame time statistics calculated from the histogram.
+     */
+    struct Summary {
+        uint64_t frameCount{0}; //!< Number of recorded frames.
+        uint64_t missedDeadlines{0}; //!< Number of frames which finished after their deadline.
+        double minimum{0.0}; //!< Shortest frame time in milliseconds.
+        double p50{0.0}; //!< Median frame time in milliseconds.
+        double p95{0.0}; //!< 95th percentile frame time in milliseconds.
+        double p99{0.0}; //!< 99th percentile frame time in milliseconds.
+        double maximum{0.0}; //!< Longest frame time in milliseconds.
+    };
+
+    /**
+     * @brief Records a single frame.
+     * @param frameTimeMicroseconds The frame time in microseconds.
+     * @param missedDeadline True if the frame finished after its scheduled deadline.
+     */
+    void Record(uint64_t frameTimeMicroseconds, bool missedDeadline);
+
+    /**
+     * @brief Returns the frame time at the given percentile.
+     * @param percentile The percentile, from 0.0 to 100.0.
+     * @return The frame time in milliseconds, or zero if no frames have been recorded.
+     */
+    double Percentile(double percentile) const;
+
+    /**
+     * @brief Calculates min, max and the commonly used percentiles.
+     * @return The frame time statistics.
+     */
+    Summary GetSummary() const;
+
+    /**
+     * @brief Clears all recorded frames.
+     */
+    void Reset();
+
+protected:
+    static constexpr uint32_t SubBucketBits{5}; //!< Number of bits used for linear sub-buckets.
+    static constexpr uint32_t SubBucketCount{1U << SubBucketBits}; //!< Linear sub-buckets per power-of-two range.
+    static constexpr uint32_t BucketCount{2 * SubBucketCount + (32 - SubBucketBits - 1) * SubBucketCount}; //!< Total number of buckets for 32-bit values.
+
+    /**
+     * @brief Returns the bucket index for the given value.
+     * @param value The value in microseconds.
+     * @return The bucket index.
+     */
+    static uint32_t BucketIndex(uint32_t value);
+
+    /**
+     * @brief Returns the value in the middle of the given bucket.
+     * @param index The bucket index.
+     * @return The representative value of the bucket in microseconds.
+     */
+    static double BucketValue(uint32_t index);
+
+    uint64_t _counts[BucketCount]{}; //!< Number of recorded frames per bucket.
+    uint64_t _frameCount{0}; //!< Total number of recorded frames.
+    uint64_t _missedDeadlines{0}; //!< Number of recorded frames which missed their deadline.
+    uint32_t _minimum{UINT32_MAX}; //!< Exact minimum recorded value in microseconds.
+    uint32_t _maximum{0}; //!< Exact maximum recorded value in microseconds.
+};
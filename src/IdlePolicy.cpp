@@ -0,0 +1,64 @@
+#include "IdlePolicy.h"
+
+#include <algorithm>
+#include <cmath>
+
+void IdlePolicy::Configure(bool pauseWhenHidden, double silenceThreshold, int silenceTimeoutSeconds, double idleFps, bool pauseWhenSilent)
+{
+    _pauseWhenHidden = pauseWhenHidden;
+    _silenceThreshold = static_cast<float>(silenceThreshold);
+    _silenceTimeoutMilliseconds = static_cast<uint64_t>(std::max(silenceTimeoutSeconds, 0)) * 1000;
+    _idleFps = std::max(idleFps, 1.0);
+    _pauseWhenSilent = pauseWhenSilent;
+}
+
+void IdlePolicy::WindowVisible(bool visible)
+{
+    _windowVisible = visible;
+}
+
+void IdlePolicy::Activity(uint64_t ticks)
+{
+    _lastActivityTicks = ticks;
+}
+
+bool IdlePolicy::Update(float level, uint64_t ticks)
+{
+    if (level > _silenceThreshold)
+    {
+        _lastActivityTicks = ticks;
+    }
+
+    Reason reason{Reason::None};
+    if (!_windowVisible && _pauseWhenHidden)
+    {
+        reason = Reason::Hidden;
+    }
+    else if (_silenceTimeoutMilliseconds > 0 && ticks - _lastActivityTicks >= _silenceTimeoutMilliseconds)
+    {
+        reason = Reason::Silence;
+    }
+
+    if (reason == _reason)
+    {
+        return false;
+    }
+
+    _reason = reason;
+    return true;
+}
+
+IdlePolicy::Reason IdlePolicy::IdleReason() const
+{
+    return _reason;
+}
+
+bool IdlePolicy::RenderingPaused() const
+{
+    return _reason == Reason::Hidden || (_reason == Reason::Silence && _pauseWhenSilent);
+}
+
+uint32_t IdlePolicy::IdleIntervalMilliseconds() const
+{
+    return static_cast<uint32_t>(std::lround(1000.0 / _idleFps));
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Decides when the render loop may idle to save power.
+ *
+ * The loop idles while the window is hidden or minimized, or after the audio input has stayed below a
+ * level threshold for a configurable time. While idling, the loop only runs at a low rate to poll events
+ * and audio. Rendering either continues at that rate or is paused entirely, which is always the case
+ * for hidden windows. Audio above the threshold, a visible window or any user input end idling with the
+ * next loop iteration.
+ */
+class IdlePolicy
+{
+public:
+    /**
+     * @brief Why the loop is idling.
+     */
+    enum class Reason
+    {
+        None, //!< Not idling, render at the normal frame rate.
+        Hidden, //!< The window is hidden or minimized.
+        Silence //!< The audio input has been silent for longer than the timeout.
+    };
+
+    /**
+     * @brief Sets the idle parameters.
+     * @param pauseWhenHidden If true, rendering pauses while the window is hidden.
+     * @param silenceThreshold RMS level in dBFS below which the input is considered silent.
+     * @param silenceTimeoutSeconds Seconds of silence before idling. 0 disables silence detection.
+     * @param idleFps Loop iterations per second while idling.
+     * @param pauseWhenSilent If true, rendering pauses on silence. If false, it continues at idleFps.
+     */
+    void Configure(bool pauseWhenHidden, double silenceThreshold, int silenceTimeoutSeconds, double idleFps, bool pauseWhenSilent);
+
+    /**
+     * @brief Updates the window visibility.
+     * @param visible True if the window is shown, false if hidden or minimized.
+     */
+    void WindowVisible(bool visible);
+
+    /**
+     * @brief Restarts the silence timeout, e.g. if the user interacted with the application.
+     * @param ticks The current time in milliseconds.
+     */
+    void Activity(uint64_t ticks);
+
+    /**
+     * @brief Updates the idle state with the latest audio level.
+     * @param level The current RMS level of the audio input in dBFS.
+     * @param ticks The current time in milliseconds.
+     * @return True if the idle reason has changed.
+     */
+    bool Update(float level, uint64_t ticks);
+
+    /**
+     * @brief Returns why the loop is currently idling.
+     * @return The idle reason, or Reason::None if not idling.
+     */
+    Reason IdleReason() const;
+
+    /**
+     * @brief Returns whether projectM rendering should be skipped.
+     * @return True if rendering is paused.
+     */
+    bool RenderingPaused() const;
+
+    /**
+     * @brief Returns the maximum time to wait for events between two loop iterations while idling.
+     * @return The wait time in milliseconds.
+     */
+    uint32_t IdleIntervalMilliseconds() const;
+
+protected:
+    bool _pauseWhenHidden{true}; //!< If true, hidden windows make the loop idle.
+    float _silenceThreshold{-60.0f}; //!< Level in dBFS below which the input is considered silent.
+    uint64_t _silenceTimeoutMilliseconds{0}; //!< Silence duration before idling, 0 if disabled.
+    double _idleFps{5.0}; //!< Loop rate while idling.
+    bool _pauseWhenSilent{false}; //!< If true, silence pauses rendering instead of throttling it.
+
+    bool _windowVisible{true}; //!< Current window visibility.
+    uint64_t _lastActivityTicks{0}; //!< Time of the last audio signal or user input.
+    Reason _reason{Reason::None}; //!< Current idle reason.
+};
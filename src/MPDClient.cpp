@@ -0,0 +1,223 @@
+#include "MPDClient.h"
+
+#include "Tracer.h"
+
+#include "mpd/client.h"
+
+MPDClient::~MPDClient()
+{
+    Stop();
+}
+
+void MPDClient::Start(const std::string& host, unsigned int port)
+{
+    if (_running)
+    {
+        return;
+    }
+
+    _host = host;
+    _port = port;
+
+    _backoff.Reset();
+    _stopEvent.reset();
+    _state = State::Disconnected;
+    _running = true;
+    _workerThreadResult = _workerThread();
+}
+
+void MPDClient::Stop()
+{
+    if (!_running)
+    {
+        return;
+    }
+
+    _running = false;
+    _stopEvent.set();
+    _commandEvent.set();
+    _workerThreadResult.wait();
+
+    Poco::Mutex::ScopedLock lock(_commandsMutex);
+    _commands.clear();
+    _state = State::Stopped;
+}
+
+MPDClient::State MPDClient::ConnectionState() const
+{
+    return _state;
+}
+
+uint64_t MPDClient::ConnectionId() const
+{
+    return _connectionId;
+}
+
+void MPDClient::Post(const char* name, Command command, Retry retry)
+{
+    if (!_running)
+    {
+        return;
+    }
+
+    {
+        Poco::Mutex::ScopedLock lock(_commandsMutex);
+
+        if (_commands.size() >= MaximumPendingCommands)
+        {
+            poco_debug_f1(_logger, "Too many pending MPD commands, dropping %s.", std::string(_commands.front().name));
+            _commands.pop_front();
+        }
+
+        PendingCommand pendingCommand;
+        pendingCommand.name = name;
+        pendingCommand.command = std::move(command);
+        pendingCommand.retry = retry;
+        pendingCommand.queued = std::chrono::steady_clock::now();
+        _commands.push_back(std::move(pendingCommand));
+    }
+
+    _commandEvent.set();
+}
+
+void MPDClient::WorkerThread()
+{
+    Tracer::RegisterThread("MPD commands");
+
+    while (_running)
+    {
+        if (_connection == nullptr)
+        {
+            _state = State::Connecting;
+            if (!Connect())
+            {
+                _state = State::Disconnected;
+                _stopEvent.tryWait(_backoff.NextDelay());
+                continue;
+            }
+
+            _backoff.Reset();
+            _state = State::Connected;
+        }
+
+        PendingCommand command;
+        if (!NextCommand(command))
+        {
+            _commandEvent.tryWait(1000);
+            continue;
+        }
+
+        if (Execute(command))
+        {
+            continue;
+        }
+
+        // The server may have executed the command before the connection broke, so only repeat it if that's harmless.
+        if (command.retry == Retry::Never)
+        {
+            poco_warning_f1(_logger, "Not retrying MPD command %s, it may already have been executed.", std::string(command.name));
+        }
+        else if (!command.retried)
+        {
+            // Typically the server closed the idle connection. Try again once reconnected.
+            command.retried = true;
+
+            Poco::Mutex::ScopedLock lock(_commandsMutex);
+            _commands.push_front(std::move(command));
+        }
+    }
+
+    Disconnect();
+}
+
+bool MPDClient::Connect()
+{
+    Tracer::Scope trace("mpd", "Connect");
+
+    _connection = mpd_connection_new(_host.c_str(), _port, ConnectTimeoutMilliseconds);
+    if (_connection == nullptr)
+    {
+        poco_error(_logger, "Out of memory while creating the MPD connection.");
+        return false;
+    }
+
+    if (mpd_connection_get_error(_connection) != MPD_ERROR_SUCCESS)
+    {
+        poco_debug_f1(_logger, "Connecting to MPD failed: %s", std::string(mpd_connection_get_error_message(_connection)));
+        mpd_connection_free(_connection);
+        _connection = nullptr;
+        return false;
+    }
+
+    _connectionId++;
+
+    poco_information_f2(_logger, R"(Connected to MPD at "%s", port %u.)", _host, _port);
+
+    return true;
+}
+
+void MPDClient::Disconnect()
+{
+    if (_connection == nullptr)
+    {
+        return;
+    }
+
+    mpd_connection_free(_connection);
+    _connection = nullptr;
+}
+
+bool MPDClient::NextCommand(PendingCommand& command)
+{
+    Poco::Mutex::ScopedLock lock(_commandsMutex);
+
+    auto now = std::chrono::steady_clock::now();
+    while (!_commands.empty())
+    {
+        command = std::move(_commands.front());
+        _commands.pop_front();
+
+        if (now - command.queued <= CommandExpiry)
+        {
+            return true;
+        }
+
+        poco_debug_f1(_logger, "Dropping stale MPD command %s.", std::string(command.name));
+    }
+
+    return false;
+}
+
+bool MPDClient::Execute(PendingCommand& command)
+{
+    Tracer::Scope trace("mpd", command.name);
+
+    command.command(_connection);
+
+    // Make sure no unread response is left over for the next command.
+    if (mpd_connection_get_error(_connection) == MPD_ERROR_SUCCESS)
+    {
+        mpd_response_finish(_connection);
+    }
+
+    if (mpd_connection_get_error(_connection) == MPD_ERROR_SUCCESS)
+    {
+        return true;
+    }
+
+    std::string message = mpd_connection_get_error_message(_connection);
+
+    // Server errors only affect the current command and can be cleared.
+    if (mpd_connection_clear_error(_connection))
+    {
+        poco_warning_f2(_logger, "MPD command %s failed: %s", std::string(command.name), message);
+        return true;
+    }
+
+    poco_warning_f2(_logger, "MPD connection lost during %s: %s", std::string(command.name), message);
+
+    Disconnect();
+    _state = State::Disconnected;
+
+    return false;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "ReconnectBackoff.h"
+
+#include <Poco/ActiveMethod.h>
+#include <Poco/Event.h>
+#include <Poco/Logger.h>
+#include <Poco/Mutex.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+
+struct mpd_connection;
+
+/**
+ * @brief Owns the MPD command connection and executes commands on a background thread.
+ *
+ * The client connects in the background and reconnects with an exponential backoff whenever the
+ * connection is lost, so neither startup nor rendering ever wait for MPD. Commands posted while
+ * disconnected are queued and sent once the connection is back, unless they have become stale in
+ * the meantime, in which case they're dropped.
+ *
+ * Server-side errors (e.g. an unknown playlist) only fail the affected command. Any other error
+ * closes the connection and triggers a reconnect; the failed command is retried once if it's
+ * retryable. As the server may already have executed a command before the connection broke,
+ * commands which aren't idempotent (e.g. "next" or "add") must be posted with Retry::Never.
+ */
+class MPDClient
+{
+public:
+    /**
+     * @brief A command to execute. Receives the connected MPD connection.
+     *
+     * Commands run on the client's worker thread. The client checks the connection error state
+     * afterwards, so commands don't need to handle errors themselves unless they want to.
+     */
+    using Command = std::function<void(struct mpd_connection*)>;
+
+    /**
+     * @brief Connection states.
+     */
+    enum class State
+    {
+        Stopped, //!< Client is not running, commands are ignored.
+        Disconnected, //!< Waiting for the next connection attempt.
+        Connecting, //!< Connection attempt in progress.
+        Connected //!< Connected, commands are executed.
+    };
+
+    /**
+     * @brief Whether a command may be sent again after the connection was lost while executing it.
+     */
+    enum class Retry
+    {
+        Allowed, //!< The command is idempotent and retried once after reconnecting.
+        Never //!< The command must not run twice and is dropped if the connection is lost.
+    };
+
+    ~MPDClient();
+
+    /**
+     * @brief Starts the worker thread, which will then connect to MPD.
+     * @param host The MPD host name or socket path.
+     * @param port The MPD TCP port.
+     */
+    void Start(const std::string& host, unsigned int port);
+
+    /**
+     * @brief Stops the worker thread and closes the connection. Pending commands are discarded.
+     */
+    void Stop();
+
+    /**
+     * @brief Returns the current connection state.
+     * @return The connection state.
+     */
+    State ConnectionState() const;
+
+    /**
+     * @brief Returns the number of connections established so far.
+     *
+     * Commands can compare this value to detect that they're talking to a new connection, e.g. to
+     * discard state that may be outdated after MPD has been restarted.
+     *
+     * @return The connection counter. Only meaningful on the worker thread.
+     */
+    uint64_t ConnectionId() const;
+
+    /**
+     * @brief Queues a command for execution. Never blocks.
+     *
+     * If the client is stopped, the command is ignored.
+     *
+     * @param name The command name used in logs and traces. Must be a string literal.
+     * @param command The command to execute.
+     * @param retry Whether the command may be retried after a connection loss.
+     */
+    void Post(const char* name, Command command, Retry retry = Retry::Allowed);
+
+protected:
+    static constexpr size_t MaximumPendingCommands{64}; //!< Oldest commands are dropped if more are queued.
+    static constexpr std::chrono::seconds CommandExpiry{10}; //!< Commands queued longer than this are not sent anymore.
+    static constexpr unsigned int ConnectTimeoutMilliseconds{5000}; //!< Timeout for connecting and for each command.
+
+    /**
+     * @brief A queued command.
+     */
+    struct PendingCommand {
+        const char* name{nullptr}; //!< Command name.
+        Command command; //!< The command function.
+        std::chrono::steady_clock::time_point queued; //!< Time the command was posted.
+        Retry retry{Retry::Allowed}; //!< Whether the command may be retried after a connection loss.
+        bool retried{false}; //!< True if the command already failed once due to a connection error.
+    };
+
+    /**
+     * @brief Worker thread main loop.
+     */
+    void WorkerThread();
+
+    /**
+     * @brief Opens the connection.
+     * @return True if the connection was established.
+     */
+    bool Connect();
+
+    /**
+     * @brief Closes the connection.
+     */
+    void Disconnect();
+
+    /**
+     * @brief Takes the next non-expired command from the queue.
+     * @param command Receives the command.
+     * @return True if a command was returned, false if the queue is empty.
+     */
+    bool NextCommand(PendingCommand& command);
+
+    /**
+     * @brief Executes a command and handles errors.
+     * @param command The command to execute.
+     * @return True if the connection is still usable, false if it was closed.
+     */
+    bool Execute(PendingCommand& command);
+
+    std::string _host; //!< MPD host name or socket path.
+    unsigned int _port{6600}; //!< MPD TCP port.
+
+    struct mpd_connection* _connection{nullptr}; //!< The command connection. Worker thread only.
+    uint64_t _connectionId{0}; //!< Incremented with each established connection. Worker thread only.
+    ReconnectBackoff _backoff; //!< Delay between reconnection attempts.
+
+    Poco::Mutex _commandsMutex; //!< Protects _commands.
+    std::deque<PendingCommand> _commands; //!< Commands waiting for execution.
+
+    std::atomic<State> _state{State::Stopped}; //!< Current connection state.
+
+    Poco::ActiveMethod<void, void, MPDClient> _workerThread{this, &MPDClient::WorkerThread}; //!< The worker thread.
+    Poco::ActiveResult<void> _workerThreadResult{new Poco::ActiveResultHolder<void>()}; //!< Result of the worker thread, used to join it.
+    std::atomic_bool _running{false}; //!< True while the worker thread should keep running.
+    Poco::Event _commandEvent; //!< Signaled if a command was posted.
+    Poco::Event _stopEvent; //!< Signaled to interrupt backoff waits.
+
+    Poco::Logger& _logger{Poco::Logger::get("MPDClient")}; //!< The class logger.
+};
@@ -0,0 +1,258 @@
+#include "MPDStatusWorker.h"
+
+#include "Tracer.h"
+
+#include "mpd/client.h"
+#include "mpd/status.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+
+unsigned int MPDStatus::ElapsedSeconds(std::chrono::steady_clock::time_point now) const
+{
+    if (!connected || !playing)
+    {
+        return elapsedSeconds;
+    }
+
+    auto elapsed = elapsedSeconds + static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::seconds>(now - timestamp).count());
+    if (totalSeconds > 0)
+    {
+        elapsed = std::min(elapsed, totalSeconds);
+    }
+
+    return elapsed;
+}
+
+MPDStatusWorker::~MPDStatusWorker()
+{
+    Stop();
+}
+
+void MPDStatusWorker::Start(const std::string& host, unsigned int port)
+{
+    if (_running)
+    {
+        return;
+    }
+
+    _host = host;
+    _port = port;
+
+    _backoff.Reset();
+    _stopEvent.reset();
+    _running = true;
+    _workerThreadResult = _workerThread();
+}
+
+void MPDStatusWorker::Stop()
+{
+    if (!_running)
+    {
+        return;
+    }
+
+    _running = false;
+    _stopEvent.set();
+    _workerThreadResult.wait();
+}
+
+std::shared_ptr<const MPDStatus> MPDStatusWorker::Status() const
+{
+    return std::atomic_load(&_status);
+}
+
+void MPDStatusWorker::WorkerThread()
+{
+    Tracer::RegisterThread("MPD status");
+
+    while (_running)
+    {
+        if (_connection == nullptr)
+        {
+            if (!Connect())
+            {
+                _stopEvent.tryWait(_backoff.NextDelay());
+                continue;
+            }
+        }
+
+        if (!Refresh())
+        {
+            Disconnect();
+            _stopEvent.tryWait(_backoff.NextDelay());
+            continue;
+        }
+
+        _backoff.Reset();
+
+        while (_running && _connection != nullptr && !WaitForChanges())
+        {
+        }
+    }
+
+    Disconnect();
+}
+
+bool MPDStatusWorker::Connect()
+{
+    Tracer::Scope trace("mpd", "StatusConnect");
+
+    // Stop() can't interrupt a pending connect, so keep the timeout short.
+    _connection = mpd_connection_new(_host.c_str(), _port, ConnectTimeoutMilliseconds);
+    if (_connection == nullptr)
+    {
+        poco_error(_logger, "Out of memory while creating the MPD status connection.");
+        return false;
+    }
+
+    if (mpd_connection_get_error(_connection) != MPD_ERROR_SUCCESS)
+    {
+        poco_debug_f1(_logger, "MPD status connection failed: %s", std::string(mpd_connection_get_error_message(_connection)));
+        mpd_connection_free(_connection);
+        _connection = nullptr;
+        return false;
+    }
+
+    poco_debug(_logger, "MPD status connection established.");
+
+    return true;
+}
+
+void MPDStatusWorker::Disconnect()
+{
+    if (_connection == nullptr)
+    {
+        return;
+    }
+
+    if (_idling && mpd_connection_get_error(_connection) == MPD_ERROR_SUCCESS)
+    {
+        mpd_run_noidle(_connection);
+    }
+
+    mpd_connection_free(_connection);
+    _connection = nullptr;
+    _idling = false;
+
+    // Let readers know the status is stale, and stop the elapsed time where the connection was lost.
+    auto status = std::make_shared<MPDStatus>(*Status());
+    auto now = std::chrono::steady_clock::now();
+    status->elapsedSeconds = status->ElapsedSeconds(now);
+    status->timestamp = now;
+    status->connected = false;
+    Publish(status);
+}
+
+bool MPDStatusWorker::Refresh()
+{
+    Tracer::Scope trace("mpd", "StatusRefresh");
+
+    if (!mpd_command_list_begin(_connection, true) ||
+        !mpd_send_status(_connection) ||
+        !mpd_send_current_song(_connection) ||
+        !mpd_command_list_end(_connection))
+    {
+        poco_debug_f1(_logger, "Sending MPD status request failed: %s", std::string(mpd_connection_get_error_message(_connection)));
+        return false;
+    }
+
+    struct mpd_status* mpdStatus = mpd_recv_status(_connection);
+    if (mpdStatus == nullptr)
+    {
+        poco_debug_f1(_logger, "Receiving MPD status failed: %s", std::string(mpd_connection_get_error_message(_connection)));
+        return false;
+    }
+
+    auto status = std::make_shared<MPDStatus>();
+    status->connected = true;
+    status->timestamp = std::chrono::steady_clock::now();
+    status->playing = mpd_status_get_state(mpdStatus) == MPD_STATE_PLAY;
+    status->paused = mpd_status_get_state(mpdStatus) == MPD_STATE_PAUSE;
+    status->repeat = mpd_status_get_repeat(mpdStatus);
+    status->single = mpd_status_get_single(mpdStatus);
+    status->volume = mpd_status_get_volume(mpdStatus);
+    status->songPos = mpd_status_get_song_pos(mpdStatus);
+    status->queueVersion = mpd_status_get_queue_version(mpdStatus);
+    status->queueLength = mpd_status_get_queue_length(mpdStatus);
+    status->elapsedSeconds = mpd_status_get_elapsed_time(mpdStatus);
+    status->totalSeconds = mpd_status_get_total_time(mpdStatus);
+    mpd_status_free(mpdStatus);
+
+    if (!mpd_response_next(_connection))
+    {
+        return false;
+    }
+
+    struct mpd_song* song = mpd_recv_song(_connection);
+    if (song != nullptr)
+    {
+        status->songURI = mpd_song_get_uri(song);
+        status->songName = status->songURI.substr(status->songURI.find_last_of('/') + 1);
+        mpd_song_free(song);
+    }
+
+    if (!mpd_response_finish(_connection))
+    {
+        return false;
+    }
+
+    Publish(status);
+
+    return true;
+}
+
+bool MPDStatusWorker::WaitForChanges()
+{
+    if (!_idling)
+    {
+        if (!mpd_send_idle_mask(_connection, static_cast<enum mpd_idle>(MPD_IDLE_PLAYER | MPD_IDLE_MIXER | MPD_IDLE_OPTIONS | MPD_IDLE_QUEUE)))
+        {
+            Disconnect();
+            return false;
+        }
+        _idling = true;
+    }
+
+    // Poll with a timeout, so the thread can notice stop requests.
+    struct pollfd pollFd {};
+    pollFd.fd = mpd_connection_get_fd(_connection);
+    pollFd.events = POLLIN;
+
+    int result = poll(&pollFd, 1, PollIntervalMilliseconds);
+    if (result == 0 || (result < 0 && errno == EINTR))
+    {
+        return false;
+    }
+
+    if (result < 0)
+    {
+        Disconnect();
+        return false;
+    }
+
+    auto changes = mpd_recv_idle(_connection, false);
+    _idling = false;
+
+    if (changes == 0 && mpd_connection_get_error(_connection) != MPD_ERROR_SUCCESS)
+    {
+        poco_debug_f1(_logger, "MPD status connection lost: %s", std::string(mpd_connection_get_error_message(_connection)));
+        Disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+void MPDStatusWorker::Publish(std::shared_ptr<MPDStatus> status)
+{
+    status->generation = ++_generation;
+    std::atomic_store(&_status, std::shared_ptr<const MPDStatus>(std::move(status)));
+}
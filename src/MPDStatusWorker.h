@@ -0,0 +1,136 @@
+#pragma once
+
+#include "ReconnectBackoff.h"
+
+#include <Poco/ActiveMethod.h>
+#include <Poco/Event.h>
+#include <Poco/Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct mpd_connection;
+
+/**
+ * @brief Immutable snapshot of the MPD player state.
+ */
+struct MPDStatus {
+    uint64_t generation{0}; //!< Incremented with each published snapshot.
+    bool connected{false}; //!< True if the worker has a working connection to MPD.
+    bool playing{false}; //!< True if MPD is playing.
+    bool paused{false}; //!< True if MPD is paused.
+    bool repeat{false}; //!< MPD repeat mode.
+    bool single{false}; //!< MPD single mode.
+    int volume{-1}; //!< Mixer volume in percent, -1 if MPD has no mixer.
+    int songPos{-1}; //!< Queue position of the current song, -1 if none.
+    unsigned int queueVersion{0}; //!< MPD queue version, changes with every queue modification.
+    unsigned int queueLength{0}; //!< Number of songs in the queue.
+    std::string songURI; //!< URI of the current song.
+    std::string songName; //!< File name part of the current song URI.
+    unsigned int elapsedSeconds{0}; //!< Elapsed time of the current song when the snapshot was taken.
+    unsigned int totalSeconds{0}; //!< Total length of the current song.
+    std::chrono::steady_clock::time_point timestamp; //!< Time the snapshot was taken, used to extrapolate the elapsed time.
+
+    /**
+     * @brief Returns the elapsed time of the current song.
+     *
+     * While connected and playing, the time since the snapshot was taken is added. Disconnected snapshots
+     * keep the elapsed time from when the connection was lost.
+     *
+     * @param now The current time.
+     * @return The elapsed time in seconds, no more than the song length if known.
+     */
+    unsigned int ElapsedSeconds(std::chrono::steady_clock::time_point now) const;
+};
+
+/**
+ * @brief Keeps an up-to-date MPD status snapshot using the idle protocol.
+ *
+ * The worker thread holds its own MPD connection, which sits in "idle" and only queries status and
+ * current song if MPD reports a player, mixer, options or queue change. Each update is published as
+ * a new immutable snapshot, so readers on other threads never block and never see partial updates.
+ *
+ * Commands are still sent over the application's main MPD connection, as an idling connection can't
+ * be used for anything else.
+ */
+class MPDStatusWorker
+{
+public:
+    ~MPDStatusWorker();
+
+    /**
+     * @brief Connects to MPD and starts the worker thread.
+     * @param host The MPD host name or socket path.
+     * @param port The MPD TCP port.
+     */
+    void Start(const std::string& host, unsigned int port);
+
+    /**
+     * @brief Stops the worker thread and closes its connection.
+     */
+    void Stop();
+
+    /**
+     * @brief Returns the most recently published status.
+     * @return The current status snapshot. Never null.
+     */
+    std::shared_ptr<const MPDStatus> Status() const;
+
+protected:
+    static constexpr int PollIntervalMilliseconds{250}; //!< How often the idling thread checks for a stop request.
+    static constexpr unsigned int ConnectTimeoutMilliseconds{1000}; //!< Timeout for connecting and for each command, limits how long Stop() waits for the thread.
+
+    /**
+     * @brief Worker thread main loop.
+     */
+    void WorkerThread();
+
+    /**
+     * @brief Opens the worker connection.
+     * @return True if the connection was established.
+     */
+    bool Connect();
+
+    /**
+     * @brief Closes the worker connection, leaving idle mode first if required.
+     */
+    void Disconnect();
+
+    /**
+     * @brief Queries status and current song and publishes a new snapshot.
+     * @return True on success, false if the connection failed.
+     */
+    bool Refresh();
+
+    /**
+     * @brief Waits for the next relevant idle event or a stop request.
+     * @return True if a relevant change was reported, false if stopping or on connection errors.
+     */
+    bool WaitForChanges();
+
+    /**
+     * @brief Atomically replaces the published snapshot.
+     * @param status The new status. The generation number is set by this method.
+     */
+    void Publish(std::shared_ptr<MPDStatus> status);
+
+    std::string _host; //!< MPD host name or socket path.
+    unsigned int _port{6600}; //!< MPD TCP port.
+
+    struct mpd_connection* _connection{nullptr}; //!< The worker's own idle connection. Worker thread only.
+    bool _idling{false}; //!< True if an idle command is pending on the connection.
+    ReconnectBackoff _backoff; //!< Delay between reconnection attempts.
+
+    std::shared_ptr<const MPDStatus> _status{std::make_shared<MPDStatus>()}; //!< Latest snapshot, only accessed via std::atomic_load/store.
+    uint64_t _generation{0}; //!< Generation number of the latest snapshot. Worker thread only.
+
+    Poco::ActiveMethod<void, void, MPDStatusWorker> _workerThread{this, &MPDStatusWorker::WorkerThread}; //!< The worker thread.
+    Poco::ActiveResult<void> _workerThreadResult{new Poco::ActiveResultHolder<void>()}; //!< Result of the worker thread, used to join it.
+    std::atomic_bool _running{false}; //!< True while the worker thread should keep running.
+    Poco::Event _stopEvent; //!< Signaled to interrupt retry waits.
+
+    Poco::Logger& _logger{Poco::Logger::get("MPDStatusWorker")}; //!< The class logger.
+};
@@ -0,0 +1,97 @@
+#include "MeshSizeGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+void MeshSizeGovernor::Configure(bool enabled, size_t maximumX, size_t maximumY, size_t minimumX, size_t minimumY)
+{
+    _enabled = enabled;
+    _maximumX = maximumX;
+    _maximumY = maximumY;
+    _minimumX = std::min(minimumX, maximumX);
+    _minimumY = std::min(minimumY, maximumY);
+
+    Reset();
+}
+
+void MeshSizeGovernor::Reset()
+{
+    _step = 0;
+    _load = 0.0;
+    _settleFramesLeft = SettleFrames;
+    _framesAboveHigh = 0;
+    _framesBelowLow = 0;
+
+    ApplyStep();
+}
+
+bool MeshSizeGovernor::Update(double frameMilliseconds, double budgetMilliseconds)
+{
+    if (!_enabled || budgetMilliseconds <= 0.0)
+    {
+        return false;
+    }
+
+    if (_settleFramesLeft > 0)
+    {
+        _settleFramesLeft--;
+        if (_settleFramesLeft == 0)
+        {
+            // Start smoothing from the first representative frame.
+            _load = frameMilliseconds / budgetMilliseconds;
+        }
+        return false;
+    }
+
+    _load += Smoothing * (frameMilliseconds / budgetMilliseconds - _load);
+
+    _framesAboveHigh = _load > HighWatermark ? _framesAboveHigh + 1 : 0;
+    _framesBelowLow = _load < LowWatermark ? _framesBelowLow + 1 : 0;
+
+    int newStep = _step;
+    if (_framesAboveHigh >= SustainFrames && !_atMinimum)
+    {
+        newStep++;
+    }
+    else if (_framesBelowLow >= SustainFrames && _step > 0)
+    {
+        newStep--;
+    }
+
+    if (newStep == _step)
+    {
+        return false;
+    }
+
+    auto previousX = _meshX;
+    auto previousY = _meshY;
+
+    _step = newStep;
+    ApplyStep();
+
+    _settleFramesLeft = SettleFrames;
+    _framesAboveHigh = 0;
+    _framesBelowLow = 0;
+
+    return _meshX != previousX || _meshY != previousY;
+}
+
+size_t MeshSizeGovernor::MeshX() const
+{
+    return _meshX;
+}
+
+size_t MeshSizeGovernor::MeshY() const
+{
+    return _meshY;
+}
+
+void MeshSizeGovernor::ApplyStep()
+{
+    double scale = std::pow(StepFactor, _step);
+
+    _meshX = std::max(_minimumX, static_cast<size_t>(std::lround(static_cast<double>(_maximumX) * scale)));
+    _meshY = std::max(_minimumY, static_cast<size_t>(std::lround(static_cast<double>(_maximumY) * scale)));
+
+    _atMinimum = _meshX == _minimumX && _meshY == _minimumY;
+}
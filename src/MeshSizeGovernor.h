@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Adapts the projectM per-point mesh size to keep the frame time within budget.
+ *
+ * The governor keeps an exponentially smoothed ratio of the measured frame work time to the frame
+ * budget. If the load stays above the high watermark for a while, the mesh is scaled down one step;
+ * if it stays below the low watermark, it's scaled up one step again. The watermarks are far enough
+ * apart that a single step up won't immediately trigger a step down again, which prevents oscillation.
+ *
+ * The mesh size never exceeds the configured size and never drops below the configured minimum.
+ * After each change and after a preset switch, measurements are ignored for a few frames, as those
+ * frames are usually not representative (shader compilation, transitions).
+ */
+class MeshSizeGovernor
+{
+public:
+    /**
+     * @brief Sets the governor configuration and resets its state.
+     * @param enabled If false, the mesh size is always the configured maximum.
+     * @param maximumX The configured mesh width, used as upper bound.
+     * @param maximumY The configured mesh height, used as upper bound.
+     * @param minimumX The smallest mesh width the governor may choose.
+     * @param minimumY The smallest mesh height the governor may choose.
+     */
+    void Configure(bool enabled, size_t maximumX, size_t maximumY, size_t minimumX, size_t minimumY);
+
+    /**
+     * @brief Restores the full mesh size and discards all measurements.
+     *
+     * Called on every preset switch, so each preset is evaluated on its own.
+     */
+    void Reset();
+
+    /**
+     * @brief Feeds the work time of the last frame into the governor.
+     * @param frameMilliseconds The time spent rendering the last frame, excluding any limiter or vsync wait.
+     * @param budgetMilliseconds The target frame time. If zero or negative, the governor does nothing.
+     * @return True if the mesh size has changed and needs to be passed to projectM.
+     */
+    bool Update(double frameMilliseconds, double budgetMilliseconds);
+
+    /**
+     * @brief Returns the current mesh width.
+     * @return The mesh width the governor wants projectM to use.
+     */
+    size_t MeshX() const;
+
+    /**
+     * @brief Returns the current mesh height.
+     * @return The mesh height the governor wants projectM to use.
+     */
+    size_t MeshY() const;
+
+protected:
+    static constexpr double StepFactor{0.8}; //!< Mesh size is multiplied by this value per step down, in each dimension.
+    static constexpr double HighWatermark{0.9}; //!< Load above which the mesh is scaled down.
+    static constexpr double LowWatermark{0.55}; //!< Load below which the mesh is scaled up. A step up costs ~1/StepFactor² more.
+    static constexpr double Smoothing{0.1}; //!< Weight of the newest frame in the smoothed load value.
+    static constexpr uint32_t SustainFrames{30}; //!< Number of consecutive frames a watermark must be crossed before acting.
+    static constexpr uint32_t SettleFrames{60}; //!< Number of frames ignored after a change or reset.
+
+    /**
+     * @brief Calculates the mesh size for the current step.
+     */
+    void ApplyStep();
+
+    bool _enabled{false}; //!< True if the governor is active.
+
+    size_t _maximumX{48}; //!< Configured mesh width.
+    size_t _maximumY{32}; //!< Configured mesh height.
+    size_t _minimumX{8}; //!< Lower bound for the mesh width.
+    size_t _minimumY{8}; //!< Lower bound for the mesh height.
+
+    size_t _meshX{48}; //!< Current mesh width.
+    size_t _meshY{32}; //!< Current mesh height.
+    int _step{0}; //!< Number of steps below the maximum mesh size.
+    bool _atMinimum{false}; //!< True if the current step already hits both lower bounds.
+
+    double _load{0.0}; //!< Smoothed ratio of frame work time to budget.
+    uint32_t _settleFramesLeft{SettleFrames}; //!< Frames to ignore before measurements count again.
+    uint32_t _framesAboveHigh{0}; //!< Consecutive frames with load above the high watermark.
+    uint32_t _framesBelowLow{0}; //!< Consecutive frames with load below the low watermark.
+};
@@ -0,0 +1,363 @@
+#include "PCMConverter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCMCONVERTER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCMCONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr float S16Scale = 1.0f / 32768.0f;
+constexpr float S32Scale = 1.0f / 2147483648.0f;
+
+/**
+ * @brief Zeroth-order modified Bessel function of the first kind, used for the Kaiser window.
+ */
+double BesselI0(double x)
+{
+    double sum{1.0};
+    double term{1.0};
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+} // namespace
+
+void PCMConverter::Configure(SampleFormat format, int channels, int inputRate, int outputRate, size_t maximumInputFrames)
+{
+    _format = format;
+    _channels = std::max(channels, 1);
+    _maximumInputFrames = maximumInputFrames;
+
+    SetupDownmix(_channels);
+
+    auto divisor = std::gcd(inputRate, outputRate);
+    _interpolation = static_cast<uint32_t>(outputRate / divisor);
+    _decimation = static_cast<uint32_t>(inputRate / divisor);
+    if (_interpolation > MaximumPhases)
+    {
+        // Unusual rate pair. Use the closest ratio the filter bank can represent, the pitch error is negligible.
+        _interpolation = MaximumPhases;
+        _decimation = static_cast<uint32_t>(std::lround(static_cast<double>(inputRate) * MaximumPhases / outputRate));
+    }
+
+    DesignFilter();
+
+    _left.assign(TapsPerPhase - 1 + maximumInputFrames, 0.0f);
+    _right.assign(TapsPerPhase - 1 + maximumInputFrames, 0.0f);
+    _phase = 0;
+    _position = 0;
+}
+
+size_t PCMConverter::MaximumInputFrames() const
+{
+    return _maximumInputFrames;
+}
+
+size_t PCMConverter::MaximumOutputFrames() const
+{
+    return (_maximumInputFrames * _interpolation + _decimation - 1) / _decimation + 1;
+}
+
+bool PCMConverter::Resampling() const
+{
+    return _interpolation != _decimation;
+}
+
+size_t PCMConverter::Process(const void* input, size_t frames, float* output)
+{
+    frames = std::min(frames, _maximumInputFrames);
+
+    if (!Resampling())
+    {
+        if (_format == SampleFormat::F32 && _channels == OutputChannels)
+        {
+            memcpy(output, input, frames * OutputChannels * sizeof(float));
+            return frames;
+        }
+
+        ConvertToStereo(input, frames, _left.data(), _right.data());
+
+        size_t frame{0};
+#ifdef PCMCONVERTER_SSE2
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto left = _mm_loadu_ps(&_left[frame]);
+            auto right = _mm_loadu_ps(&_right[frame]);
+            _mm_storeu_ps(&output[frame * 2], _mm_unpacklo_ps(left, right));
+            _mm_storeu_ps(&output[frame * 2 + 4], _mm_unpackhi_ps(left, right));
+        }
+#elif defined(PCMCONVERTER_NEON)
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            float32x4x2_t stereo{{vld1q_f32(&_left[frame]), vld1q_f32(&_right[frame])}};
+            vst2q_f32(&output[frame * 2], stereo);
+        }
+#endif
+        for (; frame < frames; frame++)
+        {
+            output[frame * 2] = _left[frame];
+            output[frame * 2 + 1] = _right[frame];
+        }
+
+        return frames;
+    }
+
+    // The first TapsPerPhase - 1 samples hold the end of the previous block.
+    constexpr size_t historyLength = TapsPerPhase - 1;
+    ConvertToStereo(input, frames, &_left[historyLength], &_right[historyLength]);
+
+    size_t outputFrames{0};
+    while (_position < frames)
+    {
+        const float* coefficients = &_coefficients[static_cast<size_t>(_phase) * TapsPerPhase];
+        output[outputFrames * 2] = DotProduct(&_left[_position], coefficients, TapsPerPhase);
+        output[outputFrames * 2 + 1] = DotProduct(&_right[_position], coefficients, TapsPerPhase);
+        outputFrames++;
+
+        _phase += _decimation;
+        _position += _phase / _interpolation;
+        _phase %= _interpolation;
+    }
+
+    _position -= frames;
+    memmove(_left.data(), &_left[frames], historyLength * sizeof(float));
+    memmove(_right.data(), &_right[frames], historyLength * sizeof(float));
+
+    return outputFrames;
+}
+
+void PCMConverter::DesignFilter()
+{
+    if (!Resampling())
+    {
+        _coefficients.clear();
+        return;
+    }
+
+    // Prototype low-pass filter at the upsampled rate, cutting off slightly below the lower Nyquist frequency.
+    const size_t length = static_cast<size_t>(_interpolation) * TapsPerPhase;
+    const double cutoff = 0.92 * 0.5 / std::max(_interpolation, _decimation);
+    const double center = (static_cast<double>(length) - 1.0) / 2.0;
+    const double beta = 8.0;
+
+    std::vector<double> prototype(length);
+    double sum{0.0};
+    for (size_t tap = 0; tap < length; tap++)
+    {
+        double x = static_cast<double>(tap) - center;
+        double sinc = x == 0.0 ? 1.0 : std::sin(2.0 * Pi * cutoff * x) / (2.0 * Pi * cutoff * x);
+        double windowPosition = 2.0 * static_cast<double>(tap) / (static_cast<double>(length) - 1.0) - 1.0;
+        double window = BesselI0(beta * std::sqrt(std::max(0.0, 1.0 - windowPosition * windowPosition))) / BesselI0(beta);
+        prototype[tap] = sinc * window;
+        sum += prototype[tap];
+    }
+
+    // Split into branches, reversed so each output is a dot product with consecutive input samples.
+    // Scaling by L / sum gives each branch unity gain at DC.
+    _coefficients.resize(length);
+    const double gain = static_cast<double>(_interpolation) / sum;
+    for (uint32_t phase = 0; phase < _interpolation; phase++)
+    {
+        for (int tap = 0; tap < TapsPerPhase; tap++)
+        {
+            auto prototypeIndex = phase + static_cast<size_t>(TapsPerPhase - 1 - tap) * _interpolation;
+            _coefficients[static_cast<size_t>(phase) * TapsPerPhase + tap] = static_cast<float>(prototype[prototypeIndex] * gain);
+        }
+    }
+}
+
+void PCMConverter::SetupDownmix(int channels)
+{
+    constexpr float front = 1.0f;
+    constexpr float side = 0.7071f;
+    constexpr float center = 0.7071f;
+    constexpr float backCenter = 0.5f;
+
+    // Channel orders as documented by SDL. LFE is dropped, it carries no information the visuals don't get from the mains.
+    switch (channels)
+    {
+        case 1: // Mono
+            _leftGains = {front};
+            _rightGains = {front};
+            break;
+
+        case 2: // FL FR
+            _leftGains = {front, 0.0f};
+            _rightGains = {0.0f, front};
+            break;
+
+        case 3: // FL FR LFE
+            _leftGains = {front, 0.0f, 0.0f};
+            _rightGains = {0.0f, front, 0.0f};
+            break;
+
+        case 4: // FL FR BL BR
+            _leftGains = {front, 0.0f, side, 0.0f};
+            _rightGains = {0.0f, front, 0.0f, side};
+            break;
+
+        case 5: // FL FR LFE BL BR
+            _leftGains = {front, 0.0f, 0.0f, side, 0.0f};
+            _rightGains = {0.0f, front, 0.0f, 0.0f, side};
+            break;
+
+        case 6: // FL FR FC LFE SL SR
+            _leftGains = {front, 0.0f, center, 0.0f, side, 0.0f};
+            _rightGains = {0.0f, front, center, 0.0f, 0.0f, side};
+            break;
+
+        case 7: // FL FR FC LFE BC SL SR
+            _leftGains = {front, 0.0f, center, 0.0f, backCenter, side, 0.0f};
+            _rightGains = {0.0f, front, center, 0.0f, backCenter, 0.0f, side};
+            break;
+
+        case 8: // FL FR FC LFE BL BR SL SR
+            _leftGains = {front, 0.0f, center, 0.0f, side, 0.0f, side, 0.0f};
+            _rightGains = {0.0f, front, center, 0.0f, 0.0f, side, 0.0f, side};
+            break;
+
+        default: // Unknown layout, use the first two channels.
+            _leftGains.assign(channels, 0.0f);
+            _rightGains.assign(channels, 0.0f);
+            _leftGains[0] = front;
+            _rightGains[1] = front;
+            break;
+    }
+}
+
+void PCMConverter::ConvertToStereo(const void* input, size_t frames, float* left, float* right) const
+{
+    size_t frame{0};
+
+    if (_channels == 2 && _format == SampleFormat::F32)
+    {
+        auto samples = static_cast<const float*>(input);
+#ifdef PCMCONVERTER_SSE2
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto first = _mm_loadu_ps(&samples[frame * 2]);
+            auto second = _mm_loadu_ps(&samples[frame * 2 + 4]);
+            _mm_storeu_ps(&left[frame], _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(&right[frame], _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+#elif defined(PCMCONVERTER_NEON)
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto stereo = vld2q_f32(&samples[frame * 2]);
+            vst1q_f32(&left[frame], stereo.val[0]);
+            vst1q_f32(&right[frame], stereo.val[1]);
+        }
+#endif
+        for (; frame < frames; frame++)
+        {
+            left[frame] = samples[frame * 2];
+            right[frame] = samples[frame * 2 + 1];
+        }
+        return;
+    }
+
+    if (_channels == 2 && _format == SampleFormat::S16)
+    {
+        auto samples = static_cast<const int16_t*>(input);
+#ifdef PCMCONVERTER_SSE2
+        const auto scale = _mm_set1_ps(S16Scale);
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            // Sign-extend by unpacking into the upper half and shifting back down.
+            auto packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&samples[frame * 2]));
+            auto first = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16)), scale);
+            auto second = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16)), scale);
+            _mm_storeu_ps(&left[frame], _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(&right[frame], _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+#elif defined(PCMCONVERTER_NEON)
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            auto stereo = vld2_s16(&samples[frame * 2]);
+            vst1q_f32(&left[frame], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(stereo.val[0])), S16Scale));
+            vst1q_f32(&right[frame], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(stereo.val[1])), S16Scale));
+        }
+#endif
+        for (; frame < frames; frame++)
+        {
+            left[frame] = samples[frame * 2] * S16Scale;
+            right[frame] = samples[frame * 2 + 1] * S16Scale;
+        }
+        return;
+    }
+
+    // Generic path for all other formats and layouts.
+    for (; frame < frames; frame++)
+    {
+        float leftSum{0.0f};
+        float rightSum{0.0f};
+        for (int channel = 0; channel < _channels; channel++)
+        {
+            size_t index = frame * _channels + channel;
+            float sample;
+            switch (_format)
+            {
+                case SampleFormat::S16:
+                    sample = static_cast<const int16_t*>(input)[index] * S16Scale;
+                    break;
+
+                case SampleFormat::S32:
+                    sample = static_cast<float>(static_cast<const int32_t*>(input)[index]) * S32Scale;
+                    break;
+
+                case SampleFormat::F32:
+                default:
+                    sample = static_cast<const float*>(input)[index];
+                    break;
+            }
+
+            leftSum += sample * _leftGains[channel];
+            rightSum += sample * _rightGains[channel];
+        }
+        left[frame] = leftSum;
+        right[frame] = rightSum;
+    }
+}
+
+float PCMConverter::DotProduct(const float* samples, const float* coefficients, size_t count)
+{
+#ifdef PCMCONVERTER_SSE2
+    auto sum = _mm_setzero_ps();
+    for (size_t index = 0; index < count; index += 4)
+    {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&samples[index]), _mm_loadu_ps(&coefficients[index])));
+    }
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(sum);
+#elif defined(PCMCONVERTER_NEON)
+    auto sum = vdupq_n_f32(0.0f);
+    for (size_t index = 0; index < count; index += 4)
+    {
+        sum = vmlaq_f32(sum, vld1q_f32(&samples[index]), vld1q_f32(&coefficients[index]));
+    }
+    auto pairs = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+#else
+    float sum{0.0f};
+    for (size_t index = 0; index < count; index++)
+    {
+        sum += samples[index] * coefficients[index];
+    }
+    return sum;
+#endif
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Converts captured PCM data into the format projectM expects.
+ *
+ * Accepts signed 16 or 32 bit integer and 32 bit float samples with any number of channels and any
+ * sample rate. The data is converted to float, downmixed to stereo and resampled to the output rate
+ * with a polyphase windowed-sinc filter.
+ *
+ * All buffers are allocated in Configure(), so Process() can safely be called from an audio callback.
+ * The inner loops use SSE2 or NEON if available at compile time, with a scalar fallback.
+ */
+class PCMConverter
+{
+public:
+    /**
+     * @brief Supported input sample formats, all in native byte order.
+     */
+    enum class SampleFormat
+    {
+        S16, //!< Signed 16 bit integer.
+        S32, //!< Signed 32 bit integer.
+        F32 //!< 32 bit float.
+    };
+
+    static constexpr int OutputChannels{2}; //!< The output is always interleaved stereo.
+
+    /**
+     * @brief Sets up the conversion and allocates all buffers.
+     * @param format The input sample format.
+     * @param channels The number of input channels, using SDL's channel layouts for 3 to 8 channels.
+     * @param inputRate The input sample rate in Hz.
+     * @param outputRate The output sample rate in Hz.
+     * @param maximumInputFrames The maximum number of input frames passed to a single Process() call.
+     */
+    void Configure(SampleFormat format, int channels, int inputRate, int outputRate, size_t maximumInputFrames);
+
+    /**
+     * @brief Returns the maximum number of input frames a single Process() call accepts.
+     * @return The maximum input frame count.
+     */
+    size_t MaximumInputFrames() const;
+
+    /**
+     * @brief Returns the maximum number of output frames a single Process() call can return.
+     * @return The maximum output frame count.
+     */
+    size_t MaximumOutputFrames() const;
+
+    /**
+     * @brief Returns whether the input is resampled.
+     * @return True if input and output rate differ.
+     */
+    bool Resampling() const;
+
+    /**
+     * @brief Converts a block of input data.
+     * @param input Interleaved input samples in the configured format.
+     * @param frames Number of input frames. Must not exceed the configured maximum.
+     * @param output Receives interleaved stereo float samples. Must hold MaximumOutputFrames() frames.
+     * @return The number of output frames written.
+     */
+    size_t Process(const void* input, size_t frames, float* output);
+
+protected:
+    static constexpr int TapsPerPhase{32}; //!< Filter length per polyphase branch. Multiple of 4 for SIMD.
+    static constexpr int MaximumPhases{1024}; //!< Rate ratios needing more phases are approximated.
+
+    /**
+     * @brief Calculates the polyphase filter coefficients for the current ratio.
+     */
+    void DesignFilter();
+
+    /**
+     * @brief Calculates the stereo downmix gains for the given channel count.
+     * @param channels Number of input channels.
+     */
+    void SetupDownmix(int channels);
+
+    /**
+     * @brief Converts input samples to float and downmixes them to stereo.
+     * @param input Interleaved input samples.
+     * @param frames Number of input frames.
+     * @param left Receives the left channel.
+     * @param right Receives the right channel.
+     */
+    void ConvertToStereo(const void* input, size_t frames, float* left, float* right) const;
+
+    /**
+     * @brief Calculates the dot product of two float arrays.
+     * @param samples First array.
+     * @param coefficients Second array.
+     * @param count Number of elements, must be a multiple of 4.
+     * @return The dot product.
+     */
+    static float DotProduct(const float* samples, const float* coefficients, size_t count);
+
+    SampleFormat _format{SampleFormat::F32}; //!< Input sample format.
+    int _channels{2}; //!< Number of input channels.
+    size_t _maximumInputFrames{0}; //!< Maximum frames per Process() call.
+
+    std::vector<float> _leftGains; //!< Per-input-channel gain for the left output channel.
+    std::vector<float> _rightGains; //!< Per-input-channel gain for the right output channel.
+
+    uint32_t _interpolation{1}; //!< Upsampling factor L, also the number of polyphase branches.
+    uint32_t _decimation{1}; //!< Downsampling factor M.
+    std::vector<float> _coefficients; //!< Polyphase filter, TapsPerPhase coefficients per branch in input order.
+
+    std::vector<float> _left; //!< Left channel history and current block.
+    std::vector<float> _right; //!< Right channel history and current block.
+    uint32_t _phase{0}; //!< Current polyphase branch.
+    size_t _position{0}; //!< Input frame index of the next output frame, relative to the current block.
+};
@@ -0,0 +1,433 @@
+#include "PresetStatsJournal.h"
+
+#include "Tracer.h"
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Path.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+PresetStatsJournal::~PresetStatsJournal()
+{
+    Close();
+}
+
+void PresetStatsJournal::Open(const std::string& directory, StatsMap& stats)
+{
+    if (_running)
+    {
+        return;
+    }
+
+    _legacyPath = directory + "dbpresets";
+    _storePath = _legacyPath + ".bin";
+    _journalPath = _legacyPath + ".journal";
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    bool storeOpened;
+    {
+        Poco::FastMutex::ScopedLock lock(_storeMutex);
+        storeOpened = _store.Open(_storePath);
+    }
+
+    _stats.clear();
+    _migrate = false;
+    if (!storeOpened)
+    {
+        auto legacyRecords = ReadFile(_legacyPath, _stats, false);
+        if (legacyRecords > 0)
+        {
+            poco_information_f1(_logger, "Converting %?d preset records from the text database.", legacyRecords);
+            _migrate = true;
+        }
+    }
+
+    _journalRecords = ReadFile(_journalPath, _stats, true);
+
+    for (const auto& entry : _stats)
+    {
+        stats[entry.first] = entry.second;
+    }
+
+    poco_debug_f3(_logger, "Opened preset stats with %?d stored and %?d journal records in %?d ms.",
+                  _store.Count(), _journalRecords,
+                  std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+
+    OpenJournal(false);
+
+    _running = true;
+    _writerThreadResult = _writerThread();
+}
+
+void PresetStatsJournal::Close()
+{
+    if (!_running)
+    {
+        return;
+    }
+
+    _running = false;
+    _recordsEvent.set();
+    _writerThreadResult.wait();
+
+    Poco::FastMutex::ScopedLock lock(_storeMutex);
+    _store.Close();
+}
+
+void PresetStatsJournal::Append(const std::string& name, const DBPreset& stats)
+{
+    if (!_running || name.empty())
+    {
+        return;
+    }
+
+    {
+        Poco::FastMutex::ScopedLock lock(_queueMutex);
+        _queue.push_back({name, stats});
+    }
+
+    _recordsEvent.set();
+}
+
+bool PresetStatsJournal::Find(const std::string& name, DBPreset& stats) const
+{
+    Poco::FastMutex::ScopedLock lock(_storeMutex);
+    return _store.Find(name, stats);
+}
+
+void PresetStatsJournal::WriterThread()
+{
+    Tracer::RegisterThread("Preset stats");
+
+    // Start with a fresh journal, which also removes a torn record left by a crash.
+    if (_journalRecords > 0 || _migrate)
+    {
+        Compact();
+    }
+
+    std::vector<Record> records;
+    bool running{true};
+    while (running)
+    {
+        _recordsEvent.wait();
+
+        // Read before taking the queue, so the last pass also writes everything appended before Close().
+        running = _running;
+
+        {
+            Poco::FastMutex::ScopedLock lock(_queueMutex);
+            std::swap(records, _queue);
+        }
+
+        WriteRecords(records);
+        records.clear();
+
+        if (running && _journalRecords >= CompactionRecords)
+        {
+            Compact();
+        }
+    }
+
+    if (_journal)
+    {
+        fclose(_journal);
+        _journal = nullptr;
+    }
+}
+
+void PresetStatsJournal::WriteRecords(const std::vector<Record>& records)
+{
+    if (records.empty())
+    {
+        return;
+    }
+
+    Tracer::Scope trace("stats", "WriteJournal");
+
+    bool written{_journal != nullptr};
+    for (const auto& record : records)
+    {
+        _stats[record.name] = record.stats;
+        if (written)
+        {
+            written = WriteRecord(_journal, record.name, record.stats);
+        }
+    }
+
+    // Also counts failed writes, so the changes are saved by the next compaction.
+    _journalRecords += records.size();
+
+    if (!written || !SyncFile(_journal))
+    {
+        poco_error_f1(_logger, R"(Could not write preset stats journal "%s", changes are kept in memory until the next compaction.)", _journalPath);
+    }
+}
+
+bool PresetStatsJournal::Compact()
+{
+    Tracer::Scope trace("stats", "CompactJournal");
+
+    // Both the snapshot and the changes are sorted by name, so they can simply be merged. The store is
+    // only replaced on this thread, so it can be read without locking.
+    PresetStatsStore::Writer writer;
+    size_t storeIndex{0};
+    auto change = _stats.begin();
+    while (storeIndex < _store.Count() || change != _stats.end())
+    {
+        std::string_view name;
+        DBPreset stats;
+        if (change == _stats.end() || (storeIndex < _store.Count() && _store.Name(storeIndex) < change->first))
+        {
+            name = _store.Name(storeIndex);
+            stats = _store.Stats(storeIndex);
+            storeIndex++;
+        }
+        else
+        {
+            if (storeIndex < _store.Count() && _store.Name(storeIndex) == change->first)
+            {
+                storeIndex++;
+            }
+            name = change->first;
+            stats = change->second;
+            ++change;
+        }
+
+        // Presets which were never played or rated don't need to be stored. Damaged records have no name.
+        if (!name.empty() && (stats.playcount > 0 || stats.rating > 0))
+        {
+            writer.Add(name, stats);
+        }
+    }
+
+    auto temporaryPath = _storePath + ".tmp";
+
+    FILE* snapshot = fopen(temporaryPath.c_str(), "wb");
+    if (!snapshot)
+    {
+        poco_error_f1(_logger, R"(Could not create preset stats snapshot "%s".)", temporaryPath);
+        return false;
+    }
+
+    bool written = writer.Write(snapshot) && SyncFile(snapshot);
+    written = fclose(snapshot) == 0 && written;
+
+    try
+    {
+        if (!written)
+        {
+            poco_error_f1(_logger, R"(Could not write preset stats snapshot "%s", keeping the previous one.)", temporaryPath);
+            Poco::File(temporaryPath).remove();
+            return false;
+        }
+
+        // Unmapped first, as mapped files can't be replaced on all platforms. The rename atomically replaces
+        // the old snapshot, so it's either the old or the new file after a crash.
+        Poco::FastMutex::ScopedLock lock(_storeMutex);
+        _store.Close();
+        Poco::File(temporaryPath).renameTo(_storePath);
+        if (!_store.Open(_storePath))
+        {
+            poco_error_f1(_logger, R"(Could not open the new preset stats snapshot "%s".)", _storePath);
+        }
+    }
+    catch (Poco::Exception& ex)
+    {
+        poco_error_f2(_logger, R"(Could not replace preset stats snapshot "%s": %s)", _storePath, ex.displayText());
+        Poco::FastMutex::ScopedLock lock(_storeMutex);
+        _store.Open(_storePath);
+        return false;
+    }
+
+    // The rename is only durable once the directory entry is on disk. Until then, the journal is still needed.
+    if (!SyncDirectory(_storePath))
+    {
+        poco_error_f1(_logger, R"(Could not sync the directory of preset stats snapshot "%s", keeping the journal.)", _storePath);
+        return false;
+    }
+
+    // Records still in the journal are also in the new snapshot, so replaying them again would be harmless.
+    OpenJournal(true);
+
+    poco_debug_f2(_logger, "Compacted preset stats journal, %?d records in snapshot, %?d journal records merged.",
+                  writer.Count(), _journalRecords);
+    _journalRecords = 0;
+    _stats.clear();
+
+    if (_migrate)
+    {
+        _migrate = false;
+        try
+        {
+            Poco::File(_legacyPath).renameTo(_legacyPath + ".old");
+        }
+        catch (Poco::Exception& ex)
+        {
+            poco_warning_f2(_logger, R"(Could not rename the old preset database "%s": %s)", _legacyPath, ex.displayText());
+        }
+    }
+
+    return true;
+}
+
+void PresetStatsJournal::OpenJournal(bool truncate)
+{
+    if (_journal)
+    {
+        fclose(_journal);
+        _journal = nullptr;
+    }
+
+    if (!truncate)
+    {
+        RemoveTornRecord();
+    }
+
+    _journal = fopen(_journalPath.c_str(), truncate ? "wb" : "ab");
+    if (!_journal)
+    {
+        poco_error_f1(_logger, R"(Could not open preset stats journal "%s", changes will only be saved on exit.)", _journalPath);
+    }
+}
+
+void PresetStatsJournal::RemoveTornRecord()
+{
+    std::ifstream file(_journalPath, std::ios::binary);
+    if (!file.is_open())
+    {
+        return;
+    }
+
+    // The journal is compacted regularly, so it's small enough to be read at once.
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    auto lastLineBreak = contents.rfind('\n');
+    size_t completeSize = lastLineBreak != std::string::npos ? lastLineBreak + 1 : 0;
+    if (completeSize == contents.size())
+    {
+        return;
+    }
+
+    // Terminating the line instead would turn the torn record into a valid one on the next load.
+    try
+    {
+        Poco::File(_journalPath).setSize(completeSize);
+        poco_debug_f1(_logger, R"(Removed incomplete last record from "%s".)", _journalPath);
+    }
+    catch (Poco::Exception& ex)
+    {
+        poco_error_f2(_logger, R"(Could not remove incomplete last record from "%s": %s)", _journalPath, ex.displayText());
+    }
+}
+
+size_t PresetStatsJournal::ReadFile(const std::string& path, StatsMap& stats, bool journal)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return 0;
+    }
+
+    size_t records{0};
+    std::string line;
+    std::string name;
+    DBPreset presetStats;
+    while (std::getline(file, line))
+    {
+        // The last journal line is incomplete if writing it was interrupted.
+        if (journal && file.eof())
+        {
+            poco_debug_f1(_logger, R"(Ignoring incomplete last record in "%s".)", path);
+            break;
+        }
+
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (!ParseRecord(line, name, presetStats))
+        {
+            continue;
+        }
+
+        stats[name] = presetStats;
+        records++;
+    }
+
+    return records;
+}
+
+bool PresetStatsJournal::ParseRecord(const std::string& line, std::string& name, DBPreset& stats)
+{
+    const char* start = line.c_str();
+    char* end{nullptr};
+
+    long rating = std::strtol(start, &end, 10);
+    if (end == start || *end != ' ')
+    {
+        return false;
+    }
+
+    start = end + 1;
+    long playcount = std::strtol(start, &end, 10);
+    if (end == start || *end != ' ' || *(end + 1) == '\0')
+    {
+        return false;
+    }
+
+    name.assign(end + 1);
+    stats.rating = static_cast<int>(rating);
+    stats.playcount = static_cast<int>(playcount);
+
+    return true;
+}
+
+bool PresetStatsJournal::WriteRecord(FILE* file, const std::string& name, const DBPreset& stats)
+{
+    return fprintf(file, "%d %d %s\n", stats.rating, stats.playcount, name.c_str()) > 0;
+}
+
+bool PresetStatsJournal::SyncFile(FILE* file)
+{
+    if (fflush(file) != 0)
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool PresetStatsJournal::SyncDirectory([[maybe_unused]] const std::string& path)
+{
+#ifdef _WIN32
+    // NTFS journals renames, directories can't be flushed separately.
+    return true;
+#else
+    auto directory = Poco::Path(path).parent().toString();
+    int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool synced = fsync(fd) == 0;
+    return close(fd) == 0 && synced;
+#endif
+}
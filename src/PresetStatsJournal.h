@@ -0,0 +1,175 @@
+#pragma once
+
+#include "PresetStatsStore.h"
+
+#include <Poco/ActiveMethod.h>
+#include <Poco/Event.h>
+#include <Poco/Logger.h>
+#include <Poco/Mutex.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Crash-safe storage for the preset ratings and play counts.
+ *
+ * The database consists of a memory-mapped binary snapshot ("dbpresets.bin", see PresetStatsStore) and an
+ * append-only text journal ("dbpresets.journal") with one "rating playcount name" record per line, with
+ * later records replacing earlier ones for the same preset. Only the journal is parsed on load, the snapshot
+ * is used directly via Find().
+ *
+ * Every change is queued and appended to the journal by a background thread, which flushes it to disk after
+ * each batch, so a crash only loses changes which were still queued. Once the journal has grown large enough,
+ * the writer compacts it by merging the changes into a new snapshot, writing it to a temporary file and
+ * atomically renaming it over the old one before truncating the journal. A torn write can therefore only
+ * affect the last journal record, which is ignored on load.
+ *
+ * The text database of earlier versions ("dbpresets") is migrated into a binary snapshot automatically and
+ * then renamed to "dbpresets.old".
+ */
+class PresetStatsJournal
+{
+public:
+    using StatsMap = std::map<std::string, DBPreset>;
+
+    ~PresetStatsJournal();
+
+    /**
+     * @brief Maps the snapshot and replays the journal, then starts the writer thread.
+     * @param directory The directory containing the database files, including a trailing separator.
+     * @param stats Receives the stats of the presets changed since the last compaction. All other
+     *              presets must be looked up with Find().
+     */
+    void Open(const std::string& directory, StatsMap& stats);
+
+    /**
+     * @brief Writes all pending changes and stops the writer thread.
+     *
+     * All records appended before calling this method are written before the journal is closed.
+     *
+     * The journal isn't compacted here, so closing only takes as long as writing the queued records.
+     * It's compacted by the writer thread after the next Open() instead.
+     */
+    void Close();
+
+    /**
+     * @brief Queues a changed preset record for writing. Never blocks on file I/O.
+     * @param name The preset name.
+     * @param stats The new preset stats.
+     */
+    void Append(const std::string& name, const DBPreset& stats);
+
+    /**
+     * @brief Looks up a preset in the snapshot. Changes since the last compaction are not included.
+     * @param name The preset name.
+     * @param stats Receives the preset stats if found.
+     * @return True if the preset is stored in the snapshot.
+     */
+    bool Find(const std::string& name, DBPreset& stats) const;
+
+protected:
+    /**
+     * @brief A queued journal record.
+     */
+    struct Record {
+        std::string name; //!< The preset name.
+        DBPreset stats; //!< The new preset stats.
+    };
+
+    /**
+     * @brief Writer thread main loop.
+     */
+    void WriterThread();
+
+    /**
+     * @brief Appends the records to the journal and applies them to the writer's copy of the database.
+     * @param records The records to write.
+     */
+    void WriteRecords(const std::vector<Record>& records);
+
+    /**
+     * @brief Merges the changes into a new snapshot, replaces the old one and truncates the journal.
+     * @return True if the new snapshot was written.
+     */
+    bool Compact();
+
+    /**
+     * @brief Opens the journal file for appending.
+     * @param truncate If true, the journal is emptied. Otherwise, an incomplete last record is removed.
+     */
+    void OpenJournal(bool truncate);
+
+    /**
+     * @brief Truncates the journal after its last complete line, removing a record torn by a crash.
+     */
+    void RemoveTornRecord();
+
+    /**
+     * @brief Reads all complete records from a database file.
+     * @param path The file path.
+     * @param stats Receives the records.
+     * @param journal If true, an incomplete last line is ignored. Text snapshots are always complete.
+     * @return The number of records read.
+     */
+    size_t ReadFile(const std::string& path, StatsMap& stats, bool journal);
+
+    /**
+     * @brief Parses a single "rating playcount name" line.
+     * @param line The line, without the line break.
+     * @param name Receives the preset name.
+     * @param stats Receives the rating and play count.
+     * @return True if the line is valid.
+     */
+    static bool ParseRecord(const std::string& line, std::string& name, DBPreset& stats);
+
+    /**
+     * @brief Writes a single record line.
+     * @param file The file to write to.
+     * @param name The preset name.
+     * @param stats The preset stats.
+     * @return True if the record was written.
+     */
+    static bool WriteRecord(FILE* file, const std::string& name, const DBPreset& stats);
+
+    /**
+     * @brief Flushes a file to the storage device.
+     * @param file The file to flush.
+     * @return True if successful.
+     */
+    static bool SyncFile(FILE* file);
+
+    /**
+     * @brief Flushes the directory entries of the directory containing a file, e.g. after a rename.
+     * @param path Path of the file.
+     * @return True if successful.
+     */
+    static bool SyncDirectory(const std::string& path);
+
+    std::string _storePath; //!< Path of the binary snapshot file.
+    std::string _legacyPath; //!< Path of the text database used by earlier versions.
+    std::string _journalPath; //!< Path of the journal file.
+
+    mutable Poco::FastMutex _storeMutex; //!< Protects _store against being replaced during lookups.
+    PresetStatsStore _store; //!< The mapped snapshot. Only replaced by the writer thread.
+    bool _migrate{false}; //!< True if the text database was loaded and must be converted.
+
+    Poco::FastMutex _queueMutex; //!< Protects _queue.
+    std::vector<Record> _queue; //!< Records waiting to be written.
+
+    FILE* _journal{nullptr}; //!< The journal file, opened for appending. Writer thread only after Open().
+    StatsMap _stats; //!< Changes not yet merged into the snapshot. Writer thread only after Open().
+    size_t _journalRecords{0}; //!< Records written to the journal or replayed from it since the last compaction.
+
+    Poco::ActiveMethod<void, void, PresetStatsJournal> _writerThread{this, &PresetStatsJournal::WriterThread}; //!< The writer thread.
+    Poco::ActiveResult<void> _writerThreadResult{new Poco::ActiveResultHolder<void>()}; //!< Result of the writer thread, used to join it.
+    std::atomic_bool _running{false}; //!< True while the writer thread should keep running.
+    Poco::Event _recordsEvent; //!< Signaled if records were queued or the writer should stop.
+
+    static constexpr size_t CompactionRecords{1000}; //!< Journal size in records that triggers a compaction.
+
+    Poco::Logger& _logger{Poco::Logger::get("PresetStatsJournal")}; //!< The class logger.
+};
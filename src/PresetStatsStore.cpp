@@ -0,0 +1,145 @@
+#include "PresetStatsStore.h"
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+
+#include <cstring>
+
+bool PresetStatsStore::Open(const std::string& path)
+{
+    Close();
+
+    try
+    {
+        if (!Poco::File(path).exists())
+        {
+            return false;
+        }
+
+        _mapping = Poco::SharedMemory(Poco::File(path), Poco::SharedMemory::AM_READ);
+    }
+    catch (Poco::Exception&)
+    {
+        return false;
+    }
+
+    size_t mappingSize = static_cast<size_t>(_mapping.end() - _mapping.begin());
+    if (mappingSize < sizeof(Header))
+    {
+        Close();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, _mapping.begin(), sizeof(Header));
+
+    size_t recordsSize = static_cast<size_t>(header.recordCount) * sizeof(Record);
+    if (header.magic != Magic || header.version != Version
+        || mappingSize != sizeof(Header) + recordsSize + header.stringTableSize)
+    {
+        Close();
+        return false;
+    }
+
+    _records = _mapping.begin() + sizeof(Header);
+    _strings = _records + recordsSize;
+    _count = header.recordCount;
+    _stringTableSize = header.stringTableSize;
+
+    return true;
+}
+
+void PresetStatsStore::Close()
+{
+    _mapping = Poco::SharedMemory();
+    _records = nullptr;
+    _strings = nullptr;
+    _count = 0;
+    _stringTableSize = 0;
+}
+
+size_t PresetStatsStore::Count() const
+{
+    return _count;
+}
+
+bool PresetStatsStore::Find(std::string_view name, DBPreset& stats) const
+{
+    size_t first{0};
+    size_t last{_count};
+    while (first < last)
+    {
+        size_t middle = first + (last - first) / 2;
+        int comparison = Name(middle).compare(name);
+        if (comparison == 0)
+        {
+            stats = Stats(middle);
+            return true;
+        }
+
+        if (comparison < 0)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    return false;
+}
+
+std::string_view PresetStatsStore::Name(size_t index) const
+{
+    // Checked here instead of in Open(), so a damaged file can't cause reads outside the mapping.
+    auto record = RecordAt(index);
+    if (static_cast<uint64_t>(record->nameOffset) + record->nameLength > _stringTableSize)
+    {
+        return {};
+    }
+
+    return {_strings + record->nameOffset, record->nameLength};
+}
+
+DBPreset PresetStatsStore::Stats(size_t index) const
+{
+    auto record = RecordAt(index);
+    return {record->rating, record->playcount};
+}
+
+const PresetStatsStore::Record* PresetStatsStore::RecordAt(size_t index) const
+{
+    // The mapping is page-aligned and header and records are multiples of 4 bytes, so records are aligned.
+    return reinterpret_cast<const Record*>(_records) + index;
+}
+
+void PresetStatsStore::Writer::Add(std::string_view name, const DBPreset& stats)
+{
+    Record record{};
+    record.nameOffset = static_cast<uint32_t>(_strings.size());
+    record.nameLength = static_cast<uint32_t>(name.size());
+    record.rating = stats.rating;
+    record.playcount = stats.playcount;
+
+    _records.push_back(record);
+    _strings.append(name);
+}
+
+bool PresetStatsStore::Writer::Write(FILE* file) const
+{
+    Header header{};
+    header.magic = Magic;
+    header.version = Version;
+    header.recordCount = static_cast<uint32_t>(_records.size());
+    header.stringTableSize = static_cast<uint32_t>(_strings.size());
+
+    return fwrite(&header, sizeof(Header), 1, file) == 1
+           && fwrite(_records.data(), sizeof(Record), _records.size(), file) == _records.size()
+           && fwrite(_strings.data(), 1, _strings.size(), file) == _strings.size();
+}
+
+size_t PresetStatsStore::Writer::Count() const
+{
+    return _records.size();
+}
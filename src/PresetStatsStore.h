@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Poco/SharedMemory.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Rating and play count of a single preset.
+ */
+struct DBPreset {
+    int rating{0}; //!< User rating from 0 to 5.
+    int playcount{0}; //!< Number of times the preset was displayed.
+};
+
+/**
+ * @brief Read-only, memory-mapped binary snapshot of the preset stats.
+ *
+ * The file starts with a header, followed by a fixed-width record array sorted by preset name and a string
+ * table containing the names. Lookups use a binary search directly on the mapped file, so opening it takes
+ * constant time regardless of the collection size and only the pages actually accessed are read from disk.
+ * For the same reason, Open() only validates the header. Record bounds are checked when a name is accessed.
+ *
+ * All values are stored in native byte order. Files written on a machine with a different byte order fail
+ * the magic number check and are ignored.
+ */
+class PresetStatsStore
+{
+public:
+    class Writer; //!< Builds new store files.
+
+    /**
+     * @brief Maps the store file. Only reads the header, so it takes constant time.
+     * @param path The file path.
+     * @return True if the file exists and its header is valid.
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Unmaps the store file.
+     */
+    void Close();
+
+    /**
+     * @brief Returns the number of records in the store.
+     * @return The record count, 0 if not opened.
+     */
+    size_t Count() const;
+
+    /**
+     * @brief Looks up a preset by name.
+     * @param name The preset name.
+     * @param stats Receives the preset stats if found.
+     * @return True if the preset was found.
+     */
+    bool Find(std::string_view name, DBPreset& stats) const;
+
+    /**
+     * @brief Returns the name of a record.
+     * @param index The record index, from 0 to Count() - 1.
+     * @return The preset name, pointing into the mapped file. Empty if the record is damaged and points
+     *         outside the string table.
+     */
+    std::string_view Name(size_t index) const;
+
+    /**
+     * @brief Returns the stats of a record.
+     * @param index The record index, from 0 to Count() - 1.
+     * @return The preset stats.
+     */
+    DBPreset Stats(size_t index) const;
+
+protected:
+    /**
+     * @brief File header.
+     */
+    struct Header {
+        uint32_t magic; //!< Always Magic, also detects the byte order.
+        uint32_t version; //!< File format version.
+        uint32_t recordCount; //!< Number of records following the header.
+        uint32_t stringTableSize; //!< Size of the string table following the records, in bytes.
+    };
+
+    /**
+     * @brief Fixed-width preset record.
+     */
+    struct Record {
+        uint32_t nameOffset; //!< Offset of the name in the string table.
+        uint32_t nameLength; //!< Length of the name in bytes.
+        int32_t rating; //!< User rating.
+        int32_t playcount; //!< Play count.
+    };
+
+    /**
+     * @brief Returns a pointer to a record in the mapped file.
+     * @param index The record index.
+     * @return The record.
+     */
+    const Record* RecordAt(size_t index) const;
+
+    static constexpr uint32_t Magic{0x53544d50}; //!< "PMTS" in little endian byte order.
+    static constexpr uint32_t Version{1}; //!< Current file format version.
+
+    Poco::SharedMemory _mapping; //!< Memory mapping of the store file.
+    const char* _records{nullptr}; //!< Start of the record array in the mapping.
+    const char* _strings{nullptr}; //!< Start of the string table in the mapping.
+    size_t _count{0}; //!< Number of records.
+    size_t _stringTableSize{0}; //!< Size of the string table in bytes.
+};
+
+/**
+ * @brief Incrementally writes a new store file. Names must be added in ascending byte order.
+ */
+class PresetStatsStore::Writer
+{
+public:
+    /**
+     * @brief Adds a preset record.
+     * @param name The preset name. Must be greater than the previously added name.
+     * @param stats The preset stats.
+     */
+    void Add(std::string_view name, const DBPreset& stats);
+
+    /**
+     * @brief Writes the store file.
+     * @param file The file to write to, opened in binary mode.
+     * @return True if the file was written completely.
+     */
+    bool Write(FILE* file) const;
+
+    /**
+     * @brief Returns the number of records added so far.
+     * @return The record count.
+     */
+    size_t Count() const;
+
+protected:
+    std::vector<Record> _records; //!< The record array.
+    std::string _strings; //!< The string table.
+};
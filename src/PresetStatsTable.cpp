@@ -0,0 +1,130 @@
+#include "PresetStatsTable.h"
+
+PresetStatsTable::PresetStatsTable(PresetStatsJournal& journal)
+    : _journal(journal)
+{
+}
+
+void PresetStatsTable::Merge(const PresetStatsJournal::StatsMap& stats)
+{
+    for (const auto& entry : stats)
+    {
+        auto id = _ids.find(entry.first);
+        if (id != _ids.end())
+        {
+            _stats[id->second] = entry.second;
+        }
+        else
+        {
+            Add(entry.first, entry.second);
+        }
+    }
+}
+
+PresetStatsTable::PresetId PresetStatsTable::Find(const std::string& name)
+{
+    auto id = _ids.find(name);
+    if (id != _ids.end())
+    {
+        return id->second;
+    }
+
+    // Only presets actually used are copied out of the mapped snapshot.
+    DBPreset stats;
+    if (!_journal.Find(name, stats))
+    {
+        return InvalidId;
+    }
+
+    return Add(name, stats);
+}
+
+PresetStatsTable::PresetId PresetStatsTable::Intern(const std::string& name, const DBPreset& defaults)
+{
+    auto id = Find(name);
+    if (id != InvalidId)
+    {
+        return id;
+    }
+
+    return Add(name, defaults);
+}
+
+PresetStatsTable::PresetId PresetStatsTable::PlaylistItem(size_t index) const
+{
+    if (index >= _playlistItems.size())
+    {
+        return InvalidId;
+    }
+
+    return _playlistItems[index];
+}
+
+void PresetStatsTable::PlaylistItem(size_t index, PresetId id)
+{
+    if (index >= _playlistItems.size())
+    {
+        _playlistItems.resize(index + 1, InvalidId);
+    }
+
+    _playlistItems[index] = id;
+}
+
+void PresetStatsTable::ClearPlaylist()
+{
+    _playlistItems.clear();
+}
+
+DBPreset& PresetStatsTable::Stats(PresetId id)
+{
+    return _stats[id];
+}
+
+const std::string& PresetStatsTable::Name(PresetId id) const
+{
+    return _names[id];
+}
+
+void PresetStatsTable::MarkDirty(PresetId id)
+{
+    if (_dirtyFlags[id])
+    {
+        return;
+    }
+
+    _dirtyFlags[id] = true;
+    _dirty.push_back(id);
+}
+
+void PresetStatsTable::Flush(std::chrono::steady_clock::time_point now)
+{
+    if (_dirty.empty() || now - _lastFlush < FlushInterval)
+    {
+        return;
+    }
+
+    Flush();
+    _lastFlush = now;
+}
+
+void PresetStatsTable::Flush()
+{
+    for (auto id : _dirty)
+    {
+        _journal.Append(_names[id], _stats[id]);
+        _dirtyFlags[id] = false;
+    }
+
+    _dirty.clear();
+}
+
+PresetStatsTable::PresetId PresetStatsTable::Add(const std::string& name, const DBPreset& stats)
+{
+    auto id = static_cast<PresetId>(_stats.size());
+    _ids.emplace(name, id);
+    _names.push_back(name);
+    _stats.push_back(stats);
+    _dirtyFlags.push_back(false);
+
+    return id;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "PresetStatsJournal.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief In-memory preset stats, addressed by dense preset IDs.
+ *
+ * Each preset name is interned once and gets an ID, which is an index into the stats array, so all further
+ * reads and updates are plain array accesses. Names are only hashed when resolving a new preset, and the
+ * IDs of playlist items are cached by playlist index, so repeated switches to the same item don't even need
+ * that. Presets not yet in the table are looked up in the journal's snapshot when first resolved.
+ *
+ * Changed presets are only marked dirty. Flush() passes each dirty preset to the journal once, so any number
+ * of changes between two flushes results in a single journal record, and nothing ever walks the whole table.
+ *
+ * IDs stay valid for the lifetime of the table. Not thread-safe, only used from the render thread.
+ */
+class PresetStatsTable
+{
+public:
+    using PresetId = uint32_t;
+
+    static constexpr PresetId InvalidId{std::numeric_limits<PresetId>::max()}; //!< Returned if a preset has no stats.
+
+    /**
+     * @brief Creates the table.
+     * @param journal The journal used to look up stored presets and to persist changes.
+     */
+    explicit PresetStatsTable(PresetStatsJournal& journal);
+
+    /**
+     * @brief Adds or replaces the stats of several presets, e.g. the journal contents after opening it.
+     * @param stats The preset stats to merge into the table.
+     */
+    void Merge(const PresetStatsJournal::StatsMap& stats);
+
+    /**
+     * @brief Resolves a preset name to its ID.
+     * @param name The preset name.
+     * @return The preset ID, or InvalidId if the preset has no stats.
+     */
+    PresetId Find(const std::string& name);
+
+    /**
+     * @brief Resolves a preset name to its ID, adding the preset if it has no stats yet.
+     * @param name The preset name.
+     * @param defaults The initial stats used if the preset is added.
+     * @return The preset ID.
+     */
+    PresetId Intern(const std::string& name, const DBPreset& defaults);
+
+    /**
+     * @brief Returns the cached ID of a playlist item.
+     * @param index The playlist index.
+     * @return The preset ID, or InvalidId if the item wasn't resolved yet.
+     */
+    PresetId PlaylistItem(size_t index) const;
+
+    /**
+     * @brief Caches the ID of a playlist item.
+     * @param index The playlist index.
+     * @param id The preset ID of the item.
+     */
+    void PlaylistItem(size_t index, PresetId id);
+
+    /**
+     * @brief Forgets all cached playlist item IDs. Must be called whenever the playlist contents change.
+     */
+    void ClearPlaylist();
+
+    /**
+     * @brief Returns the stats of a preset.
+     * @param id A valid preset ID.
+     * @return The preset stats.
+     */
+    DBPreset& Stats(PresetId id);
+
+    /**
+     * @brief Returns the name of a preset.
+     * @param id A valid preset ID.
+     * @return The preset name.
+     */
+    const std::string& Name(PresetId id) const;
+
+    /**
+     * @brief Marks the stats of a preset as changed, so they're written with the next flush.
+     * @param id A valid preset ID.
+     */
+    void MarkDirty(PresetId id);
+
+    /**
+     * @brief Flushes the dirty presets if the flush interval has passed since the last flush.
+     * @param now The current time.
+     */
+    void Flush(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Immediately queues the stats of all dirty presets for writing to the journal.
+     */
+    void Flush();
+
+protected:
+    /**
+     * @brief Adds a new preset to the table.
+     * @param name The preset name, which must not be in the table yet.
+     * @param stats The preset stats.
+     * @return The new preset ID.
+     */
+    PresetId Add(const std::string& name, const DBPreset& stats);
+
+    PresetStatsJournal& _journal; //!< Snapshot lookups and persistence.
+
+    std::unordered_map<std::string, PresetId> _ids; //!< Preset name to ID index.
+    std::vector<std::string> _names; //!< Preset names, indexed by ID.
+    std::vector<DBPreset> _stats; //!< Preset stats, indexed by ID.
+    std::vector<PresetId> _playlistItems; //!< Cached preset IDs, indexed by playlist position.
+
+    std::vector<bool> _dirtyFlags; //!< True for each preset in _dirty, indexed by ID.
+    std::vector<PresetId> _dirty; //!< IDs of the presets changed since the last flush.
+    std::chrono::steady_clock::time_point _lastFlush; //!< Time of the last flush.
+
+    static constexpr std::chrono::seconds FlushInterval{2}; //!< Minimum time between two periodic flushes.
+};
@@ -8,6 +8,7 @@
 #include "ProjectMWrapper.h"
 #include "RenderLoop.h"
 #include "SDLRenderingWindow.h"
+#include "Tracer.h"
 #include "gui/ProjectMGUI.h"
 
 #include <Poco/Environment.h>
@@ -22,6 +23,7 @@ ProjectMSDLApplication::ProjectMSDLApplication()
     : Poco::Util::Application()
 {
     // Note: order here is important, as subsystems are initialized in the same order.
+    addSubsystem(new Tracer);
     addSubsystem(new SDLRenderingWindow);
     addSubsystem(new ProjectMWrapper);
     addSubsystem(new AudioCapture);
@@ -134,6 +136,16 @@ void ProjectMSDLApplication::defineOptions(Poco::Util::OptionSet& options)
                              false, "<id or name>", true)
                           .binding("audio.device", _commandLineOverrides));
 
+    options.addOption(Option("audioFile", "",
+                             "Play audio from a WAV file, raw PCM file or named pipe instead of recording from an audio device.",
+                             false, "<path>", true)
+                          .binding("audio.file", _commandLineOverrides));
+
+    options.addOption(Option("audioFilePacing", "",
+                             "How samples from the audio file are paced: \"realtime\" or \"frame\" for exactly one frame's worth of samples per rendered frame.",
+                             false, "<mode>", true)
+                          .binding("audio.file.pacing", _commandLineOverrides));
+
     options.addOption(Option("presetPath", "p", "Base directory to search for presets.",
                              false, "<path>", true)
                           .binding("projectM.presetPath", _commandLineOverrides));
@@ -194,7 +206,7 @@ void ProjectMSDLApplication::defineOptions(Poco::Util::OptionSet& options)
                              false, "<number>", true)
                           .binding("window.top", _commandLineOverrides));
 
-    options.addOption(Option("fps", "", "Target frames per second rate.",
+    options.addOption(Option("fps", "", "Target frames per second rate. Can be fractional, e.g. 59.94.",
                              false, "<number>", true)
                           .binding("projectM.fps", _commandLineOverrides));
 
@@ -225,6 +237,10 @@ void ProjectMSDLApplication::defineOptions(Poco::Util::OptionSet& options)
     options.addOption(Option("beatSensitivity", "", "Beat sensitivity. Between 0.0 and 2.0. Default 1.0.",
                              false, "<number>", true)
                           .binding("projectM.beatSensitivity", _commandLineOverrides));
+
+    options.addOption(Option("trace", "", "Write a Chrome/Perfetto trace of render loop stages, audio callbacks, preset switches and MPD requests to the given JSON file.",
+                             false, "<file>", true)
+                          .binding("trace.file", _commandLineOverrides));
 }
 
 int ProjectMSDLApplication::main(POCO_UNUSED const std::vector<std::string>& args)
@@ -2,6 +2,7 @@
 
 #include "ProjectMSDLApplication.h"
 #include "SDLRenderingWindow.h"
+#include "Tracer.h"
 
 #include "notifications/DisplayToastNotification.h"
 
@@ -11,19 +12,14 @@
 
 #include <SDL2/SDL_opengl.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <iterator>
 #include <map>
 
 #include <assert.h>
 
-inline bool ProjectMWrapper::put(int rating, int playcount, std::string name)
-{
-    sprintf(buffer, "%d %d %s\n", rating, playcount, name.c_str() );
-    size_t i = fwrite (buffer , strlen(buffer), sizeof(char), filedb);
-    //printf("[%ld] %ld buffer: %s", i, strlen(buffer), buffer);
-    return true;
-}
-
 const char* ProjectMWrapper::name() const
 {
     return "ProjectM Wrapper";
@@ -33,6 +29,7 @@ void ProjectMWrapper::initialize(Poco::Util::Application& app)
 {
     auto& projectMSDLApp = dynamic_cast<ProjectMSDLApplication&>(app);
     _projectMConfigView = projectMSDLApp.config().createView("projectM");
+    _windowConfigView = projectMSDLApp.config().createView("window");
     _MPDConfigView = projectMSDLApp.config().createView("MPD");
     _userConfig = projectMSDLApp.UserConfiguration();
     poco_information_f1(_logger, "Events enabled: %?d", _projectMConfigView->eventsEnabled());
@@ -57,16 +54,22 @@ void ProjectMWrapper::initialize(Poco::Util::Application& app)
             throw std::runtime_error("projectM initialization failed");
         }
 
-        int fps = _projectMConfigView->getInt("fps", 60);
+        int fps = static_cast<int>(std::round(_projectMConfigView->getDouble("fps", 60.0)));
         if (fps <= 0)
         {
             // We don't know the target framerate, pass in a default of 60.
             fps = 60;
         }
 
-        projectm_set_window_size(_projectM, canvasWidth, canvasHeight);
+#if PROJECTM_VERSION_MAJOR > 4 || (PROJECTM_VERSION_MAJOR == 4 && PROJECTM_VERSION_MINOR >= 1)
+        _scaledRenderTarget.Initialize();
+#else
+        poco_information(_logger, "Render scaling requires libprojectM 4.1 or higher, ignoring window.renderScale.");
+#endif
+
+        ViewportSize(canvasWidth, canvasHeight);
         projectm_set_fps(_projectM, fps);
-        projectm_set_mesh_size(_projectM, _projectMConfigView->getInt("meshX", 48), _projectMConfigView->getInt("meshY", 32));
+        ConfigureMeshSizeGovernor();
         projectm_set_aspect_correction(_projectM, _projectMConfigView->getBool("aspectCorrectionEnabled", true));
         projectm_set_preset_locked(_projectM, _projectMConfigView->getBool("presetLocked", false));
 
@@ -116,6 +119,7 @@ void ProjectMWrapper::initialize(Poco::Util::Application& app)
             }
         }
         projectm_playlist_sort(_playlist, 0, projectm_playlist_size(_playlist), SORT_PREDICATE_FILENAME_ONLY, SORT_ORDER_ASCENDING);
+        _presetStats.ClearPlaylist();
 
         projectm_playlist_set_preset_switched_event_callback(_playlist, &ProjectMWrapper::PresetSwitchedEvent, static_cast<void*>(this));
 
@@ -134,9 +138,7 @@ void ProjectMWrapper::initialize(Poco::Util::Application& app)
 //    mpdc_port = app.config().getInt("mpd.port");
 //    printf("MPD host: '%s' MPD port: %d\n",mpdc_host.c_str(),mpdc_port);
     
-    if(app.config().getString("mpd.host").size()>0){
-        MPDConnect();
-    }
+    MPDConnect();
 
 }
 
@@ -145,30 +147,15 @@ void ProjectMWrapper::uninitialize()
     _userConfig->propertyRemoved -= Poco::delegate(this, &ProjectMWrapper::OnConfigurationPropertyRemoved);
     _userConfig->propertyChanged -= Poco::delegate(this, &ProjectMWrapper::OnConfigurationPropertyChanged);
     Poco::NotificationCenter::defaultCenter().removeObserver(_playbackControlNotificationObserver);
-    
-    if(filedb){
-        fclose(filedb);
-        filedb=nullptr;
-    }
 
-    filedb = fopen(std::string(configPath+"dbpresets").c_str(), "w");
-        
-    size_t pli = 0;
-    char* plitem=NULL;
-    while(true){
-        plitem  =  projectm_playlist_item(_playlist, pli);
-        if(plitem){
-            if(dbpm.count(plitem)>0 && dbpm[plitem].playcount>0){
-                put(dbpm[plitem].rating, dbpm[plitem].playcount, std::string(plitem) );
-                free(plitem);
-            }
-            ++pli;
-        }else{
-            printf("last\n");
-            break;
-        }
-    }
+    MPDDisconnect();
 
+    // Only presets changed since the last periodic flush are written, compaction is left to the next start.
+    _presetStats.Flush();
+    _presetStatsJournal.Close();
+
+    _scaledRenderTarget.Shutdown();
+    _renderScaled = false;
 
     if (_projectM)
     {
@@ -181,10 +168,6 @@ void ProjectMWrapper::uninitialize()
         projectm_playlist_destroy(_playlist);
         _playlist = nullptr;
     }
-    
-    if(filedb)fclose(filedb);filedb=nullptr;
-
-
 }
 
 projectm_handle ProjectMWrapper::ProjectM() const
@@ -197,9 +180,9 @@ projectm_playlist_handle ProjectMWrapper::Playlist() const
     return _playlist;
 }
 
-int ProjectMWrapper::TargetFPS()
+double ProjectMWrapper::TargetFPS()
 {
-    return _projectMConfigView->getInt("fps", 60);
+    return _projectMConfigView->getDouble("fps", 60.0);
 }
 
 void ProjectMWrapper::UpdateRealFPS(float fps)
@@ -207,21 +190,49 @@ void ProjectMWrapper::UpdateRealFPS(float fps)
     projectm_set_fps(_projectM, static_cast<uint32_t>(std::round(fps)));
 }
 
-void ProjectMWrapper::RenderFrame() const
+void ProjectMWrapper::RenderFrame()
 {
+#if PROJECTM_VERSION_MAJOR > 4 || (PROJECTM_VERSION_MAJOR == 4 && PROJECTM_VERSION_MINOR >= 1)
+    if (_renderScaled)
+    {
+        _scaledRenderTarget.Bind();
+
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        projectm_opengl_render_frame_fbo(_projectM, _scaledRenderTarget.Framebuffer());
+
+        _scaledRenderTarget.Present(_viewportWidth, _viewportHeight, _renderScaleFilter);
+        return;
+    }
+#endif
+
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    size_t currentMeshX{0};
-    size_t currentMeshY{0};
-    projectm_get_mesh_size(_projectM, &currentMeshX, &currentMeshY);
-    if (currentMeshX != _projectMConfigView->getInt("meshX", 220) ||
-        currentMeshY != _projectMConfigView->getInt("meshY", 125))
+    projectm_opengl_render_frame(_projectM);
+}
+
+void ProjectMWrapper::ViewportSize(int width, int height)
+{
+    _viewportWidth = width;
+    _viewportHeight = height;
+
+    ApplyRenderScale();
+}
+
+void ProjectMWrapper::UpdateFrameTime(double frameMilliseconds)
+{
+    double targetFps = TargetFPS();
+    double budgetMilliseconds = targetFps > 0.0 ? 1000.0 / targetFps : 0.0;
+
+    if (_meshSizeGovernor.Update(frameMilliseconds, budgetMilliseconds))
     {
-        projectm_set_mesh_size(_projectM, _projectMConfigView->getInt("meshX", 220), _projectMConfigView->getInt("meshY", 125));
+        poco_debug_f2(_logger, "Adaptive mesh size changed to %?dx%?d.", _meshSizeGovernor.MeshX(), _meshSizeGovernor.MeshY());
+        ApplyMeshSize();
     }
 
-    projectm_opengl_render_frame(_projectM);
+    _presetStats.Flush(std::chrono::steady_clock::now());
 }
 
 void ProjectMWrapper::DisplayInitialPreset()
@@ -261,8 +272,7 @@ std::string ProjectMWrapper::ProjectMRuntimeVersion()
 }
 
 int ProjectMWrapper::PresetExists(std::string pName){
-    int c = dbpm.count(pName);
-    return c;
+    return _presetStats.Find(pName) != PresetStatsTable::InvalidId ? 1 : 0;
 }
 
 void ProjectMWrapper::PresetSwitchedEvent(bool isHardCut, unsigned int index, void* context)
@@ -270,28 +280,33 @@ void ProjectMWrapper::PresetSwitchedEvent(bool isHardCut, unsigned int index, vo
     auto that = reinterpret_cast<ProjectMWrapper*>(context);
     auto presetName = projectm_playlist_item(that->_playlist, index);
     std::string pname(presetName);
-    
-    that->_presetName = pname;
-    int pc = 0;
-    size_t c = that->dbpm.count(pname);
-    int r = projectm_get_preset_rating(that->_projectM);
-    //printf("dbmp:[%ld] (%d) '%s'\n", c, r, pname.c_str());
-    if(c>0){
-        pc = that->dbpm[pname].playcount;
-        r = that->dbpm[pname].rating;
-    }else{
-        that->dbpm.insert(std::pair<std::string,DBPreset>(pname,DBPreset{r,pc}));        
-        that->dbpm[pname].rating = r;
-    }
-    ++that->dbpm[pname].playcount;  // = that->dbpm[pname].playcount +1;
-    that->_presetRating = that->dbpm[pname].rating;
-    that->_presetPlaycount = that->dbpm[pname].playcount;
-
-    poco_information_f1(that->_logger, "Displaying preset: %s", std::string(presetName));
-    Poco::NotificationCenter::defaultCenter().postNotification(
-        new DisplayToastNotification(Poco::format("%s", std::string(presetName))));
     projectm_playlist_free_string(presetName);
 
+    // Only the first switch to a playlist item needs to resolve its name.
+    auto presetId = that->_presetStats.PlaylistItem(index);
+    if (presetId == PresetStatsTable::InvalidId)
+    {
+        presetId = that->_presetStats.Intern(pname, DBPreset{projectm_get_preset_rating(that->_projectM), 0});
+        that->_presetStats.PlaylistItem(index, presetId);
+    }
+
+    that->_presetId = presetId;
+    auto& stats = that->_presetStats.Stats(presetId);
+    ++stats.playcount;
+    that->_presetRating = stats.rating;
+    that->_presetPlaycount = stats.playcount;
+    that->_presetStats.MarkDirty(presetId);
+
+    // Give each preset a fresh start at full mesh size.
+    that->_meshSizeGovernor.Reset();
+    that->ApplyMeshSize();
+
+    Tracer::Instant("preset", isHardCut ? "PresetSwitched (hard cut)" : "PresetSwitched", pname);
+
+    poco_information_f1(that->_logger, "Displaying preset: %s", pname);
+    Poco::NotificationCenter::defaultCenter().postNotification(
+        new DisplayToastNotification(Poco::format("%s", pname)));
+
     Poco::NotificationCenter::defaultCenter().postNotification(new UpdateWindowTitleNotification);
 }
 
@@ -406,90 +421,129 @@ void ProjectMWrapper::OnConfigurationPropertyRemoved(const std::string& key)
         projectm_set_hard_cut_sensitivity(_projectM, static_cast<float>(_projectMConfigView->getDouble("hardCutSensitivity", 1.0)));
     }
 
-    if (key == "projectM.meshX" || key == "projectM.meshY")
+    if (key == "projectM.meshX" || key == "projectM.meshY" || key.find("projectM.meshGovernor.") == 0)
+    {
+        ConfigureMeshSizeGovernor();
+    }
+
+    if (key == "window.renderScale" || key == "window.renderScale.sharpFilter")
+    {
+        ApplyRenderScale();
+    }
+}
+
+void ProjectMWrapper::ConfigureMeshSizeGovernor()
+{
+    _meshSizeGovernor.Configure(_projectMConfigView->getBool("meshGovernor.enabled", false),
+                                _projectMConfigView->getUInt64("meshX", 48), _projectMConfigView->getUInt64("meshY", 32),
+                                _projectMConfigView->getUInt64("meshGovernor.minimumX", 16), _projectMConfigView->getUInt64("meshGovernor.minimumY", 12));
+    ApplyMeshSize();
+}
+
+void ProjectMWrapper::ApplyMeshSize()
+{
+    size_t currentMeshX{0};
+    size_t currentMeshY{0};
+    projectm_get_mesh_size(_projectM, &currentMeshX, &currentMeshY);
+
+    if (currentMeshX != _meshSizeGovernor.MeshX() || currentMeshY != _meshSizeGovernor.MeshY())
+    {
+        projectm_set_mesh_size(_projectM, _meshSizeGovernor.MeshX(), _meshSizeGovernor.MeshY());
+    }
+}
+
+void ProjectMWrapper::ApplyRenderScale()
+{
+    _renderScaleFilter = _windowConfigView->getBool("renderScale.sharpFilter", false) ? ScaledRenderTarget::Filter::Sharp : ScaledRenderTarget::Filter::Bilinear;
+
+    double renderScale = std::max(0.25, std::min(1.0, _windowConfigView->getDouble("renderScale", 1.0)));
+
+    int renderWidth = std::max(1, static_cast<int>(std::lround(_viewportWidth * renderScale)));
+    int renderHeight = std::max(1, static_cast<int>(std::lround(_viewportHeight * renderScale)));
+
+    bool renderScaled = _scaledRenderTarget.Available() &&
+                        (renderWidth != _viewportWidth || renderHeight != _viewportHeight) &&
+                        _scaledRenderTarget.Resize(renderWidth, renderHeight);
+
+    if (!renderScaled)
+    {
+        renderWidth = _viewportWidth;
+        renderHeight = _viewportHeight;
+    }
+
+    if (renderScaled != _renderScaled)
     {
-        projectm_set_mesh_size(_projectM, _projectMConfigView->getUInt64("meshX", 48), _projectMConfigView->getUInt64("meshY", 32));
+        poco_debug_f1(_logger, "Render scaling %s.", std::string(renderScaled ? "enabled" : "disabled"));
     }
+    _renderScaled = renderScaled;
+
+    projectm_set_window_size(_projectM, renderWidth, renderHeight);
 }
 
 int ProjectMWrapper::GetRating(){
-    if(!dbpm.count(_presetName))return projectm_get_preset_rating(_projectM);
-    return dbpm[_presetName].rating;
+    if(_presetId == PresetStatsTable::InvalidId)return projectm_get_preset_rating(_projectM);
+    return _presetStats.Stats(_presetId).rating;
 }
 
 int ProjectMWrapper::GetPlayCount(){
-    return dbpm[_presetName].playcount;
+    if(_presetId == PresetStatsTable::InvalidId)return 0;
+    return _presetStats.Stats(_presetId).playcount;
 }
 
 int ProjectMWrapper::GetPlayCount(std::string pName){
-    return dbpm[pName].playcount;
+    auto presetId = _presetStats.Find(pName);
+    if(presetId == PresetStatsTable::InvalidId)return 0;
+    return _presetStats.Stats(presetId).playcount;
 }
 
 void ProjectMWrapper::RatingDown(){
-    if( dbpm[_presetName].rating > 0 ) dbpm[_presetName].rating--;
+    if(_presetId == PresetStatsTable::InvalidId)return;
+    auto& stats = _presetStats.Stats(_presetId);
+    if( stats.rating > 0 ) stats.rating--;
+    _presetStats.MarkDirty(_presetId);
 }
 
 void ProjectMWrapper::RatingUp(){
-    if( dbpm[_presetName].rating < 5 ) dbpm[_presetName].rating++;
+    if(_presetId == PresetStatsTable::InvalidId)return;
+    auto& stats = _presetStats.Stats(_presetId);
+    if( stats.rating < 5 ) stats.rating++;
+    _presetStats.MarkDirty(_presetId);
 }
 
 void ProjectMWrapper::SetRating(int rating){
-    if(rating <0 || rating >5)return;
-    dbpm[_presetName].rating = rating;
+    if(rating <0 || rating >5 || _presetId == PresetStatsTable::InvalidId)return;
+    _presetStats.Stats(_presetId).rating = rating;
+    _presetStats.MarkDirty(_presetId);
 }
 
 void ProjectMWrapper::SetPlaycount(int playcount){
-    dbpm[_presetName].playcount = playcount;
+    if(_presetId == PresetStatsTable::InvalidId)return;
+    _presetStats.Stats(_presetId).playcount = playcount;
+    _presetStats.MarkDirty(_presetId);
 }
 
 void ProjectMWrapper::SetConfigPath(std::string path){
     configPath = path;
 }
 
-void ProjectMWrapper::LoadDBPresets(){
-
-    filedb = fopen(std::string(configPath+"dbpresets").c_str(), "r+");
-
-    if(filedb){
-        char* line = NULL;
-        size_t len = 0;
-        size_t pli = 0;
-        int rating, playcount;
-        ssize_t nread;
-        std::string name;
-        while ((nread = getline(&line, &len, filedb)) != -1){
-            std::stringstream is(line);
-            is << line;
-            is >> rating;
-            is >> playcount;
-            name = std::string(line).substr(2);
-            name = name.substr(name.find_first_of(" ")+1);
-            name = name.substr(0,name.size()-1);
-            //printf("<- %d %d '%s'\n",rating, playcount, name.c_str());
-            dbpm.insert(std::pair<std::string,DBPreset>(name,DBPreset{rating,playcount}));
-            //printf("* %d %d '%s'\n",dbpm[name].rating, dbpm[name].playcount, name.c_str());
-        }
-        if(line)free(line);
-        fclose(filedb);
-        filedb=nullptr;
-    }
-
-}
-
-inline void ProjectMWrapper::printErrorAndExit()
+void ProjectMWrapper::LoadDBPresets()
 {
-    assert(mpd_connection_get_error(mpdc) == MPD_ERROR_SUCCESS);
-
-    const char *message = mpd_connection_get_error_message(mpdc);
-    if (mpd_connection_get_error(mpdc) == MPD_ERROR_SERVER)
-        fprintf(stderr, "MPD error: %s\n", message);
-    mpd_connection_free(mpdc);
-    exit(EXIT_FAILURE);
+    PresetStatsJournal::StatsMap changedStats;
+    _presetStatsJournal.Open(configPath, changedStats);
+    _presetStats.Merge(changedStats);
 }
 
 
-void ProjectMWrapper::MPDSetRepeat(bool r){ mpd_run_repeat(mpdc, r); }
-void ProjectMWrapper::MPDSetSingle(bool r){ mpd_run_single(mpdc, r); }
+void ProjectMWrapper::MPDSetRepeat(bool r){
+    _mpdClient.Post("MPDSetRepeat", [r](struct mpd_connection* connection) {
+        mpd_run_repeat(connection, r);
+    });
+}
+void ProjectMWrapper::MPDSetSingle(bool r){
+    _mpdClient.Post("MPDSetSingle", [r](struct mpd_connection* connection) {
+        mpd_run_single(connection, r);
+    });
+}
 
 bool ProjectMWrapper::MPDGetRepeat(){ return _mpd_repeat; }
 bool ProjectMWrapper::MPDGetSingle(){ return _mpd_single; }
@@ -498,7 +552,10 @@ void ProjectMWrapper::MPDVolumeUp()
 { 
     if(_mpd_volume<100){
         ++_mpd_volume;
-        mpd_run_set_volume(mpdc, _mpd_volume);
+        unsigned int volume = _mpd_volume;
+        _mpdClient.Post("MPDVolumeUp", [volume](struct mpd_connection* connection) {
+            mpd_run_set_volume(connection, volume);
+        });
         Poco::NotificationCenter::defaultCenter().postNotification(
             new DisplayToastNotification(Poco::format("MPD Volume Up: %3d", _mpd_volume)));
             poco_information_f1(_logger, "MPD Volume Up: %3d", _mpd_volume);
@@ -509,68 +566,88 @@ void ProjectMWrapper::MPDVolumeDown()
 { 
     if(_mpd_volume>0){
         --_mpd_volume;
-        mpd_run_set_volume(mpdc, _mpd_volume);
+        unsigned int volume = _mpd_volume;
+        _mpdClient.Post("MPDVolumeDown", [volume](struct mpd_connection* connection) {
+            mpd_run_set_volume(connection, volume);
+        });
         Poco::NotificationCenter::defaultCenter().postNotification(
             new DisplayToastNotification(Poco::format("MPD Volume Down: %3d", _mpd_volume)));
             poco_information_f1(_logger, "MPD Volume Down: %3d", _mpd_volume);
     }
 }
 
-void ProjectMWrapper::MPDGetStatus()
+void ProjectMWrapper::MPDUpdateStatus()
 {
-    if (!mpd_command_list_begin(mpdc, true) ||
-        !mpd_send_status(mpdc) ||
-        !mpd_send_current_song(mpdc) ||
-        !mpd_command_list_end(mpdc)
-    ) printErrorAndExit();
-
-    struct mpd_status *status = mpd_recv_status(mpdc);
-    if (status == NULL) printErrorAndExit();
-    if(mpd_status_get_state(status) == MPD_STATE_PLAY) _mpdPlaying = true;
-    if(mpd_status_get_state(status) == MPD_STATE_PAUSE) _mpdPlaying = false;
-
-    if (mpd_status_get_state(status) == MPD_STATE_PLAY ||
-        mpd_status_get_state(status) == MPD_STATE_PAUSE) {
-            if (!mpd_response_next(mpdc)) printErrorAndExit();
-
-            struct mpd_song *song = mpd_recv_song(mpdc);
-            if (song != NULL) {
-                _songURI = mpd_song_get_uri(song);
-                _songName = _songURI.substr(_songURI.find_last_of("/")+1);
-                mpd_song_free(song);
+    ApplyMPDListUpdates();
+
+    auto status = _mpdStatusWorker.Status();
+
+    // The worker only publishes on changes, so extrapolate the elapsed time while playing.
+    unsigned int elapsed = status->ElapsedSeconds(std::chrono::steady_clock::now());
+
+    if (status->generation == _mpdStatusGeneration && elapsed == _songElapsedShown)
+    {
+        return;
+    }
+
+    if (status->generation != _mpdStatusGeneration)
+    {
+        _mpdStatusGeneration = status->generation;
+
+        // Keep the local queue copy in sync. Only changed entries are transferred.
+        if (status->connected && status->queueVersion != _mpdQueueRequestedVersion)
+        {
+            _mpdQueueRequestedVersion = status->queueVersion;
+            MPDListFiles();
+        }
+        _mpdPlaying = status->playing;
+
+        if (status->playing || status->paused)
+        {
+            if (!status->songURI.empty())
+            {
+                _songURI = status->songURI;
+                _songName = status->songName;
                 if(_songName != _songNameLast){
                     Poco::NotificationCenter::defaultCenter().postNotification(
                         new DisplayToastNotification(Poco::format("MPD: %s", std::string(_songName))));
                     poco_information_f1(_logger, "Playing: %s", std::string(_songName));
                     _songNameLast = _songName;
                 }
-                if(_songURI != _songURILast){
-                    _songURILast = _songURI;
-                    _songPos = mpd_status_get_song_pos(status);
-                }
+                _songURILast = _songURI;
+            }
+            _songPos = status->songPos;
+            _mpd_repeat = status->repeat;
+            _mpd_single = status->single;
+            // Negative if MPD has no mixer, keep the last known volume then.
+            if (status->volume >= 0)
+            {
+                _mpd_volume = status->volume;
             }
+        }
+    }
+
+    _songElapsedShown = elapsed;
 
-            sprintf(infobuffer," #%i/%u  %3i:%02i / %i:%02i [R%i S%i] VOL: %3i\n",
-                    mpd_status_get_song_pos(status) + 1,
-                    mpd_status_get_queue_length(status),
-                    mpd_status_get_elapsed_time(status) / 60,
-                    mpd_status_get_elapsed_time(status) % 60,
-                    mpd_status_get_total_time(status) / 60,
-                    mpd_status_get_total_time(status) % 60,
-                    mpd_status_get_repeat(status),
-                    mpd_status_get_single(status),
-                    mpd_status_get_volume(status)
-                    );
-            //printf("%s\n",infobuffer);
-            _songInfo.assign(infobuffer);
-            _mpd_repeat = mpd_status_get_repeat(status);
-            _mpd_single = mpd_status_get_single(status);
-            _mpd_volume = mpd_status_get_volume(status);
+    if (status->playing || status->paused)
+    {
+        snprintf(infobuffer, sizeof(infobuffer), " #%i/%u  %3i:%02i / %i:%02i [R%i S%i] VOL: %3i\n",
+                 status->songPos + 1,
+                 status->queueLength,
+                 elapsed / 60,
+                 elapsed % 60,
+                 status->totalSeconds / 60,
+                 status->totalSeconds % 60,
+                 status->repeat,
+                 status->single,
+                 _mpd_volume
+                 );
+        _songInfo.assign(infobuffer);
     }
-    if (!mpd_response_finish(mpdc)) printErrorAndExit();
 }
 
 
+
 std::string ProjectMWrapper::MPDGetSongName(){
     return _songName;
 }
@@ -579,187 +656,283 @@ std::string ProjectMWrapper::MPDGetSongInfo(){
     return _songInfo;
 }
 
-uint ProjectMWrapper::MPDGetSongId(uint pos){
-    struct mpd_song* song = mpd_run_get_queue_song_id(mpdc,pos);
-    if (song == NULL) printErrorAndExit();
-    return mpd_song_get_id(song);
-}
-
 void ProjectMWrapper::MPDNext(){
-    mpd_run_next(mpdc);
+    _mpdClient.Post("MPDNext", [](struct mpd_connection* connection) {
+        mpd_run_next(connection);
+    }, MPDClient::Retry::Never);
 }
 
 void ProjectMWrapper::MPDPrev(){
-    mpd_run_previous(mpdc);
+    _mpdClient.Post("MPDPrev", [](struct mpd_connection* connection) {
+        mpd_run_previous(connection);
+    }, MPDClient::Retry::Never);
 }
 
 void ProjectMWrapper::MPDStop(){
-    mpd_run_stop(mpdc);
+    _mpdClient.Post("MPDStop", [](struct mpd_connection* connection) {
+        mpd_run_stop(connection);
+    });
 }
 
 void ProjectMWrapper::MPDPlay(){
-    mpd_run_play(mpdc);
-    MPDGetStatus();
+    _mpdClient.Post("MPDPlay", [](struct mpd_connection* connection) {
+        mpd_run_play(connection);
+    });
 }
 void ProjectMWrapper::MPDPlayId(uint i){
-    mpd_response_finish(mpdc);
-    MPDGetStatus();
-    mpd_run_play_id(mpdc,i);
-    MPDGetStatus();
+    _mpdClient.Post("MPDPlayId", [i](struct mpd_connection* connection) {
+        mpd_run_play_id(connection, i);
+    });
 }
 
 void ProjectMWrapper::MPDPlayPos(uint i){
-    mpd_response_finish(mpdc);
-    mpd_run_play_pos(mpdc,i);
-    MPDGetStatus();
-    
+    _mpdClient.Post("MPDPlayPos", [i](struct mpd_connection* connection) {
+        mpd_run_play_pos(connection, i);
+    });
 }
 
 void ProjectMWrapper::MPDPause(){
-    if(_mpdPlaying){
-        mpd_run_pause(mpdc,true);
-    }else{
-        mpd_run_pause(mpdc,false);
-    }
+    bool pause = _mpdPlaying;
+    _mpdClient.Post("MPDPause", [pause](struct mpd_connection* connection) {
+        mpd_run_pause(connection, pause);
+    });
 }
 
+void ProjectMWrapper::MPDConnect()
+{
+    auto& config = Poco::Util::Application::instance().config();
+    auto host = config.getString("mpd.host", "");
+    if (host.empty())
+    {
+        return;
+    }
+
+    auto port = config.getUInt("mpd.port", 6600);
 
-struct mpd_connection* ProjectMWrapper::MPDGetConnection(){
-    return mpdc;
+    _mpdClient.Start(host, port);
+    _mpdStatusWorker.Start(host, port);
 }
 
-bool ProjectMWrapper::MPDConnect()
+void ProjectMWrapper::MPDDisconnect()
 {
-    mpdc = mpd_connection_new(_MPDConfigView->getString("mpd.host").c_str(), _MPDConfigView->getInt("mpd.port",6600), 50000);
-    if (mpd_connection_get_error(mpdc) != MPD_ERROR_SUCCESS) {
-        fprintf(stderr, "%s\n", mpd_connection_get_error_message(mpdc));
-        mpd_connection_free(mpdc);
-        return false;
-    }else{
-        printf("mpd connected ;)\n");
-        return true;
-    }   
+    _mpdStatusWorker.Stop();
+    _mpdClient.Stop();
 }
 
 void ProjectMWrapper::MPDListFilesPreview(const char* name)
 {
-    printf("MPDListFilesPreview\n");
-    if (!mpd_command_list_begin(mpdc, true) ||
-        !mpd_send_status(mpdc) ||
-        !mpd_send_list_playlist_meta(mpdc, name) ||
-        !mpd_command_list_end(mpdc)
-    ) printErrorAndExit();
-    struct mpd_status *status = mpd_recv_status(mpdc);
-    if (status == NULL) printErrorAndExit();
-    queue_size = mpd_status_get_queue_length(status);
-    if (!mpd_response_next(mpdc)) printErrorAndExit();
-    struct mpd_song *song;
-    mpd_preview.clear();
-    while ((song = mpd_recv_song(mpdc)) != NULL) {
-        std::string songname = mpd_song_get_uri(song);
-        mpd_preview.push_back(songname);
-        mpd_song_free(song);
-    }
-    if (mpd_connection_get_error(mpdc) != MPD_ERROR_SUCCESS ||
-        !mpd_response_finish(mpdc)
-    ) printErrorAndExit();
+    std::string playlistName(name);
+    _mpdClient.Post("MPDListFilesPreview", [this, playlistName](struct mpd_connection* connection) {
+        if (!mpd_send_list_playlist_meta(connection, playlistName.c_str()))
+        {
+            return;
+        }
+
+        std::unique_ptr<StringArena> preview(new StringArena);
+        struct mpd_song *song;
+        while ((song = mpd_recv_song(connection)) != NULL) {
+            preview->Append(mpd_song_get_uri(song));
+            mpd_song_free(song);
+        }
+
+        if (mpd_connection_get_error(connection) == MPD_ERROR_SUCCESS)
+        {
+            Poco::FastMutex::ScopedLock lock(_mpdListUpdatesMutex);
+            _mpdPreviewUpdate = std::move(preview);
+        }
+    });
 }
 
 
 void ProjectMWrapper::MPDListFiles()
 {
-    if (!mpd_command_list_begin(mpdc, true) ||
-        !mpd_send_status(mpdc) ||
-        !mpd_send_list_queue_meta(mpdc) ||
-        !mpd_command_list_end(mpdc)
-    ) printErrorAndExit();
-    struct mpd_status *status = mpd_recv_status(mpdc);
-    if (status == NULL) printErrorAndExit();
-    queue_size = mpd_status_get_queue_length(status);
-    if (!mpd_response_next(mpdc)) printErrorAndExit();
-    struct mpd_song *song;
-    mpd_queue.clear();
-    while ((song = mpd_recv_song(mpdc)) != NULL) {
-        std::string songname = mpd_song_get_uri(song);
-        mpd_queue.push_back(songname);
-        mpd_song_free(song);
-    }
-    if (mpd_connection_get_error(mpdc) != MPD_ERROR_SUCCESS ||
-        !mpd_response_finish(mpdc)
-    ) printErrorAndExit();
+    _mpdClient.Post("MPDListFiles", [this](struct mpd_connection* connection) {
+        // Versions from an earlier connection might belong to a since restarted MPD instance.
+        if (_mpdQueueSyncedConnection != _mpdClient.ConnectionId())
+        {
+            _mpdQueueSyncedConnection = _mpdClient.ConnectionId();
+            _mpdQueueSyncedVersion = 0;
+        }
+
+        std::unique_ptr<MPDQueueUpdate> update;
+        unsigned int baseVersion = _mpdQueueSyncedVersion;
+        unsigned int queueVersion{0};
+
+        while (!update)
+        {
+            // Status and changes in one command list, so both refer to the same queue state.
+            if (!mpd_command_list_begin(connection, true) ||
+                !mpd_send_status(connection) ||
+                !mpd_send_queue_changes_meta(connection, baseVersion) ||
+                !mpd_command_list_end(connection))
+            {
+                return;
+            }
+
+            struct mpd_status* status = mpd_recv_status(connection);
+            if (status == NULL)
+            {
+                return;
+            }
+            queueVersion = mpd_status_get_queue_version(status);
+            unsigned int queueLength = mpd_status_get_queue_length(status);
+            mpd_status_free(status);
+
+            if (!mpd_response_next(connection))
+            {
+                return;
+            }
+
+            if (baseVersion > 0 && queueVersion < baseVersion)
+            {
+                // Version went backwards, so MPD was restarted. Fetch the whole queue instead.
+                mpd_response_finish(connection);
+                baseVersion = 0;
+                continue;
+            }
+
+            update.reset(new MPDQueueUpdate);
+            update->full = baseVersion == 0;
+            update->length = queueLength;
+        }
+
+        struct mpd_song *song;
+        while ((song = mpd_recv_song(connection)) != NULL) {
+            update->changes.emplace_back(mpd_song_get_pos(song), mpd_song_get_uri(song));
+            mpd_song_free(song);
+        }
+
+        if (mpd_connection_get_error(connection) != MPD_ERROR_SUCCESS)
+        {
+            return;
+        }
+
+        if (!update->full && update->changes.empty() && queueVersion == _mpdQueueSyncedVersion)
+        {
+            return;
+        }
+
+        poco_debug_f3(_logger, "MPD queue version %u: %?d changed entries, %u total.", queueVersion, update->changes.size(), update->length);
+
+        _mpdQueueSyncedVersion = queueVersion;
+
+        Poco::FastMutex::ScopedLock lock(_mpdListUpdatesMutex);
+        if (_mpdQueueUpdate && !update->full)
+        {
+            // Render thread didn't pick up the last changes yet, append the new ones.
+            _mpdQueueUpdate->length = update->length;
+            std::move(update->changes.begin(), update->changes.end(), std::back_inserter(_mpdQueueUpdate->changes));
+        }
+        else
+        {
+            _mpdQueueUpdate = std::move(update);
+        }
+    });
 }
 
 void ProjectMWrapper::MPDListPlaylists()
 {
-    if (!mpd_command_list_begin(mpdc, true) ||
-        !mpd_send_list_playlists(mpdc) ||
-        !mpd_command_list_end(mpdc)
-    ) printErrorAndExit();
-    mpd_playlists.clear();
-    struct mpd_playlist *playlist;
-    while ((playlist = mpd_recv_playlist(mpdc)) != NULL) {
-            std::string playlistname = mpd_playlist_get_path(playlist);
-            mpd_playlists.push_back(playlistname);
-            //printf("playlists: added '%s'\n",playlistname.c_str());
+    _mpdClient.Post("MPDListPlaylists", [this](struct mpd_connection* connection) {
+        if (!mpd_send_list_playlists(connection))
+        {
+            return;
+        }
+
+        std::unique_ptr<StringArena> playlists(new StringArena);
+        struct mpd_playlist *playlist;
+        while ((playlist = mpd_recv_playlist(connection)) != NULL) {
+            playlists->Append(mpd_playlist_get_path(playlist));
             mpd_playlist_free(playlist);
+        }
+
+        if (mpd_connection_get_error(connection) == MPD_ERROR_SUCCESS)
+        {
+            playlists->Sort();
+
+            Poco::FastMutex::ScopedLock lock(_mpdListUpdatesMutex);
+            _mpdPlaylistsUpdate = std::move(playlists);
+        }
+    });
+}
+
+void ProjectMWrapper::ApplyMPDListUpdates()
+{
+    Poco::FastMutex::ScopedLock lock(_mpdListUpdatesMutex);
+
+    if (_mpdQueueUpdate)
+    {
+        if (_mpdQueueUpdate->full)
+        {
+            mpd_queue.Clear();
+        }
+        mpd_queue.Resize(_mpdQueueUpdate->length);
+
+        for (const auto& change : _mpdQueueUpdate->changes)
+        {
+            if (change.first < mpd_queue.Size())
+            {
+                mpd_queue.Set(change.first, change.second);
+            }
+        }
+        _mpdQueueUpdate.reset();
+    }
+
+    if (_mpdPlaylistsUpdate)
+    {
+        mpd_playlists = std::move(*_mpdPlaylistsUpdate);
+        _mpdPlaylistsUpdate.reset();
+    }
+
+    if (_mpdPreviewUpdate)
+    {
+        mpd_preview = std::move(*_mpdPreviewUpdate);
+        _mpdPreviewUpdate.reset();
     }
-    if (mpd_connection_get_error(mpdc) != MPD_ERROR_SUCCESS ||
-        !mpd_response_finish(mpdc)
-    ) printErrorAndExit();
-    std::sort(mpd_playlists.begin(), mpd_playlists.end()); //,          [] (MPDPlaylist const& a, MPDPlaylist const& b) { return a.v < b.v; });
-    
 }
 
 
-std::string ProjectMWrapper::MPDQGet(uint i){    return mpd_queue.at(i);}
-bool ProjectMWrapper::MPDQDel(uint i){    fprintf(stderr,"mpdqdel: %d\n",i);mpd_queue.erase(mpd_queue.begin()+i); return true;}
-size_t      ProjectMWrapper::MPDQSize(){    return mpd_queue.size();}
-std::string ProjectMWrapper::MPDPLGet(uint i){    return mpd_playlists.at(i);}
-size_t      ProjectMWrapper::MPDPLSize(){    return mpd_playlists.size();}
-std::string ProjectMWrapper::MPDPVGet(uint i){    return mpd_preview.at(i);}
-size_t      ProjectMWrapper::MPDPVSize(){    return mpd_preview.size();}
+const char* ProjectMWrapper::MPDQGet(uint i){    return mpd_queue.At(i);}
+bool ProjectMWrapper::MPDQDel(uint i){    if(i >= mpd_queue.Size())return false; mpd_queue.Erase(i); return true;}
+size_t      ProjectMWrapper::MPDQSize(){    return mpd_queue.Size();}
+const char* ProjectMWrapper::MPDPLGet(uint i){    return mpd_playlists.At(i);}
+size_t      ProjectMWrapper::MPDPLSize(){    return mpd_playlists.Size();}
+const char* ProjectMWrapper::MPDPVGet(uint i){    return mpd_preview.At(i);}
+size_t      ProjectMWrapper::MPDPVSize(){    return mpd_preview.Size();}
 
 void ProjectMWrapper::MPDQueueAddPlaylist(const char* name, bool clear_queue){
-    //printf("Playlist '%s' [%d]\n",name,clear_queue?1:0);
-    if(clear_queue){
-        if (!mpd_command_list_begin(mpdc, true) ||
-            !mpd_send_clear(mpdc) ||
-            !mpd_send_load(mpdc, name) ||
-            !mpd_command_list_end(mpdc)
-        ) printErrorAndExit();
-    }else{
-        if (!mpd_command_list_begin(mpdc, true) ||
-            !mpd_send_load(mpdc, name) ||
-            !mpd_command_list_end(mpdc)
-        ) printErrorAndExit();
+    std::string playlistName(name);
+    _mpdClient.Post("MPDQueueAddPlaylist", [playlistName, clear_queue](struct mpd_connection* connection) {
+        if (!mpd_command_list_begin(connection, true) ||
+            (clear_queue && !mpd_send_clear(connection)) ||
+            !mpd_send_load(connection, playlistName.c_str()) ||
+            !mpd_command_list_end(connection) ||
+            !mpd_response_finish(connection))
+        {
+            return;
+        }
+
+        mpd_run_play(connection);
+    }, MPDClient::Retry::Never);
+
+    if(!clear_queue){
         _mpd_queue_clear_add = true;
-        //printf("->Playlist '%s' [%d]\n",name,clear_queue?1:0);
         Poco::NotificationCenter::defaultCenter().postNotification(
-            new DisplayToastNotification(Poco::format("Playlist '%s' added", std::string(name))));
+            new DisplayToastNotification(Poco::format("Playlist '%s' added", playlistName)));
     }
-    
-    //printf("Playlist '%s' loaded\n",name);
-    mpd_response_finish(mpdc);
+
     MPDListFiles();
-    MPDGetStatus();
-    mpd_run_play(mpdc);
-    MPDGetStatus();
-    
 }
 void ProjectMWrapper::MPDQueueAdd(const char* name){
-    if (!mpd_command_list_begin(mpdc, true) ||
-            !mpd_send_add(mpdc, name) ||
-            !mpd_command_list_end(mpdc)
-        ) printErrorAndExit();
-    mpd_response_finish(mpdc);
+    std::string songName(name);
+    _mpdClient.Post("MPDQueueAdd", [songName](struct mpd_connection* connection) {
+        mpd_run_add(connection, songName.c_str());
+    }, MPDClient::Retry::Never);
     Poco::NotificationCenter::defaultCenter().postNotification(
-        new DisplayToastNotification(Poco::format("Item '%s' added", std::string(name))));
+        new DisplayToastNotification(Poco::format("Item '%s' added", songName)));
 }
 
 void ProjectMWrapper::MPDQueueDelete(uint id){
-    if (!mpd_command_list_begin(mpdc, true) ||
-            !mpd_send_delete(mpdc, id) ||
-            !mpd_command_list_end(mpdc)
-        ) printErrorAndExit();
-    mpd_response_finish(mpdc);
+    _mpdClient.Post("MPDQueueDelete", [id](struct mpd_connection* connection) {
+        mpd_run_delete(connection, id);
+    }, MPDClient::Retry::Never);
 }
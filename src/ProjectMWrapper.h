@@ -1,11 +1,20 @@
 #pragma once
 
+#include "MPDClient.h"
+#include "MPDStatusWorker.h"
+#include "MeshSizeGovernor.h"
+#include "PresetStatsJournal.h"
+#include "PresetStatsTable.h"
+#include "ScaledRenderTarget.h"
+#include "StringArena.h"
+
 #include "notifications/PlaybackControlNotification.h"
 
 #include <projectM-4/projectM.h>
 #include <projectM-4/playlist.h>
 
 #include <Poco/Logger.h>
+#include <Poco/Mutex.h>
 #include <Poco/NObserver.h>
 
 #include <Poco/Util/AbstractConfiguration.h>
@@ -16,13 +25,19 @@
 #include <iostream>
 #include <sstream>
 #include <unistd.h>
+#include <utility>
+#include <vector>
 
 #include "mpd/client.h"
 #include "mpd/status.h"
 
-struct DBPreset{
-        int rating{0};
-        int playcount{0};
+/**
+ * @brief Changes to the local MPD queue copy, fetched via "plchanges".
+ */
+struct MPDQueueUpdate {
+    bool full{false}; //!< True if the changes contain the whole queue.
+    unsigned int length{0}; //!< New queue length.
+    std::vector<std::pair<unsigned int, std::string>> changes; //!< Changed queue positions and their new song URIs.
 };
 
 struct MPDPlaylist{
@@ -67,14 +82,27 @@ public:
 
     /**
      * Renders a single projectM frame.
+     *
+     * If render scaling is active, projectM draws into an offscreen framebuffer which is then scaled up
+     * into the default framebuffer.
      */
-    void RenderFrame() const;
+    void RenderFrame();
+
+    /**
+     * @brief Sets the size of the drawable area projectM renders to.
+     *
+     * projectM itself is told the size multiplied by the configured render scale.
+     *
+     * @param width The drawable width in pixels.
+     * @param height The drawable height in pixels.
+     */
+    void ViewportSize(int width, int height);
 
     /**
      * @brief Returns the targeted FPS value.
-     * @return The user-configured target FPS. Can be 0, which means unlimited.
+     * @return The user-configured target FPS, possibly fractional. Can be 0, which means unlimited.
      */
-    int TargetFPS();
+    double TargetFPS();
 
     /**
      * @brief Updates projectM with the current, actual FPS value.
@@ -82,6 +110,16 @@ public:
      */
     void UpdateRealFPS(float fps);
 
+    /**
+     * @brief Passes the work time of the last frame to the mesh size governor.
+     *
+     * If the adaptive mesh size is enabled and the governor decides to change the mesh size, the new size
+     * is passed on to projectM. Also periodically flushes changed preset stats to the journal.
+     *
+     * @param frameMilliseconds The time spent rendering the last frame, excluding limiter or vsync waits.
+     */
+    void UpdateFrameTime(double frameMilliseconds);
+
     /**
      * @brief If splash is disabled, shows the initial preset.
      * If shuffle is on, a random preset will be picked. Otherwise, the first playlist item is displayed.
@@ -119,15 +157,24 @@ public:
     void SetPlaycount(int playcount);
     void SetConfigPath(std::string path);
 
+    /**
+     * @brief Loads the preset ratings and play counts and starts journaling changes.
+     */
     void LoadDBPresets();
 
 
-    struct mpd_connection* MPDGetConnection();
     void MPDSetRepeat(bool r);
     void MPDSetSingle(bool r);
     bool MPDGetRepeat();
     bool MPDGetSingle();
-    void MPDGetStatus();
+
+    /**
+     * @brief Applies the latest status snapshot and list results published by the MPD threads.
+     *
+     * Never blocks. Posts a toast if the current song has changed. Must be called on the render thread.
+     */
+    void MPDUpdateStatus();
+
     void MPDVolumeUp();
     void MPDVolumeDown();
     void MPDNext();
@@ -137,21 +184,33 @@ public:
     void MPDPlayId (uint i);
     void MPDPlayPos(uint i);
     void MPDPause();
-    void printErrorAndExit();
 
     std::string MPDGetSongName();
     std::string MPDGetSongInfo();
-    uint MPDGetSongId(uint pos);
 
     
-    std::string MPDQGet(uint i);
+    /**
+     * @brief Returns a queue, playlist or preview entry without copying it.
+     *
+     * The returned pointers are valid until the next call to MPDUpdateStatus() or MPDQDel().
+     * Out-of-range indices return an empty string.
+     */
+    const char* MPDQGet(uint i);
     bool MPDQDel(uint i);
     size_t      MPDQSize();
-    std::string MPDPLGet(uint i);
+    const char* MPDPLGet(uint i);
     size_t      MPDPLSize();
-    std::string MPDPVGet(uint i);
+    const char* MPDPVGet(uint i);
     size_t      MPDPVSize();
     
+
+    /**
+     * @brief Brings the local copy of the MPD queue up to date.
+     *
+     * Only fetches the queue positions that changed since the last synchronization, or the whole
+     * queue if there's no valid base version yet. Runs in the background, the result is applied in
+     * MPDUpdateStatus().
+     */
     void MPDListFiles();
     void MPDListFilesPreview(const char* name);
     void MPDListPlaylists();
@@ -181,6 +240,21 @@ private:
 
     std::vector<std::string> GetPathListWithDefault(const std::string& baseKey, const std::string& defaultPath);
 
+    /**
+     * @brief Passes the mesh size settings to the governor and applies the resulting mesh size.
+     */
+    void ConfigureMeshSizeGovernor();
+
+    /**
+     * @brief Sets the projectM mesh size to the governor's current choice if it differs.
+     */
+    void ApplyMeshSize();
+
+    /**
+     * @brief Passes the scaled viewport size to projectM and resizes the offscreen framebuffer.
+     */
+    void ApplyRenderScale();
+
     /**
      * @brief Event callback if a configuration value has changed.
      * @param property The key and value that has been changed.
@@ -195,6 +269,7 @@ private:
 
     Poco::AutoPtr<Poco::Util::AbstractConfiguration> _userConfig; //!< View of the "projectM" configuration subkey in the "user" configuration.
     Poco::AutoPtr<Poco::Util::AbstractConfiguration> _projectMConfigView; //!< View of the "projectM" configuration subkey in the "effective" configuration.
+    Poco::AutoPtr<Poco::Util::AbstractConfiguration> _windowConfigView; //!< View of the "window" configuration subkey in the "effective" configuration.
     Poco::AutoPtr<Poco::Util::AbstractConfiguration> _MPDConfigView; //!< View of the "projectM" configuration subkey in the "effective" configuration.
 
     projectm_handle _projectM{nullptr}; //!< Pointer to the projectM instance used by the application.
@@ -202,15 +277,27 @@ private:
 
     Poco::NObserver<ProjectMWrapper, PlaybackControlNotification> _playbackControlNotificationObserver{*this, &ProjectMWrapper::PlaybackControlNotificationHandler};
 
+    MPDClient _mpdClient; //!< Sends MPD commands in the background.
+    MPDStatusWorker _mpdStatusWorker; //!< Keeps the MPD status up to date in the background.
+    uint64_t _mpdStatusGeneration{0}; //!< Generation of the last applied MPD status snapshot.
+    unsigned int _songElapsedShown{0}; //!< Elapsed song time currently shown in the song info.
+
+    MeshSizeGovernor _meshSizeGovernor; //!< Adapts the mesh size to the frame budget.
+
+    ScaledRenderTarget _scaledRenderTarget; //!< Offscreen framebuffer used if the render scale is below 1.
+    bool _renderScaled{false}; //!< True if projectM currently renders into the offscreen framebuffer.
+    ScaledRenderTarget::Filter _renderScaleFilter{ScaledRenderTarget::Filter::Bilinear}; //!< Filter used to scale up the offscreen image.
+    int _viewportWidth{0}; //!< Full drawable width.
+    int _viewportHeight{0}; //!< Full drawable height.
+
     Poco::Logger& _logger{Poco::Logger::get("SDLRenderingWindow")}; //!< The class logger.
 
-    struct mpd_connection* mpdc;    
 
-    typedef std::map<std::string, DBPreset> DBPM;
-    DBPM dbpm;
+    PresetStatsJournal _presetStatsJournal; //!< Persists every preset stats change in the background.
+    PresetStatsTable _presetStats{_presetStatsJournal}; //!< Stats of the presets used in this session or changed since the last compaction.
 
     std::string configPath;
-    std::string _presetName;
+    PresetStatsTable::PresetId _presetId{PresetStatsTable::InvalidId}; //!< ID of the currently displayed preset.
     int _presetRating;
     int _presetPlaycount;
 
@@ -220,9 +307,17 @@ private:
     std::string _songURI;
     std::string _songURILast;
     std::string _songInfo;
-    std::vector<std::string> mpd_queue;
-    std::vector<std::string> mpd_playlists;
-    std::vector<std::string> mpd_preview;
+    StringArena mpd_queue;
+    StringArena mpd_playlists;
+    StringArena mpd_preview;
+
+    Poco::FastMutex _mpdListUpdatesMutex; //!< Protects the list updates below.
+    std::unique_ptr<MPDQueueUpdate> _mpdQueueUpdate; //!< Queue changes fetched by the MPD client, not yet applied.
+    unsigned int _mpdQueueSyncedVersion{0}; //!< Queue version the fetched changes are based on. MPD client thread only.
+    uint64_t _mpdQueueSyncedConnection{0}; //!< MPD client connection the queue version belongs to. MPD client thread only.
+    unsigned int _mpdQueueRequestedVersion{0}; //!< Last queue version reported by the status worker a sync was requested for.
+    std::unique_ptr<StringArena> _mpdPlaylistsUpdate; //!< Playlists fetched by the MPD client, not yet applied.
+    std::unique_ptr<StringArena> _mpdPreviewUpdate; //!< Playlist preview fetched by the MPD client, not yet applied.
 
     bool _mpdPlaying{false};
     size_t queue_size{0};
@@ -235,11 +330,22 @@ private:
     
     int _songPos{0};
 
-    FILE *filedb;
-    char buffer[1024];
-    
-    bool put(int rating, int playcount, std::string name);
-    bool MPDConnect();
+    /**
+     * @brief Starts the MPD command client and status worker if an MPD host is configured.
+     *
+     * Both connect in the background, so this never blocks.
+     */
+    void MPDConnect();
+
+    /**
+     * @brief Stops the MPD command client and status worker.
+     */
+    void MPDDisconnect();
+
+    /**
+     * @brief Takes over queue changes, playlists and preview lists fetched by the MPD client thread.
+     */
+    void ApplyMPDListUpdates();
     CursorDir cursor_dir{cursordir_none};
 
 };
@@ -0,0 +1,16 @@
+#include "ReconnectBackoff.h"
+
+#include <algorithm>
+
+void ReconnectBackoff::Reset()
+{
+    _delay = InitialDelayMilliseconds;
+}
+
+long ReconnectBackoff::NextDelay()
+{
+    long delay = _delay;
+    _delay = std::min(_delay * 2, MaximumDelayMilliseconds);
+
+    return delay;
+}
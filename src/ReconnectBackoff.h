@@ -0,0 +1,27 @@
+#pragma once
+
+/**
+ * @brief Exponential backoff delay for reconnection attempts.
+ *
+ * Starts with a short delay and doubles it after each failed attempt, up to a fixed maximum.
+ */
+class ReconnectBackoff
+{
+public:
+    /**
+     * @brief Resets the delay to the initial value, e.g. after a successful connection.
+     */
+    void Reset();
+
+    /**
+     * @brief Returns the time to wait before the next attempt and increases the delay for the one after.
+     * @return The delay in milliseconds.
+     */
+    long NextDelay();
+
+protected:
+    static constexpr long InitialDelayMilliseconds{500}; //!< Delay after the first failed attempt.
+    static constexpr long MaximumDelayMilliseconds{30000}; //!< Upper limit for the delay.
+
+    long _delay{InitialDelayMilliseconds}; //!< The next delay to return.
+};
@@ -1,9 +1,10 @@
 #include "RenderLoop.h"
 
-#include "FPSLimiter.h"
+#include "Tracer.h"
 
 #include "gui/ProjectMGUI.h"
 
+#include <Poco/Format.h>
 #include <Poco/NotificationCenter.h>
 
 #include <Poco/Util/Application.h>
@@ -22,33 +23,110 @@ RenderLoop::RenderLoop()
 
 void RenderLoop::Run()
 {
-    FPSLimiter limiter;
-
     auto& notificationCenter{Poco::NotificationCenter::defaultCenter()};
 
     notificationCenter.addObserver(_quitNotificationObserver);
 
+    Tracer::RegisterThread("Render loop");
+
+    auto& config = Poco::Util::Application::instance().config();
+
+    auto logInterval = config.getInt("statistics.logInterval", 60);
+    _statisticsLogInterval = logInterval > 0 ? static_cast<uint64_t>(logInterval) * 1000 : 0;
+    _lastStatisticsLogTicks = SDL_GetTicks64();
+    _frameProfiler.Initialize();
+    _projectMGui.FrameTimeStatistics(&_frameTimeHistogram, &_frameProfiler);
+
+    _idlePolicy.Configure(config.getBool("idle.pauseWhenHidden", true),
+                          config.getDouble("idle.silenceThreshold", -60.0),
+                          config.getInt("idle.silenceTimeout", 0),
+                          config.getDouble("idle.fps", 5.0),
+                          config.getString("idle.mode", "throttle") == "pause");
+    _idlePolicy.Activity(SDL_GetTicks64());
+
     _projectMWrapper.DisplayInitialPreset();
 
     while (!_wantsToQuit)
     {
-        limiter.TargetFPS(_projectMWrapper.TargetFPS());
-        limiter.StartFrame();
+        bool idle = _idlePolicy.IdleReason() != IdlePolicy::Reason::None;
+
+        _fpsLimiter.TargetFPS(idle ? 0.0 : _projectMWrapper.TargetFPS());
+        _fpsLimiter.StartFrame();
+
+        if (idle)
+        {
+            // Returns early on any window or input event, so rendering resumes right away.
+            SDL_WaitEventTimeout(nullptr, static_cast<int>(_idlePolicy.IdleIntervalMilliseconds()));
+        }
+
+        Tracer::Scope frameTrace("render", "Frame");
+
+        _frameProfiler.BeginFrame();
+
+        {
+            FrameProfiler::ScopedStage stage(_frameProfiler, FrameProfiler::Stage::PollEvents);
+            PollEvents();
+        }
+        {
+            FrameProfiler::ScopedStage stage(_frameProfiler, FrameProfiler::Stage::CheckViewportSize);
+            CheckViewportSize();
+        }
+        {
+            FrameProfiler::ScopedStage stage(_frameProfiler, FrameProfiler::Stage::FillBuffer);
+            _audioCapture.Idle(idle);
+            _audioCapture.FillBuffer();
+        }
+
+        UpdateIdleState();
+        bool paused = _idlePolicy.RenderingPaused();
+
+        if (!paused)
+        {
+            {
+                FrameProfiler::ScopedStage stage(_frameProfiler, FrameProfiler::Stage::RenderFrame);
+                _projectMWrapper.RenderFrame();
+            }
+            {
+                FrameProfiler::ScopedStage stage(_frameProfiler, FrameProfiler::Stage::DrawGUI);
+                _projectMWrapper.MPDUpdateStatus();
+                _projectMGui.Draw();
+            }
+            {
+                FrameProfiler::ScopedStage stage(_frameProfiler, FrameProfiler::Stage::Swap);
+                _sdlRenderingWindow.Swap();
+            }
+        }
 
-        PollEvents();
-        CheckViewportSize();
-        _audioCapture.FillBuffer();
-        _projectMWrapper.RenderFrame();
-        _projectMGui.Draw();
+        _frameProfiler.EndFrame();
 
-        _sdlRenderingWindow.Swap();
+        if (!paused)
+        {
+            // Swap is excluded, as it blocks while waiting for vertical sync.
+            const auto& frameSample = _frameProfiler.LastSample();
+            double frameWorkMilliseconds{0.0};
+            for (int stage = 0; stage < static_cast<int>(FrameProfiler::Stage::Swap); stage++)
+            {
+                frameWorkMilliseconds += frameSample.cpuMilliseconds[stage];
+            }
+            _projectMWrapper.UpdateFrameTime(frameWorkMilliseconds);
+        }
 
-        limiter.EndFrame();
+        _fpsLimiter.EndFrame();
 
         // Pass projectM the actual FPS value of the last frame.
-        _projectMWrapper.UpdateRealFPS(limiter.FPS());
+        _projectMWrapper.UpdateRealFPS(_fpsLimiter.FPS());
+
+        // Idle frames would skew the statistics towards the idle frame rate.
+        if (!idle)
+        {
+            UpdateFrameTimeStatistics();
+        }
     }
 
+    LogFrameTimeStatistics();
+    _projectMGui.FrameTimeStatistics(nullptr, nullptr);
+    _frameProfiler.Shutdown();
+
     notificationCenter.removeObserver(_quitNotificationObserver);
 
     projectm_playlist_set_preset_switched_event_callback(_playlistHandle, nullptr, nullptr);
@@ -61,6 +139,13 @@ void RenderLoop::PollEvents()
     while (SDL_PollEvent(&event))
     {
         _projectMGui.ProcessInput(event);
+
+        if (event.type == SDL_KEYDOWN || event.type == SDL_MOUSEBUTTONDOWN ||
+            event.type == SDL_MOUSEWHEEL || event.type == SDL_MOUSEMOTION)
+        {
+            _idlePolicy.Activity(SDL_GetTicks64());
+        }
+
         switch (event.type)
         {
             case SDL_MOUSEWHEEL:
@@ -106,6 +191,10 @@ void RenderLoop::PollEvents()
                 _projectMGui.GotMouseMotion();
                 break;
 
+            case SDL_WINDOWEVENT:
+                WindowEvent(event.window);
+                break;
+
             case SDL_QUIT:
                 _wantsToQuit = true;
                 break;
@@ -121,7 +210,7 @@ void RenderLoop::CheckViewportSize()
 
     if (renderWidth != _renderWidth || renderHeight != _renderHeight)
     {
-        projectm_set_window_size(_projectMHandle, renderWidth, renderHeight);
+        _projectMWrapper.ViewportSize(renderWidth, renderHeight);
         _renderWidth = renderWidth;
         _renderHeight = renderHeight;
 
@@ -131,6 +220,81 @@ void RenderLoop::CheckViewportSize()
     }
 }
 
+void RenderLoop::UpdateIdleState()
+{
+    if (!_idlePolicy.Update(_audioCapture.GainControl().Level(), SDL_GetTicks64()))
+    {
+        return;
+    }
+
+    switch (_idlePolicy.IdleReason())
+    {
+        case IdlePolicy::Reason::None:
+            poco_information(_logger, "Leaving idle mode, rendering at full frame rate.");
+            break;
+
+        case IdlePolicy::Reason::Hidden:
+            poco_information(_logger, "Window is hidden, pausing rendering.");
+            break;
+
+        case IdlePolicy::Reason::Silence:
+            poco_information(_logger, _idlePolicy.RenderingPaused()
+                                          ? "No audio signal, pausing rendering."
+                                          : "No audio signal, throttling rendering.");
+            break;
+    }
+}
+
+void RenderLoop::WindowEvent(const SDL_WindowEvent& event)
+{
+    switch (event.event)
+    {
+        case SDL_WINDOWEVENT_HIDDEN:
+        case SDL_WINDOWEVENT_MINIMIZED:
+            _idlePolicy.WindowVisible(false);
+            break;
+
+        case SDL_WINDOWEVENT_SHOWN:
+        case SDL_WINDOWEVENT_EXPOSED:
+        case SDL_WINDOWEVENT_RESTORED:
+        case SDL_WINDOWEVENT_MAXIMIZED:
+            _idlePolicy.WindowVisible(true);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void RenderLoop::UpdateFrameTimeStatistics()
+{
+    _frameTimeHistogram.Record(_fpsLimiter.LastFrameMicroseconds(), _fpsLimiter.LastFrameMissedDeadline());
+
+    if (_statisticsLogInterval == 0)
+    {
+        return;
+    }
+
+    auto currentTicks = SDL_GetTicks64();
+    if (currentTicks - _lastStatisticsLogTicks >= _statisticsLogInterval)
+    {
+        LogFrameTimeStatistics();
+        _lastStatisticsLogTicks = currentTicks;
+    }
+}
+
+void RenderLoop::LogFrameTimeStatistics()
+{
+    auto summary = _frameTimeHistogram.GetSummary();
+    if (summary.frameCount == 0)
+    {
+        return;
+    }
+
+    poco_information(_logger, Poco::format("Frame times over %?d frames: min %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms, missed deadlines: %?d",
+                                           summary.frameCount, summary.minimum, summary.p50, summary.p95, summary.p99, summary.maximum, summary.missedDeadlines));
+}
+
 void RenderLoop::KeyEvent(const SDL_KeyboardEvent& event, bool down)
 {
     auto keyModifier{static_cast<SDL_Keymod>(event.keysym.mod)};
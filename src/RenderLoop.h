@@ -1,6 +1,10 @@
 #pragma once
 
 #include "AudioCapture.h"
+#include "FPSLimiter.h"
+#include "FrameProfiler.h"
+#include "FrameTimeHistogram.h"
+#include "IdlePolicy.h"
 #include "ProjectMWrapper.h"
 #include "SDLRenderingWindow.h"
 
@@ -37,6 +41,27 @@ protected:
      */
     void CheckViewportSize();
 
+    /**
+     * @brief Records the last frame time and periodically logs the frame time statistics.
+     */
+    void UpdateFrameTimeStatistics();
+
+    /**
+     * @brief Writes the current frame time percentiles to the log.
+     */
+    void LogFrameTimeStatistics();
+
+    /**
+     * @brief Passes the latest audio level to the idle policy and logs idle state changes.
+     */
+    void UpdateIdleState();
+
+    /**
+     * @brief Handles SDL window events, tracking whether the window is visible.
+     * @param event The window event.
+     */
+    void WindowEvent(const SDL_WindowEvent& event);
+
     /**
      * @brief Handles SDL key press events.
      * @param event The key event.
@@ -78,6 +103,14 @@ protected:
 
     Poco::NObserver<RenderLoop, QuitNotification> _quitNotificationObserver{*this, &RenderLoop::QuitNotificationHandler}; //!< The observer for quit notifications.
 
+    FPSLimiter _fpsLimiter; //!< Frame rate limiter and frame timer.
+    FrameTimeHistogram _frameTimeHistogram; //!< Frame time distribution since startup or the last reset.
+    FrameProfiler _frameProfiler; //!< Per-stage CPU and GPU timings of the last frames.
+    IdlePolicy _idlePolicy; //!< Decides when to throttle or pause rendering.
+
+    uint64_t _statisticsLogInterval{0}; //!< Interval in milliseconds between frame time log messages, 0 if disabled.
+    uint64_t _lastStatisticsLogTicks{0}; //!< SDL tick count when the frame time statistics were last logged.
+
     bool _wantsToQuit{false};
 
     bool _mouseDown{false}; //!< Left mouse button is pressed
@@ -0,0 +1,464 @@
+#include "ScaledRenderTarget.h"
+
+#include <SDL2/SDL.h>
+
+#ifdef USE_GLEW
+#include <GL/glew.h>
+#endif
+
+#include <SDL2/SDL_opengl.h>
+
+#include <string>
+#include <vector>
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+
+#ifndef GL_DRAW_FRAMEBUFFER
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+
+#ifndef GL_RENDERBUFFER
+#define GL_RENDERBUFFER 0x8D41
+#endif
+
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+
+#ifndef GL_DEPTH_STENCIL_ATTACHMENT
+#define GL_DEPTH_STENCIL_ATTACHMENT 0x821A
+#endif
+
+#ifndef GL_DEPTH24_STENCIL8
+#define GL_DEPTH24_STENCIL8 0x88F0
+#endif
+
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+#ifndef GL_INFO_LOG_LENGTH
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+struct ScaledRenderTarget::GLFunctions {
+    void(APIENTRY* genFramebuffers)(GLsizei, GLuint*){nullptr};
+    void(APIENTRY* deleteFramebuffers)(GLsizei, const GLuint*){nullptr};
+    void(APIENTRY* bindFramebuffer)(GLenum, GLuint){nullptr};
+    void(APIENTRY* framebufferTexture2D)(GLenum, GLenum, GLenum, GLuint, GLint){nullptr};
+    void(APIENTRY* framebufferRenderbuffer)(GLenum, GLenum, GLenum, GLuint){nullptr};
+    GLenum(APIENTRY* checkFramebufferStatus)(GLenum){nullptr};
+    void(APIENTRY* genRenderbuffers)(GLsizei, GLuint*){nullptr};
+    void(APIENTRY* deleteRenderbuffers)(GLsizei, const GLuint*){nullptr};
+    void(APIENTRY* bindRenderbuffer)(GLenum, GLuint){nullptr};
+    void(APIENTRY* renderbufferStorage)(GLenum, GLenum, GLsizei, GLsizei){nullptr};
+    void(APIENTRY* blitFramebuffer)(GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum){nullptr};
+    void(APIENTRY* activeTexture)(GLenum){nullptr};
+    GLuint(APIENTRY* createShader)(GLenum){nullptr};
+    void(APIENTRY* shaderSource)(GLuint, GLsizei, const GLchar* const*, const GLint*){nullptr};
+    void(APIENTRY* compileShader)(GLuint){nullptr};
+    void(APIENTRY* getShaderiv)(GLuint, GLenum, GLint*){nullptr};
+    void(APIENTRY* getShaderInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*){nullptr};
+    void(APIENTRY* deleteShader)(GLuint){nullptr};
+    GLuint(APIENTRY* createProgram)(){nullptr};
+    void(APIENTRY* attachShader)(GLuint, GLuint){nullptr};
+    void(APIENTRY* linkProgram)(GLuint){nullptr};
+    void(APIENTRY* getProgramiv)(GLuint, GLenum, GLint*){nullptr};
+    void(APIENTRY* getProgramInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*){nullptr};
+    void(APIENTRY* deleteProgram)(GLuint){nullptr};
+    void(APIENTRY* useProgram)(GLuint){nullptr};
+    GLint(APIENTRY* getUniformLocation)(GLuint, const GLchar*){nullptr};
+    void(APIENTRY* uniform1i)(GLint, GLint){nullptr};
+    void(APIENTRY* uniform2f)(GLint, GLfloat, GLfloat){nullptr};
+    void(APIENTRY* genVertexArrays)(GLsizei, GLuint*){nullptr};
+    void(APIENTRY* deleteVertexArrays)(GLsizei, const GLuint*){nullptr};
+    void(APIENTRY* bindVertexArray)(GLuint){nullptr};
+};
+
+namespace {
+
+// Draws a single triangle covering the whole viewport, no vertex buffer required.
+const char* SharpFilterVertexShader = R"(#version 330 core
+out vec2 texCoord;
+
+void main()
+{
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    texCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Catmull-Rom bicubic filter, using the hardware bilinear filter to reduce the 16 taps to 9.
+const char* SharpFilterFragmentShader = R"(#version 330 core
+uniform sampler2D sourceTexture;
+uniform vec2 sourceSize;
+
+in vec2 texCoord;
+out vec4 color;
+
+void main()
+{
+    vec2 samplePosition = texCoord * sourceSize;
+    vec2 texPos1 = floor(samplePosition - 0.5) + 0.5;
+    vec2 f = samplePosition - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    vec2 w12 = w1 + w2;
+    vec2 offset12 = w2 / w12;
+
+    vec2 texPos0 = (texPos1 - 1.0) / sourceSize;
+    vec2 texPos3 = (texPos1 + 2.0) / sourceSize;
+    vec2 texPos12 = (texPos1 + offset12) / sourceSize;
+
+    vec4 result = vec4(0.0);
+    result += texture(sourceTexture, vec2(texPos0.x, texPos0.y)) * w0.x * w0.y;
+    result += texture(sourceTexture, vec2(texPos12.x, texPos0.y)) * w12.x * w0.y;
+    result += texture(sourceTexture, vec2(texPos3.x, texPos0.y)) * w3.x * w0.y;
+
+    result += texture(sourceTexture, vec2(texPos0.x, texPos12.y)) * w0.x * w12.y;
+    result += texture(sourceTexture, vec2(texPos12.x, texPos12.y)) * w12.x * w12.y;
+    result += texture(sourceTexture, vec2(texPos3.x, texPos12.y)) * w3.x * w12.y;
+
+    result += texture(sourceTexture, vec2(texPos0.x, texPos3.y)) * w0.x * w3.y;
+    result += texture(sourceTexture, vec2(texPos12.x, texPos3.y)) * w12.x * w3.y;
+    result += texture(sourceTexture, vec2(texPos3.x, texPos3.y)) * w3.x * w3.y;
+
+    color = vec4(clamp(result.rgb, 0.0, 1.0), 1.0);
+}
+)";
+
+} // namespace
+
+ScaledRenderTarget::ScaledRenderTarget()
+    : _gl(new GLFunctions)
+{
+}
+
+ScaledRenderTarget::~ScaledRenderTarget() = default;
+
+bool ScaledRenderTarget::Initialize()
+{
+#if USE_GLES
+    // The GLES 2.0 context has neither framebuffer blits nor GLSL 3.30.
+    _available = false;
+#else
+    auto load = [](const char* name) {
+        return SDL_GL_GetProcAddress(name);
+    };
+
+    _gl->genFramebuffers = reinterpret_cast<decltype(_gl->genFramebuffers)>(load("glGenFramebuffers"));
+    _gl->deleteFramebuffers = reinterpret_cast<decltype(_gl->deleteFramebuffers)>(load("glDeleteFramebuffers"));
+    _gl->bindFramebuffer = reinterpret_cast<decltype(_gl->bindFramebuffer)>(load("glBindFramebuffer"));
+    _gl->framebufferTexture2D = reinterpret_cast<decltype(_gl->framebufferTexture2D)>(load("glFramebufferTexture2D"));
+    _gl->framebufferRenderbuffer = reinterpret_cast<decltype(_gl->framebufferRenderbuffer)>(load("glFramebufferRenderbuffer"));
+    _gl->checkFramebufferStatus = reinterpret_cast<decltype(_gl->checkFramebufferStatus)>(load("glCheckFramebufferStatus"));
+    _gl->genRenderbuffers = reinterpret_cast<decltype(_gl->genRenderbuffers)>(load("glGenRenderbuffers"));
+    _gl->deleteRenderbuffers = reinterpret_cast<decltype(_gl->deleteRenderbuffers)>(load("glDeleteRenderbuffers"));
+    _gl->bindRenderbuffer = reinterpret_cast<decltype(_gl->bindRenderbuffer)>(load("glBindRenderbuffer"));
+    _gl->renderbufferStorage = reinterpret_cast<decltype(_gl->renderbufferStorage)>(load("glRenderbufferStorage"));
+    _gl->blitFramebuffer = reinterpret_cast<decltype(_gl->blitFramebuffer)>(load("glBlitFramebuffer"));
+    _gl->activeTexture = reinterpret_cast<decltype(_gl->activeTexture)>(load("glActiveTexture"));
+    _gl->createShader = reinterpret_cast<decltype(_gl->createShader)>(load("glCreateShader"));
+    _gl->shaderSource = reinterpret_cast<decltype(_gl->shaderSource)>(load("glShaderSource"));
+    _gl->compileShader = reinterpret_cast<decltype(_gl->compileShader)>(load("glCompileShader"));
+    _gl->getShaderiv = reinterpret_cast<decltype(_gl->getShaderiv)>(load("glGetShaderiv"));
+    _gl->getShaderInfoLog = reinterpret_cast<decltype(_gl->getShaderInfoLog)>(load("glGetShaderInfoLog"));
+    _gl->deleteShader = reinterpret_cast<decltype(_gl->deleteShader)>(load("glDeleteShader"));
+    _gl->createProgram = reinterpret_cast<decltype(_gl->createProgram)>(load("glCreateProgram"));
+    _gl->attachShader = reinterpret_cast<decltype(_gl->attachShader)>(load("glAttachShader"));
+    _gl->linkProgram = reinterpret_cast<decltype(_gl->linkProgram)>(load("glLinkProgram"));
+    _gl->getProgramiv = reinterpret_cast<decltype(_gl->getProgramiv)>(load("glGetProgramiv"));
+    _gl->getProgramInfoLog = reinterpret_cast<decltype(_gl->getProgramInfoLog)>(load("glGetProgramInfoLog"));
+    _gl->deleteProgram = reinterpret_cast<decltype(_gl->deleteProgram)>(load("glDeleteProgram"));
+    _gl->useProgram = reinterpret_cast<decltype(_gl->useProgram)>(load("glUseProgram"));
+    _gl->getUniformLocation = reinterpret_cast<decltype(_gl->getUniformLocation)>(load("glGetUniformLocation"));
+    _gl->uniform1i = reinterpret_cast<decltype(_gl->uniform1i)>(load("glUniform1i"));
+    _gl->uniform2f = reinterpret_cast<decltype(_gl->uniform2f)>(load("glUniform2f"));
+    _gl->genVertexArrays = reinterpret_cast<decltype(_gl->genVertexArrays)>(load("glGenVertexArrays"));
+    _gl->deleteVertexArrays = reinterpret_cast<decltype(_gl->deleteVertexArrays)>(load("glDeleteVertexArrays"));
+    _gl->bindVertexArray = reinterpret_cast<decltype(_gl->bindVertexArray)>(load("glBindVertexArray"));
+
+    _available = _gl->genFramebuffers && _gl->deleteFramebuffers && _gl->bindFramebuffer && _gl->framebufferTexture2D &&
+                 _gl->framebufferRenderbuffer && _gl->checkFramebufferStatus && _gl->genRenderbuffers &&
+                 _gl->deleteRenderbuffers && _gl->bindRenderbuffer && _gl->renderbufferStorage && _gl->blitFramebuffer &&
+                 _gl->activeTexture && _gl->createShader && _gl->shaderSource && _gl->compileShader && _gl->getShaderiv &&
+                 _gl->getShaderInfoLog && _gl->deleteShader && _gl->createProgram && _gl->attachShader && _gl->linkProgram &&
+                 _gl->getProgramiv && _gl->getProgramInfoLog && _gl->deleteProgram && _gl->useProgram &&
+                 _gl->getUniformLocation && _gl->uniform1i && _gl->uniform2f && _gl->genVertexArrays &&
+                 _gl->deleteVertexArrays && _gl->bindVertexArray;
+#endif
+
+    if (!_available)
+    {
+        poco_information(_logger, "Offscreen framebuffers are not supported by the driver, render scaling is disabled.");
+    }
+
+    return _available;
+}
+
+void ScaledRenderTarget::Shutdown()
+{
+    if (!_available)
+    {
+        return;
+    }
+
+    DeleteFramebuffer();
+
+    if (_sharpFilterProgram != 0)
+    {
+        _gl->deleteProgram(_sharpFilterProgram);
+        _sharpFilterProgram = 0;
+    }
+
+    if (_vertexArray != 0)
+    {
+        _gl->deleteVertexArrays(1, &_vertexArray);
+        _vertexArray = 0;
+    }
+
+    _sharpFilterFailed = false;
+}
+
+bool ScaledRenderTarget::Available() const
+{
+    return _available;
+}
+
+bool ScaledRenderTarget::Resize(int width, int height)
+{
+    if (!_available || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    if (_framebuffer != 0 && width == _width && height == _height)
+    {
+        return true;
+    }
+
+    DeleteFramebuffer();
+
+    glGenTextures(1, &_colorTexture);
+    glBindTexture(GL_TEXTURE_2D, _colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    _gl->genRenderbuffers(1, &_depthStencilBuffer);
+    _gl->bindRenderbuffer(GL_RENDERBUFFER, _depthStencilBuffer);
+    _gl->renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    _gl->bindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    _gl->genFramebuffers(1, &_framebuffer);
+    _gl->bindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    _gl->framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture, 0);
+    _gl->framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthStencilBuffer);
+    auto status = _gl->checkFramebufferStatus(GL_FRAMEBUFFER);
+    _gl->bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        poco_error_f3(_logger, "Could not create a %?dx%?d offscreen framebuffer (status 0x%x).", width, height, static_cast<unsigned int>(status));
+        DeleteFramebuffer();
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+
+    poco_debug_f2(_logger, "Created %?dx%?d offscreen framebuffer.", width, height);
+
+    return true;
+}
+
+uint32_t ScaledRenderTarget::Framebuffer() const
+{
+    return _framebuffer;
+}
+
+void ScaledRenderTarget::Bind()
+{
+    _gl->bindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glViewport(0, 0, _width, _height);
+}
+
+void ScaledRenderTarget::Present(int drawableWidth, int drawableHeight, Filter filter)
+{
+    if (filter == Filter::Sharp && CreateSharpFilterProgram())
+    {
+        _gl->bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, drawableWidth, drawableHeight);
+
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_SCISSOR_TEST);
+        glDisable(GL_CULL_FACE);
+
+        _gl->useProgram(_sharpFilterProgram);
+        _gl->uniform2f(_sourceSizeLocation, static_cast<GLfloat>(_width), static_cast<GLfloat>(_height));
+        _gl->activeTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _colorTexture);
+        _gl->bindVertexArray(_vertexArray);
+
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        _gl->bindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        _gl->useProgram(0);
+
+        return;
+    }
+
+    _gl->bindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+    _gl->bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    _gl->blitFramebuffer(0, 0, _width, _height, 0, 0, drawableWidth, drawableHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    _gl->bindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, drawableWidth, drawableHeight);
+}
+
+bool ScaledRenderTarget::CreateSharpFilterProgram()
+{
+    if (_sharpFilterProgram != 0)
+    {
+        return true;
+    }
+
+    if (_sharpFilterFailed)
+    {
+        return false;
+    }
+
+    // Only try once, then stick with bilinear filtering.
+    _sharpFilterFailed = true;
+
+    auto vertexShader = CompileShader(GL_VERTEX_SHADER, SharpFilterVertexShader);
+    auto fragmentShader = CompileShader(GL_FRAGMENT_SHADER, SharpFilterFragmentShader);
+    if (vertexShader == 0 || fragmentShader == 0)
+    {
+        _gl->deleteShader(vertexShader);
+        _gl->deleteShader(fragmentShader);
+        return false;
+    }
+
+    auto program = _gl->createProgram();
+    _gl->attachShader(program, vertexShader);
+    _gl->attachShader(program, fragmentShader);
+    _gl->linkProgram(program);
+
+    // Shaders are only flagged for deletion and freed together with the program.
+    _gl->deleteShader(vertexShader);
+    _gl->deleteShader(fragmentShader);
+
+    GLint linked{GL_FALSE};
+    _gl->getProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        GLint logLength{0};
+        _gl->getProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<GLchar> log(static_cast<size_t>(logLength) + 1, 0);
+        _gl->getProgramInfoLog(program, logLength, nullptr, log.data());
+        poco_error_f1(_logger, "Could not link the sharp upscaling shader, falling back to bilinear filtering:\n%s", std::string(log.data()));
+
+        _gl->deleteProgram(program);
+        return false;
+    }
+
+    _sharpFilterProgram = program;
+    _sourceSizeLocation = _gl->getUniformLocation(_sharpFilterProgram, "sourceSize");
+
+    _gl->useProgram(_sharpFilterProgram);
+    _gl->uniform1i(_gl->getUniformLocation(_sharpFilterProgram, "sourceTexture"), 0);
+    _gl->useProgram(0);
+
+    _gl->genVertexArrays(1, &_vertexArray);
+
+    _sharpFilterFailed = false;
+
+    return true;
+}
+
+uint32_t ScaledRenderTarget::CompileShader(uint32_t type, const char* source)
+{
+    auto shader = _gl->createShader(type);
+    _gl->shaderSource(shader, 1, &source, nullptr);
+    _gl->compileShader(shader);
+
+    GLint compiled{GL_FALSE};
+    _gl->getShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE)
+    {
+        GLint logLength{0};
+        _gl->getShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<GLchar> log(static_cast<size_t>(logLength) + 1, 0);
+        _gl->getShaderInfoLog(shader, logLength, nullptr, log.data());
+        poco_error_f1(_logger, "Could not compile the sharp upscaling shader:\n%s", std::string(log.data()));
+
+        _gl->deleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+void ScaledRenderTarget::DeleteFramebuffer()
+{
+    if (_framebuffer != 0)
+    {
+        _gl->deleteFramebuffers(1, &_framebuffer);
+        _framebuffer = 0;
+    }
+
+    if (_depthStencilBuffer != 0)
+    {
+        _gl->deleteRenderbuffers(1, &_depthStencilBuffer);
+        _depthStencilBuffer = 0;
+    }
+
+    if (_colorTexture != 0)
+    {
+        glDeleteTextures(1, &_colorTexture);
+        _colorTexture = 0;
+    }
+
+    _width = 0;
+    _height = 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Poco/Logger.h>
+
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Offscreen framebuffer projectM renders into at a reduced resolution.
+ *
+ * The framebuffer is then scaled up to the full drawable size, either with a plain bilinear
+ * framebuffer blit or with a Catmull-Rom bicubic shader pass, which keeps edges noticeably sharper.
+ *
+ * Requires OpenGL 3.3 core. All methods must be called on the thread with the rendering GL context
+ * being current.
+ */
+class ScaledRenderTarget
+{
+public:
+    /**
+     * @brief Available upscaling filters.
+     */
+    enum class Filter
+    {
+        Bilinear, //!< Linear filtering via glBlitFramebuffer.
+        Sharp //!< Bicubic Catmull-Rom filtering in a shader pass.
+    };
+
+    ScaledRenderTarget();
+
+    ~ScaledRenderTarget();
+
+    /**
+     * @brief Resolves the required GL functions.
+     * @return True if the render target can be used, false if the driver lacks support.
+     */
+    bool Initialize();
+
+    /**
+     * @brief Deletes all GL objects.
+     */
+    void Shutdown();
+
+    /**
+     * @brief Returns whether the render target is usable.
+     * @return True if Initialize() succeeded.
+     */
+    bool Available() const;
+
+    /**
+     * @brief Sets the size of the offscreen framebuffer, recreating it if necessary.
+     * @param width The scaled render width in pixels.
+     * @param height The scaled render height in pixels.
+     * @return True if the framebuffer is complete and can be rendered to.
+     */
+    bool Resize(int width, int height);
+
+    /**
+     * @brief Returns the GL name of the offscreen framebuffer.
+     * @return The framebuffer object, 0 if none is allocated.
+     */
+    uint32_t Framebuffer() const;
+
+    /**
+     * @brief Binds the offscreen framebuffer and sets the viewport to its size.
+     */
+    void Bind();
+
+    /**
+     * @brief Scales the offscreen image up into the default framebuffer.
+     *
+     * Leaves the default framebuffer bound with the viewport covering the whole drawable.
+     *
+     * @param drawableWidth The width of the default framebuffer.
+     * @param drawableHeight The height of the default framebuffer.
+     * @param filter The scaling filter to use.
+     */
+    void Present(int drawableWidth, int drawableHeight, Filter filter);
+
+protected:
+    /**
+     * @brief Compiles and links the sharp upscaling shader on first use.
+     * @return True if the shader program is ready.
+     */
+    bool CreateSharpFilterProgram();
+
+    /**
+     * @brief Compiles a single shader stage.
+     * @param type The shader type.
+     * @param source The GLSL source code.
+     * @return The shader name, or 0 on failure.
+     */
+    uint32_t CompileShader(uint32_t type, const char* source);
+
+    /**
+     * @brief Deletes the framebuffer, texture and depth buffer.
+     */
+    void DeleteFramebuffer();
+
+    struct GLFunctions;
+
+    std::unique_ptr<GLFunctions> _gl; //!< GL 3.x functions resolved from the driver.
+
+    bool _available{false}; //!< True if all required GL functions are available.
+
+    uint32_t _framebuffer{0}; //!< Offscreen framebuffer object.
+    uint32_t _colorTexture{0}; //!< Color attachment, also used as upscaling source.
+    uint32_t _depthStencilBuffer{0}; //!< Depth/stencil renderbuffer attachment.
+    int _width{0}; //!< Current framebuffer width.
+    int _height{0}; //!< Current framebuffer height.
+
+    uint32_t _sharpFilterProgram{0}; //!< Bicubic upscaling shader program.
+    bool _sharpFilterFailed{false}; //!< True if the sharp filter shader could not be built. Falls back to bilinear.
+    int _sourceSizeLocation{-1}; //!< Uniform location of the source texture size.
+    uint32_t _vertexArray{0}; //!< Empty VAO, required by core profiles to draw the fullscreen triangle.
+
+    Poco::Logger& _logger{Poco::Logger::get("ScaledRenderTarget")}; //!< The class logger.
+};
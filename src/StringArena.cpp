@@ -0,0 +1,133 @@
+#include "StringArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+void StringArena::Clear()
+{
+    _buffer.assign(1, '\0');
+    _offsets.clear();
+    _unusedBytes = 0;
+}
+
+size_t StringArena::Size() const
+{
+    return _offsets.size();
+}
+
+bool StringArena::Empty() const
+{
+    return _offsets.empty();
+}
+
+const char* StringArena::At(size_t index) const
+{
+    if (index >= _offsets.size())
+    {
+        return _buffer.data();
+    }
+
+    return _buffer.data() + _offsets[index];
+}
+
+void StringArena::Append(const std::string& text)
+{
+    _offsets.push_back(Store(text));
+}
+
+void StringArena::Set(size_t index, const std::string& text)
+{
+    auto oldOffset = _offsets.at(index);
+    if (oldOffset != 0)
+    {
+        _unusedBytes += std::strlen(_buffer.data() + oldOffset) + 1;
+    }
+
+    _offsets[index] = Store(text);
+
+    CompactIfRequired();
+}
+
+void StringArena::Erase(size_t index)
+{
+    if (index >= _offsets.size())
+    {
+        return;
+    }
+
+    if (_offsets[index] != 0)
+    {
+        _unusedBytes += std::strlen(_buffer.data() + _offsets[index]) + 1;
+    }
+
+    _offsets.erase(_offsets.begin() + static_cast<std::ptrdiff_t>(index));
+
+    CompactIfRequired();
+}
+
+void StringArena::Resize(size_t size)
+{
+    for (size_t index = size; index < _offsets.size(); index++)
+    {
+        if (_offsets[index] != 0)
+        {
+            _unusedBytes += std::strlen(_buffer.data() + _offsets[index]) + 1;
+        }
+    }
+
+    // New entries point to the empty string at offset 0.
+    _offsets.resize(size, 0);
+
+    CompactIfRequired();
+}
+
+void StringArena::Sort()
+{
+    const char* buffer = _buffer.data();
+    std::sort(_offsets.begin(), _offsets.end(), [buffer](uint32_t left, uint32_t right) {
+        return std::strcmp(buffer + left, buffer + right) < 0;
+    });
+}
+
+uint32_t StringArena::Store(const std::string& text)
+{
+    if (text.empty())
+    {
+        return 0;
+    }
+
+    auto offset = static_cast<uint32_t>(_buffer.size());
+    _buffer.insert(_buffer.end(), text.begin(), text.end());
+    _buffer.push_back('\0');
+
+    return offset;
+}
+
+void StringArena::CompactIfRequired()
+{
+    if (_unusedBytes < 4096 || _unusedBytes * 2 < _buffer.size())
+    {
+        return;
+    }
+
+    std::vector<char> buffer;
+    buffer.reserve(_buffer.size() - _unusedBytes);
+    buffer.push_back('\0');
+
+    for (auto& offset : _offsets)
+    {
+        if (offset == 0)
+        {
+            continue;
+        }
+
+        const char* text = _buffer.data() + offset;
+        auto length = std::strlen(text);
+
+        offset = static_cast<uint32_t>(buffer.size());
+        buffer.insert(buffer.end(), text, text + length + 1);
+    }
+
+    _buffer.swap(buffer);
+    _unusedBytes = 0;
+}
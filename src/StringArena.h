@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A list of strings stored back to back in a single character buffer.
+ *
+ * Each entry is addressed by its offset into the buffer and zero-terminated, so it can be passed to
+ * C APIs like ImGui directly, without copying or allocating anything per entry.
+ *
+ * Replacing an entry appends the new text and leaves the old one as unused space in the buffer.
+ * Once more than half of the buffer is unused, it's compacted.
+ */
+class StringArena
+{
+public:
+    /**
+     * @brief Removes all entries.
+     */
+    void Clear();
+
+    /**
+     * @brief Returns the number of entries.
+     * @return The number of entries.
+     */
+    size_t Size() const;
+
+    /**
+     * @brief Returns whether the arena has no entries.
+     * @return True if there are no entries.
+     */
+    bool Empty() const;
+
+    /**
+     * @brief Returns an entry.
+     *
+     * The pointer is invalidated by any modification of the arena.
+     *
+     * @param index The entry index.
+     * @return The zero-terminated entry text, or an empty string if the index is out of range.
+     */
+    const char* At(size_t index) const;
+
+    /**
+     * @brief Adds an entry at the end.
+     * @param text The entry text.
+     */
+    void Append(const std::string& text);
+
+    /**
+     * @brief Replaces the text of an entry.
+     * @param index The entry index. Must be less than Size().
+     * @param text The new text.
+     */
+    void Set(size_t index, const std::string& text);
+
+    /**
+     * @brief Removes an entry, moving all following entries up by one.
+     * @param index The entry index. Out-of-range indices are ignored.
+     */
+    void Erase(size_t index);
+
+    /**
+     * @brief Truncates the arena or pads it with empty entries.
+     * @param size The new number of entries.
+     */
+    void Resize(size_t size);
+
+    /**
+     * @brief Sorts the entries in byte-wise ascending order.
+     */
+    void Sort();
+
+protected:
+    /**
+     * @brief Copies text into the buffer.
+     * @param text The text to store.
+     * @return The offset of the stored text.
+     */
+    uint32_t Store(const std::string& text);
+
+    /**
+     * @brief Rebuilds the buffer without unused space if it has become too fragmented.
+     */
+    void CompactIfRequired();
+
+    std::vector<char> _buffer{'\0'}; //!< All entry texts. Offset 0 always holds an empty string.
+    std::vector<uint32_t> _offsets; //!< Buffer offset of each entry.
+    size_t _unusedBytes{0}; //!< Bytes in the buffer no longer referenced by any entry.
+};
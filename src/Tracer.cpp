@@ -0,0 +1,365 @@
+#include "Tracer.h"
+
+#include <Poco/Util/Application.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+std::atomic_bool Tracer::_enabled{false};
+Tracer* Tracer::_instance{nullptr};
+
+namespace {
+
+thread_local void* currentThreadBuffer{nullptr}; //!< The calling thread's Tracer::ThreadBuffer, if registered.
+
+/**
+ * @brief Keeps the calling thread's buffer alive and marks it as exited when the thread ends.
+ *
+ * Holds a shared reference to the buffer's state, so it can be set safely even if the tracer was already
+ * destroyed. Assigning it only copies a shared pointer, which never allocates.
+ */
+struct ThreadBufferOwner {
+    std::shared_ptr<std::atomic<int>> state; //!< The buffer's state, aliasing the buffer itself.
+    int exitedState{0}; //!< The state value marking the buffer as exited.
+
+    ~ThreadBufferOwner()
+    {
+        if (state)
+        {
+            state->store(exitedState, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBufferOwner currentThreadBufferOwner; //!< Owner of currentThreadBuffer.
+
+uint64_t ClockMicroseconds()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+} // namespace
+
+Tracer::Scope::Scope(const char* category, const char* name)
+    : _category(category)
+    , _name(name)
+    , _active(Enabled())
+{
+    if (_active)
+    {
+        _startMicroseconds = Now();
+    }
+}
+
+Tracer::Scope::~Scope()
+{
+    if (_active)
+    {
+        Complete(_category, _name, _startMicroseconds, Now() - _startMicroseconds);
+    }
+}
+
+const char* Tracer::name() const
+{
+    return "Tracer";
+}
+
+void Tracer::initialize(Poco::Util::Application& app)
+{
+    auto traceFileName = app.config().getString("trace.file", "");
+    if (traceFileName.empty())
+    {
+        return;
+    }
+
+    _traceFile.open(traceFileName, std::ios::out | std::ios::trunc);
+    if (!_traceFile.is_open())
+    {
+        poco_error_f1(_logger, R"(Could not open trace file "%s" for writing, tracing disabled.)", traceFileName);
+        return;
+    }
+
+    _traceFile << "[\n";
+    _startTicks = ClockMicroseconds();
+
+    // Emitting threads must never allocate, so all buffers are created up front.
+    _threadBuffers.clear();
+    for (size_t index = 0; index < BufferPoolSize; index++)
+    {
+        _threadBuffers.push_back(std::make_shared<ThreadBuffer>());
+    }
+
+    _instance = this;
+    _writerRunning = true;
+    _writerThreadResult = _writerThread();
+    _enabled.store(true, std::memory_order_release);
+
+    poco_information_f1(_logger, R"(Writing trace events to "%s".)", traceFileName);
+}
+
+void Tracer::uninitialize()
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    _enabled.store(false, std::memory_order_release);
+
+    _writerRunning = false;
+    _wakeUpEvent.set();
+    _writerThreadResult.wait();
+
+    uint64_t droppedEvents{_releasedDroppedEvents + _unbufferedEvents.load()};
+    for (const auto& buffer : _threadBuffers)
+    {
+        droppedEvents += buffer->droppedEvents.load();
+    }
+
+    _traceFile << "\n]\n";
+    _traceFile.close();
+
+    if (droppedEvents > 0)
+    {
+        poco_warning_f1(_logger, "Trace buffers were full, %?d events have been dropped.", droppedEvents);
+    }
+}
+
+uint64_t Tracer::Now()
+{
+    if (!Enabled())
+    {
+        return 0;
+    }
+
+    return ClockMicroseconds() - _instance->_startTicks;
+}
+
+void Tracer::RegisterThread(const char* threadName)
+{
+    if (!Enabled())
+    {
+        return;
+    }
+
+    _instance->CurrentThreadBuffer(threadName);
+}
+
+void Tracer::Complete(const char* category, const char* name, uint64_t startMicroseconds, uint64_t durationMicroseconds,
+                      const std::string& detail)
+{
+    if (!Enabled())
+    {
+        return;
+    }
+
+    TraceEvent event;
+    event.category = category;
+    event.name = name;
+    event.phase = 'X';
+    event.timestamp = startMicroseconds;
+    event.duration = durationMicroseconds;
+
+    _instance->Push(event, detail);
+}
+
+void Tracer::Instant(const char* category, const char* name, const std::string& detail)
+{
+    if (!Enabled())
+    {
+        return;
+    }
+
+    TraceEvent event;
+    event.category = category;
+    event.name = name;
+    event.phase = 'i';
+    event.timestamp = Now();
+
+    _instance->Push(event, detail);
+}
+
+Tracer::ThreadBuffer* Tracer::CurrentThreadBuffer(const char* threadName)
+{
+    if (currentThreadBuffer != nullptr)
+    {
+        return static_cast<ThreadBuffer*>(currentThreadBuffer);
+    }
+
+    for (const auto& buffer : _threadBuffers)
+    {
+        int expectedState{Free};
+        if (!buffer->state.compare_exchange_strong(expectedState, Claimed, std::memory_order_acquire))
+        {
+            continue;
+        }
+
+        buffer->threadId = _nextThreadId.fetch_add(1, std::memory_order_relaxed);
+        buffer->threadName = threadName;
+        buffer->nameWritten = false;
+        buffer->state.store(Active, std::memory_order_release);
+
+        currentThreadBuffer = buffer.get();
+        currentThreadBufferOwner.state = std::shared_ptr<std::atomic<int>>(buffer, &buffer->state);
+        currentThreadBufferOwner.exitedState = Exited;
+
+        return buffer.get();
+    }
+
+    return nullptr;
+}
+
+void Tracer::Push(TraceEvent& event, const std::string& detail)
+{
+    auto* threadBuffer = CurrentThreadBuffer(nullptr);
+    if (threadBuffer == nullptr)
+    {
+        _unbufferedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& buffer = *threadBuffer;
+
+    auto writeIndex = buffer.writeIndex.load(std::memory_order_relaxed);
+    auto readIndex = buffer.readIndex.load(std::memory_order_acquire);
+
+    if (writeIndex - readIndex >= BufferCapacity)
+    {
+        buffer.droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto length = std::min(detail.size(), DetailLength - 1);
+    while (length < detail.size() && length > 0 && (static_cast<unsigned char>(detail[length]) & 0xC0) == 0x80)
+    {
+        // Don't cut UTF-8 sequences in half.
+        length--;
+    }
+    std::memcpy(event.detail, detail.data(), length);
+    event.detail[length] = 0;
+
+    buffer.events[writeIndex & (BufferCapacity - 1)] = event;
+    buffer.writeIndex.store(writeIndex + 1, std::memory_order_release);
+}
+
+void Tracer::WriterThread()
+{
+    while (_writerRunning)
+    {
+        _wakeUpEvent.tryWait(50);
+        Flush();
+    }
+
+    // Catch events recorded while the writer was shutting down.
+    Flush();
+}
+
+void Tracer::Flush()
+{
+    for (const auto& buffer : _threadBuffers)
+    {
+        // Checked before draining, so events pushed right before the thread exited are still written.
+        auto state = buffer->state.load(std::memory_order_acquire);
+        if (state != Active && state != Exited)
+        {
+            continue;
+        }
+
+        if (!buffer->nameWritten)
+        {
+            _traceFile << (_firstEvent ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->threadId
+                       << R"(,"args":{"name":)";
+            WriteJSONString(buffer->threadName ? buffer->threadName : ("Thread " + std::to_string(buffer->threadId)).c_str());
+            _traceFile << "}}";
+            _firstEvent = false;
+            buffer->nameWritten = true;
+        }
+
+        auto readIndex = buffer->readIndex.load(std::memory_order_relaxed);
+        auto writeIndex = buffer->writeIndex.load(std::memory_order_acquire);
+
+        for (; readIndex != writeIndex; readIndex++)
+        {
+            WriteEvent(*buffer, buffer->events[readIndex & (BufferCapacity - 1)]);
+        }
+
+        buffer->readIndex.store(readIndex, std::memory_order_release);
+
+        if (state == Exited)
+        {
+            // Fully drained, as the thread can't push anymore. Return the buffer to the pool.
+            _releasedDroppedEvents += buffer->droppedEvents.exchange(0, std::memory_order_relaxed);
+            buffer->readIndex.store(0, std::memory_order_relaxed);
+            buffer->writeIndex.store(0, std::memory_order_relaxed);
+            buffer->state.store(Free, std::memory_order_release);
+        }
+    }
+
+    _traceFile.flush();
+}
+
+void Tracer::WriteEvent(const ThreadBuffer& buffer, const TraceEvent& event)
+{
+    _traceFile << (_firstEvent ? "" : ",\n") << R"({"name":)";
+    WriteJSONString(event.name);
+    _traceFile << R"(,"cat":)";
+    WriteJSONString(event.category);
+    _traceFile << R"(,"ph":")" << event.phase << R"(","ts":)" << event.timestamp;
+
+    if (event.phase == 'X')
+    {
+        _traceFile << R"(,"dur":)" << event.duration;
+    }
+    else
+    {
+        _traceFile << R"(,"s":"t")";
+    }
+
+    _traceFile << R"(,"pid":1,"tid":)" << buffer.threadId;
+
+    if (event.detail[0] != 0)
+    {
+        _traceFile << R"(,"args":{"detail":)";
+        WriteJSONString(event.detail);
+        _traceFile << "}";
+    }
+
+    _traceFile << "}";
+    _firstEvent = false;
+}
+
+void Tracer::WriteJSONString(const char* text)
+{
+    static const char* hexDigits = "0123456789abcdef";
+
+    _traceFile << '"';
+    for (const char* character = text; *character != 0; character++)
+    {
+        auto value = static_cast<unsigned char>(*character);
+        switch (value)
+        {
+            case '"':
+                _traceFile << "\\\"";
+                break;
+
+            case '\\':
+                _traceFile << "\\\\";
+                break;
+
+            default:
+                if (value < 0x20)
+                {
+                    _traceFile << "\\u00" << hexDigits[value >> 4] << hexDigits[value & 0x0f];
+                }
+                else
+                {
+                    _traceFile << *character;
+                }
+                break;
+        }
+    }
+    _traceFile << '"';
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <Poco/ActiveMethod.h>
+#include <Poco/Event.h>
+#include <Poco/Logger.h>
+
+#include <Poco/Util/Subsystem.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes Chrome/Perfetto trace events to a JSON file.
+ *
+ * Tracing is enabled by passing --trace <file> on the command line (or setting trace.file). Each
+ * thread emitting events writes them into its own lock-free single-producer/single-consumer ring
+ * buffer, which a background thread drains into the trace file every few milliseconds. If a buffer
+ * runs full, new events are dropped and counted instead of blocking the emitting thread.
+ *
+ * All buffers are allocated from a fixed pool when tracing starts. A thread claims a free one with its first
+ * event, without locking or allocating, as this also happens on realtime audio threads. Buffers of exited
+ * threads are returned to the pool once they have been drained, so threads which are frequently recreated,
+ * like audio device threads, don't use up the pool. If it's exhausted anyway, the thread's events are dropped.
+ *
+ * When tracing is disabled, emitting an event only costs a single atomic load. The resulting file can be
+ * opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class Tracer : public Poco::Util::Subsystem
+{
+public:
+    /**
+     * @brief Records a "complete" trace event spanning the lifetime of the object.
+     */
+    class Scope
+    {
+    public:
+        /**
+         * @brief Starts the event.
+         * @param category The event category. Must be a string literal or otherwise outlive the tracer.
+         * @param name The event name. Must be a string literal or otherwise outlive the tracer.
+         */
+        Scope(const char* category, const char* name);
+
+        /**
+         * @brief Records the event with its duration.
+         */
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* _category; //!< The event category.
+        const char* _name; //!< The event name.
+        uint64_t _startMicroseconds{0}; //!< Trace timestamp when the event started.
+        bool _active{false}; //!< True if tracing was enabled when the event started.
+    };
+
+    const char* name() const override;
+
+    void initialize(Poco::Util::Application& app) override;
+
+    void uninitialize() override;
+
+    /**
+     * @brief Returns whether trace events are currently recorded.
+     * @return True if tracing is enabled, false if not.
+     */
+    static bool Enabled()
+    {
+        // Acquire, so _instance and _startTicks written before enabling tracing are visible.
+        return _enabled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the current trace timestamp.
+     * @return Microseconds since tracing was started.
+     */
+    static uint64_t Now();
+
+    /**
+     * @brief Gives the calling thread a display name in the trace.
+     *
+     * Only has an effect if called before the thread emitted its first event.
+     *
+     * @param threadName The thread name. Must be a string literal or otherwise outlive the tracer.
+     */
+    static void RegisterThread(const char* threadName);
+
+    /**
+     * @brief Records an event with a duration.
+     * @param category The event category. Must be a string literal or otherwise outlive the tracer.
+     * @param name The event name. Must be a string literal or otherwise outlive the tracer.
+     * @param startMicroseconds The start timestamp, as returned by Now().
+     * @param durationMicroseconds The duration of the event.
+     * @param detail Optional additional information, stored as the "detail" argument.
+     */
+    static void Complete(const char* category, const char* name, uint64_t startMicroseconds, uint64_t durationMicroseconds,
+                         const std::string& detail = {});
+
+    /**
+     * @brief Records a point-in-time event.
+     * @param category The event category. Must be a string literal or otherwise outlive the tracer.
+     * @param name The event name. Must be a string literal or otherwise outlive the tracer.
+     * @param detail Optional additional information, stored as the "detail" argument.
+     */
+    static void Instant(const char* category, const char* name, const std::string& detail = {});
+
+protected:
+    static constexpr size_t DetailLength{96}; //!< Maximum length of the detail string, including the terminator.
+    static constexpr size_t BufferCapacity{4096}; //!< Number of events in each thread buffer, must be a power of two.
+    static constexpr size_t BufferPoolSize{32}; //!< Number of thread buffers, i.e. threads which can emit events at the same time.
+
+    /**
+     * @brief A single recorded trace event.
+     */
+    struct TraceEvent {
+        const char* category{nullptr}; //!< Event category.
+        const char* name{nullptr}; //!< Event name.
+        char phase{'X'}; //!< Chrome trace event phase, 'X' for complete and 'i' for instant events.
+        uint64_t timestamp{0}; //!< Start time in microseconds.
+        uint64_t duration{0}; //!< Duration in microseconds, only used for complete events.
+        char detail[DetailLength]{}; //!< Optional zero-terminated detail string.
+    };
+
+    /**
+     * @brief State of a pooled thread buffer.
+     */
+    enum BufferState : int
+    {
+        Free, //!< Not owned by any thread.
+        Claimed, //!< Being set up by the claiming thread, ignored by the writer.
+        Active, //!< Owned by a running thread.
+        Exited //!< The owning thread has exited, the buffer is returned to the pool once drained.
+    };
+
+    /**
+     * @brief Single-producer/single-consumer event ring buffer owned by one emitting thread.
+     */
+    struct ThreadBuffer {
+        std::atomic<int> state{Free}; //!< The BufferState. Published with release, so the fields below are visible to the writer.
+        uint64_t threadId{0}; //!< Sequential trace thread ID, used as "tid" in the trace. Not the OS thread ID.
+        const char* threadName{nullptr}; //!< Display name of the thread, nullptr to use the thread ID.
+        bool nameWritten{false}; //!< True if the thread name metadata event was written. Writer thread only.
+        std::atomic<size_t> writeIndex{0}; //!< Next event index to write. Only modified by the producer.
+        std::atomic<size_t> readIndex{0}; //!< Next event index to read. Only modified by the writer thread.
+        std::atomic<uint64_t> droppedEvents{0}; //!< Number of events dropped because the buffer was full.
+        TraceEvent events[BufferCapacity]; //!< The event storage.
+    };
+
+    /**
+     * @brief Returns the calling thread's event buffer, claiming one from the pool if required.
+     * @param threadName The name to use if a buffer is claimed.
+     * @return The thread's event buffer, or nullptr if the pool is exhausted.
+     */
+    ThreadBuffer* CurrentThreadBuffer(const char* threadName);
+
+    /**
+     * @brief Appends an event to the calling thread's buffer.
+     * @param event The event to record.
+     * @param detail The detail string to copy into the event.
+     */
+    void Push(TraceEvent& event, const std::string& detail);
+
+    /**
+     * @brief Background thread draining all thread buffers into the trace file.
+     */
+    void WriterThread();
+
+    /**
+     * @brief Writes all pending events of all thread buffers to the file and returns drained buffers of exited threads to the pool.
+     */
+    void Flush();
+
+    /**
+     * @brief Writes a single event as JSON.
+     * @param buffer The buffer the event belongs to.
+     * @param event The event to write.
+     */
+    void WriteEvent(const ThreadBuffer& buffer, const TraceEvent& event);
+
+    /**
+     * @brief Writes a string as a quoted and escaped JSON string literal.
+     * @param text The string to write.
+     */
+    void WriteJSONString(const char* text);
+
+    static std::atomic_bool _enabled; //!< True while trace events are recorded.
+    static Tracer* _instance; //!< The active tracer instance, only valid while _enabled is true. Published by _enabled.
+
+    std::ofstream _traceFile; //!< The trace output stream.
+    bool _firstEvent{true}; //!< True until the first event was written, used for comma separation.
+    uint64_t _startTicks{0}; //!< Clock value when tracing started.
+
+    std::vector<std::shared_ptr<ThreadBuffer>> _threadBuffers; //!< The buffer pool. Allocated before tracing is enabled and never resized while enabled.
+    std::atomic<uint64_t> _nextThreadId{1}; //!< Trace thread ID given to the next registered thread.
+    std::atomic<uint64_t> _unbufferedEvents{0}; //!< Events dropped because no buffer was available.
+    uint64_t _releasedDroppedEvents{0}; //!< Dropped events counted in buffers which were already returned to the pool. Writer thread only.
+
+    Poco::ActiveMethod<void, void, Tracer> _writerThread{this, &Tracer::WriterThread}; //!< Background writer thread.
+    Poco::ActiveResult<void> _writerThreadResult{new Poco::ActiveResultHolder<void>()}; //!< Result of the writer thread, used to join it.
+    Poco::Event _wakeUpEvent; //!< Signaled to make the writer flush immediately.
+    std::atomic_bool _writerRunning{false}; //!< True while the writer thread should keep running.
+
+    Poco::Logger& _logger{Poco::Logger::get("Tracer")}; //!< The class logger.
+};
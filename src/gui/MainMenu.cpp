@@ -89,13 +89,20 @@ void MainMenu::Draw()
                 auto devices = _audioCapture.AudioDeviceList();
                 auto currentIndex = _audioCapture.AudioDeviceIndex();
 
-                for (const auto& device : devices)
+                for (const auto& device : *devices)
                 {
                     if (ImGui::MenuItem(device.second.c_str(), "", device.first == currentIndex))
                     {
                         _audioCapture.AudioDeviceIndex(device.first);
                     }
                 }
+
+                ImGui::Separator();
+
+                if (ImGui::MenuItem("Refresh Device List"))
+                {
+                    _audioCapture.RefreshAudioDeviceList();
+                }
                 ImGui::EndMenu();
             }
 
@@ -120,6 +127,13 @@ void MainMenu::Draw()
                 app.UserConfiguration()->setDouble("projectM.beatSensitivity", beatSensitivity);
             }
 
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Performance Statistics..."))
+            {
+                _gui.ShowPerformanceWindow();
+            }
+
             ImGui::EndMenu();
         }
 
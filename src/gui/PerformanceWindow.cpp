@@ -0,0 +1,180 @@
+#include "PerformanceWindow.h"
+
+#include "FrameProfiler.h"
+#include "FrameTimeHistogram.h"
+
+#include "notifications/DisplayToastNotification.h"
+
+#include <imgui.h>
+
+#include <Poco/File.h>
+#include <Poco/NotificationCenter.h>
+#include <Poco/Path.h>
+
+#include <fstream>
+
+void PerformanceWindow::Show()
+{
+    _visible = true;
+}
+
+void PerformanceWindow::Draw()
+{
+    if (!_visible)
+    {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(500, 500), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Performance Statistics###Performance", &_visible, ImGuiWindowFlags_NoCollapse))
+    {
+        if (_frameTimeHistogram == nullptr || _frameProfiler == nullptr)
+        {
+            ImGui::TextUnformatted("No frame time statistics available.");
+        }
+        else
+        {
+            DrawFrameTimes();
+            ImGui::Dummy({.0f, 10.0f});
+            DrawStageTimes();
+        }
+    }
+    ImGui::End();
+}
+
+void PerformanceWindow::FrameTimeStatistics(FrameTimeHistogram* histogram, FrameProfiler* profiler)
+{
+    _frameTimeHistogram = histogram;
+    _frameProfiler = profiler;
+}
+
+void PerformanceWindow::DrawFrameTimes()
+{
+    ImGui::TextUnformatted("Frame Times");
+    ImGui::Separator();
+
+    auto summary = _frameTimeHistogram->GetSummary();
+
+    if (ImGui::BeginTable("Frame Times", 2, ImGuiTableFlags_BordersInnerH))
+    {
+        ImGui::TableSetupColumn("##desc", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("##value", ImGuiTableColumnFlags_WidthFixed, 150);
+
+        auto row = [](const char* label, const char* format, auto value) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(label);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text(format, value);
+        };
+
+        row("Recorded frames", "%llu", static_cast<unsigned long long>(summary.frameCount));
+        row("Missed deadlines", "%llu", static_cast<unsigned long long>(summary.missedDeadlines));
+        row("Minimum", "%.2f ms", summary.minimum);
+        row("Median (p50)", "%.2f ms", summary.p50);
+        row("95th percentile", "%.2f ms", summary.p95);
+        row("99th percentile", "%.2f ms", summary.p99);
+        row("Maximum", "%.2f ms", summary.maximum);
+
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Reset"))
+    {
+        _frameTimeHistogram->Reset();
+    }
+}
+
+void PerformanceWindow::DrawStageTimes()
+{
+    ImGui::TextUnformatted("Render Loop Stages");
+    ImGui::Separator();
+
+    auto average = _frameProfiler->AverageSample();
+    bool showGpu = _frameProfiler->GpuTimingAvailable();
+
+    ImGui::Text("Average over the last %llu frames.", static_cast<unsigned long long>(average.frameNumber));
+    if (!showGpu)
+    {
+        ImGui::TextUnformatted("GPU timer queries are not supported by the driver.");
+    }
+
+    if (ImGui::BeginTable("Stages", showGpu ? 3 : 2, ImGuiTableFlags_BordersInnerH))
+    {
+        ImGui::TableSetupColumn("Stage", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("CPU", ImGuiTableColumnFlags_WidthFixed, 100);
+        if (showGpu)
+        {
+            ImGui::TableSetupColumn("GPU", ImGuiTableColumnFlags_WidthFixed, 100);
+        }
+        ImGui::TableHeadersRow();
+
+        double cpuTotal{0.0};
+        double gpuTotal{0.0};
+
+        for (int stage = 0; stage < FrameProfiler::StageCount; stage++)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(FrameProfiler::StageName(static_cast<FrameProfiler::Stage>(stage)));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.3f ms", average.cpuMilliseconds[stage]);
+            cpuTotal += average.cpuMilliseconds[stage];
+
+            if (showGpu)
+            {
+                ImGui::TableSetColumnIndex(2);
+                if (average.gpuValid)
+                {
+                    ImGui::Text("%.3f ms", average.gpuMilliseconds[stage]);
+                    gpuTotal += average.gpuMilliseconds[stage];
+                }
+                else
+                {
+                    ImGui::TextUnformatted("-");
+                }
+            }
+        }
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted("Total");
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%.3f ms", cpuTotal);
+        if (showGpu && average.gpuValid)
+        {
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f ms", gpuTotal);
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Export to CSV"))
+    {
+        ExportStageTimes();
+    }
+}
+
+void PerformanceWindow::ExportStageTimes()
+{
+    Poco::Path exportPath = Poco::Path::dataHome();
+    exportPath.append("projectMSDL").makeDirectory();
+    Poco::File(exportPath).createDirectories();
+    exportPath.setFileName("frame-profile.csv");
+
+    std::ofstream exportFile(exportPath.toString());
+    if (exportFile.is_open())
+    {
+        _frameProfiler->WriteCSV(exportFile);
+    }
+
+    if (exportFile.is_open() && exportFile.good())
+    {
+        Poco::NotificationCenter::defaultCenter().postNotification(new DisplayToastNotification("Frame profile exported to " + exportPath.toString()));
+    }
+    else
+    {
+        Poco::NotificationCenter::defaultCenter().postNotification(new DisplayToastNotification("Error exporting frame profile"));
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+class FrameProfiler;
+class FrameTimeHistogram;
+
+class PerformanceWindow
+{
+public:
+    /**
+     * @brief Displays the performance statistics window.
+     */
+    void Show();
+
+    /**
+     * @brief Draws the performance statistics window.
+     */
+    void Draw();
+
+    /**
+     * @brief Sets the frame time histogram to display.
+     * @param histogram The frame time histogram, or nullptr if no statistics are available.
+     * @param profiler The per-stage frame profiler, or nullptr if no statistics are available.
+     */
+    void FrameTimeStatistics(FrameTimeHistogram* histogram, FrameProfiler* profiler);
+
+private:
+    /**
+     * @brief Draws the frame time percentiles.
+     */
+    void DrawFrameTimes();
+
+    /**
+     * @brief Draws the average CPU and GPU time of each render loop stage.
+     */
+    void DrawStageTimes();
+
+    /**
+     * @brief Writes the stored per-stage frame samples to a CSV file in the user data directory.
+     */
+    void ExportStageTimes();
+
+    FrameTimeHistogram* _frameTimeHistogram{nullptr}; //!< The frame time histogram owned by the render loop.
+    FrameProfiler* _frameProfiler{nullptr}; //!< The per-stage profiler owned by the render loop.
+
+    bool _visible{false}; //!< window visibility flag.
+};
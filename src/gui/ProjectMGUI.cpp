@@ -179,7 +179,6 @@ void ProjectMGUI::Draw()
             _permText = _toast->getToastText();
             _permText = _permText.substr(_permText.find_last_of("/")+1); // remove path prefix
             _permText = _permText.substr(0,_permText.size()-5); // remove '.milk' extension
-            _projectMWrapper->MPDGetStatus();
             _toast.reset();
         }else if (!_toast->Draw(secondsSinceLastFrame)){
             _toast.reset();
@@ -204,12 +203,12 @@ void ProjectMGUI::Draw()
         _aboutWindow.Draw();
         //_mpdWindow.Draw();
         _helpWindow.Draw();
+        _performanceWindow.Draw();
     }
     
     //either menu or permanent info visible
     if(_permTextVisible && !_visible)
     { 
-        _projectMWrapper->MPDGetStatus();
         if (_permText.size()>0){       
             DrawPermText(_permText);    
         }
@@ -292,6 +291,16 @@ void ProjectMGUI::ShowHelpWindow()
     _helpWindow.Show();
 }
 
+void ProjectMGUI::ShowPerformanceWindow()
+{
+    _performanceWindow.Show();
+}
+
+void ProjectMGUI::FrameTimeStatistics(FrameTimeHistogram* histogram, FrameProfiler* profiler)
+{
+    _performanceWindow.FrameTimeStatistics(histogram, profiler);
+}
+
 float ProjectMGUI::GetScalingFactor()
 {
     int renderWidth;
@@ -340,16 +349,26 @@ void ProjectMGUI::DrawMPDPreviewWindow()
             was_key = true;
         }
         if(  ImGui::IsKeyPressed(ImGuiKey_D) ){
-            printf("Item_APPEND '%s'\n",_projectMWrapper->MPDPVGet(mpd_pv_item_current).c_str());
-            _projectMWrapper->MPDQueueAdd(_projectMWrapper->MPDPVGet(mpd_pv_item_current).c_str());
+            poco_debug_f1(_logger, "Appending '%s' to the MPD queue.", std::string(_projectMWrapper->MPDPVGet(mpd_pv_item_current)));
+            _projectMWrapper->MPDQueueAdd(_projectMWrapper->MPDPVGet(mpd_pv_item_current));
             mpd_item_current = 0;
         }    
-        for (int n = 0; n < _projectMWrapper->MPDPVSize(); ++n) {
-            bool is_selected = (n == mpd_pv_item_current);
-            if (ImGui::Selectable(_projectMWrapper->MPDPVGet(n).c_str(), is_selected)) { mpd_pv_item_current = n; }
-            if (is_selected && was_key) { ImGui::SetScrollHereY(0.5f); ImGui::SetItemDefaultFocus(); }
-            if(was_key && _projectMWrapper->GetCD() != cursordir_none)_projectMWrapper->SetCD(cursordir_none);
+
+        // Only submit the visible rows, plus the selected one if it has to be scrolled into view.
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_projectMWrapper->MPDPVSize()));
+        if (was_key) { clipper.IncludeItemByIndex(mpd_pv_item_current); }
+        while (clipper.Step()) {
+            for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; ++n) {
+                bool is_selected = (n == mpd_pv_item_current);
+                ImGui::PushID(n);
+                if (ImGui::Selectable(_projectMWrapper->MPDPVGet(n), is_selected)) { mpd_pv_item_current = n; }
+                ImGui::PopID();
+                if (is_selected && was_key) { ImGui::SetScrollHereY(0.5f); ImGui::SetItemDefaultFocus(); }
+            }
         }
+        clipper.End();
+        if(was_key && _projectMWrapper->GetCD() != cursordir_none)_projectMWrapper->SetCD(cursordir_none);
         ImGui::EndListBox();
     }
     ImGui::End();
@@ -406,41 +425,42 @@ void ProjectMGUI::DrawMPDWindow()
         }    
         
 
-        for (int n = 0; n < _projectMWrapper->MPDQSize(); n++) {
-            bool is_selected = (n == mpd_item_current);
-            if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
-            {
-                is_selected = !is_selected;
-                //printf("selected:[%d] %s\n", n, _projectMWrapper->MPDQGet(n-1).c_str());
-                _projectMWrapper->MPDPlayPos(n-1);
-            }
-            if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
-            {
-                is_selected = !is_selected;
-                //printf("selected:[%d] %s\n", n, _projectMWrapper->MPDQGet(n-1).c_str());
-                _projectMWrapper->MPDPlayPos(n-1);
-                _visibleMPDQ = false;
-                _visibleMPDPV = false;
-            
-            }
-            //if(mpd_item_current == n) childFlags |= ImGuiSelectableFlags_Highlight;
-            
-            
-            if(n == songpos){
+        // Only submit the visible rows, plus the selected one if it has to be scrolled into view.
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_projectMWrapper->MPDQSize()));
+        if (was_key) { clipper.IncludeItemByIndex(mpd_item_current); }
+        while (clipper.Step()) {
+            for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; n++) {
+                bool is_selected = (n == mpd_item_current);
+
                 ImGui::PushID(n);
-                ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 255, 0, 255));
-            }
-            
-            if (ImGui::Selectable(_projectMWrapper->MPDQGet(n).c_str(), is_selected) ) { mpd_item_current = n; }
-            
-            if(n == songpos){
-                ImGui::PopStyleColor(1);
+                if(n == songpos){
+                    ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 255, 0, 255));
+                }
+
+                if (ImGui::Selectable(_projectMWrapper->MPDQGet(n), is_selected) ) { mpd_item_current = n; }
+
+                if(n == songpos){
+                    ImGui::PopStyleColor(1);
+                }
                 ImGui::PopID();
+
+                if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
+                {
+                    _projectMWrapper->MPDPlayPos(n);
+                }
+                if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+                {
+                    _projectMWrapper->MPDPlayPos(n);
+                    _visibleMPDQ = false;
+                    _visibleMPDPV = false;
+                }
+
+                if (is_selected && was_key) { ImGui::SetScrollHereY(0.5f); ImGui::SetItemDefaultFocus(); }
             }
-            
-            if (is_selected && was_key) { ImGui::SetScrollHereY(0.5f); ImGui::SetItemDefaultFocus(); }
-            if(was_key && _projectMWrapper->GetCD() != cursordir_none)_projectMWrapper->SetCD(cursordir_none);
         }
+        clipper.End();
+        if(was_key && _projectMWrapper->GetCD() != cursordir_none)_projectMWrapper->SetCD(cursordir_none);
         ImGui::EndListBox();
     }
     if(was_key){_showMouse=false;ImGui::SetCursorPos(ImVec2(0.0f,0.0f));}
@@ -482,44 +502,51 @@ void ProjectMGUI::DrawMPDPlaylistsWindow()
         }    
         if (ImGui::IsKeyPressed(ImGuiKey_LeftShift)&&
             ImGui::IsKeyPressed(ImGuiKey_Enter)){
-            _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current).c_str());
+            _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current));
             _visibleMPDPL = false;
             mpd_item_current = 0;
         }else if( ImGui::IsKeyPressed(ImGuiKey_A) ){
             //printf("PlayPlaylist_ADD\n");
-            _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current).c_str(), false);
+            _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current), false);
             mpd_item_current = 0;
         }else if (ImGui::IsKeyPressed(ImGuiKey_Enter) ){
-            _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current).c_str());
+            _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current));
             mpd_item_current = 0;
         }
-        for (int n = 0; n < _projectMWrapper->MPDPLSize(); ++n) {
-            bool is_selected = (n == mpd_pl_item_current);
-            if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
-            {
-                is_selected = !is_selected;
-                _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current).c_str());
-            }
-            if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
-            {
-                is_selected = !is_selected;
-                _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(mpd_pl_item_current).c_str());
-                _visibleMPDQ = false;
-            }
-            if (ImGui::Selectable(_projectMWrapper->MPDPLGet(n).c_str(), is_selected)) { mpd_pl_item_current = n; }
-            if (is_selected && was_key) { 
-                ImGui::SetScrollHereY(0.5f); ImGui::SetItemDefaultFocus(); 
-                _projectMWrapper->MPDListFilesPreview(_projectMWrapper->MPDPLGet(n).c_str());
-                mpd_pv_item_current = 0;
-            }
-            if(was_key) {
-                _visibleMPDPV = true;
-                _showMouse = false;
+        // Only submit the visible rows, plus the selected one if it has to be scrolled into view.
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_projectMWrapper->MPDPLSize()));
+        if (was_key) { clipper.IncludeItemByIndex(mpd_pl_item_current); }
+        while (clipper.Step()) {
+            for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; ++n) {
+                bool is_selected = (n == mpd_pl_item_current);
+                ImGui::PushID(n);
+                if (ImGui::Selectable(_projectMWrapper->MPDPLGet(n), is_selected)) { mpd_pl_item_current = n; }
+                ImGui::PopID();
+                if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
+                {
+                    _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(n));
+                }
+                if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+                {
+                    _projectMWrapper->MPDQueueAddPlaylist(_projectMWrapper->MPDPLGet(n));
+                    _visibleMPDQ = false;
+                }
+                if (is_selected && was_key) { 
+                    ImGui::SetScrollHereY(0.5f); ImGui::SetItemDefaultFocus(); 
+                    _projectMWrapper->MPDListFilesPreview(_projectMWrapper->MPDPLGet(n));
+                    mpd_pv_item_current = 0;
+                }
             }
         }
+        clipper.End();
+        if(was_key) {
+            _visibleMPDPV = true;
+            _showMouse = false;
+        }
         ImGui::EndListBox();
         if(!_first_mpd_preview){
-            _projectMWrapper->MPDListFilesPreview(_projectMWrapper->MPDPLGet(0).c_str());
+            _projectMWrapper->MPDListFilesPreview(_projectMWrapper->MPDPLGet(0));
             mpd_pv_item_current = 0;
             _first_mpd_preview = true;
             _visibleMPDPV = true;
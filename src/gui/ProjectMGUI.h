@@ -3,6 +3,7 @@
 #include "AboutWindow.h"
 #include "HelpWindow.h"
 #include "MainMenu.h"
+#include "PerformanceWindow.h"
 #include "ToastMessage.h"
 #include "SettingsWindow.h"
 
@@ -117,6 +118,18 @@ public:
      */
     void ShowHelpWindow();
 
+    /**
+     * @brief Displays the performance statistics window.
+     */
+    void ShowPerformanceWindow();
+
+    /**
+     * @brief Sets the frame time histogram displayed in the performance statistics window.
+     * @param histogram The frame time histogram, or nullptr if no statistics are available.
+     * @param profiler The per-stage frame profiler, or nullptr if no statistics are available.
+     */
+    void FrameTimeStatistics(FrameTimeHistogram* histogram, FrameProfiler* profiler);
+
     /**
      * @brief Get current MPDWindow queue item.
      */
@@ -156,6 +169,7 @@ private:
     SettingsWindow _settingsWindow{*this}; //!< The settings window.
     AboutWindow _aboutWindow{*this}; //!< The about window.
     HelpWindow _helpWindow; //!< Help window with shortcuts and tips.
+    PerformanceWindow _performanceWindow; //!< Frame time statistics window.
     
     std::unique_ptr<ToastMessage> _toast; //!< Current toast to be displayed.
 
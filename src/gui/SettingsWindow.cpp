@@ -10,10 +10,13 @@
 
 #include <imgui.h>
 
+#include <Poco/Format.h>
 #include <Poco/NotificationCenter.h>
 
 #include <Poco/Util/Application.h>
 
+#include <algorithm>
+
 SettingsWindow::SettingsWindow(ProjectMGUI& gui)
     : _gui(gui)
     , _audioCapture(ProjectMSDLApplication::instance().getSubsystem<AudioCapture>())
@@ -31,6 +34,11 @@ void SettingsWindow::Draw()
 {
     if (!_visible)
     {
+        if (_calibrating)
+        {
+            _calibrating = false;
+            _audioCapture.Calibration(false);
+        }
         return;
     }
 
@@ -63,6 +71,8 @@ void SettingsWindow::Draw()
     }
     ImGui::End();
 
+    DrawCalibrationFlash();
+
     if (_pathChooser.Draw())
     {
         auto& selectedDirectory = _pathChooser.SelectedFiles();
@@ -171,6 +181,14 @@ void SettingsWindow::DrawProjectMSettingsTab()
             LabelWithTooltip("Per-Point Mesh Size X/Y", "Size of the per-point transformation grid.\nHigher values produce better quality, but require exponentially more CPU time to calculate.\nMilkdrop's default is 48x32.");
             IntegerSettingVec("projectM.meshX", "projectM.meshY", 64, 48, 8, 300);
 
+            ImGui::TableNextRow();
+            LabelWithTooltip("Adaptive Mesh Size", "Lowers the mesh size in steps if rendering takes longer than the frame budget\nof the target FPS, and raises it again up to the size above if there's headroom.\nEach preset starts at the full mesh size.");
+            BooleanSetting("projectM.meshGovernor.enabled", false);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("  Minimum Mesh Size X/Y", "The smallest mesh size the adaptive mesh size may use.");
+            IntegerSettingVec("projectM.meshGovernor.minimumX", "projectM.meshGovernor.minimumY", 16, 12, 8, 300);
+
             ImGui::EndTable();
         }
         ImGui::EndTabItem();
@@ -240,8 +258,8 @@ void SettingsWindow::DrawWindowSettingsTab()
             IntegerSettingVec("fullscreen.width", "fullscreen.height", 1920, 1080, 240, 8192);
 
             ImGui::TableNextRow();
-            LabelWithTooltip("Target FPS", "Limit frames rendered per second to the given FPS value.\nNOTE: A value of 0 will NOT limit FPS and render at either VSync or unlimited pace, possibly using all CPU/GPU resources.");
-            IntegerSetting("projectM.fps", 60, 0, 300);
+            LabelWithTooltip("Target FPS", "Limit frames rendered per second to the given FPS value.\nFractional values like 59.94 are supported.\nNOTE: A value of 0 will NOT limit FPS and render at either VSync or unlimited pace, possibly using all CPU/GPU resources.");
+            DoubleSetting("projectM.fps", 60.0, 0.0, 300.0);
 
             ImGui::TableNextRow();
             LabelWithTooltip("Wait for Vertical Sync", "Wait for vertical sync interval before displaying the next frame.\nThis will limit max FPS to the vertical sync frequency but prevents tearing.");
@@ -251,6 +269,14 @@ void SettingsWindow::DrawWindowSettingsTab()
             LabelWithTooltip("  Use Adaptive Sync", "Tries to use adaptive vertical sync if vertical sync is enabled.\nWhen using a monitor capable of adaptive sync, setting FPS to 0 gives the best results.");
             BooleanSetting("window.adaptiveVerticalSync", false);
 
+            ImGui::TableNextRow();
+            LabelWithTooltip("Render Scale", "Renders projectM at a fraction of the window resolution and scales the image up.\nLowers the GPU load on high-resolution displays. 1.0 renders at full resolution.\nRequires libprojectM 4.1 or higher.");
+            DoubleSetting("window.renderScale", 1.0, 0.25, 1.0);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("  Sharp Upscaling", "Scales the image up with a bicubic filter, which looks sharper than the default bilinear filter.");
+            BooleanSetting("window.renderScale.sharpFilter", false);
+
             ImGui::TableNextRow();
             LabelWithTooltip("Preset Name in Title", "Controls displaying the current preset name after the application name in the window title.");
             BooleanSetting("window.displayPresetNameInTitle", true);
@@ -281,16 +307,95 @@ void SettingsWindow::DrawAudioSettingsTab()
             LabelWithTooltip("Audio Capturing Device", "The device to capture audio from.");
             AudioDeviceSetting();
 
+            ImGui::TableNextRow();
+            LabelWithTooltip("Mixed Audio Devices", "Additional devices captured at the same time.\nThe audio of all devices is summed before being passed to projectM.");
+            MixDevicesSetting();
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("Buffer Overruns/Underruns", "Number of times audio data was dropped because it wasn't consumed in time,\nand number of frames which got less audio data than required.");
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu / %llu",
+                        static_cast<unsigned long long>(_audioCapture.BufferOverruns()),
+                        static_cast<unsigned long long>(_audioCapture.BufferUnderruns()));
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("Capture Buffer / Callback Rate", "Sample frames delivered by the capture device at once, and how often it delivers them.\nIdeally, one block arrives per rendered frame.");
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%u frames / %.1f Hz", _audioCapture.CaptureBufferFrames(), _audioCapture.CallbackRate());
+
             ImGui::TableNextRow();
             LabelWithTooltip("Beat Sensitivity", "Beat detection multiplier.");
             DoubleSetting("projectM.beatSensitivity", 1.0, 0.0, 2.0);
 
+            ImGui::TableNextRow();
+            LabelWithTooltip("Automatic Gain Control", "Adjusts the input level automatically, so beat detection works without changing\nthe beat sensitivity whenever the input gets louder or quieter.");
+            BooleanSetting("audio.agc.enabled", false);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("AGC Target Level (dBFS)", "RMS level the gain control tries to reach.");
+            DoubleSetting("audio.agc.targetLevel", -18.0, -40.0, 0.0);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("AGC Attack (ms)", "How fast the gain is lowered if the input gets louder.");
+            IntegerSetting("audio.agc.attack", 10, 1, 1000);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("AGC Release (ms)", "How fast the gain is raised if the input gets quieter.");
+            IntegerSetting("audio.agc.release", 2000, 10, 10000);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("AGC Maximum Gain (dB)", "Upper limit for the gain, so quiet passages and noise aren't amplified too much.");
+            DoubleSetting("audio.agc.ceiling", 24.0, 0.0, 40.0);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("Input Level / Gain", "RMS and peak level of the audio input before the gain control, and the gain currently applied.");
+            ImGui::TableSetColumnIndex(1);
+            {
+                const auto& gainControl = _audioCapture.GainControl();
+                auto level = gainControl.Level();
+                auto levelText = Poco::format("%.1f dBFS RMS, %.1f dBFS peak, gain %+.1f dB",
+                                              static_cast<double>(level), static_cast<double>(gainControl.Peak()), static_cast<double>(gainControl.Gain()));
+                ImGui::ProgressBar(std::max(0.0f, std::min((level + 60.0f) / 60.0f, 1.0f)), ImVec2(-1.0f, 0.0f), levelText.c_str());
+            }
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("Latency Offset (ms)", "Delays the audio data passed to projectM, so the visuals match the sound if it\nreaches the audience later than the capturing device, e.g. through a separate PA system.");
+            IntegerSetting("audio.latencyOffset", 0, 0, 1000);
+
+            ImGui::TableNextRow();
+            LabelWithTooltip("Latency Calibration", "Flashes the screen whenever a click is detected in the audio passed to projectM.\nPlay a metronome or click track through the PA and adjust the latency offset until\nthe flashes match the clicks heard. Only available when capturing via SDL.");
+            ImGui::TableSetColumnIndex(1);
+            if (ImGui::Checkbox("##latency_calibration", &_calibrating))
+            {
+                _audioCapture.Calibration(_calibrating);
+            }
+
             ImGui::EndTable();
         }
         ImGui::EndTabItem();
     }
 }
 
+void SettingsWindow::DrawCalibrationFlash()
+{
+    if (!_calibrating)
+    {
+        return;
+    }
+
+    if (_audioCapture.CalibrationClick())
+    {
+        _calibrationFlashFrames = 3;
+    }
+
+    if (_calibrationFlashFrames > 0)
+    {
+        // Background draw list is rendered above projectM's image, but below all windows.
+        ImGui::GetBackgroundDrawList()->AddRectFilled(ImVec2(0.0f, 0.0f), ImGui::GetIO().DisplaySize, IM_COL32(255, 255, 255, 255));
+        _calibrationFlashFrames--;
+    }
+}
+
 void SettingsWindow::DrawHelpTab() const
 {
     if (ImGui::BeginTabItem("Help"))
@@ -554,10 +659,14 @@ void SettingsWindow::AudioDeviceSetting()
     auto devices = _audioCapture.AudioDeviceList();
     auto currentIndex = _audioCapture.AudioDeviceIndex();
 
+    // The snapshot may lag behind a device change for a few frames.
+    auto currentDevice = devices->find(currentIndex);
+    std::string currentDeviceName = currentDevice != devices->end() ? currentDevice->second : _audioCapture.AudioDeviceName();
+
     ImGui::SetNextItemWidth(-1);
-    if (ImGui::BeginCombo("##audiodevice", devices.at(currentIndex).c_str(), 0))
+    if (ImGui::BeginCombo("##audiodevice", currentDeviceName.c_str(), 0))
     {
-        for (const auto& device : devices)
+        for (const auto& device : *devices)
         {
             bool isSelected = device.first == currentIndex;
 
@@ -584,6 +693,17 @@ void SettingsWindow::AudioDeviceSetting()
         ImGui::EndCombo();
     }
 
+    ImGui::TableSetColumnIndex(2);
+
+    if (ImGui::Button("Refresh##audiodevice"))
+    {
+        _audioCapture.RefreshAudioDeviceList();
+    }
+    if (ImGui::IsItemHovered())
+    {
+        ImGui::SetTooltip("Enumerates the audio devices again.");
+    }
+
     ResetButton("audio.device");
 
     if (_commandLineConfiguration->has("audio.device"))
@@ -592,6 +712,55 @@ void SettingsWindow::AudioDeviceSetting()
     }
 }
 
+void SettingsWindow::MixDevicesSetting()
+{
+    ImGui::TableSetColumnIndex(1);
+
+    auto devices = _audioCapture.AudioDeviceList();
+    auto mixDevices = AudioCapture::ParseDeviceSet(_userConfiguration->getString("audio.mix.devices", ""));
+    auto preview = mixDevices.empty() ? std::string("(None)") : AudioCapture::FormatDeviceSet(mixDevices);
+
+    ImGui::SetNextItemWidth(-1);
+    if (ImGui::BeginCombo("##mixdevices", preview.c_str(), 0))
+    {
+        for (const auto& device : *devices)
+        {
+            // The default device can't be mixed, as it may be the same as the main device.
+            if (device.first < 0)
+            {
+                continue;
+            }
+
+            auto mixDevice = std::find(mixDevices.begin(), mixDevices.end(), device.second);
+            bool isSelected = mixDevice != mixDevices.end();
+
+            if (ImGui::Selectable(device.second.c_str(), isSelected, ImGuiSelectableFlags_DontClosePopups))
+            {
+                if (isSelected)
+                {
+                    mixDevices.erase(mixDevice);
+                }
+                else
+                {
+                    mixDevices.push_back(device.second);
+                }
+
+                _userConfiguration->setString("audio.mix.devices", AudioCapture::FormatDeviceSet(mixDevices));
+                _changed = true;
+            }
+        }
+
+        ImGui::EndCombo();
+    }
+
+    ResetButton("audio.mix.devices");
+
+    if (_commandLineConfiguration->has("audio.mix.devices"))
+    {
+        OverriddenSettingMarker();
+    }
+}
+
 void SettingsWindow::ResetButton(const std::string& property1, const std::string& property2)
 {
     if (!_userConfiguration->has(property1) && (property2.empty() || !_userConfiguration->has(property2)))
@@ -48,6 +48,11 @@ private:
      */
     void DrawAudioSettingsTab();
 
+    /**
+     * @brief Flashes the screen for a few frames after a calibration click, if latency calibration is active.
+     */
+    void DrawCalibrationFlash();
+
     /**
      * @brief Draws the help tab.
      */
@@ -125,6 +130,11 @@ private:
      */
     void AudioDeviceSetting();
 
+    /**
+     * @brief Displays a combobox to select the devices mixed with the main audio device.
+     */
+    void MixDevicesSetting();
+
     /**
      * @brief Displays a reset button and removes the property from the UI map if clicked.
      * @param property1 First property to reset.
@@ -142,6 +152,8 @@ private:
 
     bool _visible{false}; //!< Window visibility flag.
     bool _changed{false}; //!< true if the user changed any setting since the last save.
+    bool _calibrating{false}; //!< true while the audio latency calibration mode is active.
+    int _calibrationFlashFrames{0}; //!< Remaining frames to display the calibration flash.
 
     Poco::AutoPtr<Poco::Util::PropertyFileConfiguration> _userConfiguration;
     Poco::AutoPtr<Poco::Util::MapConfiguration> _commandLineConfiguration;
@@ -0,0 +1,365 @@
+#include "AudioFileSource.h"
+
+#include <Poco/AutoPtr.h>
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/Process.h>
+
+#include <Poco/Util/Application.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint16_t FormatPCM{1};
+constexpr uint16_t FormatFloat{3};
+constexpr uint16_t FormatExtensible{0xFFFE};
+
+/**
+ * @brief File source which keeps the converted samples instead of passing them to projectM.
+ */
+class TestSource : public AudioFileSource
+{
+public:
+    using AudioFileSource::MaximumCatchUpSeconds;
+
+    /**
+     * @brief Calls FillBuffer() once.
+     * @return The number of stereo frames passed on.
+     */
+    size_t Fill()
+    {
+        _samples.clear();
+        FillBuffer();
+        return _samples.size() / PCMConverter::OutputChannels;
+    }
+
+    const std::vector<float>& Samples() const
+    {
+        return _samples;
+    }
+
+    PCMConverter::SampleFormat Format() const
+    {
+        return _format;
+    }
+
+    int Channels() const
+    {
+        return _channels;
+    }
+
+    int SampleRate() const
+    {
+        return _sampleRate;
+    }
+
+protected:
+    void AddToProjectM(const float* samples, size_t frames) override
+    {
+        _samples.insert(_samples.end(), samples, samples + frames * PCMConverter::OutputChannels);
+    }
+
+    std::vector<float> _samples; //!< Samples passed on in the last Fill() call.
+};
+
+void AppendUInt16(std::string& data, uint16_t value)
+{
+    data.push_back(static_cast<char>(value & 0xFF));
+    data.push_back(static_cast<char>(value >> 8));
+}
+
+void AppendUInt32(std::string& data, uint32_t value)
+{
+    AppendUInt16(data, static_cast<uint16_t>(value & 0xFFFF));
+    AppendUInt16(data, static_cast<uint16_t>(value >> 16));
+}
+
+void AppendChunk(std::string& data, const char* id, const std::string& chunkData)
+{
+    data.append(id, 4);
+    AppendUInt32(data, static_cast<uint32_t>(chunkData.size()));
+    data.append(chunkData);
+
+    // Chunks are padded to an even size.
+    if (chunkData.size() & 1)
+    {
+        data.push_back('\0');
+    }
+}
+
+/**
+ * @brief Builds a WAV file with a "fmt " chunk, a "LIST" chunk of odd size and a "data" chunk.
+ * @param extensible If true, the format is stored as WAVE_FORMAT_EXTENSIBLE.
+ */
+std::string WaveFile(uint16_t formatTag, uint16_t channels, uint32_t sampleRate, uint16_t bitsPerSample,
+                     const std::string& samples, bool extensible = false)
+{
+    uint16_t blockAlign = static_cast<uint16_t>(channels * bitsPerSample / 8);
+
+    std::string format;
+    AppendUInt16(format, extensible ? FormatExtensible : formatTag);
+    AppendUInt16(format, channels);
+    AppendUInt32(format, sampleRate);
+    AppendUInt32(format, sampleRate * blockAlign);
+    AppendUInt16(format, blockAlign);
+    AppendUInt16(format, bitsPerSample);
+    if (extensible)
+    {
+        AppendUInt16(format, 22);
+        AppendUInt16(format, bitsPerSample);
+        AppendUInt32(format, channels == 1 ? 0x4 : 0x3);
+
+        // Sub format GUID, the actual format tag followed by the fixed KSDATAFORMAT_SUBTYPE suffix.
+        static const unsigned char guidSuffix[14]{0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                                  0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+        AppendUInt16(format, formatTag);
+        format.append(reinterpret_cast<const char*>(guidSuffix), sizeof(guidSuffix));
+    }
+
+    std::string chunks{"WAVE"};
+    AppendChunk(chunks, "fmt ", format);
+    AppendChunk(chunks, "LIST", "abc");
+    AppendChunk(chunks, "data", samples);
+
+    std::string file{"RIFF"};
+    AppendUInt32(file, static_cast<uint32_t>(chunks.size()));
+    file.append(chunks);
+    return file;
+}
+
+/**
+ * @brief Returns interleaved 16 bit samples, all set to the given value.
+ */
+std::string Int16Samples(int16_t value, size_t frames, size_t channels)
+{
+    std::string samples;
+    for (size_t index = 0; index < frames * channels; index++)
+    {
+        AppendUInt16(samples, static_cast<uint16_t>(value));
+    }
+    return samples;
+}
+
+/**
+ * @brief Returns interleaved 32 bit float samples, all set to the given value.
+ */
+std::string FloatSamples(float value, size_t frames, size_t channels)
+{
+    std::string samples(frames * channels * sizeof(float), '\0');
+    for (size_t index = 0; index < frames * channels; index++)
+    {
+        std::memcpy(&samples[index * sizeof(float)], &value, sizeof(float));
+    }
+    return samples;
+}
+
+class AudioFileSourceTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        _directory = ::testing::TempDir() + "projectMSDL-audiofile-" + std::to_string(Poco::Process::id()) + Poco::Path::separator();
+        Poco::File(_directory).createDirectories();
+
+        Config().setString("audio.file.pacing", "frame");
+        Config().setDouble("projectM.fps", 60.0);
+    }
+
+    void TearDown() override
+    {
+        Poco::File(_directory).remove(true);
+    }
+
+    Poco::Util::AbstractConfiguration& Config()
+    {
+        return _application->config();
+    }
+
+    /**
+     * @brief Writes a file into the test directory.
+     * @return The full path of the file.
+     */
+    std::string WriteFile(const std::string& name, const std::string& contents)
+    {
+        std::string path = _directory + name;
+        std::ofstream file(path, std::ios::binary);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        return path;
+    }
+
+    Poco::AutoPtr<Poco::Util::Application> _application{new Poco::Util::Application}; //!< Provides the configuration.
+    std::string _directory; //!< Temporary directory for the test files.
+    TestSource _source; //!< The source under test.
+};
+
+} // namespace
+
+TEST_F(AudioFileSourceTest, ParsesWaveHeader)
+{
+    auto path = WriteFile("s16.wav", WaveFile(FormatPCM, 2, 48000, 16, Int16Samples(16384, 4800, 2)));
+
+    ASSERT_TRUE(_source.Open(nullptr, path));
+    EXPECT_EQ(_source.Format(), PCMConverter::SampleFormat::S16);
+    EXPECT_EQ(_source.Channels(), 2);
+    EXPECT_EQ(_source.SampleRate(), 48000);
+    EXPECT_EQ(_source.Name(), "s16.wav");
+
+    // Only sample data is played, the header and the "LIST" chunk are skipped.
+    ASSERT_GT(_source.Fill(), 0U);
+    EXPECT_NEAR(_source.Samples().back(), 0.5f, 1e-3f);
+}
+
+TEST_F(AudioFileSourceTest, ParsesExtensibleWaveHeader)
+{
+    auto path = WriteFile("f32.wav", WaveFile(FormatFloat, 1, 22050, 32, FloatSamples(0.25f, 1000, 1), true));
+
+    ASSERT_TRUE(_source.Open(nullptr, path));
+    EXPECT_EQ(_source.Format(), PCMConverter::SampleFormat::F32);
+    EXPECT_EQ(_source.Channels(), 1);
+    EXPECT_EQ(_source.SampleRate(), 22050);
+}
+
+TEST_F(AudioFileSourceTest, RejectsUnsupportedWaveFormats)
+{
+    std::string samples(3 * 2 * 100, '\x7F');
+
+    EXPECT_FALSE(_source.Open(nullptr, WriteFile("s24.wav", WaveFile(FormatPCM, 2, 44100, 24, samples))));
+    EXPECT_FALSE(_source.Open(nullptr, WriteFile("s24ext.wav", WaveFile(FormatPCM, 2, 44100, 24, samples, true))));
+    EXPECT_FALSE(_source.Open(nullptr, WriteFile("f64.wav", WaveFile(FormatFloat, 1, 44100, 64, FloatSamples(0.5f, 100, 2)))));
+
+    // Nothing is played after a failed open.
+    EXPECT_EQ(_source.Fill(), 0U);
+}
+
+TEST_F(AudioFileSourceTest, RejectsWaveFileWithoutDataChunk)
+{
+    auto file = WaveFile(FormatPCM, 2, 44100, 16, Int16Samples(100, 100, 2));
+    file.resize(file.find("data"));
+
+    EXPECT_FALSE(_source.Open(nullptr, WriteFile("truncated.wav", file)));
+}
+
+TEST_F(AudioFileSourceTest, ReadsFileWithoutHeaderAsRawData)
+{
+    Config().setString("audio.file.format", "s16");
+    Config().setInt("audio.file.channels", 1);
+    Config().setInt("audio.file.sampleRate", 44100);
+
+    // 1000 frames plus a partial frame, which is ignored.
+    auto path = WriteFile("audio.raw", Int16Samples(-16384, 1000, 1) + std::string(1, '\0'));
+
+    ASSERT_TRUE(_source.Open(nullptr, path));
+    EXPECT_EQ(_source.Format(), PCMConverter::SampleFormat::S16);
+    EXPECT_EQ(_source.Channels(), 1);
+    EXPECT_EQ(_source.SampleRate(), 44100);
+
+    ASSERT_EQ(_source.Fill(), 735U);
+    EXPECT_FLOAT_EQ(_source.Samples().front(), -0.5f);
+    EXPECT_FLOAT_EQ(_source.Samples().back(), -0.5f);
+}
+
+TEST_F(AudioFileSourceTest, FramePacingPassesOneVideoFrameOfSamplesPerCall)
+{
+    Config().setBool("audio.file.loop", false);
+
+    // 44100 / 60 = 735 frames per call.
+    auto path = WriteFile("f32.wav", WaveFile(FormatFloat, 2, 44100, 32, FloatSamples(0.5f, 2000, 2)));
+    ASSERT_TRUE(_source.Open(nullptr, path));
+
+    EXPECT_EQ(_source.Fill(), 735U);
+    EXPECT_EQ(_source.Fill(), 735U);
+    EXPECT_EQ(_source.Fill(), 530U);
+    EXPECT_EQ(_source.Fill(), 0U);
+}
+
+TEST_F(AudioFileSourceTest, FramePacingCarriesOverFractionalFrames)
+{
+    Config().setDouble("projectM.fps", 30.0);
+
+    // 1000 / 30 = 33.33 input frames per call, looping over the short file.
+    auto path = WriteFile("s16.wav", WaveFile(FormatPCM, 2, 1000, 16, Int16Samples(1000, 100, 2)));
+    ASSERT_TRUE(_source.Open(nullptr, path));
+
+    std::vector<size_t> frames;
+    for (int call = 0; call < 3; call++)
+    {
+        frames.push_back(_source.Fill());
+    }
+
+    // 33 + 33 + 34 input frames, each upsampled to about 44.1 output frames.
+    size_t totalFrames = frames[0] + frames[1] + frames[2];
+    EXPECT_NEAR(static_cast<double>(totalFrames), 4410.0, 100.0);
+    EXPECT_GT(frames[2], frames[1]);
+}
+
+TEST_F(AudioFileSourceTest, RealTimePacingFollowsElapsedTime)
+{
+    Config().setString("audio.file.pacing", "realtime");
+
+    auto path = WriteFile("f32.wav", WaveFile(FormatFloat, 2, 44100, 32, FloatSamples(0.5f, 44100, 2)));
+    ASSERT_TRUE(_source.Open(nullptr, path));
+
+    // The first call passes one video frame's worth of samples.
+    EXPECT_EQ(_source.Fill(), 735U);
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto frames = _source.Fill();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_GE(frames, 4410U);
+    EXPECT_LE(static_cast<double>(frames), elapsed * 44100.0 + 1.0);
+
+    // After a long stall, the samples passed are capped.
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+    EXPECT_EQ(_source.Fill(), static_cast<size_t>(TestSource::MaximumCatchUpSeconds * 44100));
+}
+
+#ifndef _WIN32
+TEST_F(AudioFileSourceTest, ReadsAvailableFramesFromPipe)
+{
+    Config().setString("audio.file.format", "f32");
+    Config().setInt("audio.file.channels", 2);
+    Config().setInt("audio.file.sampleRate", 44100);
+
+    auto path = _directory + "fifo";
+    ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+    ASSERT_TRUE(_source.Open(nullptr, path));
+
+    // Nothing is written yet.
+    EXPECT_EQ(_source.Fill(), 0U);
+
+    int writer = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+    ASSERT_GE(writer, 0);
+
+    // 1000 frames and half a frame.
+    auto samples = FloatSamples(0.25f, 1000, 2) + std::string(4, '\0');
+    ASSERT_EQ(write(writer, samples.data(), samples.size()), static_cast<ssize_t>(samples.size()));
+
+    EXPECT_EQ(_source.Fill(), 735U);
+    EXPECT_FLOAT_EQ(_source.Samples().front(), 0.25f);
+    EXPECT_EQ(_source.Fill(), 265U);
+
+    // The other half of the frame completes the partial one.
+    ASSERT_EQ(write(writer, samples.data(), 4), 4);
+    EXPECT_EQ(_source.Fill(), 1U);
+
+    close(writer);
+    _source.Close();
+}
+#endif
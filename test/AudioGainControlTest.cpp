@@ -0,0 +1,209 @@
+#include "AudioGainControl.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr int SampleRate{44100};
+constexpr int Channels{2};
+constexpr size_t BlockFrames{441};
+
+/**
+ * @brief Exposes the SIMD helpers, which are compiled with SSE2 or NEON where available.
+ */
+class TestGainControl : public AudioGainControl
+{
+public:
+    using AudioGainControl::ApplyGain;
+    using AudioGainControl::Measure;
+};
+
+std::vector<float> RandomSamples(size_t count, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    std::vector<float> samples(count);
+    for (auto& sample : samples)
+    {
+        sample = distribution(generator);
+    }
+    return samples;
+}
+
+/**
+ * @brief Passes a stereo sine with the given RMS level through the gain control, block by block.
+ * @return The processed samples of the last block.
+ */
+std::vector<float> ProcessSine(AudioGainControl& gainControl, double rmsDecibels, double seconds)
+{
+    double amplitude = std::pow(10.0, rmsDecibels / 20.0) * std::sqrt(2.0);
+    auto blocks = static_cast<size_t>(seconds * SampleRate / BlockFrames);
+
+    std::vector<float> samples(BlockFrames * Channels);
+    size_t frame{0};
+    for (size_t block = 0; block < blocks; block++)
+    {
+        for (size_t index = 0; index < BlockFrames; index++, frame++)
+        {
+            auto value = static_cast<float>(amplitude * std::sin(2.0 * Pi * 440.0 * static_cast<double>(frame) / SampleRate));
+            samples[index * Channels] = value;
+            samples[index * Channels + 1] = value;
+        }
+        gainControl.Process(samples.data(), BlockFrames, Channels, SampleRate);
+    }
+
+    return samples;
+}
+
+/**
+ * @brief Passes silence through the gain control, block by block.
+ * @return The processed samples of the last block.
+ */
+std::vector<float> ProcessSilence(AudioGainControl& gainControl, double seconds)
+{
+    auto blocks = static_cast<size_t>(seconds * SampleRate / BlockFrames);
+
+    std::vector<float> samples(BlockFrames * Channels);
+    for (size_t block = 0; block < blocks; block++)
+    {
+        std::fill(samples.begin(), samples.end(), 0.0f);
+        gainControl.Process(samples.data(), BlockFrames, Channels, SampleRate);
+    }
+
+    return samples;
+}
+
+double RmsDecibels(const std::vector<float>& samples)
+{
+    double sumOfSquares{0.0};
+    for (auto sample : samples)
+    {
+        sumOfSquares += static_cast<double>(sample) * sample;
+    }
+    return 10.0 * std::log10(sumOfSquares / static_cast<double>(samples.size()));
+}
+
+} // namespace
+
+TEST(AudioGainControlTest, MeasureMatchesScalarResult)
+{
+    auto samples = RandomSamples(64, 1);
+
+    // All remainders and misalignments of the four-sample SIMD loop.
+    for (size_t offset = 0; offset < 4; offset++)
+    {
+        for (size_t count = 0; count <= 37; count++)
+        {
+            float peak;
+            double sumOfSquares;
+            TestGainControl::Measure(samples.data() + offset, count, peak, sumOfSquares);
+
+            float expectedPeak{0.0f};
+            double expectedSumOfSquares{0.0};
+            for (size_t index = offset; index < offset + count; index++)
+            {
+                expectedPeak = std::max(expectedPeak, std::abs(samples[index]));
+                expectedSumOfSquares += static_cast<double>(samples[index]) * samples[index];
+            }
+
+            EXPECT_EQ(peak, expectedPeak) << "offset " << offset << ", count " << count;
+            EXPECT_NEAR(sumOfSquares, expectedSumOfSquares, 1e-5 * std::max(expectedSumOfSquares, 1.0)) << "offset " << offset << ", count " << count;
+        }
+    }
+}
+
+TEST(AudioGainControlTest, ApplyGainMatchesScalarResult)
+{
+    auto input = RandomSamples(64, 2);
+
+    for (size_t offset = 0; offset < 4; offset++)
+    {
+        for (size_t count = 1; count <= 37; count++)
+        {
+            auto samples = input;
+            TestGainControl::ApplyGain(samples.data() + offset, count, 0.5f, 2.0f);
+
+            float step = 1.5f / static_cast<float>(count);
+            for (size_t index = 0; index < count; index++)
+            {
+                float expected = input[offset + index] * (0.5f + static_cast<float>(index) * step);
+                EXPECT_NEAR(samples[offset + index], expected, 1e-5f) << "offset " << offset << ", count " << count << ", index " << index;
+            }
+
+            // Samples outside the range are untouched.
+            for (size_t index = 0; index < offset; index++)
+            {
+                EXPECT_EQ(samples[index], input[index]);
+            }
+            for (size_t index = offset + count; index < samples.size(); index++)
+            {
+                EXPECT_EQ(samples[index], input[index]);
+            }
+        }
+    }
+}
+
+TEST(AudioGainControlTest, RaisesQuietInputToTargetLevel)
+{
+    AudioGainControl gainControl;
+    gainControl.Configure(true, -18.0, 10, 100, 24.0);
+
+    auto output = ProcessSine(gainControl, -30.0, 3.0);
+
+    EXPECT_NEAR(gainControl.Gain(), 12.0f, 0.5f);
+    EXPECT_NEAR(RmsDecibels(output), -18.0, 0.5);
+}
+
+TEST(AudioGainControlTest, GateHoldsGainOnSilence)
+{
+    AudioGainControl gainControl;
+    gainControl.Configure(true, -18.0, 10, 100, 24.0);
+
+    ProcessSine(gainControl, -30.0, 3.0);
+    float gain = gainControl.Gain();
+
+    // The windowed level is still well above the gate for the first seconds.
+    auto output = ProcessSilence(gainControl, 3.0);
+
+    EXPECT_FLOAT_EQ(gainControl.Gain(), gain);
+    for (auto sample : output)
+    {
+        EXPECT_EQ(sample, 0.0f);
+    }
+
+    // Input right below the gate level is not amplified further either.
+    ProcessSine(gainControl, -65.0, 3.0);
+    EXPECT_FLOAT_EQ(gainControl.Gain(), gain);
+}
+
+TEST(AudioGainControlTest, GainIsCappedAtCeiling)
+{
+    AudioGainControl gainControl;
+    gainControl.Configure(true, -18.0, 10, 100, 6.0);
+
+    // Would need 32 dB to reach the target.
+    auto output = ProcessSine(gainControl, -50.0, 3.0);
+
+    EXPECT_LE(gainControl.Gain(), 6.0f + 1e-3f);
+    EXPECT_NEAR(gainControl.Gain(), 6.0f, 0.1f);
+    EXPECT_NEAR(RmsDecibels(output), -44.0, 0.2);
+}
+
+TEST(AudioGainControlTest, OnlyMeasuresWhenDisabled)
+{
+    AudioGainControl gainControl;
+    gainControl.Configure(false, -18.0, 10, 100, 24.0);
+
+    auto output = ProcessSine(gainControl, -30.0, 1.0);
+
+    EXPECT_FLOAT_EQ(gainControl.Gain(), 0.0f);
+    EXPECT_NEAR(gainControl.Level(), -30.0f, 0.5f);
+    EXPECT_NEAR(RmsDecibels(output), -30.0, 0.1);
+}
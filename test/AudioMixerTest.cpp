@@ -0,0 +1,161 @@
+#include "AudioMixer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Mixer which returns the mix instead of passing it to projectM.
+ */
+class TestMixer : public AudioMixer
+{
+public:
+    using AudioMixer::MaximumBacklogFrames;
+    using AudioMixer::StallTimeout;
+
+    /**
+     * @brief Mixes the samples due at the given time.
+     * @return The number of mixed stereo frames.
+     */
+    size_t MixAt(Clock::time_point now)
+    {
+        return MixInputs(now);
+    }
+
+    const std::vector<float>& MixBuffer() const
+    {
+        return _mixBuffer;
+    }
+
+    size_t PendingFrames(size_t input) const
+    {
+        return _inputs.at(input).samples.size() / PCMConverter::OutputChannels;
+    }
+
+    void LastSamplesTime(size_t input, Clock::time_point time)
+    {
+        _inputs.at(input).lastSamplesTime = time;
+    }
+};
+
+/**
+ * @brief Adds a constant signal to a mixer input.
+ */
+void AddConstant(TestMixer& mixer, size_t input, float value, size_t frames, int channels = 2, int sampleRate = AudioMixer::OutputSampleRate)
+{
+    std::vector<float> samples(frames * static_cast<size_t>(channels), value);
+    mixer.AddSamples(input, samples.data(), frames, channels, sampleRate);
+}
+
+} // namespace
+
+TEST(AudioMixerTest, MixesOnlySamplesReceivedByAllInputs)
+{
+    TestMixer mixer;
+    mixer.Inputs(2);
+
+    AddConstant(mixer, 0, 0.25f, 100);
+    AddConstant(mixer, 1, 0.5f, 60);
+
+    ASSERT_EQ(mixer.MixAt(Clock::now()), 60U);
+    for (auto sample : mixer.MixBuffer())
+    {
+        EXPECT_FLOAT_EQ(sample, 0.75f);
+    }
+
+    EXPECT_EQ(mixer.PendingFrames(0), 40U);
+    EXPECT_EQ(mixer.PendingFrames(1), 0U);
+}
+
+TEST(AudioMixerTest, AlignsInputsWithDifferentSampleRates)
+{
+    TestMixer mixer;
+    mixer.Inputs(2);
+
+    // One second in blocks of 10 ms, one input at 44.1 kHz stereo and one at 48 kHz mono.
+    size_t mixedFrames{0};
+    for (int block = 0; block < 100; block++)
+    {
+        AddConstant(mixer, 0, 0.25f, 441);
+        AddConstant(mixer, 1, 0.5f, 480, 1, 48000);
+        mixedFrames += mixer.MixAt(Clock::now());
+
+        // Only the resampler's delay may be held back.
+        EXPECT_LT(mixer.PendingFrames(0), 100U);
+        EXPECT_LT(mixer.PendingFrames(1), 100U);
+    }
+
+    EXPECT_NEAR(static_cast<double>(mixedFrames), 44100.0, 100.0);
+
+    // The resampled constant is settled by now.
+    ASSERT_FALSE(mixer.MixBuffer().empty());
+    EXPECT_NEAR(mixer.MixBuffer().back(), 0.75f, 0.01f);
+}
+
+TEST(AudioMixerTest, LeavesOutStalledInputAfterTimeout)
+{
+    TestMixer mixer;
+    mixer.Inputs(2);
+
+    auto now = Clock::now();
+    AddConstant(mixer, 0, 0.25f, 100);
+    AddConstant(mixer, 1, 0.5f, 10);
+
+    // Input 1 still counts as active and holds back input 0.
+    EXPECT_EQ(mixer.MixAt(now), 10U);
+    EXPECT_EQ(mixer.PendingFrames(0), 90U);
+
+    AddConstant(mixer, 0, 0.25f, 100);
+    mixer.LastSamplesTime(0, now + TestMixer::StallTimeout * 2);
+    mixer.LastSamplesTime(1, now);
+    EXPECT_EQ(mixer.MixAt(now + TestMixer::StallTimeout), 0U);
+
+    // Input 1 is stalled now, so input 0 is mixed alone.
+    ASSERT_EQ(mixer.MixAt(now + TestMixer::StallTimeout * 2), 190U);
+    for (auto sample : mixer.MixBuffer())
+    {
+        EXPECT_FLOAT_EQ(sample, 0.25f);
+    }
+    EXPECT_EQ(mixer.PendingFrames(0), 0U);
+}
+
+TEST(AudioMixerTest, LimitsBacklogOfFasterInput)
+{
+    TestMixer mixer;
+    mixer.Inputs(2);
+
+    AddConstant(mixer, 0, 0.25f, TestMixer::MaximumBacklogFrames + 1000);
+    AddConstant(mixer, 1, 0.5f, 1);
+
+    // The slower input is padded with silence.
+    ASSERT_EQ(mixer.MixAt(Clock::now()), 1000U);
+    EXPECT_FLOAT_EQ(mixer.MixBuffer().front(), 0.75f);
+    EXPECT_FLOAT_EQ(mixer.MixBuffer().back(), 0.25f);
+
+    EXPECT_EQ(mixer.PendingFrames(0), TestMixer::MaximumBacklogFrames);
+    EXPECT_EQ(mixer.PendingFrames(1), 0U);
+}
+
+TEST(AudioMixerTest, SumsInputsWithTheirGains)
+{
+    TestMixer mixer;
+    mixer.Inputs(3);
+    mixer.InputGain(0, -6.0206);
+    mixer.InputGain(1, 6.0206);
+    mixer.InputGain(2, -120.0);
+
+    AddConstant(mixer, 0, 0.4f, 50);
+    AddConstant(mixer, 1, 0.1f, 50);
+    AddConstant(mixer, 2, 1.0f, 50);
+
+    ASSERT_EQ(mixer.MixAt(Clock::now()), 50U);
+    for (auto sample : mixer.MixBuffer())
+    {
+        EXPECT_NEAR(sample, 0.4f, 1e-4f);
+    }
+}
@@ -0,0 +1,99 @@
+#include "AudioRingBuffer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int Channels{2};
+
+} // namespace
+
+/**
+ * @brief Time from the capture callback writing a block until the consumer thread has read it.
+ *
+ * The producer writes one callback-sized block per iteration and waits until a spinning consumer thread
+ * has read it, so each iteration measures the ring buffer's own hand-off latency: the copy in, the
+ * cross-thread publication and the copy out. The wait for the next render frame comes on top of this.
+ *
+ * Argument: callback size in frames.
+ */
+static void BM_AudioRingBuffer_CallbackToConsumerLatency(benchmark::State& state)
+{
+    const auto blockSamples = static_cast<size_t>(state.range(0)) * Channels;
+
+    AudioRingBuffer ringBuffer;
+    ringBuffer.Reset(blockSamples * 8);
+
+    std::atomic_bool running{true};
+    std::atomic<uint64_t> consumedBlocks{0};
+
+    std::thread consumer([&]() {
+        std::vector<float> samples(blockSamples);
+        while (running.load(std::memory_order_relaxed))
+        {
+            if (ringBuffer.Available() >= blockSamples)
+            {
+                ringBuffer.Read(samples.data(), blockSamples);
+                benchmark::DoNotOptimize(samples.data());
+                consumedBlocks.fetch_add(1, std::memory_order_release);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<float> block(blockSamples, 0.25f);
+    uint64_t writtenBlocks{0};
+    for (auto _ : state)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        ringBuffer.Write(block.data(), blockSamples);
+        writtenBlocks++;
+        while (consumedBlocks.load(std::memory_order_acquire) < writtenBlocks)
+        {
+            std::this_thread::yield();
+        }
+
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    running = false;
+    consumer.join();
+
+    state.SetItemsProcessed(static_cast<int64_t>(writtenBlocks * blockSamples / Channels));
+}
+BENCHMARK(BM_AudioRingBuffer_CallbackToConsumerLatency)->Arg(128)->Arg(512)->Arg(2048)->UseManualTime();
+
+/**
+ * @brief Single-threaded cost of writing and reading one callback-sized block, including wrap-around.
+ *
+ * Argument: callback size in frames.
+ */
+static void BM_AudioRingBuffer_WriteRead(benchmark::State& state)
+{
+    const auto blockSamples = static_cast<size_t>(state.range(0)) * Channels;
+
+    AudioRingBuffer ringBuffer;
+    // Not a multiple of the block size, so the copies regularly wrap around the buffer end.
+    ringBuffer.Reset(blockSamples * 3);
+
+    std::vector<float> input(blockSamples, 0.25f);
+    std::vector<float> output(blockSamples);
+    for (auto _ : state)
+    {
+        ringBuffer.Write(input.data(), blockSamples);
+        ringBuffer.Read(output.data(), blockSamples);
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_AudioRingBuffer_WriteRead)->Arg(128)->Arg(512)->Arg(2048);
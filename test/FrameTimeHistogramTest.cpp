@@ -0,0 +1,130 @@
+#include "FrameTimeHistogram.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+/**
+ * @brief Exposes the bucket mapping.
+ */
+class TestHistogram : public FrameTimeHistogram
+{
+public:
+    using FrameTimeHistogram::BucketCount;
+    using FrameTimeHistogram::BucketIndex;
+    using FrameTimeHistogram::BucketValue;
+};
+
+} // namespace
+
+TEST(FrameTimeHistogramTest, SmallValuesHaveExactBuckets)
+{
+    for (uint32_t value = 0; value < 64; value++)
+    {
+        EXPECT_EQ(TestHistogram::BucketIndex(value), value);
+        EXPECT_EQ(TestHistogram::BucketValue(value), static_cast<double>(value));
+    }
+}
+
+TEST(FrameTimeHistogramTest, BucketEdges)
+{
+    // 64 to 127 in buckets of two.
+    EXPECT_EQ(TestHistogram::BucketIndex(64), 64U);
+    EXPECT_EQ(TestHistogram::BucketIndex(65), 64U);
+    EXPECT_EQ(TestHistogram::BucketIndex(66), 65U);
+    EXPECT_EQ(TestHistogram::BucketIndex(127), 95U);
+    EXPECT_DOUBLE_EQ(TestHistogram::BucketValue(64), 64.5);
+
+    // 128 to 255 in buckets of four.
+    EXPECT_EQ(TestHistogram::BucketIndex(128), 96U);
+    EXPECT_EQ(TestHistogram::BucketIndex(131), 96U);
+    EXPECT_EQ(TestHistogram::BucketIndex(132), 97U);
+    EXPECT_DOUBLE_EQ(TestHistogram::BucketValue(96), 129.5);
+
+    EXPECT_EQ(TestHistogram::BucketIndex(UINT32_MAX), TestHistogram::BucketCount - 1);
+}
+
+TEST(FrameTimeHistogramTest, BucketsAreContiguousAndWithinRelativeError)
+{
+    // Each bucket starts right after the previous one, and its value is within the bucket.
+    uint32_t previousIndex{0};
+    for (uint64_t value = 1; value <= UINT32_MAX; value += value / 97 + 1)
+    {
+        auto index = TestHistogram::BucketIndex(static_cast<uint32_t>(value));
+        ASSERT_GE(index, previousIndex) << "value " << value;
+        ASSERT_LT(index, TestHistogram::BucketCount) << "value " << value;
+        previousIndex = index;
+
+        auto bucketValue = TestHistogram::BucketValue(index);
+        EXPECT_LE(std::abs(bucketValue - static_cast<double>(value)) / static_cast<double>(value), 1.0 / 32.0) << "value " << value;
+        EXPECT_EQ(TestHistogram::BucketIndex(static_cast<uint32_t>(std::floor(bucketValue))), index) << "value " << value;
+    }
+}
+
+TEST(FrameTimeHistogramTest, PercentilesOfUniformFrameTimes)
+{
+    FrameTimeHistogram histogram;
+    for (uint64_t milliseconds = 1; milliseconds <= 100; milliseconds++)
+    {
+        histogram.Record(milliseconds * 1000, false);
+    }
+
+    EXPECT_NEAR(histogram.Percentile(50.0), 50.0, 50.0 / 32.0);
+    EXPECT_NEAR(histogram.Percentile(95.0), 95.0, 95.0 / 32.0);
+    EXPECT_NEAR(histogram.Percentile(99.0), 99.0, 99.0 / 32.0);
+
+    // The outermost percentiles are clamped to the exact minimum and maximum.
+    EXPECT_DOUBLE_EQ(histogram.Percentile(0.0), 1.0);
+    EXPECT_DOUBLE_EQ(histogram.Percentile(100.0), 100.0);
+    EXPECT_DOUBLE_EQ(histogram.Percentile(150.0), 100.0);
+}
+
+TEST(FrameTimeHistogramTest, SummaryShowsOutliersInTail)
+{
+    FrameTimeHistogram histogram;
+    for (int frame = 0; frame < 98; frame++)
+    {
+        histogram.Record(16667, false);
+    }
+    histogram.Record(50000, true);
+    histogram.Record(100000, true);
+
+    auto summary = histogram.GetSummary();
+    EXPECT_EQ(summary.frameCount, 100U);
+    EXPECT_EQ(summary.missedDeadlines, 2U);
+    EXPECT_DOUBLE_EQ(summary.minimum, 16.667);
+    EXPECT_NEAR(summary.p50, 16.667, 16.667 / 32.0);
+    EXPECT_NEAR(summary.p95, 16.667, 16.667 / 32.0);
+    EXPECT_NEAR(summary.p99, 50.0, 50.0 / 32.0);
+    EXPECT_DOUBLE_EQ(summary.maximum, 100.0);
+}
+
+TEST(FrameTimeHistogramTest, ClampsValuesAbove32Bits)
+{
+    FrameTimeHistogram histogram;
+    histogram.Record(uint64_t{1} << 40, false);
+
+    EXPECT_DOUBLE_EQ(histogram.GetSummary().maximum, static_cast<double>(UINT32_MAX) / 1000.0);
+    EXPECT_DOUBLE_EQ(histogram.Percentile(50.0), static_cast<double>(UINT32_MAX) / 1000.0);
+}
+
+TEST(FrameTimeHistogramTest, ResetClearsAllFrames)
+{
+    FrameTimeHistogram histogram;
+    histogram.Record(20000, true);
+    histogram.Reset();
+
+    auto summary = histogram.GetSummary();
+    EXPECT_EQ(summary.frameCount, 0U);
+    EXPECT_EQ(summary.missedDeadlines, 0U);
+    EXPECT_EQ(summary.minimum, 0.0);
+    EXPECT_EQ(summary.maximum, 0.0);
+    EXPECT_EQ(histogram.Percentile(50.0), 0.0);
+
+    histogram.Record(10000, false);
+    EXPECT_DOUBLE_EQ(histogram.GetSummary().minimum, 10.0);
+    EXPECT_DOUBLE_EQ(histogram.GetSummary().maximum, 10.0);
+}
@@ -0,0 +1,156 @@
+#include "IdlePolicy.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr float Silent{-80.0f};
+constexpr float Loud{-20.0f};
+
+/**
+ * @brief Policy with a 10 second silence timeout at -60 dBFS, throttling to 5 FPS while idle.
+ */
+IdlePolicy DefaultPolicy(bool pauseWhenSilent = false, bool pauseWhenHidden = true)
+{
+    IdlePolicy policy;
+    policy.Configure(pauseWhenHidden, -60.0, 10, 5.0, pauseWhenSilent);
+    policy.Activity(0);
+    return policy;
+}
+
+} // namespace
+
+TEST(IdlePolicyTest, ThrottlesAfterSilenceTimeout)
+{
+    auto policy = DefaultPolicy();
+
+    EXPECT_FALSE(policy.Update(Silent, 9999));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+
+    EXPECT_TRUE(policy.Update(Silent, 10000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+    EXPECT_FALSE(policy.RenderingPaused());
+
+    EXPECT_FALSE(policy.Update(Silent, 20000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+
+    // The first update with signal ends idling.
+    EXPECT_TRUE(policy.Update(Loud, 20200));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+}
+
+TEST(IdlePolicyTest, PausesOnSilenceIfConfigured)
+{
+    auto policy = DefaultPolicy(true);
+
+    EXPECT_TRUE(policy.Update(Silent, 10000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+    EXPECT_TRUE(policy.RenderingPaused());
+}
+
+TEST(IdlePolicyTest, OnlyLevelsAboveThresholdAreSignal)
+{
+    auto policy = DefaultPolicy();
+
+    // A level right at the threshold still counts as silence.
+    policy.Update(-60.0f, 5000);
+    EXPECT_TRUE(policy.Update(-60.0f, 10000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+
+    EXPECT_TRUE(policy.Update(-59.9f, 10200));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+
+    // The timeout restarts with the last signal.
+    EXPECT_FALSE(policy.Update(Silent, 20199));
+    EXPECT_TRUE(policy.Update(Silent, 20200));
+}
+
+TEST(IdlePolicyTest, UserActivityRestartsSilenceTimeout)
+{
+    auto policy = DefaultPolicy();
+
+    policy.Activity(8000);
+    EXPECT_FALSE(policy.Update(Silent, 17999));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+
+    EXPECT_TRUE(policy.Update(Silent, 18000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+
+    policy.Activity(18100);
+    EXPECT_TRUE(policy.Update(Silent, 18100));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+}
+
+TEST(IdlePolicyTest, ZeroTimeoutDisablesSilenceDetection)
+{
+    IdlePolicy policy;
+    policy.Configure(true, -60.0, 0, 5.0, true);
+    policy.Activity(0);
+
+    EXPECT_FALSE(policy.Update(Silent, 3600000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+}
+
+TEST(IdlePolicyTest, PausesWhileMinimized)
+{
+    auto policy = DefaultPolicy();
+
+    policy.WindowVisible(false);
+    EXPECT_TRUE(policy.Update(Loud, 100));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Hidden);
+    EXPECT_TRUE(policy.RenderingPaused());
+
+    // Hiding takes precedence over silence, even if rendering would only be throttled.
+    EXPECT_FALSE(policy.Update(Silent, 60000));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Hidden);
+
+    // Restoring the window ends the pause with the next update, then silence detection applies again.
+    policy.WindowVisible(true);
+    EXPECT_TRUE(policy.Update(Silent, 60016));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+    EXPECT_FALSE(policy.RenderingPaused());
+
+    EXPECT_TRUE(policy.Update(Loud, 60032));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+}
+
+TEST(IdlePolicyTest, IgnoresHiddenWindowIfDisabled)
+{
+    auto policy = DefaultPolicy(false, false);
+
+    policy.WindowVisible(false);
+    EXPECT_FALSE(policy.Update(Loud, 100));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+
+    // Silence detection still applies.
+    EXPECT_TRUE(policy.Update(Silent, 10100));
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::Silence);
+}
+
+TEST(IdlePolicyTest, UnfocusedWindowKeepsRenderingWhileAudioPlays)
+{
+    auto policy = DefaultPolicy();
+
+    // A window without input focus stays visible and receives no user input, only audio.
+    for (uint64_t ticks = 0; ticks <= 3600000; ticks += 1000)
+    {
+        EXPECT_FALSE(policy.Update(Loud, ticks));
+    }
+    EXPECT_EQ(policy.IdleReason(), IdlePolicy::Reason::None);
+    EXPECT_FALSE(policy.RenderingPaused());
+}
+
+TEST(IdlePolicyTest, IdleIntervalFollowsIdleFps)
+{
+    IdlePolicy policy;
+
+    policy.Configure(true, -60.0, 10, 5.0, false);
+    EXPECT_EQ(policy.IdleIntervalMilliseconds(), 200U);
+
+    policy.Configure(true, -60.0, 10, 30.0, false);
+    EXPECT_EQ(policy.IdleIntervalMilliseconds(), 33U);
+
+    // Limited to at least one loop iteration per second, so events are still handled.
+    policy.Configure(true, -60.0, 10, 0.1, false);
+    EXPECT_EQ(policy.IdleIntervalMilliseconds(), 1000U);
+}
@@ -0,0 +1,334 @@
+#include "MPDClient.h"
+
+#include <mpd/client.h>
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Minimal MPD server on a Unix domain socket, answering every command with "OK".
+ *
+ * Serves one connection at a time, which is all MPDClient ever opens. Records how often each command
+ * was received, and can simulate a lost connection by closing the socket after receiving a command
+ * without sending a response, i.e. after the command would have been executed by a real server.
+ */
+class FakeMPDServer
+{
+public:
+    explicit FakeMPDServer(std::string socketPath)
+        : _socketPath(std::move(socketPath))
+    {
+    }
+
+    ~FakeMPDServer()
+    {
+        Stop();
+    }
+
+    /**
+     * @brief Starts listening and accepting connections.
+     */
+    void Start()
+    {
+        unlink(_socketPath.c_str());
+
+        _listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_GE(_listenSocket, 0);
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        ASSERT_LT(_socketPath.size(), sizeof(address.sun_path));
+        std::strncpy(address.sun_path, _socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+        ASSERT_EQ(bind(_listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        ASSERT_EQ(listen(_listenSocket, 4), 0);
+
+        _running = true;
+        _thread = std::thread(&FakeMPDServer::Serve, this);
+    }
+
+    /**
+     * @brief Stops the server and removes the socket file.
+     */
+    void Stop()
+    {
+        if (!_running)
+        {
+            return;
+        }
+
+        _running = false;
+        _thread.join();
+
+        close(_listenSocket);
+        unlink(_socketPath.c_str());
+    }
+
+    /**
+     * @brief Closes the connection without a response the next time the command is received.
+     * @param command The command name, e.g. "next".
+     */
+    void DropConnectionOn(const std::string& command)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _dropCommand = command;
+    }
+
+    /**
+     * @brief Answers the command with a server error instead of "OK".
+     * @param command The command name, e.g. "load".
+     */
+    void FailCommand(const std::string& command)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _failCommand = command;
+    }
+
+    /**
+     * @brief Returns how often a command was received, including dropped ones.
+     * @param command The command name.
+     * @return The number of times the command was received.
+     */
+    int Received(const std::string& command)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto count = _received.find(command);
+        return count != _received.end() ? count->second : 0;
+    }
+
+    /**
+     * @brief Returns the number of accepted connections.
+     * @return The connection count.
+     */
+    int Connections() const
+    {
+        return _connections;
+    }
+
+private:
+    void Serve()
+    {
+        while (_running)
+        {
+            if (!WaitReadable(_listenSocket))
+            {
+                continue;
+            }
+
+            int connection = accept(_listenSocket, nullptr, nullptr);
+            if (connection < 0)
+            {
+                continue;
+            }
+
+            _connections++;
+            ServeConnection(connection);
+            close(connection);
+        }
+    }
+
+    void ServeConnection(int connection)
+    {
+        Send(connection, "OK MPD 0.23.5\n");
+
+        std::string buffer;
+        while (_running)
+        {
+            if (!WaitReadable(connection))
+            {
+                continue;
+            }
+
+            char data[1024];
+            auto length = read(connection, data, sizeof(data));
+            if (length <= 0)
+            {
+                return;
+            }
+            buffer.append(data, static_cast<size_t>(length));
+
+            size_t lineEnd;
+            while ((lineEnd = buffer.find('\n')) != std::string::npos)
+            {
+                auto line = buffer.substr(0, lineEnd);
+                buffer.erase(0, lineEnd + 1);
+
+                auto command = line.substr(0, line.find(' '));
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                _received[command]++;
+
+                if (command == _dropCommand)
+                {
+                    _dropCommand.clear();
+                    return;
+                }
+
+                if (command == _failCommand)
+                {
+                    Send(connection, "ACK [50@0] {" + command + "} No such playlist\n");
+                }
+                else
+                {
+                    Send(connection, "OK\n");
+                }
+            }
+        }
+    }
+
+    static bool WaitReadable(int fileDescriptor)
+    {
+        pollfd pollDescriptor{fileDescriptor, POLLIN, 0};
+        return poll(&pollDescriptor, 1, 20) > 0;
+    }
+
+    static void Send(int connection, const std::string& text)
+    {
+        auto result = write(connection, text.data(), text.size());
+        (void) result;
+    }
+
+    std::string _socketPath;
+    int _listenSocket{-1};
+    std::thread _thread;
+    std::atomic_bool _running{false};
+    std::atomic_int _connections{0};
+
+    std::mutex _mutex;
+    std::map<std::string, int> _received;
+    std::string _dropCommand;
+    std::string _failCommand;
+};
+
+/**
+ * @brief Polls a condition until it's true or the timeout has passed.
+ */
+bool WaitUntil(const std::function<bool()>& condition, std::chrono::milliseconds timeout = std::chrono::seconds(5))
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        if (condition())
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return condition();
+}
+
+class MPDClientTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        _socketPath = ::testing::TempDir() + "projectMSDL-fake-mpd-" + std::to_string(getpid()) + ".sock";
+    }
+
+    void TearDown() override
+    {
+        _client.Stop();
+    }
+
+    void PostVolume(unsigned int volume)
+    {
+        _client.Post("SetVolume", [volume](struct mpd_connection* connection) {
+            mpd_run_set_volume(connection, volume);
+        });
+    }
+
+    std::string _socketPath;
+    MPDClient _client;
+};
+
+} // namespace
+
+TEST_F(MPDClientTest, ExecutesCommandsQueuedBeforeTheServerIsUp)
+{
+    FakeMPDServer server(_socketPath);
+
+    _client.Start(_socketPath, 0);
+    PostVolume(50);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_NE(_client.ConnectionState(), MPDClient::State::Connected);
+
+    server.Start();
+
+    EXPECT_TRUE(WaitUntil([&server]() { return server.Received("setvol") == 1; }));
+    EXPECT_EQ(_client.ConnectionState(), MPDClient::State::Connected);
+
+    _client.Stop();
+}
+
+TEST_F(MPDClientTest, RetriesIdempotentCommandAfterConnectionLoss)
+{
+    FakeMPDServer server(_socketPath);
+    server.DropConnectionOn("setvol");
+    server.Start();
+
+    _client.Start(_socketPath, 0);
+    PostVolume(50);
+
+    EXPECT_TRUE(WaitUntil([&server]() { return server.Received("setvol") == 2; }));
+    EXPECT_EQ(server.Connections(), 2);
+
+    _client.Stop();
+}
+
+TEST_F(MPDClientTest, DoesNotRepeatNonRetryableCommandAfterConnectionLoss)
+{
+    FakeMPDServer server(_socketPath);
+    server.DropConnectionOn("next");
+    server.Start();
+
+    _client.Start(_socketPath, 0);
+    _client.Post("Next", [](struct mpd_connection* connection) {
+        mpd_run_next(connection);
+    }, MPDClient::Retry::Never);
+
+    // Executed on the new connection, so the dropped command must have been handled by then.
+    PostVolume(50);
+
+    EXPECT_TRUE(WaitUntil([&server]() { return server.Received("setvol") == 1; }));
+    EXPECT_EQ(server.Connections(), 2);
+    EXPECT_EQ(server.Received("next"), 1);
+
+    _client.Stop();
+}
+
+TEST_F(MPDClientTest, ServerErrorOnlyFailsTheCommand)
+{
+    FakeMPDServer server(_socketPath);
+    server.FailCommand("load");
+    server.Start();
+
+    _client.Start(_socketPath, 0);
+    _client.Post("Load", [](struct mpd_connection* connection) {
+        mpd_run_load(connection, "missing");
+    });
+    PostVolume(50);
+
+    EXPECT_TRUE(WaitUntil([&server]() { return server.Received("setvol") == 1; }));
+    EXPECT_EQ(server.Received("load"), 1);
+    EXPECT_EQ(server.Connections(), 1);
+
+    _client.Stop();
+}
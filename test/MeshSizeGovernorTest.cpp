@@ -0,0 +1,163 @@
+#include "MeshSizeGovernor.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr double Budget{16.667};
+
+/**
+ * @brief Exposes the timing constants.
+ */
+class TestGovernor : public MeshSizeGovernor
+{
+public:
+    using MeshSizeGovernor::SettleFrames;
+    using MeshSizeGovernor::SustainFrames;
+
+    TestGovernor()
+    {
+        Configure(true, 48, 32, 8, 8);
+    }
+};
+
+/**
+ * @brief Feeds frames with a fixed load into the governor.
+ * @return The number of mesh size changes.
+ */
+int Feed(MeshSizeGovernor& governor, double load, int frames)
+{
+    int changes{0};
+    for (int frame = 0; frame < frames; frame++)
+    {
+        if (governor.Update(load * Budget, Budget))
+        {
+            changes++;
+        }
+    }
+    return changes;
+}
+
+/**
+ * @brief Feeds frames whose cost scales with the number of mesh points, like per-point equations.
+ * @param fullSizeLoad The load at the maximum mesh size of 48x32.
+ * @return The number of mesh size changes.
+ */
+int FeedMeshDependentLoad(MeshSizeGovernor& governor, double fullSizeLoad, int frames)
+{
+    int changes{0};
+    for (int frame = 0; frame < frames; frame++)
+    {
+        double points = static_cast<double>(governor.MeshX() * governor.MeshY());
+        if (governor.Update(fullSizeLoad * points / (48.0 * 32.0) * Budget, Budget))
+        {
+            changes++;
+        }
+    }
+    return changes;
+}
+
+} // namespace
+
+TEST(MeshSizeGovernorTest, StepsDownAfterSustainedHighLoad)
+{
+    TestGovernor governor;
+
+    // The settle frames and all but the last of the sustain frames don't change the mesh.
+    int frames = static_cast<int>(TestGovernor::SettleFrames + TestGovernor::SustainFrames);
+    EXPECT_EQ(Feed(governor, 1.5, frames - 1), 0);
+    EXPECT_EQ(governor.MeshX(), 48U);
+    EXPECT_EQ(governor.MeshY(), 32U);
+
+    EXPECT_TRUE(governor.Update(1.5 * Budget, Budget));
+    EXPECT_EQ(governor.MeshX(), 38U);
+    EXPECT_EQ(governor.MeshY(), 26U);
+}
+
+TEST(MeshSizeGovernorTest, StopsAtMinimumSize)
+{
+    TestGovernor governor;
+
+    EXPECT_EQ(Feed(governor, 3.0, 10000), 8);
+    EXPECT_EQ(governor.MeshX(), 8U);
+    EXPECT_EQ(governor.MeshY(), 8U);
+}
+
+TEST(MeshSizeGovernorTest, StepsUpToConfiguredSizeOnLowLoad)
+{
+    TestGovernor governor;
+    Feed(governor, 3.0, 10000);
+
+    EXPECT_EQ(Feed(governor, 0.2, 10000), 8);
+    EXPECT_EQ(governor.MeshX(), 48U);
+    EXPECT_EQ(governor.MeshY(), 32U);
+}
+
+TEST(MeshSizeGovernorTest, LoadBetweenWatermarksKeepsMeshSize)
+{
+    TestGovernor governor;
+    Feed(governor, 1.5, 120);
+    ASSERT_EQ(governor.MeshX(), 38U);
+
+    EXPECT_EQ(Feed(governor, 0.7, 10000), 0);
+    EXPECT_EQ(governor.MeshX(), 38U);
+    EXPECT_EQ(governor.MeshY(), 26U);
+}
+
+TEST(MeshSizeGovernorTest, DoesNotOscillateAroundWatermark)
+{
+    TestGovernor governor;
+
+    // Slightly too slow at full size. After one step down, the load is ~0.64, and stepping up again
+    // would immediately cross the high watermark.
+    EXPECT_EQ(FeedMeshDependentLoad(governor, 1.0, 10000), 1);
+    EXPECT_EQ(governor.MeshX(), 38U);
+    EXPECT_EQ(governor.MeshY(), 26U);
+
+    // The smaller mesh's load of ~0.51 is below the low watermark, while the full size stays below the high one.
+    EXPECT_EQ(FeedMeshDependentLoad(governor, 0.8, 10000), 1);
+    EXPECT_EQ(governor.MeshX(), 48U);
+    EXPECT_EQ(governor.MeshY(), 32U);
+}
+
+TEST(MeshSizeGovernorTest, IgnoresShortSpikes)
+{
+    TestGovernor governor;
+    Feed(governor, 0.6, 100);
+
+    for (int spike = 0; spike < 100; spike++)
+    {
+        EXPECT_FALSE(governor.Update(10.0 * Budget, Budget));
+        EXPECT_EQ(Feed(governor, 0.6, 29), 0);
+    }
+    EXPECT_EQ(governor.MeshX(), 48U);
+}
+
+TEST(MeshSizeGovernorTest, ResetRestoresConfiguredSize)
+{
+    TestGovernor governor;
+    Feed(governor, 3.0, 10000);
+
+    governor.Reset();
+    EXPECT_EQ(governor.MeshX(), 48U);
+    EXPECT_EQ(governor.MeshY(), 32U);
+
+    // Measurements restart with the settle frames.
+    EXPECT_EQ(Feed(governor, 3.0, static_cast<int>(TestGovernor::SettleFrames + TestGovernor::SustainFrames) - 1), 0);
+}
+
+TEST(MeshSizeGovernorTest, DoesNothingIfDisabledOrWithoutBudget)
+{
+    MeshSizeGovernor governor;
+    governor.Configure(false, 64, 48, 8, 8);
+    EXPECT_EQ(Feed(governor, 3.0, 1000), 0);
+    EXPECT_EQ(governor.MeshX(), 64U);
+    EXPECT_EQ(governor.MeshY(), 48U);
+
+    governor.Configure(true, 64, 48, 8, 8);
+    for (int frame = 0; frame < 1000; frame++)
+    {
+        EXPECT_FALSE(governor.Update(100.0, 0.0));
+    }
+    EXPECT_EQ(governor.MeshX(), 64U);
+}
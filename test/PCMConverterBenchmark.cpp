@@ -0,0 +1,58 @@
+#include "PCMConverter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t BlockFrames{1024};
+
+/**
+ * @brief Converts one block per iteration.
+ */
+template<typename Sample>
+void Convert(benchmark::State& state, PCMConverter::SampleFormat format, int channels)
+{
+    const auto inputRate = static_cast<int>(state.range(0));
+
+    std::vector<Sample> input(BlockFrames * channels);
+    for (size_t sample = 0; sample < input.size(); sample++)
+    {
+        input[sample] = static_cast<Sample>(std::sin(static_cast<double>(sample) * 0.01) * (format == PCMConverter::SampleFormat::F32 ? 0.5 : 16000.0));
+    }
+
+    PCMConverter converter;
+    converter.Configure(format, channels, inputRate, 44100, BlockFrames);
+    std::vector<float> output(converter.MaximumOutputFrames() * PCMConverter::OutputChannels);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(converter.Process(input.data(), BlockFrames, output.data()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockFrames));
+}
+
+} // namespace
+
+static void BM_PCMConverter_StereoFloat(benchmark::State& state)
+{
+    Convert<float>(state, PCMConverter::SampleFormat::F32, 2);
+}
+BENCHMARK(BM_PCMConverter_StereoFloat)->Arg(44100)->Arg(48000)->Arg(96000)->Arg(192000);
+
+static void BM_PCMConverter_StereoS16(benchmark::State& state)
+{
+    Convert<int16_t>(state, PCMConverter::SampleFormat::S16, 2);
+}
+BENCHMARK(BM_PCMConverter_StereoS16)->Arg(44100)->Arg(48000);
+
+static void BM_PCMConverter_Surround71S32(benchmark::State& state)
+{
+    Convert<int32_t>(state, PCMConverter::SampleFormat::S32, 8);
+}
+BENCHMARK(BM_PCMConverter_Surround71S32)->Arg(48000);
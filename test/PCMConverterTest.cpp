@@ -0,0 +1,295 @@
+#include "PCMConverter.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr int OutputRate{44100};
+
+/**
+ * @brief Generates an interleaved sine wave with the same signal on all channels.
+ */
+std::vector<float> Sine(double frequency, int sampleRate, int channels, size_t frames, double amplitude = 0.5)
+{
+    std::vector<float> samples(frames * channels);
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+        auto value = static_cast<float>(amplitude * std::sin(2.0 * Pi * frequency * static_cast<double>(frame) / sampleRate));
+        for (int channel = 0; channel < channels; channel++)
+        {
+            samples[frame * channels + channel] = value;
+        }
+    }
+    return samples;
+}
+
+/**
+ * @brief Converts a whole signal, feeding it in blocks of the given size.
+ */
+std::vector<float> Convert(PCMConverter& converter, const void* input, size_t bytesPerFrame, size_t frames, size_t blockFrames)
+{
+    std::vector<float> output;
+    std::vector<float> block(converter.MaximumOutputFrames() * PCMConverter::OutputChannels);
+
+    auto data = static_cast<const uint8_t*>(input);
+    for (size_t frame = 0; frame < frames; frame += blockFrames)
+    {
+        auto count = std::min(blockFrames, frames - frame);
+        auto outputFrames = converter.Process(data + frame * bytesPerFrame, count, block.data());
+        output.insert(output.end(), block.begin(), block.begin() + outputFrames * PCMConverter::OutputChannels);
+    }
+    return output;
+}
+
+/**
+ * @brief Calculates the signal-to-noise ratio of one output channel against an ideal sine.
+ *
+ * Amplitude and phase of the reference are fitted by least squares, so the filter's delay doesn't matter.
+ * The filter's start-up transient is skipped.
+ */
+double SignalToNoiseRatio(const std::vector<float>& output, int channel, double frequency, size_t skipFrames)
+{
+    double sinSin{0.0}, cosCos{0.0}, sinCos{0.0}, signalSin{0.0}, signalCos{0.0};
+    size_t frames = output.size() / PCMConverter::OutputChannels;
+    for (size_t frame = skipFrames; frame < frames; frame++)
+    {
+        double phase = 2.0 * Pi * frequency * static_cast<double>(frame) / OutputRate;
+        double s = std::sin(phase);
+        double c = std::cos(phase);
+        double sample = output[frame * PCMConverter::OutputChannels + channel];
+        sinSin += s * s;
+        cosCos += c * c;
+        sinCos += s * c;
+        signalSin += sample * s;
+        signalCos += sample * c;
+    }
+
+    double determinant = sinSin * cosCos - sinCos * sinCos;
+    double a = (signalSin * cosCos - signalCos * sinCos) / determinant;
+    double b = (signalCos * sinSin - signalSin * sinCos) / determinant;
+
+    double signalPower{0.0}, noisePower{0.0};
+    for (size_t frame = skipFrames; frame < frames; frame++)
+    {
+        double phase = 2.0 * Pi * frequency * static_cast<double>(frame) / OutputRate;
+        double reference = a * std::sin(phase) + b * std::cos(phase);
+        double error = output[frame * PCMConverter::OutputChannels + channel] - reference;
+        signalPower += reference * reference;
+        noisePower += error * error;
+    }
+
+    return 10.0 * std::log10(signalPower / std::max(noisePower, 1e-30));
+}
+
+class PCMConverterResamplingTest : public ::testing::TestWithParam<int>
+{
+};
+
+} // namespace
+
+TEST_P(PCMConverterResamplingTest, SineSignalToNoiseRatio)
+{
+    const int inputRate = GetParam();
+    const size_t inputFrames = static_cast<size_t>(inputRate); // One second.
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::F32, 2, inputRate, OutputRate, 512);
+
+    for (double frequency : {440.0, 5000.0, 15000.0})
+    {
+        auto input = Sine(frequency, inputRate, 2, inputFrames);
+        auto output = Convert(converter, input.data(), 2 * sizeof(float), inputFrames, 512);
+
+        // One second of input must result in one second of output, give or take the filter delay.
+        EXPECT_NEAR(static_cast<double>(output.size() / 2), OutputRate, 2.0);
+
+        for (int channel = 0; channel < 2; channel++)
+        {
+            EXPECT_GT(SignalToNoiseRatio(output, channel, frequency, 256), 60.0)
+                << "input rate " << inputRate << " Hz, frequency " << frequency << " Hz, channel " << channel;
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(InputRates, PCMConverterResamplingTest, ::testing::Values(44100, 48000, 96000, 192000));
+
+TEST(PCMConverterTest, PassesThroughStereoFloatAtOutputRate)
+{
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::F32, 2, OutputRate, OutputRate, 64);
+    EXPECT_FALSE(converter.Resampling());
+
+    auto input = Sine(1000.0, OutputRate, 2, 64);
+    std::vector<float> output(converter.MaximumOutputFrames() * 2);
+    ASSERT_EQ(converter.Process(input.data(), 64, output.data()), 64u);
+
+    for (size_t sample = 0; sample < input.size(); sample++)
+    {
+        EXPECT_EQ(output[sample], input[sample]);
+    }
+}
+
+TEST(PCMConverterTest, ScalesS16ToFloat)
+{
+    // Also covers the SIMD path, which processes four frames at a time, and the scalar tail.
+    const std::vector<int16_t> input{
+        0, 0,
+        32767, -32768,
+        16384, -16384,
+        1, -1,
+        -32768, 32767};
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::S16, 2, OutputRate, OutputRate, 5);
+
+    std::vector<float> output(converter.MaximumOutputFrames() * 2);
+    ASSERT_EQ(converter.Process(input.data(), 5, output.data()), 5u);
+
+    for (size_t sample = 0; sample < input.size(); sample++)
+    {
+        EXPECT_FLOAT_EQ(output[sample], input[sample] / 32768.0f) << "sample " << sample;
+    }
+
+    // Full scale maps to [-1, 1), nothing exceeds the float range projectM expects.
+    EXPECT_FLOAT_EQ(output[3], -1.0f);
+    EXPECT_LT(output[2], 1.0f);
+}
+
+TEST(PCMConverterTest, ScalesS32ToFloat)
+{
+    const std::vector<int32_t> input{
+        0, 0,
+        2147483647, -2147483647 - 1,
+        1073741824, -1073741824,
+        65536, -65536};
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::S32, 2, OutputRate, OutputRate, 4);
+
+    std::vector<float> output(converter.MaximumOutputFrames() * 2);
+    ASSERT_EQ(converter.Process(input.data(), 4, output.data()), 4u);
+
+    for (size_t sample = 0; sample < input.size(); sample++)
+    {
+        EXPECT_NEAR(output[sample], static_cast<double>(input[sample]) / 2147483648.0, 1e-7) << "sample " << sample;
+    }
+
+    EXPECT_FLOAT_EQ(output[3], -1.0f);
+    EXPECT_LE(output[2], 1.0f);
+}
+
+TEST(PCMConverterTest, ResamplesFullScaleS16WithoutWrapping)
+{
+    // Full-scale square wave. Any band-limited resampler overshoots at the edges (Gibbs phenomenon), but the
+    // conversion must neither wrap around nor clip the plateaus.
+    std::vector<int16_t> input(48000 * 2);
+    for (size_t frame = 0; frame < 48000; frame++)
+    {
+        int16_t value = (frame / 1000) % 2 ? 32767 : -32768;
+        input[frame * 2] = value;
+        input[frame * 2 + 1] = value;
+    }
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::S16, 2, 48000, OutputRate, 480);
+
+    auto output = Convert(converter, input.data(), 2 * sizeof(int16_t), 48000, 480);
+
+    float minimum{0.0f};
+    float maximum{0.0f};
+    for (float sample : output)
+    {
+        minimum = std::min(minimum, sample);
+        maximum = std::max(maximum, sample);
+    }
+
+    EXPECT_GT(maximum, 0.99f);
+    EXPECT_LT(minimum, -0.99f);
+    EXPECT_LT(maximum, 1.3f);
+    EXPECT_GT(minimum, -1.3f);
+
+    // Middle of the first positive plateau, far away from both edges.
+    size_t plateauFrame = 1500 * OutputRate / 48000;
+    EXPECT_NEAR(output[plateauFrame * 2], 1.0f, 0.01f);
+    EXPECT_NEAR(output[plateauFrame * 2 + 1], 1.0f, 0.01f);
+}
+
+TEST(PCMConverterTest, DownmixesSixChannels)
+{
+    // FL FR FC LFE SL SR, each channel with a distinct value.
+    const std::vector<float> input{0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f};
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::F32, 6, OutputRate, OutputRate, 1);
+
+    std::vector<float> output(converter.MaximumOutputFrames() * 2);
+    ASSERT_EQ(converter.Process(input.data(), 1, output.data()), 1u);
+
+    // LFE is dropped, center and surrounds are mixed in at -3 dB.
+    EXPECT_NEAR(output[0], 0.1f + 0.7071f * 0.3f + 0.7071f * 0.5f, 1e-6);
+    EXPECT_NEAR(output[1], 0.2f + 0.7071f * 0.3f + 0.7071f * 0.6f, 1e-6);
+}
+
+TEST(PCMConverterTest, DownmixesEightChannels)
+{
+    // FL FR FC LFE BL BR SL SR
+    const std::vector<int16_t> input{1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000};
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::S16, 8, OutputRate, OutputRate, 1);
+
+    std::vector<float> output(converter.MaximumOutputFrames() * 2);
+    ASSERT_EQ(converter.Process(input.data(), 1, output.data()), 1u);
+
+    constexpr float scale = 1.0f / 32768.0f;
+    EXPECT_NEAR(output[0], (1000 + 0.7071f * 3000 + 0.7071f * 5000 + 0.7071f * 7000) * scale, 1e-6);
+    EXPECT_NEAR(output[1], (2000 + 0.7071f * 3000 + 0.7071f * 6000 + 0.7071f * 8000) * scale, 1e-6);
+}
+
+TEST(PCMConverterTest, DownmixedSineKeepsItsLevelWhenResampling)
+{
+    const size_t inputFrames = 48000;
+    auto input = Sine(1000.0, 48000, 6, inputFrames, 0.25);
+
+    PCMConverter converter;
+    converter.Configure(PCMConverter::SampleFormat::F32, 6, 48000, OutputRate, 480);
+
+    auto output = Convert(converter, input.data(), 6 * sizeof(float), inputFrames, 480);
+
+    // Each output channel gets its front, the center and one surround channel.
+    float peak{0.0f};
+    for (size_t frame = 256; frame < output.size() / 2; frame++)
+    {
+        peak = std::max(peak, std::abs(output[frame * 2]));
+    }
+    EXPECT_NEAR(peak, 0.25f * (1.0f + 2.0f * 0.7071f), 0.01f);
+    EXPECT_GT(SignalToNoiseRatio(output, 0, 1000.0, 256), 60.0);
+}
+
+TEST(PCMConverterTest, BlockSizeDoesNotChangeTheOutput)
+{
+    const size_t inputFrames = 9600;
+    auto input = Sine(997.0, 48000, 2, inputFrames);
+
+    PCMConverter reference;
+    reference.Configure(PCMConverter::SampleFormat::F32, 2, 48000, OutputRate, 1024);
+    auto expected = Convert(reference, input.data(), 2 * sizeof(float), inputFrames, 1024);
+
+    for (size_t blockFrames : {1, 7, 64, 333, 1000})
+    {
+        PCMConverter converter;
+        converter.Configure(PCMConverter::SampleFormat::F32, 2, 48000, OutputRate, 1024);
+        auto output = Convert(converter, input.data(), 2 * sizeof(float), inputFrames, blockFrames);
+
+        ASSERT_EQ(output.size(), expected.size()) << "block size " << blockFrames;
+        for (size_t sample = 0; sample < expected.size(); sample++)
+        {
+            ASSERT_EQ(output[sample], expected[sample]) << "block size " << blockFrames << ", sample " << sample;
+        }
+    }
+}
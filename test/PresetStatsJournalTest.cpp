@@ -0,0 +1,93 @@
+#include "PresetStatsJournal.h"
+
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/Process.h>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+
+namespace {
+
+class PresetStatsJournalTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        _directory = ::testing::TempDir() + "projectMSDL-stats-" + std::to_string(Poco::Process::id()) + Poco::Path::separator();
+        Poco::File(_directory).createDirectories();
+    }
+
+    void TearDown() override
+    {
+        Poco::File(_directory).remove(true);
+    }
+
+    void WriteJournal(const std::string& contents)
+    {
+        std::ofstream journal(_directory + "dbpresets.journal", std::ios::binary);
+        journal << contents;
+    }
+
+    std::string _directory; //!< Database directory, including a trailing separator.
+};
+
+} // namespace
+
+TEST_F(PresetStatsJournalTest, WritesAllRecordsAppendedBeforeClose)
+{
+    PresetStatsJournal::StatsMap stats;
+
+    PresetStatsJournal journal;
+    journal.Open(_directory, stats);
+    for (int index = 0; index < 500; index++)
+    {
+        journal.Append("preset" + std::to_string(index) + ".milk", {index % 6, index});
+    }
+    journal.Close();
+
+    journal.Open(_directory, stats);
+    journal.Close();
+
+    ASSERT_EQ(stats.size(), 500U);
+    EXPECT_EQ(stats["preset499.milk"].rating, 499 % 6);
+    EXPECT_EQ(stats["preset499.milk"].playcount, 499);
+}
+
+TEST_F(PresetStatsJournalTest, IgnoresTornLastRecord)
+{
+    WriteJournal("5 3 complete.milk\n2 1 torn");
+
+    PresetStatsJournal::StatsMap stats;
+
+    PresetStatsJournal journal;
+    journal.Open(_directory, stats);
+    journal.Close();
+
+    ASSERT_EQ(stats.size(), 1U);
+    EXPECT_EQ(stats["complete.milk"].rating, 5);
+    EXPECT_EQ(stats["complete.milk"].playcount, 3);
+}
+
+TEST_F(PresetStatsJournalTest, DoesNotCompleteTornRecordWhenAppending)
+{
+    // Only a torn record, so the journal isn't compacted on open and new records are appended to it.
+    WriteJournal("2 1 torn");
+
+    PresetStatsJournal::StatsMap stats;
+
+    PresetStatsJournal journal;
+    journal.Open(_directory, stats);
+    EXPECT_TRUE(stats.empty());
+    journal.Append("next.milk", {4, 1});
+    journal.Close();
+
+    journal.Open(_directory, stats);
+    journal.Close();
+
+    ASSERT_EQ(stats.size(), 1U);
+    EXPECT_EQ(stats.count("torn"), 0U);
+    EXPECT_EQ(stats["next.milk"].rating, 4);
+}
@@ -0,0 +1,103 @@
+#include "PresetStatsStore.h"
+
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/Process.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Returns a sorted list of preset names, like the ones found in a large preset collection.
+ */
+std::vector<std::string> PresetNames(size_t count)
+{
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        // Zero-padded, so the numeric order is also the byte order required by the writer.
+        char name[64];
+        std::snprintf(name, sizeof(name), "Author %08zu - Some preset name with a typical length.milk", index);
+        names.emplace_back(name);
+    }
+
+    return names;
+}
+
+/**
+ * @brief Writes a store file with the given number of records, deleted when going out of scope.
+ */
+class StoreFile
+{
+public:
+    explicit StoreFile(const std::vector<std::string>& names)
+        : _path(Poco::Path::temp() + "projectMSDL-benchmark-" + std::to_string(Poco::Process::id()) + "-" + std::to_string(names.size()) + ".bin")
+    {
+        PresetStatsStore::Writer writer;
+        for (size_t index = 0; index < names.size(); index++)
+        {
+            writer.Add(names[index], {static_cast<int>(index % 6), static_cast<int>(index)});
+        }
+
+        FILE* file = std::fopen(_path.c_str(), "wb");
+        if (file)
+        {
+            writer.Write(file);
+            std::fclose(file);
+        }
+    }
+
+    ~StoreFile()
+    {
+        Poco::File(_path).remove();
+    }
+
+    const std::string& Path() const
+    {
+        return _path;
+    }
+
+private:
+    std::string _path;
+};
+
+} // namespace
+
+// Startup cost of the snapshot, which must not depend on the collection size.
+static void BM_PresetStatsStore_Open(benchmark::State& state)
+{
+    StoreFile file(PresetNames(static_cast<size_t>(state.range(0))));
+
+    PresetStatsStore store;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(store.Open(file.Path()));
+        store.Close();
+    }
+}
+BENCHMARK(BM_PresetStatsStore_Open)->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+
+// Binary search on the mapped file, as done once per preset switch for presets not changed since the last compaction.
+static void BM_PresetStatsStore_Find(benchmark::State& state)
+{
+    auto names = PresetNames(static_cast<size_t>(state.range(0)));
+    StoreFile file(names);
+
+    PresetStatsStore store;
+    store.Open(file.Path());
+
+    size_t index{0};
+    DBPreset stats;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(store.Find(names[index], stats));
+        index = (index + 7919) % names.size();
+    }
+}
+BENCHMARK(BM_PresetStatsStore_Find)->Arg(1000)->Arg(100000)->Arg(1000000);
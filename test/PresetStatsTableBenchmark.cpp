@@ -0,0 +1,164 @@
+#include "PresetStatsTable.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Returns a list of preset paths, as returned for the items of a large playlist.
+ */
+std::vector<std::string> PresetPaths(size_t count)
+{
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/usr/share/projectM/presets/Author %08zu - Some preset name with a typical length.milk", index);
+        paths.emplace_back(path);
+    }
+
+    return paths;
+}
+
+/**
+ * @brief Returns the stats of all presets, as loaded from the preset stats database.
+ */
+PresetStatsJournal::StatsMap PresetStats(const std::vector<std::string>& paths)
+{
+    PresetStatsJournal::StatsMap stats;
+    for (size_t index = 0; index < paths.size(); index++)
+    {
+        stats.emplace(paths[index], DBPreset{static_cast<int>(index % 6), static_cast<int>(index)});
+    }
+
+    return stats;
+}
+
+/**
+ * @brief Playlist index of the next preset switch, jumping around like shuffle mode does.
+ */
+size_t NextIndex(size_t index, size_t count)
+{
+    return (index + 7919) % count;
+}
+
+} // namespace
+
+// The journal is never opened, so it neither finds presets nor writes records. All presets are in the
+// table or map, and persisting changes is excluded on both sides.
+
+/**
+ * @brief Preset switch with the previous name-keyed std::map, which was searched once for the stats
+ *        and again when storing the changed stats.
+ *
+ * Argument: number of presets with stats.
+ */
+static void BM_PresetSwitch_NameLookup(benchmark::State& state)
+{
+    auto paths = PresetPaths(static_cast<size_t>(state.range(0)));
+    auto stats = PresetStats(paths);
+
+    size_t index{0};
+    for (auto _ : state)
+    {
+        std::string presetName(paths[index].c_str());
+
+        auto& presetStats = stats.find(presetName)->second;
+        ++presetStats.playcount;
+        benchmark::DoNotOptimize(presetStats.rating);
+
+        benchmark::DoNotOptimize(stats.find(presetName));
+
+        index = NextIndex(index, paths.size());
+    }
+}
+BENCHMARK(BM_PresetSwitch_NameLookup)->Arg(1000)->Arg(10000)->Arg(100000);
+
+/**
+ * @brief Preset switch via the preset ID cached for each playlist item, as done by ProjectMWrapper.
+ *
+ * All playlist items were resolved before, as after the first switch to each item.
+ *
+ * Argument: number of presets with stats.
+ */
+static void BM_PresetSwitch_PresetId(benchmark::State& state)
+{
+    auto paths = PresetPaths(static_cast<size_t>(state.range(0)));
+
+    PresetStatsJournal journal;
+    PresetStatsTable table(journal);
+    table.Merge(PresetStats(paths));
+    for (size_t index = 0; index < paths.size(); index++)
+    {
+        table.PlaylistItem(index, table.Intern(paths[index], {}));
+    }
+
+    size_t index{0};
+    for (auto _ : state)
+    {
+        std::string presetName(paths[index].c_str());
+
+        auto presetId = table.PlaylistItem(index);
+        if (presetId == PresetStatsTable::InvalidId)
+        {
+            presetId = table.Intern(presetName, {});
+            table.PlaylistItem(index, presetId);
+        }
+
+        auto& presetStats = table.Stats(presetId);
+        ++presetStats.playcount;
+        benchmark::DoNotOptimize(presetStats.rating);
+
+        table.MarkDirty(presetId);
+
+        index = NextIndex(index, paths.size());
+    }
+}
+BENCHMARK(BM_PresetSwitch_PresetId)->Arg(1000)->Arg(10000)->Arg(100000);
+
+/**
+ * @brief Per-frame rating and play count reads of the overlay with the previous name-keyed std::map.
+ *
+ * Argument: number of presets with stats.
+ */
+static void BM_PresetOverlay_NameLookup(benchmark::State& state)
+{
+    auto paths = PresetPaths(static_cast<size_t>(state.range(0)));
+    auto stats = PresetStats(paths);
+    const auto& presetName = paths[paths.size() / 2];
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(stats.find(presetName)->second.rating);
+        benchmark::DoNotOptimize(stats.find(presetName)->second.playcount);
+    }
+}
+BENCHMARK(BM_PresetOverlay_NameLookup)->Arg(1000)->Arg(10000)->Arg(100000);
+
+/**
+ * @brief Per-frame rating and play count reads of the overlay via the current preset's ID.
+ *
+ * Argument: number of presets with stats.
+ */
+static void BM_PresetOverlay_PresetId(benchmark::State& state)
+{
+    auto paths = PresetPaths(static_cast<size_t>(state.range(0)));
+
+    PresetStatsJournal journal;
+    PresetStatsTable table(journal);
+    table.Merge(PresetStats(paths));
+    auto presetId = table.Find(paths[paths.size() / 2]);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(table.Stats(presetId).rating);
+        benchmark::DoNotOptimize(table.Stats(presetId).playcount);
+    }
+}
+BENCHMARK(BM_PresetOverlay_PresetId)->Arg(1000)->Arg(10000)->Arg(100000);
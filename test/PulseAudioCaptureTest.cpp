@@ -0,0 +1,217 @@
+#include "AudioCaptureImpl_PulseAudio.h"
+
+#include "AudioMixer.h"
+
+#include <Poco/AutoPtr.h>
+
+#include <Poco/Util/Application.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr const char* NullSinkName{"projectMSDL_test"};
+constexpr const char* MonitorDescription{"Monitor of projectMSDL-Test"};
+
+/**
+ * @brief Mixer which keeps the samples of input 0 instead of passing them to projectM.
+ */
+class CapturingMixer : public AudioMixer
+{
+public:
+    void MoveSamples(std::vector<float>& destination)
+    {
+        auto& samples = _inputs.at(0).samples;
+        destination.insert(destination.end(), samples.begin(), samples.end());
+        samples.clear();
+    }
+};
+
+/**
+ * @brief Polls a condition until it's true or the timeout has passed.
+ */
+bool WaitUntil(const std::function<bool()>& condition, std::chrono::milliseconds timeout = std::chrono::seconds(5))
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        if (condition())
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return condition();
+}
+
+/**
+ * @brief Runs a shell command and returns the first line of its output.
+ */
+bool RunCommand(const std::string& command, std::string& output)
+{
+    auto pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr)
+    {
+        return false;
+    }
+
+    char line[256]{};
+    output = std::fgets(line, sizeof(line), pipe) != nullptr ? line : "";
+    return pclose(pipe) == 0;
+}
+
+/**
+ * @brief Captures from the monitor of a null sink loaded for the test, so no audio hardware is required.
+ *
+ * Skipped if no PulseAudio server (or PipeWire's PulseAudio server) is running, or pactl isn't installed.
+ */
+class PulseAudioCaptureTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::string output;
+        if (!RunCommand("pactl info 2>/dev/null", output))
+        {
+            GTEST_SKIP() << "No PulseAudio server available.";
+        }
+
+        if (!RunCommand(std::string("pactl load-module module-null-sink sink_name=") + NullSinkName +
+                            " sink_properties=device.description=projectMSDL-Test 2>/dev/null",
+                        output))
+        {
+            GTEST_SKIP() << "Could not load the null sink module.";
+        }
+        _moduleIndex = std::atoi(output.c_str());
+    }
+
+    void TearDown() override
+    {
+        UnloadNullSink();
+    }
+
+    void UnloadNullSink()
+    {
+        if (_moduleIndex < 0)
+        {
+            return;
+        }
+
+        std::string output;
+        RunCommand("pactl unload-module " + std::to_string(_moduleIndex), output);
+        _moduleIndex = -1;
+    }
+
+    /**
+     * @brief Returns the device index of the null sink's monitor, -2 if not listed.
+     */
+    static int MonitorIndex(PulseAudioCapture& capture)
+    {
+        for (const auto& device : capture.AudioDeviceList())
+        {
+            if (device.second == MonitorDescription)
+            {
+                return device.first;
+            }
+        }
+
+        return -2;
+    }
+
+    /**
+     * @brief Plays a stereo sine into the null sink using pacat.
+     */
+    static void PlaySine(float amplitude, std::chrono::milliseconds duration)
+    {
+        auto player = popen((std::string("pacat --playback --raw --format=float32le --rate=44100 --channels=2 --device=") + NullSinkName).c_str(), "w");
+        if (player == nullptr)
+        {
+            return;
+        }
+
+        size_t frames = static_cast<size_t>(duration.count()) * 44100 / 1000;
+        std::vector<float> samples(frames * 2);
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            float sample = amplitude * static_cast<float>(std::sin(2.0 * Pi * 1000.0 * static_cast<double>(frame) / 44100.0));
+            samples[frame * 2] = sample;
+            samples[frame * 2 + 1] = sample;
+        }
+
+        std::fwrite(samples.data(), sizeof(float), samples.size(), player);
+        pclose(player);
+    }
+
+    Poco::AutoPtr<Poco::Util::Application> _application{new Poco::Util::Application}; //!< Provides the configuration.
+    int _moduleIndex{-1}; //!< Index of the loaded null sink module, -1 if not loaded.
+};
+
+} // namespace
+
+TEST_F(PulseAudioCaptureTest, CapturesAudioPlayedIntoNullSink)
+{
+    PulseAudioCapture capture;
+    ASSERT_TRUE(capture.Connected());
+
+    ASSERT_TRUE(WaitUntil([&capture]() { return MonitorIndex(capture) >= 0; }));
+
+    CapturingMixer mixer;
+    mixer.Inputs(1);
+    capture.Mixer(&mixer, 0);
+    capture.StartRecording(nullptr, MonitorIndex(capture));
+
+    std::thread player(&PulseAudioCaptureTest::PlaySine, 0.5f, std::chrono::milliseconds(1000));
+
+    // Collect half a second of audio, as the render thread would.
+    std::vector<float> captured;
+    float peak{0.0f};
+    WaitUntil([&]() {
+        size_t previousSize = captured.size();
+        capture.FillBuffer();
+        mixer.MoveSamples(captured);
+        for (size_t index = previousSize; index < captured.size(); index++)
+        {
+            peak = std::max(peak, std::abs(captured[index]));
+        }
+        return peak > 0.0f && captured.size() >= 44100;
+    });
+
+    player.join();
+    capture.StopRecording();
+
+    EXPECT_EQ(capture.AudioDeviceName(), MonitorDescription);
+    EXPECT_NEAR(peak, 0.5f, 0.05f);
+    EXPECT_EQ(capture.BufferOverruns(), 0U);
+}
+
+TEST_F(PulseAudioCaptureTest, FallsBackToDefaultDeviceIfSourceIsRemoved)
+{
+    PulseAudioCapture capture;
+    ASSERT_TRUE(capture.Connected());
+
+    ASSERT_TRUE(WaitUntil([&capture]() { return MonitorIndex(capture) >= 0; }));
+    auto listVersion = capture.AudioDeviceListVersion();
+
+    capture.StartRecording(nullptr, MonitorIndex(capture));
+    EXPECT_EQ(capture.AudioDeviceName(), MonitorDescription);
+
+    UnloadNullSink();
+
+    EXPECT_TRUE(WaitUntil([&capture]() { return capture.AudioDeviceIndex() == -1; }));
+    EXPECT_GT(capture.AudioDeviceListVersion(), listVersion);
+    EXPECT_EQ(MonitorIndex(capture), -2);
+
+    capture.StopRecording();
+}